@@ -0,0 +1,710 @@
+const std = @import("std");
+const cascade = @import("dsp/cascade.zig");
+const shared = @import("dsp/shared.zig");
+
+// Loudness and balance analysis behind analyze_audio_comprehensive, built
+// from chunk-local accumulators that merge exactly, so long files can be
+// streamed through in bounded memory or split across threads; and the
+// gated integrated loudness the normalizers work to.
+
+/// Values written by Stats.write, in order.
+pub const result_len = 14;
+
+/// Frames per filter pass; the planar scratch lives on the stack.
+const block_frames = 256;
+const lanes = 8;
+/// Short-term (3 s) and momentary (400 ms) windows, in 100 ms hops.
+const short_term_hops = 30;
+const momentary_hops = 4;
+/// Hops a window reaches back past the one it ends on.
+const edge_hops = short_term_hops - 1;
+/// Chunks per worker thread, so a slow chunk doesn't hold up the rest, and
+/// the smallest chunk worth its warm-up.
+const chunks_per_thread = 4;
+const min_chunk_hops = 100;
+
+/// Frames a chunk that starts mid-stream should run its filters over
+/// before its first frame (see Accumulator.warmup). The slowest pole, the
+/// K-weighting high-pass (r ~ 0.995 at 48 kHz), has decayed by ~40
+/// e-folds after 8192 frames at 48 kHz; its time constant is fixed in
+/// seconds, so higher rates need proportionally more.
+pub fn warmupFrames(sample_rate: f32) usize {
+    const scale = std.math.clamp(@ceil(sample_rate / 48000.0), 1.0, 16.0);
+    return 8192 * @as(usize, @intFromFloat(scale));
+}
+
+/// One-pole lowpass y += alpha * (x - y) as a biquad section.
+fn onePole(cutoff: f32, sample_rate: f32) cascade.Coefficients {
+    const alpha = 1.0 - std.math.exp(-2.0 * std.math.pi * cutoff / sample_rate);
+    return .{ .b0 = alpha, .b1 = 0, .b2 = 0, .a1 = alpha - 1.0, .a2 = 0 };
+}
+
+pub fn hopFrames(sample_rate: f32) usize {
+    return @max(@as(usize, @intFromFloat(sample_rate * 0.1)), 1);
+}
+
+fn blockLoudness(mean_energy: f64) f32 {
+    return if (mean_energy > 1e-10) @floatCast(-0.691 + 10.0 * std.math.log10(mean_energy)) else -100.0;
+}
+
+/// Mean of a window of hop energies.
+fn windowMean(hops: []const f32) f64 {
+    var sum: f64 = 0;
+    for (hops) |h| sum += h;
+    return sum / @as(f64, @floatFromInt(hops.len));
+}
+
+/// Short-term loudness values above the absolute gate (-70 LUFS), in
+/// 0.01 LU bins up to +10 LUFS. Fixed size, so an hour costs no more than a
+/// minute, and two histograms merge by adding counts. Percentiles read from
+/// it are bin centres, within 0.005 LU of the exact values.
+const Histogram = struct {
+    const floor: f32 = -70.0;
+    const bins_per_lu = 100;
+    const bins = 80 * bins_per_lu;
+
+    counts: [bins]u32 = [_]u32{0} ** bins,
+
+    fn add(self: *Histogram, lufs: f32) void {
+        if (!(lufs > floor)) return;
+        const bin: usize = @intFromFloat(@min((lufs - floor) * bins_per_lu, bins - 1));
+        self.counts[bin] += 1;
+    }
+
+    fn merge(self: *Histogram, other: *const Histogram) void {
+        for (&self.counts, other.counts) |*c, o| c.* += o;
+    }
+
+    fn centre(bin: usize) f32 {
+        return floor + (@as(f32, @floatFromInt(bin)) + 0.5) / bins_per_lu;
+    }
+
+    /// Spread between the 10th and 95th percentile of the values above
+    /// `gate`, or 0 with fewer than two of them.
+    fn range(self: *const Histogram, gate: f32) f32 {
+        // First bin whose centre is above the gate
+        const edge = @floor((gate - floor) * bins_per_lu - 0.5) + 1.0;
+        const first: usize = @intFromFloat(std.math.clamp(edge, 0, bins));
+        var valid: u64 = 0;
+        for (self.counts[first..]) |c| valid += c;
+        if (valid <= 1) return 0;
+
+        const count: f32 = @floatFromInt(valid);
+        const p10 = self.nth(first, @intFromFloat(count * 0.10));
+        const p95 = self.nth(first, @intFromFloat(count * 0.95));
+        return p95 - p10;
+    }
+
+    fn nth(self: *const Histogram, first: usize, n: u64) f32 {
+        var seen: u64 = 0;
+        for (first..bins) |bin| {
+            seen += self.counts[bin];
+            if (seen > n) return centre(bin);
+        }
+        return centre(bins - 1);
+    }
+};
+
+/// analyze_audio_comprehensive's results, in output order.
+pub const Stats = struct {
+    lufs_integrated: f32,
+    lra: f32, // Loudness Range (Macrodynamics)
+    peak_db: f32,
+    rms_db: f32,
+    crest_factor: f32, // Microdynamics (Peak - RMS)
+    correlation: f32, // Phase coherence
+    stereo_width: f32, // Side / Mid ratio
+    balance: f32, // L vs R energy (-1.0 to 1.0)
+    dc_offset: f32,
+    spec_low: f32, // Bass energy (<250Hz)
+    spec_mid: f32, // Mid energy (250Hz - 4kHz)
+    spec_high: f32, // High energy (>4kHz)
+    lufs_momentary_max: f32,
+    lufs_short_term_max: f32,
+
+    pub fn write(self: Stats, out: []f32) void {
+        inline for (std.meta.fields(Stats), 0..) |field, i| out[i] = @field(self, field.name);
+    }
+};
+
+/// Planar scratch for one block: the input (mono duplicated to both
+/// channels), its K-weighted version and the two band-split lowpasses.
+const Block = struct {
+    x: [2][block_frames]f32,
+    weighted: [2][block_frames]f32,
+    low: [2][block_frames]f32,
+    smooth: [2][block_frames]f32,
+    energy: [block_frames]f32,
+};
+
+/// Running analysis of one stretch of interleaved audio. Feed it with
+/// push(); join it to the accumulator of the stretch that follows with
+/// merge(), which gives exactly what pushing both stretches through one
+/// accumulator would (up to float summation order, and filter warm-up, see
+/// warmup()). Only the first two channels are analysed; mono is treated as
+/// a centred stereo pair.
+///
+/// Short-term and momentary windows that reach back past the start see
+/// silence there, as a meter starting from rest would. Windows that reach
+/// into an earlier stretch are settled when the two are merged, from the
+/// first and last edge_hops hop energies each accumulator keeps.
+pub const Accumulator = struct {
+    stride: usize,
+    stereo: bool,
+    hop_frames: usize,
+    weighting: cascade.Cascade(2) = .{},
+    /// 250 Hz and 4 kHz one-poles: low L, low R, smooth L, smooth R
+    bands: cascade.Cascade(1) = .{},
+
+    frames: u64 = 0,
+    peak: f32 = 0,
+    sum_sq_raw: f64 = 0,
+    sum_sq_weighted: f64 = 0,
+    sum_dc: [2]f64 = .{ 0, 0 },
+    sum_l_sq: f64 = 0,
+    sum_r_sq: f64 = 0,
+    sum_lr: f64 = 0,
+    sum_mid_sq: f64 = 0,
+    sum_side_sq: f64 = 0,
+    energy_low: f64 = 0,
+    energy_high: f64 = 0,
+
+    hop_energy: f64 = 0,
+    hop_fill: usize = 0,
+    hops: usize = 0,
+    /// Mean weighted energy of the first and the last edge_hops hops,
+    /// oldest first
+    head: [edge_hops]f32 = [_]f32{0} ** edge_hops,
+    tail: [edge_hops]f32 = [_]f32{0} ** edge_hops,
+
+    max_momentary: f32 = -100.0,
+    max_short_term: f32 = -100.0,
+    short_term: Histogram = .{},
+
+    pub fn init(channels: usize, sample_rate: f32) Accumulator {
+        var self: Accumulator = .{
+            .stride = @max(channels, 1),
+            .stereo = channels >= 2,
+            .hop_frames = hopFrames(sample_rate),
+        };
+        const weighting = kWeighting(sample_rate);
+        self.weighting.setSection(0, weighting[0]);
+        self.weighting.setSection(1, weighting[1]);
+        self.weighting.snap();
+        const low = onePole(250.0, sample_rate);
+        const smooth = onePole(4000.0, sample_rate);
+        for (0..2) |c| {
+            self.bands.setSectionChannel(0, c, low);
+            self.bands.setSectionChannel(0, 2 + c, smooth);
+        }
+        self.bands.snap();
+        return self;
+    }
+
+    /// Runs the filters over the audio just before this accumulator's
+    /// stretch without counting it, so a chunk starting mid-stream begins
+    /// from (to float precision) the filter state a single pass would have.
+    /// warmupFrames is enough.
+    pub fn warmup(self: *Accumulator, interleaved: []const f32) void {
+        var block: Block = undefined;
+        var pos: usize = 0;
+        const frames = interleaved.len / self.stride;
+        while (pos < frames) : (pos += block_frames) {
+            const n = @min(block_frames, frames - pos);
+            self.filter(interleaved[pos * self.stride ..], n, &block);
+        }
+    }
+
+    pub fn push(self: *Accumulator, interleaved: []const f32) void {
+        var block: Block = undefined;
+        var pos: usize = 0;
+        const frames = interleaved.len / self.stride;
+        while (pos < frames) : (pos += block_frames) {
+            const n = @min(block_frames, frames - pos);
+            self.filter(interleaved[pos * self.stride ..], n, &block);
+            self.accumulate(&block, n);
+        }
+    }
+
+    fn filter(self: *Accumulator, interleaved: []const f32, n: usize, block: *Block) void {
+        for (0..n) |i| {
+            const frame = interleaved[i * self.stride ..];
+            block.x[0][i] = frame[0];
+            block.x[1][i] = if (self.stereo) frame[1] else frame[0];
+        }
+        const x = [2][*]const f32{ &block.x[0], &block.x[1] };
+        var weighted = [2][*]f32{ &block.weighted[0], &block.weighted[1] };
+        self.weighting.processChannels(&x, &weighted, 2, n);
+        const band_inputs = [4][*]const f32{ x[0], x[1], x[0], x[1] };
+        var band_outputs = [4][*]f32{ &block.low[0], &block.low[1], &block.smooth[0], &block.smooth[1] };
+        self.bands.processChannels(&band_inputs, &band_outputs, 4, n);
+    }
+
+    fn accumulate(self: *Accumulator, block: *Block, n: usize) void {
+        const V = @Vector(lanes, f32);
+        const D = @Vector(lanes, f64);
+        const zero: D = @splat(0);
+
+        // Silence past the end adds nothing to any sum
+        const padded = std.mem.alignForward(usize, n, lanes);
+        for (0..2) |c| {
+            @memset(block.x[c][n..padded], 0);
+            @memset(block.weighted[c][n..padded], 0);
+            @memset(block.low[c][n..padded], 0);
+            @memset(block.smooth[c][n..padded], 0);
+        }
+
+        var peak: V = @splat(0);
+        var raw = zero;
+        var dc_l = zero;
+        var dc_r = zero;
+        var ll = zero;
+        var rr = zero;
+        var lr = zero;
+        var mid = zero;
+        var side = zero;
+        var low = zero;
+        var high = zero;
+        var i: usize = 0;
+        while (i < padded) : (i += lanes) {
+            const l: V = block.x[0][i..][0..lanes].*;
+            const r: V = block.x[1][i..][0..lanes].*;
+            const kl: V = block.weighted[0][i..][0..lanes].*;
+            const kr: V = block.weighted[1][i..][0..lanes].*;
+            const lo_l: V = block.low[0][i..][0..lanes].*;
+            const lo_r: V = block.low[1][i..][0..lanes].*;
+            const hi_l = l - @as(V, block.smooth[0][i..][0..lanes].*);
+            const hi_r = r - @as(V, block.smooth[1][i..][0..lanes].*);
+            const half: V = @splat(0.5);
+            const m = (l + r) * half;
+            const s = (l - r) * half;
+
+            block.energy[i..][0..lanes].* = kl * kl + kr * kr;
+            peak = @max(peak, @max(@abs(l), @abs(r)));
+            raw += @floatCast(l * l + r * r);
+            dc_l += @floatCast(l);
+            dc_r += @floatCast(r);
+            ll += @floatCast(l * l);
+            rr += @floatCast(r * r);
+            lr += @floatCast(l * r);
+            mid += @floatCast(m * m);
+            side += @floatCast(s * s);
+            low += @floatCast(lo_l * lo_l + lo_r * lo_r);
+            high += @floatCast(hi_l * hi_l + hi_r * hi_r);
+        }
+
+        self.frames += n;
+        self.peak = @max(self.peak, @reduce(.Max, peak));
+        self.sum_sq_raw += @reduce(.Add, raw) / @as(f64, if (self.stereo) 2 else 1);
+        self.sum_dc[0] += @reduce(.Add, dc_l);
+        self.sum_dc[1] += @reduce(.Add, dc_r);
+        if (self.stereo) {
+            self.sum_l_sq += @reduce(.Add, ll);
+            self.sum_r_sq += @reduce(.Add, rr);
+            self.sum_lr += @reduce(.Add, lr);
+            self.sum_mid_sq += @reduce(.Add, mid);
+            self.sum_side_sq += @reduce(.Add, side);
+        }
+        self.energy_low += @reduce(.Add, low);
+        self.energy_high += @reduce(.Add, high);
+
+        // Weighted energy, split at hop boundaries
+        i = 0;
+        while (i < n) {
+            const take = @min(self.hop_frames - self.hop_fill, n - i);
+            var sum: f64 = 0;
+            for (block.energy[i .. i + take]) |e| sum += e;
+            self.hop_energy += sum;
+            self.sum_sq_weighted += sum;
+            self.hop_fill += take;
+            i += take;
+            if (self.hop_fill == self.hop_frames) {
+                self.completeHop(@floatCast(self.hop_energy / @as(f64, @floatFromInt(self.hop_frames))));
+                self.hop_energy = 0;
+                self.hop_fill = 0;
+            }
+        }
+    }
+
+    fn completeHop(self: *Accumulator, energy: f32) void {
+        var window: [short_term_hops]f32 = undefined;
+        window[0..edge_hops].* = self.tail;
+        window[edge_hops] = energy;
+        self.addWindows(&window, self.hops);
+
+        if (self.hops < edge_hops) self.head[self.hops] = energy;
+        std.mem.copyForwards(f32, self.tail[0 .. edge_hops - 1], self.tail[1..]);
+        self.tail[edge_hops - 1] = energy;
+        self.hops += 1;
+    }
+
+    /// Counts the windows ending on the last hop of `window`, hop `end` of
+    /// this accumulator, that lie wholly inside it.
+    fn addWindows(self: *Accumulator, window: *const [short_term_hops]f32, end: usize) void {
+        if (end >= short_term_hops - 1) self.addShortTerm(blockLoudness(windowMean(window)));
+        if (end >= momentary_hops - 1) self.addMomentary(blockLoudness(windowMean(window[short_term_hops - momentary_hops ..])));
+    }
+
+    fn addShortTerm(self: *Accumulator, lufs: f32) void {
+        self.short_term.add(lufs);
+        self.max_short_term = @max(self.max_short_term, lufs);
+    }
+
+    fn addMomentary(self: *Accumulator, lufs: f32) void {
+        self.max_momentary = @max(self.max_momentary, lufs);
+    }
+
+    /// Appends `next`, the accumulator of the stretch straight after this
+    /// one, and takes over its filter state so pushing can carry on. This
+    /// stretch must end on a hop boundary and both must share a layout and
+    /// rate.
+    pub fn merge(self: *Accumulator, next: *const Accumulator) error{Incompatible}!void {
+        if (self.hop_fill != 0 or self.stride != next.stride or self.hop_frames != next.hop_frames) {
+            return error.Incompatible;
+        }
+
+        // Windows ending on next's first hops reach back into this stretch
+        for (0..@min(next.hops, edge_hops)) |j| {
+            var window: [short_term_hops]f32 = undefined;
+            @memcpy(window[0 .. edge_hops - j], self.tail[j..]);
+            @memcpy(window[edge_hops - j ..], next.head[0 .. j + 1]);
+            const end = self.hops + j;
+            if (end >= short_term_hops - 1) self.addShortTerm(blockLoudness(windowMean(&window)));
+            if (j < momentary_hops - 1 and end >= momentary_hops - 1) {
+                self.addMomentary(blockLoudness(windowMean(window[short_term_hops - momentary_hops ..])));
+            }
+        }
+
+        if (self.hops < edge_hops) {
+            const from_next = @min(edge_hops - self.hops, next.hops);
+            @memcpy(self.head[self.hops..][0..from_next], next.head[0..from_next]);
+        }
+        if (next.hops >= edge_hops) {
+            self.tail = next.tail;
+        } else {
+            const keep = edge_hops - next.hops;
+            std.mem.copyForwards(f32, self.tail[0..keep], self.tail[next.hops..]);
+            @memcpy(self.tail[keep..], next.tail[keep..]);
+        }
+
+        self.frames += next.frames;
+        self.peak = @max(self.peak, next.peak);
+        self.sum_sq_raw += next.sum_sq_raw;
+        self.sum_sq_weighted += next.sum_sq_weighted;
+        self.sum_dc[0] += next.sum_dc[0];
+        self.sum_dc[1] += next.sum_dc[1];
+        self.sum_l_sq += next.sum_l_sq;
+        self.sum_r_sq += next.sum_r_sq;
+        self.sum_lr += next.sum_lr;
+        self.sum_mid_sq += next.sum_mid_sq;
+        self.sum_side_sq += next.sum_side_sq;
+        self.energy_low += next.energy_low;
+        self.energy_high += next.energy_high;
+        self.max_momentary = @max(self.max_momentary, next.max_momentary);
+        self.max_short_term = @max(self.max_short_term, next.max_short_term);
+        self.short_term.merge(&next.short_term);
+        self.hops += next.hops;
+
+        self.weighting = next.weighting;
+        self.bands = next.bands;
+        self.hop_energy = next.hop_energy;
+        self.hop_fill = next.hop_fill;
+    }
+
+    /// Results for everything pushed so far. A trailing partial hop counts
+    /// towards the totals but not the windows.
+    pub fn result(self: *const Accumulator) Stats {
+        var short_term = self.short_term;
+        var max_short_term = self.max_short_term;
+        var max_momentary = self.max_momentary;
+        for (0..@min(self.hops, edge_hops)) |j| {
+            var window = [_]f32{0} ** short_term_hops;
+            @memcpy(window[edge_hops - j ..], self.head[0 .. j + 1]);
+            const st = blockLoudness(windowMean(&window));
+            short_term.add(st);
+            max_short_term = @max(max_short_term, st);
+            if (j < momentary_hops - 1) {
+                max_momentary = @max(max_momentary, blockLoudness(windowMean(window[short_term_hops - momentary_hops ..])));
+            }
+        }
+
+        const total: f64 = @floatFromInt(@max(self.frames, 1));
+        const lufs_int = -0.691 + 10.0 * std.math.log10((self.sum_sq_weighted / total) + 1e-10);
+        const gate: f32 = @floatCast(@max(lufs_int - 20.0, -70.0));
+
+        const rms_db = 20.0 * std.math.log10(std.math.sqrt(self.sum_sq_raw / total) + 1e-10);
+        const peak_db = 20.0 * std.math.log10(@as(f64, self.peak) + 1e-10);
+
+        var correlation: f32 = 1.0;
+        if (self.sum_l_sq * self.sum_r_sq > 0) {
+            correlation = @floatCast(self.sum_lr / std.math.sqrt(self.sum_l_sq * self.sum_r_sq));
+        }
+        var width: f32 = 0.0;
+        if (self.sum_mid_sq + self.sum_side_sq > 0) {
+            width = @floatCast(self.sum_side_sq / (self.sum_mid_sq + self.sum_side_sq));
+        }
+        var balance: f32 = 0.0;
+        if (self.sum_l_sq + self.sum_r_sq > 0) {
+            balance = @floatCast((self.sum_r_sq - self.sum_l_sq) / (self.sum_r_sq + self.sum_l_sq));
+        }
+
+        const energy_mid = @max(self.sum_sq_raw - self.energy_low - self.energy_high, 0);
+        const total_spec = self.energy_low + energy_mid + self.energy_high + 1e-10;
+        const dc_l = self.sum_dc[0] / total;
+        const dc_r = self.sum_dc[1] / total;
+
+        return .{
+            .lufs_integrated = @floatCast(lufs_int),
+            .lra = short_term.range(gate),
+            .peak_db = @floatCast(peak_db),
+            .rms_db = @floatCast(rms_db),
+            .crest_factor = @floatCast(peak_db - rms_db),
+            .correlation = correlation,
+            .stereo_width = width,
+            .balance = balance,
+            .dc_offset = @floatCast(@max(@abs(dc_l), @abs(dc_r))),
+            .spec_low = @floatCast(self.energy_low / total_spec),
+            .spec_mid = @floatCast(energy_mid / total_spec),
+            .spec_high = @floatCast(self.energy_high / total_spec),
+            .lufs_momentary_max = max_momentary,
+            .lufs_short_term_max = max_short_term,
+        };
+    }
+};
+
+fn runChunk(part: *Accumulator, interleaved: []const f32, stride: usize, sample_rate: f32, start: usize, end: usize) void {
+    part.* = Accumulator.init(stride, sample_rate);
+    const lead = @min(start, warmupFrames(sample_rate));
+    part.warmup(interleaved[(start - lead) * stride .. start * stride]);
+    part.push(interleaved[start * stride .. end * stride]);
+}
+
+/// Analyses a whole interleaved buffer on `threads` threads (the caller's
+/// included). The buffer is cut into a fixed number of hop-aligned chunks
+/// per thread, whatever its length, each analysed from a warm-up on its own
+/// accumulator, and the accumulators merged in order.
+pub fn analyzeParallel(gpa: std.mem.Allocator, interleaved: []const f32, channels: usize, sample_rate: f32, threads: usize) !Stats {
+    const stride = @max(channels, 1);
+    const frames = interleaved.len / stride;
+    const hop = hopFrames(sample_rate);
+    const wanted = if (threads > 1) threads * chunks_per_thread else 1;
+    const hops_per_chunk = @max(std.math.divCeil(usize, std.math.divCeil(usize, frames, wanted) catch unreachable, hop) catch unreachable, min_chunk_hops);
+    const chunk = hops_per_chunk * hop;
+    const count = @max(std.math.divCeil(usize, frames, chunk) catch unreachable, 1);
+
+    const parts = try gpa.alloc(Accumulator, count);
+    defer gpa.free(parts);
+    if (threads <= 1 or count == 1) {
+        for (parts, 0..) |*part, c| runChunk(part, interleaved, stride, sample_rate, c * chunk, @min((c + 1) * chunk, frames));
+    } else {
+        var pool: std.Thread.Pool = undefined;
+        const jobs: u32 = @intCast(@min(threads, count) - 1);
+        try pool.init(.{ .allocator = gpa, .n_jobs = jobs });
+        defer pool.deinit();
+        var wg: std.Thread.WaitGroup = .{};
+        for (parts, 0..) |*part, c| {
+            pool.spawnWg(&wg, runChunk, .{ part, interleaved, stride, sample_rate, c * chunk, @min((c + 1) * chunk, frames) });
+        }
+        pool.waitAndWork(&wg);
+    }
+
+    for (parts[1..]) |*part| parts[0].merge(part) catch unreachable;
+    return parts[0].result();
+}
+
+/// BS.1770 K-weighting for any rate, from the standard's analogue
+/// prototypes by bilinear transform with the corners prewarped: the head
+/// shelf, then the RLB high-pass. At 48 kHz this gives the coefficients
+/// the standard tabulates (shelf b0 1.53512486, high-pass a1 -1.99004745).
+pub fn kWeighting(sample_rate: f32) [2]cascade.Coefficients {
+    const fs: f64 = sample_rate;
+    var k = @tan(std.math.pi * 1681.974450955533 / fs);
+    var q: f64 = 0.7071752369554196;
+    const vh = std.math.pow(f64, 10.0, 3.999843853973347 / 20.0);
+    const vb = std.math.pow(f64, vh, 0.4996667741545416);
+    var a0 = 1.0 + k / q + k * k;
+    const head: cascade.Coefficients = .{
+        .b0 = @floatCast((vh + vb * k / q + k * k) / a0),
+        .b1 = @floatCast(2.0 * (k * k - vh) / a0),
+        .b2 = @floatCast((vh - vb * k / q + k * k) / a0),
+        .a1 = @floatCast(2.0 * (k * k - 1.0) / a0),
+        .a2 = @floatCast((1.0 - k / q + k * k) / a0),
+    };
+
+    k = @tan(std.math.pi * 38.13547087602444 / fs);
+    q = 0.5003270373238773;
+    a0 = 1.0 + k / q + k * k;
+    const rlb: cascade.Coefficients = .{
+        .b0 = 1.0, .b1 = -2.0, .b2 = 1.0,
+        .a1 = @floatCast(2.0 * (k * k - 1.0) / a0),
+        .a2 = @floatCast((1.0 - k / q + k * k) / a0),
+    };
+    return .{ head, rlb };
+}
+
+/// Gating blocks (400 ms, every 100 ms) by loudness, in 0.1 LU bins from the
+/// absolute gate up to +30 LUFS. Each bin keeps its blocks' summed energy
+/// as well as their count, so the gated mean is exact except for blocks in
+/// the one bin the relative gate falls in.
+const BlockHistogram = struct {
+    const floor: f32 = -70.0;
+    const bins_per_lu = 10;
+    const bins = 100 * bins_per_lu;
+
+    counts: [bins]u32 = [_]u32{0} ** bins,
+    energy: [bins]f64 = [_]f64{0} ** bins,
+
+    fn add(self: *BlockHistogram, mean_energy: f64) void {
+        const lufs = blockLoudness(mean_energy);
+        if (!(lufs > floor)) return;
+        const bin: usize = @intFromFloat(@min((lufs - floor) * bins_per_lu, bins - 1));
+        self.counts[bin] += 1;
+        self.energy[bin] += mean_energy;
+    }
+
+    /// Loudness of the blocks from `first` up, or null if there are none.
+    fn meanFrom(self: *const BlockHistogram, first: usize) ?f32 {
+        var count: u64 = 0;
+        var energy: f64 = 0;
+        for (self.counts[first..], self.energy[first..]) |c, e| {
+            count += c;
+            energy += e;
+        }
+        if (count == 0) return null;
+        return blockLoudness(energy / @as(f64, @floatFromInt(count)));
+    }
+
+    fn integrated(self: *const BlockHistogram) ?f32 {
+        const ungated = self.meanFrom(0) orelse return null;
+        // Bins whose centre is above the relative gate
+        const edge = @floor((ungated - 10.0 - floor) * bins_per_lu - 0.5) + 1.0;
+        return self.meanFrom(@intFromFloat(std.math.clamp(edge, 0, bins)));
+    }
+};
+
+/// BS.1770 integrated loudness of a stream of up to shared.max_channels
+/// channels (all weighted 1), in constant memory: K-weighting at the
+/// stream's rate, 400 ms blocks overlapping by 75%, absolute gate at
+/// -70 LUFS and relative gate 10 LU below the blocks above it.
+pub const GatedLoudness = struct {
+    const block_hops = 4;
+
+    channels: usize,
+    hop_frames: usize,
+    weighting: cascade.Cascade(2) = .{},
+    hop_energy: f64 = 0,
+    hop_fill: usize = 0,
+    /// Energies of the last block_hops - 1 hops, oldest first
+    recent: [block_hops - 1]f64 = [_]f64{0} ** (block_hops - 1),
+    hops: usize = 0,
+    /// Mean energy of the last complete 400 ms block
+    last_block: f64 = 0,
+    blocks: BlockHistogram = .{},
+
+    pub fn init(channels: usize, sample_rate: f32) GatedLoudness {
+        var self: GatedLoudness = .{
+            .channels = std.math.clamp(channels, 1, shared.max_channels),
+            .hop_frames = hopFrames(sample_rate),
+        };
+        const sections = kWeighting(sample_rate);
+        self.weighting.setSection(0, sections[0]);
+        self.weighting.setSection(1, sections[1]);
+        self.weighting.snap();
+        return self;
+    }
+
+    /// Frames left in the current 100 ms hop; integrated() can only change
+    /// when one completes.
+    pub fn untilHop(self: *const GatedLoudness) usize {
+        return self.hop_frames - self.hop_fill;
+    }
+
+    pub fn pushPlanar(self: *GatedLoudness, inputs: [*]const [*]const f32, frames: usize) void {
+        var ins: [shared.max_channels][*]const f32 = undefined;
+        var pos: usize = 0;
+        while (pos < frames) : (pos += block_frames) {
+            for (0..self.channels) |c| ins[c] = inputs[c] + pos;
+            self.pushBlock(&ins, @min(block_frames, frames - pos));
+        }
+    }
+
+    pub fn pushInterleaved(self: *GatedLoudness, interleaved: []const f32) void {
+        var planar: [shared.max_channels][block_frames]f32 = undefined;
+        var ins: [shared.max_channels][*]const f32 = undefined;
+        for (0..self.channels) |c| ins[c] = &planar[c];
+        const frames = interleaved.len / self.channels;
+        var pos: usize = 0;
+        while (pos < frames) : (pos += block_frames) {
+            const n = @min(block_frames, frames - pos);
+            for (0..n) |i| {
+                const frame = interleaved[(pos + i) * self.channels ..][0..self.channels];
+                for (frame, 0..) |s, c| planar[c][i] = s;
+            }
+            self.pushBlock(&ins, n);
+        }
+    }
+
+    fn pushBlock(self: *GatedLoudness, inputs: [*]const [*]const f32, n: usize) void {
+        var weighted: [shared.max_channels][block_frames]f32 = undefined;
+        var outs: [shared.max_channels][*]f32 = undefined;
+        for (0..self.channels) |c| outs[c] = &weighted[c];
+        self.weighting.processChannels(inputs, &outs, self.channels, n);
+
+        var energy: [block_frames]f32 = [_]f32{0} ** block_frames;
+        for (weighted[0..self.channels]) |*channel| {
+            for (energy[0..n], channel[0..n]) |*e, k| e.* += k * k;
+        }
+
+        var i: usize = 0;
+        while (i < n) {
+            const take = @min(self.untilHop(), n - i);
+            for (energy[i .. i + take]) |e| self.hop_energy += e;
+            self.fillHop(take);
+            i += take;
+        }
+    }
+
+    /// Frames of digital silence, counted into the hops without running
+    /// the K-weighting over them: for a meter whose plugin was skipped
+    /// because its tail had died away.
+    pub fn pushSilence(self: *GatedLoudness, frames: usize) void {
+        var left = frames;
+        while (left > 0) {
+            const take = @min(self.untilHop(), left);
+            self.fillHop(take);
+            left -= take;
+        }
+    }
+
+    fn fillHop(self: *GatedLoudness, frames: usize) void {
+        self.hop_fill += frames;
+        if (self.hop_fill < self.hop_frames) return;
+        self.completeHop(self.hop_energy / @as(f64, @floatFromInt(self.hop_frames)));
+        self.hop_energy = 0;
+        self.hop_fill = 0;
+    }
+
+    fn completeHop(self: *GatedLoudness, energy: f64) void {
+        if (self.hops >= block_hops - 1) {
+            var sum = energy;
+            for (self.recent) |e| sum += e;
+            self.last_block = sum / block_hops;
+            self.blocks.add(self.last_block);
+        }
+        std.mem.copyForwards(f64, self.recent[0 .. block_hops - 2], self.recent[1..]);
+        self.recent[block_hops - 2] = energy;
+        self.hops += 1;
+    }
+
+    /// Gated loudness of everything pushed so far in LUFS, or null until a
+    /// block above the absolute gate has been seen.
+    pub fn integrated(self: *const GatedLoudness) ?f32 {
+        return self.blocks.integrated();
+    }
+
+    /// Momentary loudness (the last 400 ms block, ungated) in LUFS; -100
+    /// until a block completes. Moves once per 100 ms hop.
+    pub fn momentary(self: *const GatedLoudness) f32 {
+        return blockLoudness(self.last_block);
+    }
+};
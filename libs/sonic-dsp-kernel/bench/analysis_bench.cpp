@@ -0,0 +1,64 @@
+// Loudness analysis throughput: loudness_analyze on 1 to 16 threads over
+// ten minutes of stereo noise at 48 kHz, against one accumulator fed the
+// same audio in 4096-frame blocks.
+//
+// Reports wall time, how many times faster than real time, the speedup
+// over one thread, and how far the integrated loudness and LRA move from
+// the streamed result (they should stay within float noise and one 0.01 LU
+// histogram bin).
+
+#include "bench_host.h"
+#include "loudness_analysis.h"
+#include <cmath>
+
+using namespace bench;
+
+static const float kSampleRate = 48000.0f;
+static const size_t kFrames = (size_t)(600 * kSampleRate);
+static const size_t kBlock = 4096;
+static const uint32_t kThreads[] = { 1, 2, 4, 8, 12, 16 };
+static const int kRuns = 3;
+
+int main() {
+    std::vector<float> audio(kFrames * 2);
+    fillNoise(audio, 1);
+    // Slow swell so the windows and LRA aren't flat
+    for (size_t i = 0; i < kFrames; i++) {
+        const float gain = 0.05f + 0.2f * (0.5f + 0.5f * sinf(2.0f * (float)M_PI * (float)i / (40.0f * kSampleRate)));
+        audio[2 * i] *= gain;
+        audio[2 * i + 1] *= gain;
+    }
+    const double seconds = (double)kFrames / kSampleRate;
+
+    float streamed[14];
+    void* acc = loudness_analysis_create(2, kSampleRate);
+    auto start = Clock::now();
+    for (size_t pos = 0; pos < kFrames; pos += kBlock) {
+        loudness_analysis_push(acc, audio.data() + 2 * pos, pos + kBlock < kFrames ? kBlock : kFrames - pos);
+    }
+    const double streamNs = elapsedNs(start);
+    loudness_analysis_result(acc, streamed);
+    loudness_analysis_destroy(acc);
+
+    printf("%-10s %10s %12s %9s %12s %10s\n", "threads", "ms", "x realtime", "speedup", "d integrated", "d lra");
+    printf("%-10s %10.1f %12.0f %9s %12s %10s\n", "streamed", streamNs / 1e6, seconds / (streamNs / 1e9), "-", "-",
+           "-");
+    double single = 0.0;
+    for (uint32_t threads : kThreads) {
+        float result[14];
+        double best = 0.0;
+        for (int run = 0; run < kRuns; run++) {
+            start = Clock::now();
+            if (loudness_analyze(audio.data(), kFrames, 2, kSampleRate, threads, result) != 0) {
+                fprintf(stderr, "analysis_bench: loudness_analyze failed on %u threads\n", threads);
+                return 1;
+            }
+            const double ns = elapsedNs(start);
+            if (run == 0 || ns < best) best = ns;
+        }
+        if (threads == 1) single = best;
+        printf("%-10u %10.1f %12.0f %9.2f %12.5f %10.3f\n", threads, best / 1e6, seconds / (best / 1e9),
+               single / best, fabsf(result[0] - streamed[0]), fabsf(result[1] - streamed[1]));
+    }
+    return 0;
+}
@@ -0,0 +1,136 @@
+// Many-instance benchmark for the per-instance arenas.
+//
+// Creates 200 kernel instances, cycling through every class in the suite as
+// a large session would, then processes 256-frame blocks through all of them
+// in turn. Reports the footprint of the prepared instances, the time per
+// instance-block and the hardware cache misses per instance-block from
+// perf_event_open (Linux only).
+//
+// Compare `zig build bench-arena` with `zig build bench-arena
+// -Dinstance-arena=false` (plugins allocating from the shared GPA);
+// bench/run_arena_bench.sh runs both.
+
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+extern "C" {
+    uint32_t plugin_class_count();
+    void* plugin_create_class(uint32_t index, float sample_rate);
+    size_t plugin_instance_footprint(void* instance);
+    int32_t plugin_prepare(void* instance, float sample_rate, size_t max_block);
+    void plugin_process(void* instance, const float* const* inputs, float** outputs, size_t frames);
+    void plugin_destroy(void* instance);
+}
+
+static const int kInstances = 200;
+static const size_t kBlockSize = 256;
+static const int kPasses = 200;
+static const float kSampleRate = 48000.0f;
+
+// Counts hardware events for this thread; reads -1 where the kernel or
+// container does not allow it.
+class EventCounter {
+public:
+    EventCounter(uint32_t type, uint64_t config) {
+        perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = type;
+        attr.config = config;
+        attr.disabled = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        fd = (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+    }
+    ~EventCounter() {
+        if (fd >= 0) close(fd);
+    }
+    void start() {
+        if (fd < 0) return;
+        ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+        ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+    }
+    int64_t stop() {
+        if (fd < 0) return -1;
+        ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+        int64_t count = 0;
+        if (read(fd, &count, sizeof(count)) != sizeof(count)) return -1;
+        return count;
+    }
+
+private:
+    int fd = -1;
+};
+
+static void fillNoise(std::vector<float>& buf, uint32_t seed) {
+    for (float& s : buf) {
+        seed = seed * 1664525u + 1013904223u;
+        s = ((float)(seed >> 8) / 16777216.0f) * 0.5f - 0.25f;
+    }
+}
+
+static void printPerBlock(const char* label, int64_t count, double blocks) {
+    if (count < 0) printf("%-28s %12s\n", label, "n/a");
+    else printf("%-28s %12.1f\n", label, (double)count / blocks);
+}
+
+int main() {
+    uint32_t classCount = plugin_class_count();
+    std::vector<void*> instances;
+    size_t footprint = 0;
+    for (int i = 0; i < kInstances; i++) {
+        uint32_t index = (uint32_t)i % classCount;
+        void* instance = plugin_create_class(index, kSampleRate);
+        if (!instance) {
+            fprintf(stderr, "arena_bench: failed to create class %u\n", index);
+            return 1;
+        }
+        plugin_prepare(instance, kSampleRate, kBlockSize);
+        footprint += plugin_instance_footprint(instance);
+        instances.push_back(instance);
+    }
+
+    std::vector<float> in[2] = { std::vector<float>(kBlockSize), std::vector<float>(kBlockSize) };
+    std::vector<float> out[2] = { std::vector<float>(kBlockSize), std::vector<float>(kBlockSize) };
+    fillNoise(in[0], 1);
+    fillNoise(in[1], 2);
+    const float* inPtrs[2] = { in[0].data(), in[1].data() };
+    float* outPtrs[2] = { out[0].data(), out[1].data() };
+
+    // One untimed pass so first-touch page faults stay out of the numbers
+    for (void* instance : instances) plugin_process(instance, inPtrs, outPtrs, kBlockSize);
+
+    EventCounter cacheMisses(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES);
+    EventCounter l1dMisses(PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                                                   (PERF_COUNT_HW_CACHE_RESULT_MISS << 16));
+    cacheMisses.start();
+    l1dMisses.start();
+    auto start = std::chrono::steady_clock::now();
+    for (int pass = 0; pass < kPasses; pass++) {
+        for (void* instance : instances) plugin_process(instance, inPtrs, outPtrs, kBlockSize);
+    }
+    double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    int64_t llc = cacheMisses.stop();
+    int64_t l1d = l1dMisses.stop();
+
+    double blocks = (double)kPasses * kInstances;
+    printf("%-28s %12d\n", "instances", kInstances);
+    printf("%-28s %12u\n", "classes", classCount);
+    printf("%-28s %12.1f\n", "arena footprint KB", (double)footprint / 1024.0);
+    printf("%-28s %12.1f\n", "ns per instance-block", ns / blocks);
+    printf("%-28s %12.1f\n", "ns per frame", ns / blocks / (double)kBlockSize);
+    printPerBlock("cache misses per block", llc, blocks);
+    printPerBlock("L1D read misses per block", l1d, blocks);
+
+    for (void* instance : instances) plugin_destroy(instance);
+    return std::isfinite(out[0][0]) ? 0 : 1;
+}
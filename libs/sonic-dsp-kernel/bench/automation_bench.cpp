@@ -0,0 +1,77 @@
+// Dense-automation benchmark for PluginWrapper::process.
+// Renders the same stretch of audio at several host buffer sizes, once with
+// static parameters and once with an automation point every few samples on
+// several parameters, and reports the CPU cost of each run.
+
+#include "bench_host.h"
+#include <cmath>
+
+using namespace bench;
+
+static const double kSampleRate = 48000.0;
+static const double kSeconds = 30.0;
+static const int32 kAutomatedParams = 4;
+static const int32 kPointSpacing = 16; // samples between automation points
+
+static double run(int32 blockSize, bool automate) {
+    Plugin plugin;
+    if (!plugin.open(kSampleRate, blockSize)) {
+        fprintf(stderr, "failed to create plugin\n");
+        return 0.0;
+    }
+
+    StereoBlock block(blockSize);
+    fillNoise(block.in[0], 1);
+    fillNoise(block.in[1], 2);
+
+    HostParamChanges changes;
+    for (int32 p = 0; p < kAutomatedParams; p++) {
+        int32 idx;
+        changes.addParameterData(p, idx);
+    }
+    if (automate) block.data.inputParameterChanges = &changes;
+
+    const int64_t totalFrames = (int64_t)(kSampleRate * kSeconds);
+    const int64_t numBlocks = totalFrames / blockSize;
+    double ns = 0.0;
+    int64_t frame = 0;
+
+    for (int64_t b = 0; b < numBlocks; b++) {
+        if (automate) {
+            // Build this block's automation outside the timed region
+            changes.clearPoints();
+            for (int32 p = 0; p < kAutomatedParams; p++) {
+                IParamValueQueue* queue = changes.getParameterData(p);
+                for (int32 off = 0; off < blockSize; off += kPointSpacing) {
+                    double t = (double)(frame + off) / kSampleRate;
+                    double v = 0.5 + 0.5 * std::sin(2.0 * 3.14159265358979 * (0.5 + p) * t);
+                    int32 idx;
+                    queue->addPoint(off, v, idx);
+                }
+            }
+        }
+
+        auto start = Clock::now();
+        plugin.processor->process(block.data);
+        ns += elapsedNs(start);
+        frame += blockSize;
+    }
+
+    plugin.close();
+    return ns / (double)(numBlocks * blockSize);
+}
+
+int main() {
+    const int32 blockSizes[] = { 64, 256, 1024 };
+    const double budgetNs = 1e9 / kSampleRate;
+
+    printf("%-8s %-10s %12s %10s\n", "block", "automation", "ns/sample", "cpu %");
+    for (int32 blockSize : blockSizes) {
+        for (int automate = 0; automate < 2; automate++) {
+            double nsPerSample = run(blockSize, automate != 0);
+            printf("%-8d %-10s %12.2f %9.3f%%\n", blockSize, automate ? "dense" : "static",
+                   nsPerSample, 100.0 * nsPerSample / budgetNs);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,215 @@
+#pragma once
+
+// Minimal in-process VST3 host used by the native benchmarks.
+// It talks to the plugin only through GetPluginFactory(), exactly like a DAW.
+
+#include "vst3_minimal.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <vector>
+
+namespace bench {
+
+using namespace Steinberg;
+using namespace Steinberg::Vst;
+
+class HostParamQueue : public IParamValueQueue {
+public:
+    explicit HostParamQueue(ParamID id) : paramId(id) { points.reserve(1024); }
+
+    int32 SMTG_STDCALL queryInterface(const TUID, void** obj) override { *obj = nullptr; return kNoInterface; }
+    uint32 SMTG_STDCALL addRef() override { return 1; }
+    uint32 SMTG_STDCALL release() override { return 1; }
+
+    ParamID SMTG_STDCALL getParameterId() override { return paramId; }
+    int32 SMTG_STDCALL getPointCount() override { return (int32)points.size(); }
+    tresult SMTG_STDCALL getPoint(int32 index, int32& sampleOffset, ParamValue& value) override {
+        if (index < 0 || index >= (int32)points.size()) return kInvalidArgument;
+        sampleOffset = points[index].offset;
+        value = points[index].value;
+        return kResultOk;
+    }
+    tresult SMTG_STDCALL addPoint(int32 sampleOffset, ParamValue value, int32& index) override {
+        index = (int32)points.size();
+        points.push_back({ sampleOffset, value });
+        return kResultOk;
+    }
+
+    void clear() { points.clear(); }
+
+private:
+    struct Point { int32 offset; ParamValue value; };
+    ParamID paramId;
+    std::vector<Point> points;
+};
+
+class HostParamChanges : public IParameterChanges {
+public:
+    int32 SMTG_STDCALL queryInterface(const TUID, void** obj) override { *obj = nullptr; return kNoInterface; }
+    uint32 SMTG_STDCALL addRef() override { return 1; }
+    uint32 SMTG_STDCALL release() override { return 1; }
+
+    int32 SMTG_STDCALL getParameterCount() override { return (int32)queues.size(); }
+    IParamValueQueue* SMTG_STDCALL getParameterData(int32 index) override {
+        if (index < 0 || index >= (int32)queues.size()) return nullptr;
+        return &queues[index];
+    }
+    IParamValueQueue* SMTG_STDCALL addParameterData(const ParamID& id, int32& index) override {
+        for (size_t i = 0; i < queues.size(); i++) {
+            if (queues[i].getParameterId() == id) { index = (int32)i; return &queues[i]; }
+        }
+        index = (int32)queues.size();
+        queues.emplace_back(id);
+        return &queues.back();
+    }
+
+    void clearPoints() { for (auto& q : queues) q.clear(); }
+
+private:
+    std::vector<HostParamQueue> queues;
+};
+
+struct Plugin {
+    IComponent* component = nullptr;
+    IAudioProcessor* processor = nullptr;
+
+    // classIndex picks the plugin in a SonicSuite build; single-plugin builds have only class 0.
+    // A non-empty arrangement is negotiated for both buses first; open fails if it is refused.
+    // processMode is the ProcessSetup's: kOffline renders as a host's bounce does.
+    bool open(double sampleRate, int32 maxBlock, int32 classIndex = 0, uint64 arrangement = SpeakerArr::kEmpty,
+              int32 processMode = kRealtime) {
+        IPluginFactory* factory = GetPluginFactory();
+        PClassInfo info;
+        if (factory->getClassInfo(classIndex, &info) != kResultOk) return false;
+        void* obj = nullptr;
+        if (factory->createInstance(info.cid, IComponent::iid, &obj) != kResultOk) return false;
+        component = (IComponent*)obj;
+        if (component->queryInterface(IAudioProcessor::iid, &obj) != kResultOk) return false;
+        processor = (IAudioProcessor*)obj;
+        if (arrangement != SpeakerArr::kEmpty &&
+            processor->setBusArrangements(&arrangement, 1, &arrangement, 1) != kResultOk) return false;
+
+        ProcessSetup setup = { processMode, 0, maxBlock, sampleRate };
+        processor->setupProcessing(setup);
+        component->setActive(true);
+        processor->setProcessing(true);
+        return true;
+    }
+
+    void close() {
+        if (processor) { processor->setProcessing(false); processor->release(); }
+        if (component) { component->setActive(false); component->release(); }
+        processor = nullptr;
+        component = nullptr;
+    }
+};
+
+// Planar stereo buffers plus the ProcessData that points at them.
+struct StereoBlock {
+    std::vector<float> in[2];
+    std::vector<float> out[2];
+    float* inPtrs[2];
+    float* outPtrs[2];
+    AudioBusBuffers inBus;
+    AudioBusBuffers outBus;
+    ProcessData data;
+
+    explicit StereoBlock(int32 frames) {
+        for (int ch = 0; ch < 2; ch++) {
+            in[ch].assign(frames, 0.0f);
+            out[ch].assign(frames, 0.0f);
+            inPtrs[ch] = in[ch].data();
+            outPtrs[ch] = out[ch].data();
+        }
+        inBus.numChannels = 2; inBus.silenceFlags = 0; inBus.channelBuffers32 = inPtrs;
+        outBus.numChannels = 2; outBus.silenceFlags = 0; outBus.channelBuffers32 = outPtrs;
+        data = {};
+        data.numSamples = frames;
+        data.numInputs = 1;
+        data.numOutputs = 1;
+        data.inputs = &inBus;
+        data.outputs = &outBus;
+    }
+};
+
+// Planar buffers for a bus of any width, plus the ProcessData that points at them.
+struct BusBlock {
+    std::vector<std::vector<float>> in;
+    std::vector<std::vector<float>> out;
+    std::vector<float*> inPtrs;
+    std::vector<float*> outPtrs;
+    AudioBusBuffers inBus;
+    AudioBusBuffers outBus;
+    ProcessData data;
+
+    BusBlock(int32 channels, int32 frames)
+        : in(channels, std::vector<float>(frames, 0.0f)), out(channels, std::vector<float>(frames, 0.0f)) {
+        for (int32 ch = 0; ch < channels; ch++) {
+            inPtrs.push_back(in[ch].data());
+            outPtrs.push_back(out[ch].data());
+        }
+        inBus.numChannels = channels; inBus.silenceFlags = 0; inBus.channelBuffers32 = inPtrs.data();
+        outBus.numChannels = channels; outBus.silenceFlags = 0; outBus.channelBuffers32 = outPtrs.data();
+        data = {};
+        data.numSamples = frames;
+        data.numInputs = 1;
+        data.numOutputs = 1;
+        data.inputs = &inBus;
+        data.outputs = &outBus;
+    }
+};
+
+// In-memory IBStream, standing in for the host's project file in
+// getState/setState. Reads start from the beginning.
+class MemoryStream : public IBStream {
+public:
+    int32 SMTG_STDCALL queryInterface(const TUID, void** obj) override { *obj = nullptr; return kNoInterface; }
+    uint32 SMTG_STDCALL addRef() override { return 1; }
+    uint32 SMTG_STDCALL release() override { return 1; }
+
+    tresult SMTG_STDCALL read(void* buffer, int32 numBytes, int32* numBytesRead) override {
+        int32 n = std::min(numBytes, (int32)(bytes.size() - pos));
+        memcpy(buffer, bytes.data() + pos, n);
+        pos += n;
+        if (numBytesRead) *numBytesRead = n;
+        return kResultOk;
+    }
+    tresult SMTG_STDCALL write(void* buffer, int32 numBytes, int32* numBytesWritten) override {
+        bytes.insert(bytes.end(), (const uint8*)buffer, (const uint8*)buffer + numBytes);
+        if (numBytesWritten) *numBytesWritten = numBytes;
+        return kResultOk;
+    }
+    tresult SMTG_STDCALL seek(int64 to, int32 mode, int64* result) override {
+        int64 base = mode == kIBSeekCur ? (int64)pos : mode == kIBSeekEnd ? (int64)bytes.size() : 0;
+        pos = (size_t)std::min(std::max(base + to, (int64)0), (int64)bytes.size());
+        if (result) *result = (int64)pos;
+        return kResultOk;
+    }
+    tresult SMTG_STDCALL tell(int64* at) override {
+        if (at) *at = (int64)pos;
+        return kResultOk;
+    }
+
+    void rewind() { pos = 0; }
+
+    std::vector<uint8> bytes;
+
+private:
+    size_t pos = 0;
+};
+
+inline void fillNoise(std::vector<float>& buf, uint32_t seed) {
+    for (auto& s : buf) {
+        seed = seed * 1664525u + 1013904223u;
+        s = ((float)(seed >> 8) / 16777216.0f) * 2.0f - 1.0f;
+    }
+}
+
+using Clock = std::chrono::steady_clock;
+
+inline double elapsedNs(Clock::time_point start) {
+    return (double)std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count();
+}
+
+} // namespace bench
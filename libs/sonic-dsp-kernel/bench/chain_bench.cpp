@@ -0,0 +1,169 @@
+// A six-module channel strip as one sonicchain instance versus six separate
+// plugin instances, through the suite's VST3 wrapper.
+//
+// kTracks tracks each run parametric EQ, compressor, saturation, de-esser,
+// stereo imager and limiter on noise, one track after another per block as
+// a host's mixer does. The separate strips pass audio between inserts in
+// two buffers per track without copying, like a host's insert chain; the
+// chain runs the same modules in 256-frame sub-blocks over its shared
+// scratch. Both start from the wrapper's defaults with oversampling off.
+// Reports CPU milliseconds per second of audio for all tracks at several
+// host block sizes, and the chain's speedup.
+
+#include "bench_host.h"
+#include <cstring>
+#include <memory>
+
+using namespace bench;
+
+extern "C" {
+    uint32_t plugin_class_param_steps(uint32_t index, int32_t param);
+    int32_t plugin_class_oversampling_param(uint32_t index);
+}
+
+static const double kSampleRate = 48000.0;
+static const double kSeconds = 5.0;
+static const int kTracks = 16;
+static const int32 kBlockSizes[] = { 64, 256, 1024, 4096 };
+static const char* const kModules[] = {
+    "sonicparametriceq", "soniccompressor", "sonicsaturation", "sonicdeesser", "sonicstereoimager", "soniclimiter",
+};
+static const int kModuleCount = sizeof(kModules) / sizeof(kModules[0]);
+// Parameter layout (module_chain.zig): one selector per slot, then 16
+// parameters per slot
+static const int32 kChainSlots = 8;
+static const int32 kSlotParams = 16;
+
+static int32 findClass(const char* name) {
+    IPluginFactory* factory = GetPluginFactory();
+    for (int32 c = 0; c < factory->countClasses(); c++) {
+        PClassInfo info;
+        if (factory->getClassInfo(c, &info) == kResultOk && strcmp(info.name, name) == 0) return c;
+    }
+    return -1;
+}
+
+// Six instances, the track's input and the two buffers the inserts hand
+// audio back and forth in: the first reads the input into buffer 1, and
+// after that insert m reads buffer m % 2 + 1 and writes the other one.
+struct Strip {
+    Plugin inserts[kModuleCount];
+    std::vector<float> buf[3][2];
+    float* ptrs[3][2];
+    AudioBusBuffers bus[3];
+    ProcessData data[3];
+
+    Strip(int32 blockSize) {
+        for (int b = 0; b < 3; b++) {
+            for (int ch = 0; ch < 2; ch++) {
+                buf[b][ch].assign(blockSize, 0.0f);
+                ptrs[b][ch] = buf[b][ch].data();
+            }
+            bus[b].numChannels = 2;
+            bus[b].silenceFlags = 0;
+            bus[b].channelBuffers32 = ptrs[b];
+        }
+        static const int route[3][2] = { { 0, 1 }, { 1, 2 }, { 2, 1 } };
+        for (int d = 0; d < 3; d++) {
+            data[d] = {};
+            data[d].numSamples = blockSize;
+            data[d].numInputs = 1;
+            data[d].numOutputs = 1;
+            data[d].inputs = &bus[route[d][0]];
+            data[d].outputs = &bus[route[d][1]];
+        }
+    }
+
+    ProcessData& stage(int m) { return m == 0 ? data[0] : data[1 + (m + 1) % 2]; }
+};
+
+// CPU ms per second of audio for every track, or a negative value on failure
+static double runSeparate(const int32* modules, int32 blockSize) {
+    std::vector<std::unique_ptr<Strip>> strips;
+    for (int t = 0; t < kTracks; t++) {
+        strips.emplace_back(new Strip(blockSize));
+        fillNoise(strips[t]->buf[0][0], 1 + 2 * t);
+        fillNoise(strips[t]->buf[0][1], 2 + 2 * t);
+        for (int m = 0; m < kModuleCount; m++) {
+            if (!strips[t]->inserts[m].open(kSampleRate, blockSize, modules[m])) return -1.0;
+        }
+    }
+    auto pass = [&]() {
+        for (auto& strip : strips) {
+            for (int m = 0; m < kModuleCount; m++) strip->inserts[m].processor->process(strip->stage(m));
+        }
+    };
+    const int blocks = (int)(kSeconds * kSampleRate / blockSize);
+    for (int i = 0; i < 16; i++) pass();
+    auto start = Clock::now();
+    for (int i = 0; i < blocks; i++) pass();
+    const double ns = elapsedNs(start);
+    for (auto& strip : strips) {
+        for (Plugin& p : strip->inserts) p.close();
+    }
+    return ns / 1e6 / kSeconds;
+}
+
+static double runChain(int32 chainIndex, const int32* modules, int32 blockSize) {
+    const double steps = plugin_class_param_steps((uint32_t)chainIndex, 0);
+    std::vector<Plugin> chains(kTracks);
+    std::vector<std::unique_ptr<StereoBlock>> blocks;
+    for (int t = 0; t < kTracks; t++) {
+        if (!chains[t].open(kSampleRate, blockSize, chainIndex)) return -1.0;
+        void* obj = nullptr;
+        chains[t].component->queryInterface(IEditController::iid, &obj);
+        IEditController* controller = (IEditController*)obj;
+        for (int m = 0; m < kModuleCount; m++) {
+            controller->setParamNormalized(m, (modules[m] + 1) / steps);
+            // A slot's parameters start mid-range, like the wrapper's
+            const int32 os = plugin_class_oversampling_param((uint32_t)modules[m]);
+            if (os >= 0) controller->setParamNormalized(kChainSlots + m * kSlotParams + os, 0.0);
+        }
+        controller->release();
+        // What a host does after kLatencyChanged
+        chains[t].component->setActive(false);
+        chains[t].component->setActive(true);
+        blocks.emplace_back(new StereoBlock(blockSize));
+        fillNoise(blocks[t]->in[0], 1 + 2 * t);
+        fillNoise(blocks[t]->in[1], 2 + 2 * t);
+    }
+    auto pass = [&]() {
+        for (int t = 0; t < kTracks; t++) chains[t].processor->process(blocks[t]->data);
+    };
+    const int count = (int)(kSeconds * kSampleRate / blockSize);
+    for (int i = 0; i < 16; i++) pass();
+    auto start = Clock::now();
+    for (int i = 0; i < count; i++) pass();
+    const double ns = elapsedNs(start);
+    for (Plugin& p : chains) p.close();
+    return ns / 1e6 / kSeconds;
+}
+
+int main() {
+    const int32 chainIndex = findClass("sonicchain");
+    int32 modules[kModuleCount];
+    for (int m = 0; m < kModuleCount; m++) {
+        modules[m] = findClass(kModules[m]);
+        if (modules[m] < 0) {
+            fprintf(stderr, "chain_bench: no %s in this build\n", kModules[m]);
+            return 1;
+        }
+    }
+    if (chainIndex < 0) {
+        fprintf(stderr, "chain_bench: no sonicchain in this build\n");
+        return 1;
+    }
+
+    printf("%d tracks x %d modules, CPU ms per second of audio\n", kTracks, kModuleCount);
+    printf("%-8s %12s %12s %8s\n", "block", "separate", "chain", "speedup");
+    for (int32 blockSize : kBlockSizes) {
+        const double separate = runSeparate(modules, blockSize);
+        const double chain = runChain(chainIndex, modules, blockSize);
+        if (separate < 0.0 || chain < 0.0) {
+            fprintf(stderr, "chain_bench: failed to open the plugins\n");
+            return 1;
+        }
+        printf("%-8d %12.2f %12.2f %7.2fx\n", blockSize, separate, chain, separate / chain);
+    }
+    return 0;
+}
@@ -0,0 +1,80 @@
+// Cost per channel of negotiated bus widths through the VST3 wrapper.
+//
+// For every class in the suite, negotiates a mono, a stereo and a 7.1.4
+// (12-channel) arrangement and processes noise at 256-frame blocks. Reports
+// nanoseconds per channel-sample for each width, "-" where the class refuses
+// the arrangement. Classes with vectorised multichannel paths should cost
+// the same or less per channel as the bus widens. Stereo-only classes run
+// mono through the kernel's adapter, which still processes two channels.
+
+#include "bench_host.h"
+
+using namespace bench;
+
+static const double kSampleRate = 48000.0;
+static const int32 kBlockSize = 256;
+static const int kWarmupBlocks = 64;
+static const int kBlocks = 2000;
+
+struct Width {
+    const char* name;
+    uint64 arrangement;
+};
+
+static const Width kWidths[] = {
+    { "mono", SpeakerArr::kMono },
+    { "stereo", SpeakerArr::kStereo },
+    { "7.1.4", SpeakerArr::k71_4 },
+};
+static const int kNumWidths = sizeof(kWidths) / sizeof(kWidths[0]);
+
+// ns per channel-sample, or a negative value if the arrangement was refused
+static double measure(int32 classIndex, uint64 arrangement) {
+    Plugin plugin;
+    if (!plugin.open(kSampleRate, kBlockSize, classIndex, arrangement)) {
+        plugin.close();
+        return -1.0;
+    }
+    const int32 channels = SpeakerArr::getChannelCount(arrangement);
+    BusBlock block(channels, kBlockSize);
+    for (int32 ch = 0; ch < channels; ch++) {
+        fillNoise(block.in[ch], (uint32_t)ch + 1);
+        for (float& s : block.in[ch]) s *= 0.25f;
+    }
+
+    for (int i = 0; i < kWarmupBlocks; i++) plugin.processor->process(block.data);
+    auto start = Clock::now();
+    for (int i = 0; i < kBlocks; i++) plugin.processor->process(block.data);
+    const double ns = elapsedNs(start);
+    plugin.close();
+    return ns / ((double)kBlocks * kBlockSize * channels);
+}
+
+int main() {
+    IPluginFactory* factory = GetPluginFactory();
+    int32 classCount = factory->countClasses();
+
+    printf("%-24s", "class (ns/ch-sample)");
+    for (const Width& w : kWidths) printf(" %10s", w.name);
+    printf(" %12s\n", "12ch/stereo");
+
+    for (int32 c = 0; c < classCount; c++) {
+        double ns[kNumWidths];
+        for (int w = 0; w < kNumWidths; w++) ns[w] = measure(c, kWidths[w].arrangement);
+        if (ns[1] < 0.0) {
+            fprintf(stderr, "channels_bench: class %d refused a stereo bus\n", c);
+            return 1;
+        }
+
+        PClassInfo info;
+        factory->getClassInfo(c, &info);
+        printf("%-24s", info.name);
+        for (int w = 0; w < kNumWidths; w++) {
+            if (ns[w] < 0.0) printf(" %10s", "-");
+            else printf(" %10.2f", ns[w]);
+        }
+        if (ns[2] < 0.0) printf(" %12s\n", "-");
+        else printf(" %12.2f\n", ns[2] / ns[1]);
+    }
+    return 0;
+}
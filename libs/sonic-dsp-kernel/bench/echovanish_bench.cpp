@@ -0,0 +1,149 @@
+// Online WPE dereverberation: peak memory and throughput against input
+// length.
+//
+// For 1, 10 and 60 minutes of noise at 48 kHz, each run in its own process
+// so its peak RSS is its own:
+//   plugin  sonicechovanish through the suite's VST3 wrapper, 4096-frame
+//           blocks generated as they go, so the process never holds the
+//           input;
+//   buffer  echovanish_process over the whole input in one mono buffer,
+//           reported with the buffer's own size taken off.
+// Also prints what the whole-file STFT echovanish used to hold (every frame
+// of every bin) for comparison. Fails if either path's memory grows by
+// more than kMaxGrowthMb from the shortest input to the longest, or if the
+// output stops being finite.
+
+#include "bench_host.h"
+#include "echovanish.h"
+#include <cmath>
+#include <cstring>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+using namespace bench;
+
+static const double kSampleRate = 48000.0;
+static const int kMinutes[] = { 1, 10, 60 };
+static const int32 kBlock = 4096;
+static const float kReduction = 0.8f;
+static const float kTailMs = 150.0f;
+static const double kMaxGrowthMb = 4.0;
+
+struct Result {
+    double ns;
+    double rssMb;
+    int finite;
+};
+
+static int32 findClass(const char* name) {
+    IPluginFactory* factory = GetPluginFactory();
+    for (int32 c = 0; c < factory->countClasses(); c++) {
+        PClassInfo info;
+        if (factory->getClassInfo(c, &info) == kResultOk && strcmp(info.name, name) == 0) return c;
+    }
+    return -1;
+}
+
+static bool allFinite(const float* x, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        if (!std::isfinite(x[i])) return false;
+    }
+    return true;
+}
+
+static bool runPlugin(size_t frames, Result& r) {
+    const int32 classIndex = findClass("sonicechovanish");
+    Plugin plugin;
+    if (classIndex < 0 || !plugin.open(kSampleRate, kBlock, classIndex)) return false;
+    void* obj = nullptr;
+    plugin.component->queryInterface(IEditController::iid, &obj);
+    IEditController* controller = (IEditController*)obj;
+    controller->setParamNormalized(0, kReduction);
+    controller->setParamNormalized(1, (kTailMs - 50.0) / 450.0);
+    controller->release();
+
+    StereoBlock block(kBlock);
+    for (size_t pos = 0; pos < frames; pos += kBlock) {
+        const int32 n = (int32)std::min((size_t)kBlock, frames - pos);
+        fillNoise(block.in[0], (uint32_t)(pos / kBlock));
+        block.in[1] = block.in[0];
+        block.data.numSamples = n;
+        auto start = Clock::now();
+        plugin.processor->process(block.data);
+        r.ns += elapsedNs(start);
+        if (!allFinite(block.out[0].data(), n)) r.finite = 0;
+    }
+    plugin.close();
+    return true;
+}
+
+static bool runBuffer(size_t frames, Result& r) {
+    std::vector<float> audio(frames);
+    fillNoise(audio, 1);
+    auto start = Clock::now();
+    echovanish_process(audio.data(), frames, kSampleRate, kReduction, kTailMs);
+    r.ns = elapsedNs(start);
+    r.finite = allFinite(audio.data(), frames);
+    return true;
+}
+
+// Runs one path in a child process and collects its time and peak RSS
+static bool measure(bool plugin, size_t frames, Result& r) {
+    int fds[2];
+    if (pipe(fds) != 0) return false;
+    const pid_t pid = fork();
+    if (pid < 0) return false;
+    if (pid == 0) {
+        close(fds[0]);
+        Result child = { 0.0, 0.0, 1 };
+        const bool ok = plugin ? runPlugin(frames, child) : runBuffer(frames, child);
+        if (ok && write(fds[1], &child, sizeof(child)) != (ssize_t)sizeof(child)) _exit(1);
+        _exit(ok ? 0 : 1);
+    }
+    close(fds[1]);
+    const bool got = read(fds[0], &r, sizeof(r)) == (ssize_t)sizeof(r);
+    close(fds[0]);
+    int status = 0;
+    struct rusage usage;
+    if (wait4(pid, &status, 0, &usage) != pid || !got || !WIFEXITED(status) || WEXITSTATUS(status) != 0) return false;
+#ifdef __APPLE__
+    r.rssMb = (double)usage.ru_maxrss / (1024.0 * 1024.0);
+#else
+    r.rssMb = (double)usage.ru_maxrss / 1024.0;
+#endif
+    if (!plugin) r.rssMb -= (double)(frames * sizeof(float)) / (1024.0 * 1024.0);
+    return true;
+}
+
+int main() {
+    printf("noise at %.0f Hz, reduction %.1f, %.0f ms tail\n", kSampleRate, kReduction, kTailMs);
+    printf("%-8s %8s %10s %10s %12s %16s\n", "path", "minutes", "s", "realtime", "peak RSS MB", "old STFT MB");
+    int failures = 0;
+    for (int p = 0; p < 2; p++) {
+        const bool plugin = p == 0;
+        double first = 0.0, last = 0.0;
+        for (int minutes : kMinutes) {
+            const size_t frames = (size_t)(minutes * 60 * kSampleRate);
+            Result r;
+            if (!measure(plugin, frames, r)) {
+                fprintf(stderr, "echovanish_bench: %s run failed\n", plugin ? "plugin" : "buffer");
+                return 1;
+            }
+            // The 2048-point spectrogram process_echovanish used to build
+            const double spectrogramMb = (double)((frames - 2048) / 1024 + 1) * 1025 * 8 / (1024.0 * 1024.0);
+            const double seconds = (double)frames / kSampleRate;
+            printf("%-8s %8d %10.1f %9.0fx %12.1f %16.1f%s\n", plugin ? "plugin" : "buffer", minutes, r.ns / 1e9,
+                   seconds / (r.ns / 1e9), r.rssMb, spectrogramMb, r.finite ? "" : "  NOT FINITE");
+            if (!r.finite) failures++;
+            if (minutes == kMinutes[0]) first = r.rssMb;
+            last = r.rssMb;
+        }
+        if (last - first > kMaxGrowthMb) {
+            fprintf(stderr, "echovanish_bench: %s memory grew %.1f MB from %d to %d minutes\n", plugin ? "plugin" : "buffer",
+                    last - first, kMinutes[0], kMinutes[sizeof(kMinutes) / sizeof(kMinutes[0]) - 1]);
+            failures++;
+        }
+    }
+    return failures ? 1 : 0;
+}
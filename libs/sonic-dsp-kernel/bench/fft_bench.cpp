@@ -0,0 +1,67 @@
+// FFT throughput: the old scalar radix-2 transform against the plan-based
+// complex and real-input transforms, for sizes 256 to 65536.
+// Reports ns per transform and MFLOPS using the usual 5 n log2(n) estimate
+// for a complex transform (2.5 n log2(n) for a real one).
+
+#include "bench_host.h"
+#include "fft_plan.h"
+#include <cmath>
+
+using namespace bench;
+
+// Roughly the same amount of work per size
+static int iterationsFor(size_t n) {
+    int iters = (int)((1u << 24) / (n * (size_t)std::log2((double)n)));
+    return iters < 20 ? 20 : iters;
+}
+
+int main() {
+    printf("%-8s %14s %14s %14s %12s %12s %12s\n", "n", "reference ns", "plan ns", "real ns",
+           "ref MFLOPS", "plan MFLOPS", "real MFLOPS");
+    for (size_t n = 256; n <= 65536; n *= 2) {
+        std::vector<float> input(2 * n);
+        fillNoise(input, (uint32_t)n);
+        std::vector<float> data(2 * n);
+        std::vector<float> bins(2 * (n / 2 + 1));
+        void* plan = fft_plan_create(n);
+        void* realPlan = fft_real_plan_create(n);
+        if (!plan || !realPlan) {
+            fprintf(stderr, "fft_bench: failed to create plans for n=%zu\n", n);
+            return 1;
+        }
+        int iters = iterationsFor(n);
+
+        // Forward then inverse keeps the data bounded across iterations
+        data = input;
+        auto start = Clock::now();
+        for (int i = 0; i < iters; i++) {
+            fft_reference_transform(data.data(), n, 0);
+            fft_reference_transform(data.data(), n, 1);
+        }
+        double refNs = elapsedNs(start) / (2.0 * iters);
+
+        data = input;
+        start = Clock::now();
+        for (int i = 0; i < iters; i++) {
+            fft_plan_transform(plan, data.data(), 0);
+            fft_plan_transform(plan, data.data(), 1);
+        }
+        double planNs = elapsedNs(start) / (2.0 * iters);
+
+        std::vector<float> signal(input.begin(), input.begin() + n);
+        start = Clock::now();
+        for (int i = 0; i < iters; i++) {
+            fft_real_forward(realPlan, signal.data(), bins.data());
+            fft_real_inverse(realPlan, bins.data(), signal.data());
+        }
+        double realNs = elapsedNs(start) / (2.0 * iters);
+
+        fft_plan_destroy(plan);
+        fft_real_plan_destroy(realPlan);
+
+        double flops = 5.0 * (double)n * std::log2((double)n);
+        printf("%-8zu %14.0f %14.0f %14.0f %12.0f %12.0f %12.0f\n", n, refNs, planNs, realNs,
+               flops / refNs * 1e3, flops / planNs * 1e3, 0.5 * flops / realNs * 1e3);
+    }
+    return 0;
+}
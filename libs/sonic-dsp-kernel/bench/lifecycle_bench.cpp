@@ -0,0 +1,75 @@
+// Instantiate / prepare benchmark.
+// Measures what a host pays when it loads the plugin and when it reconfigures
+// it, against the old destroy-and-recreate path:
+//   instantiate  factory createInstance + setupProcessing + setActive
+//   recreate     plugin_destroy + plugin_create (what setupProcessing used to do)
+//   prepare      setupProcessing on a live instance, same format
+//   rate change  setupProcessing alternating 44.1 kHz / 48 kHz
+//
+// One plugin per build; bench/run_lifecycle.sh sweeps every plugin in plugins/.
+
+#include "bench_host.h"
+
+using namespace bench;
+
+extern "C" {
+    void* plugin_create(float sample_rate);
+    void plugin_destroy(void* instance);
+}
+
+static const int kIterations = 200;
+static const int32 kMaxBlock = 1024;
+
+int main(int argc, char** argv) {
+    const char* name = argc > 1 ? argv[1] : "plugin";
+
+    double instantiateNs = 0.0;
+    for (int i = 0; i < kIterations; i++) {
+        Plugin plugin;
+        auto start = Clock::now();
+        bool ok = plugin.open(48000.0, kMaxBlock);
+        instantiateNs += elapsedNs(start);
+        if (!ok) {
+            fprintf(stderr, "%s: failed to create plugin\n", name);
+            return 1;
+        }
+        plugin.close();
+    }
+
+    double recreateNs = 0.0;
+    void* instance = plugin_create(48000.0f);
+    for (int i = 0; i < kIterations; i++) {
+        auto start = Clock::now();
+        plugin_destroy(instance);
+        instance = plugin_create(48000.0f);
+        recreateNs += elapsedNs(start);
+    }
+    plugin_destroy(instance);
+
+    Plugin plugin;
+    plugin.open(48000.0, kMaxBlock);
+    ProcessSetup same = { 0, 0, kMaxBlock, 48000.0 };
+    ProcessSetup other = { 0, 0, kMaxBlock, 44100.0 };
+
+    double prepareNs = 0.0;
+    for (int i = 0; i < kIterations; i++) {
+        auto start = Clock::now();
+        plugin.processor->setupProcessing(same);
+        prepareNs += elapsedNs(start);
+    }
+
+    double rateNs = 0.0;
+    for (int i = 0; i < kIterations; i++) {
+        ProcessSetup& setup = (i % 2) ? same : other;
+        auto start = Clock::now();
+        plugin.processor->setupProcessing(setup);
+        rateNs += elapsedNs(start);
+    }
+    plugin.close();
+
+    printf("%-24s %14s %12s %12s %14s\n", "plugin", "instantiate us", "recreate us", "prepare us", "rate change us");
+    printf("%-24s %14.2f %12.2f %12.2f %14.2f\n", name,
+           instantiateNs / kIterations / 1000.0, recreateNs / kIterations / 1000.0,
+           prepareNs / kIterations / 1000.0, rateNs / kIterations / 1000.0);
+    return 0;
+}
@@ -0,0 +1,179 @@
+// What the real-time meters cost the audio thread, per block.
+//
+// For each class in kClasses and each block size, two instances run the
+// same stereo noise: one with plugin_set_metering on, one without. They
+// take turns in runs of kRunBlocks so drift in clock speed hits both, and
+// a reader thread polls the metered one every kPollMs the way a plugin
+// view would. Prints the mean plugin_process time of each, the meters'
+// share per block and per sample, and what a read costs the poller.
+// Fails if a read never succeeds or the metered output differs from the
+// unmetered one: measuring must not touch the audio.
+
+#include "meters.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+extern "C" {
+    uint32_t plugin_class_count();
+    const char* plugin_class_id(uint32_t index);
+    uint32_t plugin_class_param_count(uint32_t index);
+    uint32_t plugin_class_param_steps(uint32_t index, int32_t param);
+    void* plugin_create_class(uint32_t index, float sample_rate);
+    int32_t plugin_prepare(void* instance, float sample_rate, size_t max_block);
+    void plugin_process(void* instance, const float* const* inputs, float** outputs, size_t frames);
+    void plugin_set_parameter(void* instance, int32_t index, float value);
+    void plugin_destroy(void* instance);
+}
+
+static const float kSampleRate = 48000.0f;
+static const size_t kBlocks[] = { 32, 64, 128, 256, 512, 1024 };
+// An empty chain is a copy, so it shows the meters' cost against nothing;
+// the compressor is the class whose gain reduction they read
+static const char* const kClasses[] = { "sonicchain", "soniccompressor", "sonicparametriceq" };
+static const size_t kRunBlocks = 64;
+// Audio per class and block size
+static const double kSeconds = 20.0;
+static const int kPollMs = 16;
+// The wrapper's parameter limit
+static const uint32_t kMaxParams = 256;
+
+using Clock = std::chrono::steady_clock;
+
+static int32_t findClass(const char* id) {
+    for (uint32_t c = 0; c < plugin_class_count(); c++) {
+        if (strcmp(plugin_class_id(c), id) == 0) return (int32_t)c;
+    }
+    return -1;
+}
+
+// At the wrappers' starting values; an empty chain for sonicchain
+static void* openInstance(int32_t index, size_t block, bool metered) {
+    void* instance = plugin_create_class((uint32_t)index, kSampleRate);
+    if (!instance) return nullptr;
+    const uint32_t params = std::min(plugin_class_param_count((uint32_t)index), kMaxParams);
+    for (uint32_t p = 0; p < params; p++) {
+        plugin_set_parameter(instance, (int32_t)p, plugin_class_param_steps((uint32_t)index, (int32_t)p) ? 0.0f : 0.5f);
+    }
+    if ((metered && plugin_set_metering(instance, 1) != 0) || plugin_prepare(instance, kSampleRate, block) != 0) {
+        plugin_destroy(instance);
+        return nullptr;
+    }
+    return instance;
+}
+
+static void fillNoise(std::vector<float>& buf, uint32_t seed) {
+    for (float& s : buf) {
+        seed = seed * 1664525u + 1013904223u;
+        s = ((float)(seed >> 8) / 16777216.0f) * 0.5f - 0.25f;
+    }
+}
+
+struct Stereo {
+    std::vector<float> in[2];
+    std::vector<float> out[2];
+    const float* inPtrs[2];
+    float* outPtrs[2];
+
+    explicit Stereo(size_t frames) {
+        for (int ch = 0; ch < 2; ch++) {
+            in[ch].assign(frames, 0.0f);
+            out[ch].assign(frames, 0.0f);
+            inPtrs[ch] = in[ch].data();
+            outPtrs[ch] = out[ch].data();
+        }
+    }
+};
+
+struct Poller {
+    std::atomic<bool> running{ true };
+    std::atomic<uint64_t> reads{ 0 };
+    std::atomic<double> readNs{ 0.0 };
+    std::thread thread;
+
+    explicit Poller(void* instance) {
+        thread = std::thread([this, instance] {
+            while (running.load(std::memory_order_acquire)) {
+                SonicMeterReadings r;
+                const auto start = Clock::now();
+                const bool ok = plugin_read_meters(instance, &r) == 0;
+                const double ns = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+                if (ok) {
+                    reads.fetch_add(1, std::memory_order_relaxed);
+                    readNs.store(readNs.load(std::memory_order_relaxed) + ns, std::memory_order_relaxed);
+                }
+                std::this_thread::sleep_for(std::chrono::milliseconds(kPollMs));
+            }
+        });
+    }
+    ~Poller() { stop(); }
+
+    void stop() {
+        running.store(false, std::memory_order_release);
+        if (thread.joinable()) thread.join();
+    }
+};
+
+int main() {
+    printf("stereo noise at %.0f Hz, %.0f s per row, a reader polling every %d ms\n", kSampleRate, kSeconds, kPollMs);
+    printf("%-20s %6s %12s %12s %12s %9s %12s %9s\n", "class", "block", "off ns", "on ns", "meters ns", "share", "ns/sample",
+           "read ns");
+    int failures = 0;
+    for (const char* id : kClasses) {
+        const int32_t index = findClass(id);
+        if (index < 0) {
+            fprintf(stderr, "meter_bench: no class %s\n", id);
+            return 1;
+        }
+        for (size_t block : kBlocks) {
+            void* plain = openInstance(index, block, false);
+            void* metered = openInstance(index, block, true);
+            if (!plain || !metered) {
+                fprintf(stderr, "meter_bench: can't open %s\n", id);
+                return 1;
+            }
+            Stereo a(block), b(block);
+            const size_t total = (size_t)(kSeconds * kSampleRate) / block;
+            double ns[2] = { 0.0, 0.0 };
+            bool same = true;
+            {
+                Poller poller(metered);
+                for (size_t run = 0; run < total; run += kRunBlocks) {
+                    const size_t end = std::min(total, run + kRunBlocks);
+                    for (int which = 0; which < 2; which++) {
+                        void* instance = which ? metered : plain;
+                        Stereo& io = which ? b : a;
+                        for (size_t k = run; k < end; k++) {
+                            fillNoise(io.in[0], (uint32_t)(2 * k + 1));
+                            fillNoise(io.in[1], (uint32_t)(2 * k + 2));
+                            const auto start = Clock::now();
+                            plugin_process(instance, io.inPtrs, io.outPtrs, block);
+                            ns[which] += std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+                        }
+                    }
+                    for (int ch = 0; ch < 2; ch++) {
+                        same = same && memcmp(a.out[ch].data(), b.out[ch].data(), sizeof(float) * block) == 0;
+                    }
+                }
+                poller.stop();
+
+                const double off = ns[0] / (double)total;
+                const double on = ns[1] / (double)total;
+                const uint64_t reads = poller.reads.load();
+                printf("%-20s %6zu %12.0f %12.0f %12.0f %8.1f%% %12.2f %9.0f%s\n", id, block, off, on, on - off,
+                       100.0 * (on - off) / off, (on - off) / (double)block,
+                       reads ? poller.readNs.load() / (double)reads : 0.0,
+                       !same ? "  OUTPUT DIFFERS" : (reads == 0 ? "  NO READS" : ""));
+                if (!same || reads == 0) failures++;
+            }
+            plugin_destroy(plain);
+            plugin_destroy(metered);
+        }
+    }
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,101 @@
+// Offline bounce throughput of the heavy spectral classes on 1 to 16
+// threads, through the suite's VST3 wrapper.
+//
+// Each class renders ten minutes of stereo noise at 48 kHz in kOffline mode
+// with 65536-frame host blocks, the thread count set through
+// SONIC_OFFLINE_THREADS. Reports wall time, how many times faster than real
+// time, the speedup over one thread, and whether the output (hashed block
+// by block, outside the timing) is bit-identical to the one-thread render.
+
+#include "bench_host.h"
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+using namespace bench;
+
+static const double kSampleRate = 48000.0;
+static const size_t kFrames = (size_t)(600 * kSampleRate);
+static const int32 kBlock = 65536;
+static const uint32_t kThreads[] = { 1, 2, 4, 8, 12, 16 };
+static const char* const kClasses[] = { "sonicechovanish", "sonicdebleed", "sonicvoiceisolate" };
+
+static int32 findClass(const char* name) {
+    IPluginFactory* factory = GetPluginFactory();
+    for (int32 c = 0; c < factory->countClasses(); c++) {
+        PClassInfo info;
+        if (factory->getClassInfo(c, &info) == kResultOk && strcmp(info.name, name) == 0) return c;
+    }
+    return -1;
+}
+
+static uint64_t hashBlock(uint64_t h, const std::vector<float>& samples, int32 n) {
+    const unsigned char* bytes = (const unsigned char*)samples.data();
+    for (size_t i = 0; i < n * sizeof(float); i++) {
+        h ^= bytes[i];
+        h *= 0x100000001b3ull;
+    }
+    return h;
+}
+
+struct Render {
+    double ns;
+    uint64_t hash;
+};
+
+static bool render(int32 classIndex, uint32_t threads, const std::vector<float>* audio, Render& result) {
+    setenv("SONIC_OFFLINE_THREADS", std::to_string(threads).c_str(), 1);
+    Plugin plugin;
+    const bool opened = plugin.open(kSampleRate, kBlock, classIndex, SpeakerArr::kEmpty, kOffline);
+    unsetenv("SONIC_OFFLINE_THREADS");
+    if (!opened) return false;
+
+    StereoBlock block(kBlock);
+    result = { 0.0, 0xcbf29ce484222325ull };
+    for (size_t pos = 0; pos < kFrames; pos += kBlock) {
+        const int32 n = (int32)std::min((size_t)kBlock, kFrames - pos);
+        for (int ch = 0; ch < 2; ch++) std::copy(audio[ch].begin() + pos, audio[ch].begin() + pos + n, block.in[ch].begin());
+        block.data.numSamples = n;
+        auto start = Clock::now();
+        plugin.processor->process(block.data);
+        result.ns += elapsedNs(start);
+        for (int ch = 0; ch < 2; ch++) result.hash = hashBlock(result.hash, block.out[ch], n);
+    }
+    plugin.close();
+    return true;
+}
+
+int main() {
+    std::vector<float> audio[2];
+    for (int ch = 0; ch < 2; ch++) {
+        audio[ch].resize(kFrames);
+        fillNoise(audio[ch], 1 + ch);
+    }
+    const double seconds = (double)kFrames / kSampleRate;
+
+    printf("%.0f s of stereo noise at %.0f Hz, %d-frame offline blocks\n", seconds, kSampleRate, kBlock);
+    printf("%-20s %8s %10s %10s %8s %10s\n", "class", "threads", "ms", "realtime", "speedup", "identical");
+    int failures = 0;
+    for (const char* name : kClasses) {
+        const int32 classIndex = findClass(name);
+        if (classIndex < 0) {
+            fprintf(stderr, "offline_bench: no %s in this build\n", name);
+            return 1;
+        }
+        Render single;
+        for (uint32_t threads : kThreads) {
+            Render r;
+            if (!render(classIndex, threads, audio, r)) {
+                fprintf(stderr, "offline_bench: failed to open %s\n", name);
+                return 1;
+            }
+            if (threads == 1) single = r;
+            const bool identical = r.hash == single.hash;
+            if (!identical) failures++;
+            printf("%-20s %8u %10.1f %9.0fx %7.2fx %10s\n", name, threads, r.ns / 1e6, seconds / (r.ns / 1e9),
+                   single.ns / r.ns, identical ? "yes" : "NO");
+        }
+    }
+    if (failures) fprintf(stderr, "offline_bench: %d renders differ from one thread\n", failures);
+    return failures ? 1 : 0;
+}
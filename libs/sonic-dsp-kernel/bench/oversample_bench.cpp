@@ -0,0 +1,86 @@
+// Cost of oversampling the nonlinear plugins in the kernel versus running
+// the host faster.
+//
+// For saturation, distortion and bitcrusher, processes ten seconds of noise
+// twice through the VST3 wrapper: at 48 kHz with the plugin's oversampling
+// set to 4x, and at 192 kHz with it off, at the same block duration (256
+// and 1024 frames). Reports CPU milliseconds per second of audio for each,
+// their ratio, and the latency the wrapper reports for the 4x setting. Only
+// the oversampled plugin pays for the higher rate in the first case; in the
+// second every plugin in the chain would.
+
+#include "bench_host.h"
+#include <cstring>
+
+using namespace bench;
+
+extern "C" int32_t plugin_class_oversampling_param(uint32_t index);
+
+static const double kSeconds = 10.0;
+static const char* kClasses[] = { "sonicsaturation", "sonicdistortion", "sonicbitcrusher" };
+
+static int32 findClass(const char* name) {
+    IPluginFactory* factory = GetPluginFactory();
+    for (int32 c = 0; c < factory->countClasses(); c++) {
+        PClassInfo info;
+        if (factory->getClassInfo(c, &info) == kResultOk && strcmp(info.name, name) == 0) return c;
+    }
+    return -1;
+}
+
+// CPU ms per second of audio, or a negative value on failure
+static double measure(int32 classIndex, double sampleRate, int32 blockSize, double osValue, int32* latency) {
+    Plugin plugin;
+    if (!plugin.open(sampleRate, blockSize, classIndex)) {
+        plugin.close();
+        return -1.0;
+    }
+    void* obj = nullptr;
+    if (plugin.component->queryInterface(IEditController::iid, &obj) != kResultOk) {
+        plugin.close();
+        return -1.0;
+    }
+    IEditController* controller = (IEditController*)obj;
+    controller->setParamNormalized(plugin_class_oversampling_param(classIndex), osValue);
+    // What a host does after kLatencyChanged
+    plugin.component->setActive(false);
+    plugin.component->setActive(true);
+    plugin.processor->getLatencySamples(*latency);
+    controller->release();
+
+    StereoBlock block(blockSize);
+    fillNoise(block.in[0], 1);
+    fillNoise(block.in[1], 2);
+    for (int ch = 0; ch < 2; ch++) {
+        for (float& s : block.in[ch]) s *= 0.5f;
+    }
+
+    const int blocks = (int)(kSeconds * sampleRate / blockSize);
+    for (int i = 0; i < 64; i++) plugin.processor->process(block.data);
+    auto start = Clock::now();
+    for (int i = 0; i < blocks; i++) plugin.processor->process(block.data);
+    const double ns = elapsedNs(start);
+    plugin.close();
+    return ns / 1e6 / kSeconds;
+}
+
+int main() {
+    printf("%-18s %14s %14s %8s %12s\n", "class (ms/s)", "48k @ 4x", "192k @ 1x", "ratio", "4x latency");
+    for (const char* name : kClasses) {
+        int32 classIndex = findClass(name);
+        if (classIndex < 0 || plugin_class_oversampling_param((uint32_t)classIndex) < 0) {
+            fprintf(stderr, "oversample_bench: no oversampling class %s in this build\n", name);
+            return 1;
+        }
+        int32 latency4x = 0;
+        int32 latency1x = 0;
+        const double oversampled = measure(classIndex, 48000.0, 256, 2.0 / 3.0, &latency4x);
+        const double fastHost = measure(classIndex, 192000.0, 1024, 0.0, &latency1x);
+        if (oversampled < 0.0 || fastHost < 0.0) {
+            fprintf(stderr, "oversample_bench: failed to run %s\n", name);
+            return 1;
+        }
+        printf("%-18s %14.3f %14.3f %8.2f %9d smp\n", name, oversampled, fastHost, oversampled / fastHost, latency4x);
+    }
+    return 0;
+}
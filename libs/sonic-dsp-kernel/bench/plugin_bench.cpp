@@ -0,0 +1,381 @@
+// Per-plugin processing cost across block sizes and sample rates, straight
+// through the kernel's C ABI, with JSON results and a regression gate.
+//
+// Every class in the library (all of plugins/ plus the module chain in the
+// suite) is created and prepared for each sample rate (44.1 to 192 kHz)
+// and block size (16 to 8192 frames), and processes stereo noise twice:
+// with its parameters held at the wrapper's defaults, and with every
+// continuous parameter swept along its own slow triangle, set before each
+// block as a host's automation would. Stepped settings (oversampling, a
+// chain slot's module) stay at their first step: changing one needs a
+// prepare, not a block. Each run starts with untimed warmup blocks, on a
+// thread pinned to one core where the OS allows it, and times every block
+// (parameter changes included) with the cycle counter the profiler uses:
+// the TSC on x86, the generic timer on arm64, steady_clock elsewhere.
+//
+// Prints a row per run and, with --json FILE, writes them as JSON:
+// ns_per_sample (per stereo frame), ticks_per_sample, xrt (times faster
+// than real time) and the p50 and p99 block times in ns. --compare FILE
+// reads such a file back as the baseline and fails if any class got slower
+// by more than --threshold percent (default 10), taking the geometric mean
+// of its runs' ns_per_sample ratios so one noisy run does not decide it.
+//
+//   zig build bench-plugins -Doptimize=ReleaseFast -- --json baseline.json
+//   zig build bench-plugins -Doptimize=ReleaseFast -- --compare baseline.json
+//
+// Other options: --quick (48 kHz, 64 and 1024 frames), --seconds S of audio
+// per run (default 1), --class NAME to run one class, --cpu N to pin to.
+
+#include "profiler.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#if defined(__linux__)
+#include <sched.h>
+#endif
+
+extern "C" {
+    uint32_t plugin_class_count();
+    const char* plugin_class_id(uint32_t index);
+    uint32_t plugin_class_param_count(uint32_t index);
+    uint32_t plugin_class_param_steps(uint32_t index, int32_t param);
+    void* plugin_create_class(uint32_t index, float sample_rate);
+    int32_t plugin_prepare(void* instance, float sample_rate, size_t max_block);
+    void plugin_process(void* instance, const float* const* inputs, float** outputs, size_t frames);
+    void plugin_set_parameter(void* instance, int32_t index, float value);
+    void plugin_destroy(void* instance);
+}
+
+static const double kSampleRates[] = { 44100.0, 48000.0, 96000.0, 192000.0 };
+static const size_t kBlockSizes[] = { 16, 64, 256, 1024, 4096, 8192 };
+static const double kQuickSampleRates[] = { 48000.0 };
+static const size_t kQuickBlockSizes[] = { 64, 1024 };
+// The wrapper's parameter limit
+static const uint32_t kMaxParams = 256;
+static const double kWarmupSeconds = 0.1;
+static const size_t kMinWarmupBlocks = 16;
+static const double kSweepPeriod = 2.0;
+
+struct Options {
+    bool quick = false;
+    double seconds = 1.0;
+    const char* only = nullptr;
+    int cpu = -1;
+    const char* jsonPath = nullptr;
+    const char* baselinePath = nullptr;
+    double threshold = 10.0;
+};
+
+struct Run {
+    std::string name;
+    double sampleRate;
+    size_t block;
+    bool sweep;
+    double nsPerSample;
+    double ticksPerSample;
+    double xrt;
+    double p50Ns;
+    double p99Ns;
+    size_t blocks;
+    bool finite;
+};
+
+static bool parseOptions(int argc, char** argv, Options& o) {
+    for (int i = 1; i < argc; i++) {
+        const char* a = argv[i];
+        const bool hasValue = i + 1 < argc;
+        if (strcmp(a, "--quick") == 0) o.quick = true;
+        else if (strcmp(a, "--seconds") == 0 && hasValue) o.seconds = atof(argv[++i]);
+        else if (strcmp(a, "--class") == 0 && hasValue) o.only = argv[++i];
+        else if (strcmp(a, "--cpu") == 0 && hasValue) o.cpu = atoi(argv[++i]);
+        else if (strcmp(a, "--json") == 0 && hasValue) o.jsonPath = argv[++i];
+        else if (strcmp(a, "--compare") == 0 && hasValue) o.baselinePath = argv[++i];
+        else if (strcmp(a, "--threshold") == 0 && hasValue) o.threshold = atof(argv[++i]);
+        else {
+            fprintf(stderr, "plugin_bench: unknown option %s\n", a);
+            return false;
+        }
+    }
+    return o.seconds > 0.0 && o.threshold >= 0.0;
+}
+
+// Pins the calling thread; returns the core, or -1 where that isn't possible
+static int pinThread(int cpu) {
+#if defined(__linux__)
+    if (cpu < 0) cpu = sched_getcpu();
+    if (cpu < 0) return -1;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return sched_setaffinity(0, sizeof(set), &set) == 0 ? cpu : -1;
+#else
+    (void)cpu;
+    return -1;
+#endif
+}
+
+static void fillNoise(std::vector<float>& buf, uint32_t seed) {
+    for (float& s : buf) {
+        seed = seed * 1664525u + 1013904223u;
+        s = ((float)(seed >> 8) / 16777216.0f) * 0.5f - 0.25f;
+    }
+}
+
+// The wrapper's starting values: stepped settings at their first step,
+// everything else mid-range
+static void setDefaults(void* instance, uint32_t index, uint32_t params) {
+    for (uint32_t p = 0; p < params; p++) {
+        plugin_set_parameter(instance, (int32_t)p, plugin_class_param_steps(index, (int32_t)p) ? 0.0f : 0.5f);
+    }
+}
+
+// Triangle between 0 and 1, each parameter a different phase
+static float sweepValue(double t, uint32_t param) {
+    const double phase = std::fmod(t / kSweepPeriod + 0.37 * param, 1.0);
+    return (float)(phase < 0.5 ? 2.0 * phase : 2.0 - 2.0 * phase);
+}
+
+static double percentile(std::vector<double>& v, double q) {
+    const size_t k = std::min(v.size() - 1, (size_t)(q * (double)(v.size() - 1) + 0.5));
+    std::nth_element(v.begin(), v.begin() + k, v.end());
+    return v[k];
+}
+
+static bool measure(uint32_t index, double sampleRate, size_t block, bool sweep, const Options& o, double ticksPerNs, Run& run) {
+    void* instance = plugin_create_class(index, (float)sampleRate);
+    if (!instance) return false;
+    const uint32_t params = std::min(plugin_class_param_count(index), kMaxParams);
+    setDefaults(instance, index, params);
+    std::vector<uint32_t> continuous;
+    for (uint32_t p = 0; p < params; p++) {
+        if (plugin_class_param_steps(index, (int32_t)p) == 0) continuous.push_back(p);
+    }
+    if (plugin_prepare(instance, (float)sampleRate, block) != 0) {
+        plugin_destroy(instance);
+        return false;
+    }
+
+    std::vector<float> in[2] = { std::vector<float>(block), std::vector<float>(block) };
+    std::vector<float> out[2] = { std::vector<float>(block), std::vector<float>(block) };
+    const float* inPtrs[2] = { in[0].data(), in[1].data() };
+    float* outPtrs[2] = { out[0].data(), out[1].data() };
+    const size_t warmup = std::max(kMinWarmupBlocks, (size_t)(kWarmupSeconds * sampleRate / block));
+    const size_t timed = std::max((size_t)1, (size_t)(o.seconds * sampleRate / block));
+    std::vector<double> blockNs;
+    blockNs.reserve(timed);
+
+    uint64_t ticks = 0;
+    for (size_t b = 0; b < warmup + timed; b++) {
+        fillNoise(in[0], (uint32_t)(2 * b + 1));
+        fillNoise(in[1], (uint32_t)(2 * b + 2));
+        const uint64_t t0 = sonic_stats::readTicks();
+        if (sweep) {
+            const double t = (double)(b * block) / sampleRate;
+            for (uint32_t p : continuous) plugin_set_parameter(instance, (int32_t)p, sweepValue(t, p));
+        }
+        plugin_process(instance, inPtrs, outPtrs, block);
+        const uint64_t t1 = sonic_stats::readTicks();
+        if (b >= warmup) {
+            ticks += t1 - t0;
+            blockNs.push_back((double)(t1 - t0) / ticksPerNs);
+        }
+    }
+    const bool finite = std::isfinite(out[0][block - 1]) && std::isfinite(out[1][block - 1]);
+    plugin_destroy(instance);
+
+    const double samples = (double)(timed * block);
+    const double ns = (double)ticks / ticksPerNs;
+    run.name = plugin_class_id(index);
+    run.sampleRate = sampleRate;
+    run.block = block;
+    run.sweep = sweep;
+    run.nsPerSample = ns / samples;
+    run.ticksPerSample = (double)ticks / samples;
+    run.xrt = samples / sampleRate / (ns / 1e9);
+    run.p50Ns = percentile(blockNs, 0.5);
+    run.p99Ns = percentile(blockNs, 0.99);
+    run.blocks = timed;
+    run.finite = finite;
+    return true;
+}
+
+static bool writeJson(const char* path, const std::vector<Run>& runs, double ticksPerSecond, int cpu, const Options& o) {
+    FILE* f = fopen(path, "w");
+    if (!f) return false;
+    fprintf(f, "{\n  \"ticks_per_second\": %.0f,\n  \"cpu\": %d,\n  \"seconds\": %g,\n  \"results\": [\n", ticksPerSecond, cpu, o.seconds);
+    for (size_t i = 0; i < runs.size(); i++) {
+        const Run& r = runs[i];
+        fprintf(f,
+                "    {\"class\": \"%s\", \"sample_rate\": %.0f, \"block\": %zu, \"params\": \"%s\", \"ns_per_sample\": %.4f, "
+                "\"ticks_per_sample\": %.4f, \"xrt\": %.2f, \"p50_block_ns\": %.0f, \"p99_block_ns\": %.0f, \"blocks\": %zu}%s\n",
+                r.name.c_str(), r.sampleRate, r.block, r.sweep ? "sweep" : "static", r.nsPerSample, r.ticksPerSample, r.xrt,
+                r.p50Ns, r.p99Ns, r.blocks, i + 1 < runs.size() ? "," : "");
+    }
+    fprintf(f, "  ]\n}\n");
+    return fclose(f) == 0;
+}
+
+// The files are this program's own output, one flat object per run, so a
+// key scan is all the parsing they need
+static bool findString(const std::string& obj, const char* key, std::string& value) {
+    const std::string pattern = std::string("\"") + key + "\": \"";
+    const size_t at = obj.find(pattern);
+    if (at == std::string::npos) return false;
+    const size_t begin = at + pattern.size();
+    const size_t end = obj.find('"', begin);
+    if (end == std::string::npos) return false;
+    value = obj.substr(begin, end - begin);
+    return true;
+}
+
+static bool findNumber(const std::string& obj, const char* key, double& value) {
+    const std::string pattern = std::string("\"") + key + "\": ";
+    const size_t at = obj.find(pattern);
+    if (at == std::string::npos) return false;
+    value = atof(obj.c_str() + at + pattern.size());
+    return true;
+}
+
+static bool readJson(const char* path, std::vector<Run>& runs) {
+    FILE* f = fopen(path, "r");
+    if (!f) return false;
+    std::string text;
+    char buf[4096];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), f)) > 0) text.append(buf, n);
+    fclose(f);
+
+    const size_t results = text.find("\"results\"");
+    if (results == std::string::npos) return false;
+    size_t pos = results;
+    while ((pos = text.find('{', pos)) != std::string::npos) {
+        const size_t end = text.find('}', pos);
+        if (end == std::string::npos) return false;
+        const std::string obj = text.substr(pos, end - pos);
+        Run r;
+        std::string params;
+        double block = 0.0;
+        if (!findString(obj, "class", r.name) || !findString(obj, "params", params) || !findNumber(obj, "sample_rate", r.sampleRate) ||
+            !findNumber(obj, "block", block) || !findNumber(obj, "ns_per_sample", r.nsPerSample)) {
+            return false;
+        }
+        r.block = (size_t)block;
+        r.sweep = params == "sweep";
+        runs.push_back(r);
+        pos = end;
+    }
+    return true;
+}
+
+// Fails every class whose runs got slower than the baseline's by more than
+// the threshold, on the geometric mean
+static int compare(const std::vector<Run>& runs, const std::vector<Run>& baseline, double threshold) {
+    const double limit = 1.0 + threshold / 100.0;
+    int regressions = 0;
+    printf("\nagainst the baseline (limit +%.1f%%):\n%-24s %6s %10s %10s %24s\n", threshold, "class", "runs", "change", "worst", "worst run");
+    size_t i = 0;
+    while (i < runs.size()) {
+        const std::string& name = runs[i].name;
+        double logSum = 0.0;
+        int matched = 0;
+        double worst = 0.0;
+        const Run* worstRun = nullptr;
+        for (; i < runs.size() && runs[i].name == name; i++) {
+            const Run& r = runs[i];
+            for (const Run& b : baseline) {
+                if (b.name != name || b.sampleRate != r.sampleRate || b.block != r.block || b.sweep != r.sweep || !(b.nsPerSample > 0.0)) continue;
+                const double ratio = r.nsPerSample / b.nsPerSample;
+                logSum += std::log(ratio);
+                matched++;
+                if (ratio > worst) {
+                    worst = ratio;
+                    worstRun = &r;
+                }
+                break;
+            }
+        }
+        if (matched == 0) {
+            printf("%-24s %6s %10s\n", name.c_str(), "0", "new");
+            continue;
+        }
+        const double change = std::exp(logSum / matched);
+        char where[64];
+        snprintf(where, sizeof(where), "%.0f Hz %zu %s", worstRun->sampleRate, worstRun->block, worstRun->sweep ? "sweep" : "static");
+        const bool regressed = change > limit;
+        printf("%-24s %6d %+9.1f%% %+9.1f%% %24s%s\n", name.c_str(), matched, (change - 1.0) * 100.0, (worst - 1.0) * 100.0, where,
+               regressed ? "  REGRESSED" : "");
+        if (regressed) regressions++;
+    }
+    return regressions;
+}
+
+int main(int argc, char** argv) {
+    Options o;
+    if (!parseOptions(argc, argv, o)) {
+        fprintf(stderr, "usage: plugin_bench [--quick] [--seconds S] [--class NAME] [--cpu N] [--json FILE] [--compare FILE] [--threshold PCT]\n");
+        return 2;
+    }
+    std::vector<Run> baseline;
+    if (o.baselinePath && !readJson(o.baselinePath, baseline)) {
+        fprintf(stderr, "plugin_bench: cannot read baseline %s\n", o.baselinePath);
+        return 2;
+    }
+
+    const int cpu = pinThread(o.cpu);
+    const double ticksPerSecond = sonic_stats::measureTicksPerSecond();
+    const double ticksPerNs = ticksPerSecond / 1e9;
+    const double* rates = o.quick ? kQuickSampleRates : kSampleRates;
+    const size_t rateCount = o.quick ? sizeof(kQuickSampleRates) / sizeof(double) : sizeof(kSampleRates) / sizeof(double);
+    const size_t* blocks = o.quick ? kQuickBlockSizes : kBlockSizes;
+    const size_t blockCount = o.quick ? sizeof(kQuickBlockSizes) / sizeof(size_t) : sizeof(kBlockSizes) / sizeof(size_t);
+
+    if (cpu >= 0) printf("pinned to cpu %d, ", cpu);
+    else printf("not pinned, ");
+    printf("%.0f ticks per second, %g s of audio per run\n", ticksPerSecond, o.seconds);
+    printf("%-24s %8s %6s %7s %12s %12s %10s %12s\n", "class", "Hz", "block", "params", "ns/sample", "ticks/sample", "xRT", "p99 us");
+
+    std::vector<Run> runs;
+    int failures = 0;
+    for (uint32_t index = 0; index < plugin_class_count(); index++) {
+        if (o.only && strcmp(plugin_class_id(index), o.only) != 0) continue;
+        for (size_t ri = 0; ri < rateCount; ri++) {
+            for (size_t bi = 0; bi < blockCount; bi++) {
+                for (int sweep = 0; sweep < 2; sweep++) {
+                    Run r;
+                    if (!measure(index, rates[ri], blocks[bi], sweep != 0, o, ticksPerNs, r)) {
+                        fprintf(stderr, "plugin_bench: %s failed to set up at %.0f Hz, %zu frames\n", plugin_class_id(index), rates[ri], blocks[bi]);
+                        failures++;
+                        continue;
+                    }
+                    printf("%-24s %8.0f %6zu %7s %12.2f %12.2f %9.0fx %12.1f\n", r.name.c_str(), r.sampleRate, r.block, r.sweep ? "sweep" : "static",
+                           r.nsPerSample, r.ticksPerSample, r.xrt, r.p99Ns / 1e3);
+                    if (!r.finite) {
+                        fprintf(stderr, "plugin_bench: %s output not finite at %.0f Hz, %zu frames\n", r.name.c_str(), r.sampleRate, r.block);
+                        failures++;
+                    }
+                    runs.push_back(r);
+                }
+            }
+        }
+    }
+    if (runs.empty()) {
+        fprintf(stderr, "plugin_bench: nothing ran\n");
+        return 1;
+    }
+    if (o.jsonPath && !writeJson(o.jsonPath, runs, ticksPerSecond, cpu, o)) {
+        fprintf(stderr, "plugin_bench: cannot write %s\n", o.jsonPath);
+        return 1;
+    }
+    if (o.baselinePath) {
+        const int regressions = compare(runs, baseline, o.threshold);
+        if (regressions) fprintf(stderr, "plugin_bench: %d classes slower than the baseline\n", regressions);
+        failures += regressions;
+    }
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,86 @@
+// Overhead of the wrappers' always-on profiling (native/profiler.h).
+//
+// For every class in the suite, runs two instances side by side at 64-frame
+// blocks: one profiled, one created with SONIC_PROFILE=0. They take turns
+// in short bursts on the same input so clock drift and cache state hit both
+// alike. Reports the time per block each way, the overhead per class and
+// over the whole suite, and the cost of a bare begin()/end() pair. The
+// target is under 1% of process time at this block size.
+
+#include "bench_host.h"
+#include "profiler.h"
+#include <cstdlib>
+
+using namespace bench;
+
+static const double kSampleRate = 48000.0;
+static const int32 kBlockSize = 64;
+static const int kRounds = 200;
+static const int kBurst = 64; // blocks per instance per turn
+
+int main() {
+    IPluginFactory* factory = GetPluginFactory();
+    int32 classCount = factory->countClasses();
+
+    StereoBlock block(kBlockSize);
+    fillNoise(block.in[0], 1);
+    fillNoise(block.in[1], 2);
+    for (int ch = 0; ch < 2; ch++) {
+        for (float& s : block.in[ch]) s *= 0.25f;
+    }
+
+    printf("%-24s %12s %12s %10s\n", "class", "off ns/blk", "on ns/blk", "overhead %");
+    double totalOff = 0.0;
+    double totalOn = 0.0;
+    for (int32 c = 0; c < classCount; c++) {
+        Plugin profiled;
+        Plugin plain;
+        bool ok = profiled.open(kSampleRate, kBlockSize, c);
+        setenv("SONIC_PROFILE", "0", 1);
+        ok = plain.open(kSampleRate, kBlockSize, c) && ok;
+        unsetenv("SONIC_PROFILE");
+        if (!ok) {
+            fprintf(stderr, "profile_bench: failed to create class %d\n", c);
+            return 1;
+        }
+
+        double ns[2] = { 0.0, 0.0 };
+        for (int r = 0; r < kRounds; r++) {
+            for (int which = 0; which < 2; which++) {
+                Plugin& p = which ? profiled : plain;
+                auto start = Clock::now();
+                for (int i = 0; i < kBurst; i++) p.processor->process(block.data);
+                ns[which] += elapsedNs(start);
+            }
+        }
+        profiled.close();
+        plain.close();
+
+        const double blocks = (double)kRounds * kBurst;
+        PClassInfo info;
+        factory->getClassInfo(c, &info);
+        printf("%-24s %12.1f %12.1f %10.2f\n", info.name, ns[0] / blocks, ns[1] / blocks,
+               100.0 * (ns[1] - ns[0]) / ns[0]);
+        totalOff += ns[0];
+        totalOn += ns[1];
+    }
+
+    // The instrumentation alone, against a slot of its own
+    sonic_stats::InstanceProfiler probe;
+    probe.attach("profile_bench", (float)kSampleRate, kBlockSize);
+    if (!probe.active()) {
+        fprintf(stderr, "profile_bench: no stats segment (shared memory unavailable?), nothing was profiled\n");
+        return 1;
+    }
+    const int kProbeBlocks = 1000000;
+    auto start = Clock::now();
+    for (int i = 0; i < kProbeBlocks; i++) {
+        probe.begin(0);
+        probe.end(kBlockSize, 0);
+    }
+    const double probeNs = elapsedNs(start) / kProbeBlocks;
+
+    printf("\n%-28s %12.1f\n", "begin/end pair ns", probeNs);
+    printf("%-28s %12.2f  (target < 1%%)\n", "suite overhead %", 100.0 * (totalOn - totalOff) / totalOff);
+    return 0;
+}
@@ -0,0 +1,10 @@
+#!/bin/sh
+# 200-instance benchmark with per-instance arenas and with every plugin
+# allocating from the shared GPA.
+set -e
+cd "$(dirname "$0")/.."
+
+echo "== Per-instance arenas"
+zig build bench-arena -Doptimize=ReleaseFast -Dinstance-arena=true "$@"
+echo "== Shared GPA"
+zig build bench-arena -Doptimize=ReleaseFast -Dinstance-arena=false "$@"
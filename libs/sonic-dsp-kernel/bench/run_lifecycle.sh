@@ -0,0 +1,18 @@
+#!/bin/sh
+# Runs the instantiate/prepare benchmark once per plugin in plugins/.
+# build.zig builds a single plugin per invocation, so this loops over them
+# and keeps only the first table header.
+set -e
+cd "$(dirname "$0")/.."
+
+header=1
+for src in plugins/*.zig; do
+    name=$(basename "$src" .zig)
+    out=$(zig build bench-lifecycle -Dplugin-name="$name" -Doptimize=ReleaseFast "$@" 2>&1)
+    if [ $header -eq 1 ]; then
+        echo "$out"
+        header=0
+    else
+        echo "$out" | grep -v '^plugin '
+    fi
+done
@@ -0,0 +1,16 @@
+#!/bin/sh
+# Two-pass loudness normalization of a two-hour stereo file: renders the
+# file from noise, then normalizes it to -16 LUFS with sonic-render and
+# reports the time of each pass and the peak resident memory, which should
+# not grow with the file. Needs about 5.6 GB of free space in $TMPDIR.
+set -e
+cd "$(dirname "$0")/.."
+
+zig build render -Doptimize=ReleaseFast "$@"
+dir=$(mktemp -d)
+trap 'rm -rf "$dir"' EXIT
+
+echo "== Generating 2 h of stereo noise"
+zig-out/bin/sonic-render noise:7200 "$dir/in.wav"
+echo "== Normalizing to -16 LUFS"
+zig-out/bin/sonic-render --normalize -16 "$dir/in.wav" "$dir/out.wav"
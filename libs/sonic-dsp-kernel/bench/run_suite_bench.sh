@@ -0,0 +1,21 @@
+#!/bin/sh
+# Load time and resident memory: one SonicSuite library versus one library
+# per plugin, each instantiating every plugin once. Linux only (/proc).
+set -e
+cd "$(dirname "$0")/.."
+
+optimize=${OPTIMIZE:-ReleaseFast}
+separate=zig-out/separate
+mkdir -p "$separate"
+
+for src in plugins/*.zig; do
+    name=$(basename "$src" .zig)
+    zig build plugin -Dplugin-name="$name" -Doptimize="$optimize" "$@"
+    cp "zig-out/lib/lib$name.so" "$separate/"
+done
+zig build suite -Doptimize="$optimize" "$@"
+
+echo "== SonicSuite (1 library)"
+zig-out/bin/bench-suite-load zig-out/lib/libSonicSuite.so
+echo "== Separate libraries"
+zig-out/bin/bench-suite-load "$separate"/lib*.so
@@ -0,0 +1,113 @@
+// Sparse-session benchmark for silence skipping in PluginWrapper::process.
+//
+// Plays a minute-long session of 64 tracks, one plugin instance each,
+// cycling through every class in the suite. Each track only has audio in
+// short clips (one 6 s clip every 30 s, staggered across tracks), the way a
+// multitrack edit mostly is; between clips the host feeds zeros and sets the
+// input silence flags. Reports the CPU time per track-block, the share of
+// blocks the wrapper answered with output silence flags, and the DSP load as
+// a fraction of real time.
+//
+// Built twice: bench-silence, and bench-silence-off with
+// -DSONIC_NO_SILENCE_SKIP, which runs the kernel on every block as before.
+
+#include "bench_host.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+using namespace bench;
+
+static const double kSampleRate = 48000.0;
+static const int32 kBlockSize = 256;
+static const int kTracks = 64;
+static const double kSessionSeconds = 60.0;
+static const double kClipSeconds = 6.0;
+static const double kClipPeriod = 30.0;
+
+#ifdef SONIC_NO_SILENCE_SKIP
+static const char* kMode = "off";
+#else
+static const char* kMode = "on";
+#endif
+
+struct Track {
+    Plugin plugin;
+    int64_t clipOffset; // frames into each period where the clip starts
+};
+
+int main() {
+    IPluginFactory* factory = GetPluginFactory();
+    int32 classCount = factory->countClasses();
+
+    std::vector<Track> tracks(kTracks);
+    const int64_t period = (int64_t)(kClipPeriod * kSampleRate);
+    const int64_t clipFrames = (int64_t)(kClipSeconds * kSampleRate);
+    for (int t = 0; t < kTracks; t++) {
+        if (!tracks[t].plugin.open(kSampleRate, kBlockSize, t % classCount)) {
+            fprintf(stderr, "silence_bench: failed to create class %d\n", t % classCount);
+            return 1;
+        }
+        tracks[t].clipOffset = (period * t / kTracks) / kBlockSize * kBlockSize;
+    }
+
+    // A second of noise, looped, stands in for each clip's audio
+    const int64_t loopFrames = (int64_t)kSampleRate;
+    std::vector<float> noise[2] = { std::vector<float>(loopFrames), std::vector<float>(loopFrames) };
+    fillNoise(noise[0], 1);
+    fillNoise(noise[1], 2);
+    for (int ch = 0; ch < 2; ch++) {
+        for (float& s : noise[ch]) s *= 0.25f;
+    }
+
+    StereoBlock block(kBlockSize);
+    const int64_t numBlocks = (int64_t)(kSessionSeconds * kSampleRate) / kBlockSize;
+    int64_t activeBlocks = 0;
+    int64_t skippedBlocks = 0;
+    double ns = 0.0;
+    bool finite = true;
+
+    for (int64_t b = 0; b < numBlocks; b++) {
+        const int64_t frame = b * kBlockSize;
+        for (Track& track : tracks) {
+            const int64_t intoClip = (frame + period - track.clipOffset) % period;
+            const bool active = intoClip < clipFrames;
+            if (active) {
+                const int64_t src = frame % loopFrames;
+                const int32 n = (int32)std::min<int64_t>(kBlockSize, loopFrames - src);
+                for (int ch = 0; ch < 2; ch++) {
+                    memcpy(block.in[ch].data(), noise[ch].data() + src, sizeof(float) * n);
+                    memcpy(block.in[ch].data() + n, noise[ch].data(), sizeof(float) * (kBlockSize - n));
+                }
+                block.inBus.silenceFlags = 0;
+                activeBlocks++;
+            } else {
+                for (int ch = 0; ch < 2; ch++) memset(block.in[ch].data(), 0, sizeof(float) * kBlockSize);
+                block.inBus.silenceFlags = 3;
+            }
+
+            auto start = Clock::now();
+            track.plugin.processor->process(block.data);
+            ns += elapsedNs(start);
+
+            if (block.outBus.silenceFlags == 3) skippedBlocks++;
+            if (!std::isfinite(block.out[0][kBlockSize - 1])) finite = false;
+        }
+    }
+
+    for (Track& track : tracks) track.plugin.close();
+
+    const double trackBlocks = (double)numBlocks * kTracks;
+    const double renderedSeconds = (double)numBlocks * kBlockSize / kSampleRate;
+    printf("silence skip %s: %d tracks, %d classes, %.0f%% of blocks with audio\n", kMode, kTracks, classCount,
+           100.0 * (double)activeBlocks / trackBlocks);
+    printf("%-28s %12.1f\n", "ns per track-block", ns / trackBlocks);
+    printf("%-28s %12.1f\n", "blocks skipped %", 100.0 * (double)skippedBlocks / trackBlocks);
+    printf("%-28s %12.2f\n", "DSP load % of real time", 100.0 * ns * 1e-9 / renderedSeconds);
+
+    if (!finite) {
+        fprintf(stderr, "silence_bench: non-finite output\n");
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,222 @@
+// Edit-to-preview latency on a 30-minute file: re-rendering a rack from
+// the last snapshot before an edit against re-rendering it from the top.
+//
+// A rack of five modules renders 30 minutes of stereo noise at 48 kHz in
+// kBlock-frame blocks, taking a plugin_snapshot of every module every
+// kCheckpointSeconds. Then, for edits at several points of the file, each
+// moving one module's first parameter over kEditSeconds, the kPreviewSeconds
+// from the start of the edit are rendered two ways:
+//   top         fresh instances from sample 0, which is what
+//               cli/engine/native-engine.ts does now when it re-runs a
+//               rack from its cacheStack;
+//   checkpoint  the first render's instances, restored to the checkpoint
+//               at or before the edit and run from there.
+// Both run the whole rack; the engine would start at the edited module on
+// the cached output of the one before it, which shortens both alike.
+// Every render sets every module's first parameter before every block, so
+// the instances see the same calls whichever way they got to a block.
+//
+// Prints the time to preview each way, what snapshots and restores cost
+// and the checkpoints' memory. Fails if the two previews differ in a
+// single sample or a module can't be snapshotted.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+extern "C" {
+    uint32_t plugin_class_count();
+    const char* plugin_class_id(uint32_t index);
+    uint32_t plugin_class_param_count(uint32_t index);
+    uint32_t plugin_class_param_steps(uint32_t index, int32_t param);
+    void* plugin_create_class(uint32_t index, float sample_rate);
+    int32_t plugin_prepare(void* instance, float sample_rate, size_t max_block);
+    void plugin_process(void* instance, const float* const* inputs, float** outputs, size_t frames);
+    void plugin_set_parameter(void* instance, int32_t index, float value);
+    void plugin_destroy(void* instance);
+    size_t plugin_snapshot_size(void* instance);
+    size_t plugin_snapshot(void* instance, uint8_t* out, size_t capacity);
+    int32_t plugin_restore(void* instance, const uint8_t* data, size_t len);
+}
+
+static const float kSampleRate = 48000.0f;
+static const size_t kBlock = 4096;
+static const double kFileSeconds = 30.0 * 60.0;
+static const double kCheckpointSeconds = 10.0;
+static const double kEditSeconds = 20.0;
+static const double kPreviewSeconds = 5.0;
+static const double kEditAt[] = { 60.0, 600.0, 1200.0, 1790.0 };
+static const char* const kRack[] = { "sonicparametriceq", "soniccompressor", "sonicdenoise", "sonicfeedbackdelay", "soniclimiter" };
+static const size_t kRackSize = sizeof(kRack) / sizeof(kRack[0]);
+static const float kEditValue = 0.9f;
+// The wrapper's parameter limit
+static const uint32_t kMaxParams = 256;
+
+using Clock = std::chrono::steady_clock;
+
+static double elapsedMs(Clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+static size_t blocksIn(double seconds) {
+    return (size_t)(seconds * kSampleRate) / kBlock;
+}
+
+// An edit: `module`'s first parameter at kEditValue over blocks first..last
+struct Edit {
+    size_t module = kRackSize;
+    size_t first = 0;
+    size_t last = 0;
+};
+
+struct Rack {
+    std::vector<void*> modules;
+    // Module m reads buf[m % 2] and writes buf[(m + 1) % 2]; the input
+    // goes into buf[0]
+    std::vector<float> buf[2][2];
+
+    Rack() {
+        for (auto& pair : buf) {
+            for (auto& ch : pair) ch.assign(kBlock, 0.0f);
+        }
+    }
+    ~Rack() {
+        for (void* m : modules) plugin_destroy(m);
+    }
+};
+
+static int32_t findClass(const char* id) {
+    for (uint32_t c = 0; c < plugin_class_count(); c++) {
+        if (strcmp(plugin_class_id(c), id) == 0) return (int32_t)c;
+    }
+    return -1;
+}
+
+// Each module at the wrapper's starting values
+static bool openRack(Rack& rack) {
+    for (const char* id : kRack) {
+        const int32_t index = findClass(id);
+        void* m = index < 0 ? nullptr : plugin_create_class((uint32_t)index, kSampleRate);
+        if (!m) {
+            fprintf(stderr, "snapshot_bench: can't create %s\n", id);
+            return false;
+        }
+        rack.modules.push_back(m);
+        const uint32_t params = std::min(plugin_class_param_count((uint32_t)index), kMaxParams);
+        for (uint32_t p = 0; p < params; p++) {
+            plugin_set_parameter(m, (int32_t)p, plugin_class_param_steps((uint32_t)index, (int32_t)p) ? 0.0f : 0.5f);
+        }
+        if (plugin_prepare(m, kSampleRate, kBlock) != 0) {
+            fprintf(stderr, "snapshot_bench: can't prepare %s\n", id);
+            return false;
+        }
+    }
+    return true;
+}
+
+static void fillNoise(std::vector<float>& buf, uint32_t seed) {
+    for (float& s : buf) {
+        seed = seed * 1664525u + 1013904223u;
+        s = ((float)(seed >> 8) / 16777216.0f) * 0.5f - 0.25f;
+    }
+}
+
+// Renders blocks from..to. Before block b, checkpoints[m][b / every] takes
+// module m's snapshot if b is a multiple of `every`; output from block
+// keepFrom on is appended to `kept`.
+static void render(Rack& rack, size_t from, size_t to, const Edit& edit, std::vector<std::vector<std::vector<uint8_t>>>* checkpoints,
+                   size_t every, double* snapshotMs, size_t keepFrom, std::vector<float>* kept) {
+    for (size_t b = from; b < to; b++) {
+        if (checkpoints && b % every == 0) {
+            const auto start = Clock::now();
+            for (size_t m = 0; m < kRackSize; m++) {
+                std::vector<uint8_t>& slot = (*checkpoints)[m][b / every];
+                plugin_snapshot(rack.modules[m], slot.data(), slot.size());
+            }
+            *snapshotMs += elapsedMs(start);
+        }
+        fillNoise(rack.buf[0][0], (uint32_t)(2 * b + 1));
+        fillNoise(rack.buf[0][1], (uint32_t)(2 * b + 2));
+        for (size_t m = 0; m < kRackSize; m++) {
+            const bool edited = m == edit.module && b >= edit.first && b <= edit.last;
+            plugin_set_parameter(rack.modules[m], 0, edited ? kEditValue : 0.5f);
+            const float* in[2] = { rack.buf[m % 2][0].data(), rack.buf[m % 2][1].data() };
+            float* out[2] = { rack.buf[(m + 1) % 2][0].data(), rack.buf[(m + 1) % 2][1].data() };
+            plugin_process(rack.modules[m], in, out, kBlock);
+        }
+        if (kept && b >= keepFrom) {
+            for (int ch = 0; ch < 2; ch++) kept->insert(kept->end(), rack.buf[kRackSize % 2][ch].begin(), rack.buf[kRackSize % 2][ch].end());
+        }
+    }
+}
+
+int main() {
+    const size_t total = blocksIn(kFileSeconds);
+    const size_t every = blocksIn(kCheckpointSeconds);
+    const size_t previewBlocks = blocksIn(kPreviewSeconds);
+
+    Rack rack;
+    if (!openRack(rack)) return 1;
+    std::vector<std::vector<std::vector<uint8_t>>> checkpoints(kRackSize);
+    size_t bytesPerCheckpoint = 0;
+    for (size_t m = 0; m < kRackSize; m++) {
+        const size_t size = plugin_snapshot_size(rack.modules[m]);
+        if (size == 0) {
+            fprintf(stderr, "snapshot_bench: %s can't be snapshotted\n", kRack[m]);
+            return 1;
+        }
+        checkpoints[m].assign((total + every - 1) / every, std::vector<uint8_t>(size));
+        bytesPerCheckpoint += size;
+        printf("%-20s %9zu bytes per snapshot\n", kRack[m], size);
+    }
+
+    double snapshotMs = 0.0;
+    auto start = Clock::now();
+    render(rack, 0, total, Edit(), &checkpoints, every, &snapshotMs, 0, nullptr);
+    const double firstMs = elapsedMs(start);
+    const size_t count = checkpoints[0].size();
+    printf("first render: %.0f min in %.1f s, %zu checkpoints every %.0f s, %.1f MB, snapshots %.1f ms (%.1f us each)\n",
+           kFileSeconds / 60.0, firstMs / 1000.0, count, kCheckpointSeconds, (double)(bytesPerCheckpoint * count) / (1024.0 * 1024.0),
+           snapshotMs, 1000.0 * snapshotMs / (double)count);
+
+    printf("%-8s %-20s %10s %14s %12s %9s\n", "edit at", "module", "top ms", "checkpoint ms", "restore us", "speedup");
+    int failures = 0;
+    for (size_t e = 0; e < sizeof(kEditAt) / sizeof(kEditAt[0]); e++) {
+        Edit edit;
+        edit.module = e % kRackSize;
+        edit.first = blocksIn(kEditAt[e]);
+        edit.last = edit.first + blocksIn(kEditSeconds) - 1;
+        const size_t to = std::min(total, edit.first + previewBlocks);
+
+        std::vector<float> top, fromCheckpoint;
+        start = Clock::now();
+        {
+            Rack fresh;
+            if (!openRack(fresh)) return 1;
+            render(fresh, 0, to, edit, nullptr, every, nullptr, edit.first, &top);
+        }
+        const double topMs = elapsedMs(start);
+
+        start = Clock::now();
+        const size_t c = edit.first / every;
+        bool restored = true;
+        for (size_t m = 0; m < kRackSize; m++) {
+            const std::vector<uint8_t>& slot = checkpoints[m][c];
+            restored = plugin_restore(rack.modules[m], slot.data(), slot.size()) == 0 && restored;
+        }
+        const double restoreMs = elapsedMs(start);
+        render(rack, c * every, to, edit, nullptr, every, nullptr, edit.first, &fromCheckpoint);
+        const double checkpointMs = elapsedMs(start);
+
+        const bool same = restored && top.size() == fromCheckpoint.size() &&
+                          memcmp(top.data(), fromCheckpoint.data(), sizeof(float) * top.size()) == 0;
+        const int at = (int)kEditAt[e];
+        printf("%5d:%02d %-20s %10.1f %14.1f %12.1f %8.0fx%s\n", at / 60, at % 60, kRack[edit.module],
+               topMs, checkpointMs, 1000.0 * restoreMs, topMs / checkpointMs, restored ? (same ? "" : "  PREVIEWS DIFFER") : "  RESTORE REFUSED");
+        if (!same) failures++;
+    }
+    return failures ? 1 : 0;
+}
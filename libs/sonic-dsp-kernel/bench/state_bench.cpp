@@ -0,0 +1,119 @@
+// Session recall benchmark: 500 instances across every class in the suite.
+//
+// Builds a session the way a user would (parameters moved, the denoiser
+// and spectral match left with learned data), saves it through getState,
+// then times loading it back:
+//   save        getState on every instance
+//   recall      createInstance + setState + setupProcessing + setActive,
+//               what a host does per plugin when it opens the project
+//   no state    the same without setState, for the cost of the state alone
+//   live load   setState into instances that are already running (preset
+//               recall) plus the block that applies it
+// Reports wall time per phase, per instance and the session's total size.
+
+#include "bench_host.h"
+
+using namespace bench;
+
+static const int kInstances = 500;
+static const double kSampleRate = 48000.0;
+static const int32 kBlockSize = 1024;
+// Enough for the denoiser's 20 learning frames
+static const int kLearnBlocks = 24;
+
+static IComponent* createComponent(int32 classIndex) {
+    IPluginFactory* factory = GetPluginFactory();
+    PClassInfo info;
+    void* obj = nullptr;
+    if (factory->getClassInfo(classIndex, &info) != kResultOk) return nullptr;
+    if (factory->createInstance(info.cid, IComponent::iid, &obj) != kResultOk) return nullptr;
+    return (IComponent*)obj;
+}
+
+// setupProcessing + setActive on a bare component
+static bool activate(IComponent* component) {
+    void* obj = nullptr;
+    if (component->queryInterface(IAudioProcessor::iid, &obj) != kResultOk) return false;
+    IAudioProcessor* processor = (IAudioProcessor*)obj;
+    ProcessSetup setup = { 0, 0, kBlockSize, kSampleRate };
+    processor->setupProcessing(setup);
+    component->setActive(true);
+    processor->release();
+    return true;
+}
+
+int main() {
+    const int32 classCount = GetPluginFactory()->countClasses();
+    std::vector<Plugin> session(kInstances);
+    StereoBlock block(kBlockSize);
+    fillNoise(block.in[0], 1);
+    fillNoise(block.in[1], 2);
+
+    for (int i = 0; i < kInstances; i++) {
+        if (!session[i].open(kSampleRate, kBlockSize, i % classCount)) {
+            fprintf(stderr, "state_bench: failed to open class %d\n", i % classCount);
+            return 1;
+        }
+        void* obj = nullptr;
+        session[i].component->queryInterface(IEditController::iid, &obj);
+        IEditController* controller = (IEditController*)obj;
+        controller->setParamNormalized(0, 0.3 + 0.001 * i);
+        controller->setParamNormalized(1, 1.0);
+        for (int b = 0; b < kLearnBlocks; b++) session[i].processor->process(block.data);
+        controller->setParamNormalized(1, 0.0);
+        session[i].processor->process(block.data);
+        controller->release();
+    }
+
+    std::vector<MemoryStream> saved(kInstances);
+    auto start = Clock::now();
+    for (int i = 0; i < kInstances; i++) session[i].component->getState(&saved[i]);
+    const double saveNs = elapsedNs(start);
+    size_t bytes = 0;
+    for (const MemoryStream& s : saved) bytes += s.bytes.size();
+
+    std::vector<IComponent*> recalled(kInstances);
+    start = Clock::now();
+    for (int i = 0; i < kInstances; i++) {
+        recalled[i] = createComponent(i % classCount);
+        saved[i].rewind();
+        if (recalled[i]->setState(&saved[i]) != kResultOk || !activate(recalled[i])) {
+            fprintf(stderr, "state_bench: instance %d failed to recall\n", i);
+            return 1;
+        }
+    }
+    const double recallNs = elapsedNs(start);
+    for (IComponent* c : recalled) {
+        c->setActive(false);
+        c->release();
+    }
+
+    start = Clock::now();
+    for (int i = 0; i < kInstances; i++) {
+        recalled[i] = createComponent(i % classCount);
+        activate(recalled[i]);
+    }
+    const double defaultsNs = elapsedNs(start);
+    for (IComponent* c : recalled) {
+        c->setActive(false);
+        c->release();
+    }
+
+    start = Clock::now();
+    for (int i = 0; i < kInstances; i++) {
+        saved[i].rewind();
+        session[i].component->setState(&saved[i]);
+        session[i].processor->process(block.data);
+    }
+    const double liveNs = elapsedNs(start);
+    for (Plugin& p : session) p.close();
+
+    printf("%d instances over %d classes, %.1f KB of state (%.0f bytes each)\n", kInstances, classCount,
+           bytes / 1024.0, (double)bytes / kInstances);
+    printf("%-12s %10s %14s\n", "phase", "ms", "us/instance");
+    printf("%-12s %10.2f %14.2f\n", "save", saveNs / 1e6, saveNs / 1e3 / kInstances);
+    printf("%-12s %10.2f %14.2f\n", "recall", recallNs / 1e6, recallNs / 1e3 / kInstances);
+    printf("%-12s %10.2f %14.2f\n", "no state", defaultsNs / 1e6, defaultsNs / 1e3 / kInstances);
+    printf("%-12s %10.2f %14.2f\n", "live load", liveNs / 1e6, liveNs / 1e3 / kInstances);
+    return 0;
+}
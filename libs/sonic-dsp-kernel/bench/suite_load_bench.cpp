@@ -0,0 +1,94 @@
+// Load-time / resident-memory benchmark: SonicSuite vs separate binaries.
+//
+//   bench-suite-load <lib> [<lib> ...]
+//
+// dlopens every library given, then instantiates and activates every class
+// each factory exposes, the way a host does when a session loads. Reports
+// wall time and the growth in resident memory. Run it once with
+// libSonicSuite and once with the per-plugin libraries;
+// bench/run_suite_bench.sh does both.
+
+#include "vst3_minimal.h"
+#include <chrono>
+#include <cstdio>
+#include <vector>
+#include <dlfcn.h>
+#include <unistd.h>
+
+using namespace Steinberg;
+using namespace Steinberg::Vst;
+
+// Hosts carry the interface IDs themselves; these match native/PluginWrapper.cpp
+const TUID FUnknown::iid = {0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0xC0,0x00,0x00,0x00,0x00,0x00,0x00,0x46};
+const TUID IPluginFactory::iid = {0x7A,0x43,0x81,0x98,0x72,0xEE,0x4A,0x51,0xA3,0x96,0x09,0xE9,0x54,0x66,0x28,0xC6};
+const TUID Vst::IComponent::iid = {0xE8,0x31,0xFF,0x31,0xF2,0xD5,0x43,0x01,0x92,0x8E,0xBB,0xEE,0x25,0x69,0x78,0x02};
+const TUID Vst::IAudioProcessor::iid = {0x42,0x04,0x3F,0x99,0xB1,0xF9,0x42,0xE9,0x8C,0xB8,0x69,0x7E,0x20,0x8E,0x44,0xDA};
+
+typedef IPluginFactory* (*GetFactoryProc)();
+
+static long residentKB() {
+    long pages = 0, resident = 0;
+    FILE* f = fopen("/proc/self/statm", "r");
+    if (!f) return 0;
+    if (fscanf(f, "%ld %ld", &pages, &resident) != 2) resident = 0;
+    fclose(f);
+    return resident * (sysconf(_SC_PAGESIZE) / 1024);
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        fprintf(stderr, "usage: %s <lib> [<lib> ...]\n", argv[0]);
+        return 1;
+    }
+
+    std::vector<void*> handles;
+    std::vector<IComponent*> components;
+    std::vector<IAudioProcessor*> processors;
+
+    long rssBefore = residentKB();
+    auto start = std::chrono::steady_clock::now();
+
+    for (int a = 1; a < argc; a++) {
+        void* handle = dlopen(argv[a], RTLD_NOW | RTLD_LOCAL);
+        if (!handle) {
+            fprintf(stderr, "dlopen %s: %s\n", argv[a], dlerror());
+            return 1;
+        }
+        handles.push_back(handle);
+        GetFactoryProc getFactory = (GetFactoryProc)dlsym(handle, "GetPluginFactory");
+        if (!getFactory) {
+            fprintf(stderr, "%s: no GetPluginFactory\n", argv[a]);
+            return 1;
+        }
+        IPluginFactory* factory = getFactory();
+        for (int32 c = 0; c < factory->countClasses(); c++) {
+            PClassInfo info;
+            if (factory->getClassInfo(c, &info) != kResultOk) continue;
+            void* obj = nullptr;
+            if (factory->createInstance(info.cid, IComponent::iid, &obj) != kResultOk) continue;
+            IComponent* component = (IComponent*)obj;
+            component->queryInterface(IAudioProcessor::iid, &obj);
+            IAudioProcessor* processor = (IAudioProcessor*)obj;
+
+            ProcessSetup setup = { 0, 0, 512, 48000.0 };
+            processor->setupProcessing(setup);
+            component->setActive(true);
+            components.push_back(component);
+            processors.push_back(processor);
+        }
+    }
+
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    long rssDelta = residentKB() - rssBefore;
+
+    printf("%-12s %-10s %12s %14s\n", "libraries", "instances", "load ms", "resident KB");
+    printf("%-12d %-10zu %12.2f %14ld\n", argc - 1, components.size(), ms, rssDelta);
+
+    for (size_t i = 0; i < components.size(); i++) {
+        components[i]->setActive(false);
+        processors[i]->release();
+        components[i]->release();
+    }
+    for (void* h : handles) dlclose(h);
+    return 0;
+}
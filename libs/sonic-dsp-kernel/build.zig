@@ -6,6 +6,17 @@ pub fn build(b: *std.Build) void {
 
     // --- Options ---
     const plugin_name = b.option([]const u8, "plugin-name", "Name of the plugin to build") orelse "Gain";
+    const rt_guard = b.option(bool, "rt-guard", "Flag allocations inside Render/process (debug builds)") orelse false;
+    const instance_arena = b.option(bool, "instance-arena", "Give each plugin instance its own contiguous arena") orelse true;
+
+    const build_options = b.addOptions();
+    build_options.addOption(bool, "rt_guard", rt_guard);
+    build_options.addOption(bool, "instance_arena", instance_arena);
+
+    const cpp_flags: []const []const u8 = if (rt_guard)
+        &.{ "-std=c++17", "-fPIC", "-DSONIC_RT_GUARD" }
+    else
+        &.{ "-std=c++17", "-fPIC" };
     
     // --- Modules ---
     // Construct path to plugin source
@@ -14,34 +25,12 @@ pub fn build(b: *std.Build) void {
     // lowerString copies content to buffer
     const lower_name = std.ascii.lowerString(buffer[0..plugin_name.len], plugin_name);
     
-    const plugin_path_str = b.fmt("plugins/{s}.zig", .{lower_name});
-
     // Generate a bridge file in the root to allow relative imports to work
     // from the project root instead of from the plugins/ directory.
-    const entry_content = b.fmt("pub const plugin_impl = @import(\"{s}\").plugin_impl;\n", .{plugin_path_str});
-    std.fs.cwd().writeFile(.{ .sub_path = "plugin_entry.zig", .data = entry_content }) catch {};
+    writePluginTable("plugin_entry.zig", &.{.{ .id = lower_name, .name = plugin_name }}, false);
 
-    const plugin_mod = b.createModule(.{
-        .root_source_file = b.path("plugin_entry.zig"),
-        .pic = true,
-    });
+    const lib = addKernel(b, "plugin_entry.zig", "dsp_kernel", target, optimize, build_options);
 
-    // --- Static Library (Zig DSP Kernel) ---
-    // This compiles the Zig code into a static lib that C++ can link against.
-    const lib_mod = b.createModule(.{
-        .root_source_file = b.path("c_export.zig"),
-        .target = target,
-        .optimize = optimize,
-        .pic = true,
-    });
-    lib_mod.addImport("plugin_impl", plugin_mod);
-
-    const lib = b.addLibrary(.{
-        .linkage = .static,
-        .name = "dsp_kernel",
-        .root_module = lib_mod,
-    });
-    
     const lib_install = b.addInstallArtifact(lib, .{});
     
     // --- VST3 Shared Library (Native Wrapper) ---
@@ -58,7 +47,7 @@ pub fn build(b: *std.Build) void {
     
     vst3_lib.addCSourceFile(.{
         .file = b.path("native/PluginWrapper.cpp"),
-        .flags = &.{ "-std=c++17", "-fPIC" },
+        .flags = cpp_flags,
     });
     
     vst3_lib.linkLibrary(lib);
@@ -71,6 +60,389 @@ pub fn build(b: *std.Build) void {
     plugin_step.dependOn(&lib_install.step);
     plugin_step.dependOn(&vst3_install.step);
 
+    // --- Native Benchmarks ---
+    // Host-side harnesses that load the VST3 wrapper in-process and drive it
+    // through GetPluginFactory(), linked against the same DSP kernel.
+    const bench_step = b.step("bench", "Run the native plugin benchmarks");
+
+    const automation_bench = addNativeHarness(b, lib, target, optimize, "bench-automation", cpp_flags, &.{
+        "bench/automation_bench.cpp",
+        "native/PluginWrapper.cpp",
+    });
+    bench_step.dependOn(&b.addRunArtifact(automation_bench).step);
+
+    const lifecycle_bench = addNativeHarness(b, lib, target, optimize, "bench-lifecycle", cpp_flags, &.{
+        "bench/lifecycle_bench.cpp",
+        "native/PluginWrapper.cpp",
+    });
+    const lifecycle_run = b.addRunArtifact(lifecycle_bench);
+    lifecycle_run.addArg(plugin_name);
+    bench_step.dependOn(&lifecycle_run.step);
+    const lifecycle_step = b.step("bench-lifecycle", "Time instantiate vs prepare for this plugin");
+    lifecycle_step.dependOn(&lifecycle_run.step);
+
+    const fft_bench = addNativeHarness(b, lib, target, optimize, "bench-fft", cpp_flags, &.{
+        "bench/fft_bench.cpp",
+    });
+    const fft_bench_run = b.addRunArtifact(fft_bench);
+    bench_step.dependOn(&fft_bench_run.step);
+    const fft_bench_step = b.step("bench-fft", "FFT plan throughput vs the scalar radix-2 transform");
+    fft_bench_step.dependOn(&fft_bench_run.step);
+
+    const eq_bench = addNativeHarness(b, lib, target, optimize, "bench-eq", cpp_flags, &.{
+        "bench/eq_bench.cpp",
+    });
+    const eq_bench_run = b.addRunArtifact(eq_bench);
+    bench_step.dependOn(&eq_bench_run.step);
+    const eq_bench_step = b.step("bench-eq", "EQ cascade throughput vs the scalar biquad chain");
+    eq_bench_step.dependOn(&eq_bench_run.step);
+
+    const analysis_bench = addNativeHarness(b, lib, target, optimize, "bench-analysis", cpp_flags, &.{
+        "bench/analysis_bench.cpp",
+    });
+    const analysis_bench_run = b.addRunArtifact(analysis_bench);
+    bench_step.dependOn(&analysis_bench_run.step);
+    const analysis_bench_step = b.step("bench-analysis", "Loudness analysis scaling from 1 to 16 threads");
+    analysis_bench_step.dependOn(&analysis_bench_run.step);
+
+    const pitch_bench = addNativeHarness(b, lib, target, optimize, "bench-pitch", cpp_flags, &.{
+        "bench/pitch_bench.cpp",
+    });
+    const pitch_bench_run = b.addRunArtifact(pitch_bench);
+    bench_step.dependOn(&pitch_bench_run.step);
+    const pitch_bench_step = b.step("bench-pitch", "YIN tracker frames per second vs the brute-force detector");
+    pitch_bench_step.dependOn(&pitch_bench_run.step);
+
+    // --- Native Tests ---
+    const test_step = b.step("test", "Run the native wrapper tests");
+
+    const param_stress = addNativeHarness(b, lib, target, optimize, "test-param-stress", cpp_flags, &.{
+        "tests/param_stress_test.cpp",
+        "native/PluginWrapper.cpp",
+    });
+    test_step.dependOn(&b.addRunArtifact(param_stress).step);
+
+    const block_size = addNativeHarness(b, lib, target, optimize, "test-block-size", cpp_flags, &.{
+        "tests/block_size_test.cpp",
+        "native/PluginWrapper.cpp",
+    });
+    const block_size_run = b.addRunArtifact(block_size);
+    block_size_run.addArg(lower_name);
+    test_step.dependOn(&block_size_run.step);
+
+    const latency = addNativeHarness(b, lib, target, optimize, "test-latency", cpp_flags, &.{
+        "tests/latency_test.cpp",
+        "native/PluginWrapper.cpp",
+    });
+    const latency_run = b.addRunArtifact(latency);
+    latency_run.addArg(lower_name);
+    test_step.dependOn(&latency_run.step);
+
+    const fft_accuracy = addNativeHarness(b, lib, target, optimize, "test-fft-accuracy", cpp_flags, &.{
+        "tests/fft_accuracy_test.cpp",
+    });
+    test_step.dependOn(&b.addRunArtifact(fft_accuracy).step);
+
+    const analysis_test = addNativeHarness(b, lib, target, optimize, "test-analysis", cpp_flags, &.{
+        "tests/analysis_test.cpp",
+    });
+    test_step.dependOn(&b.addRunArtifact(analysis_test).step);
+
+    // The interposer is glibc-specific, so both of these are Linux-only.
+    if (target.result.os.tag == .linux) {
+        // Always instrumented: links the interposer directly and drives both
+        // wrappers' render paths with violations counted instead of aborting.
+        const rt_safety = addNativeHarness(b, lib, target, optimize, "test-rt-safety", &.{ "-std=c++17", "-fPIC", "-DSONIC_RT_GUARD" }, &.{
+            "tests/rt_safety_test.cpp",
+            "native/rt_guard.cpp",
+            "native/PluginWrapper.cpp",
+            "native/AUWrapper.cpp",
+        });
+        test_step.dependOn(&b.addRunArtifact(rt_safety).step);
+
+        // --- RT Guard Preload Library ---
+        // LD_PRELOAD=zig-out/lib/librt_guard.so <host> with a -Drt-guard plugin
+        const rt_guard_lib = b.addLibrary(.{
+            .linkage = .dynamic,
+            .name = "rt_guard",
+            .root_module = b.createModule(.{
+                .target = target,
+                .optimize = optimize,
+                .link_libc = true,
+                .link_libcpp = true,
+            }),
+        });
+        rt_guard_lib.addCSourceFile(.{
+            .file = b.path("native/rt_guard.cpp"),
+            .flags = &.{ "-std=c++17", "-fPIC" },
+        });
+        const rt_guard_step = b.step("rt-guard", "Build the RT-safety preload library");
+        rt_guard_step.dependOn(&b.addInstallArtifact(rt_guard_lib, .{}).step);
+    }
+
+    // --- SonicSuite (every plugin in one binary) ---
+    // The VST3 factory enumerates each plugin under plugins/ as its own
+    // class, sharing one kernel, one allocator and one copy of the DSP code,
+    // plus sonicchain, which runs any of them in series (module_chain.zig).
+    const suite_entries = listPlugins(b);
+    writePluginTable("suite_entry.zig", suite_entries, true);
+
+    const suite_kernel = addKernel(b, "suite_entry.zig", "dsp_suite_kernel", target, optimize, build_options);
+    const suite_lib = b.addLibrary(.{
+        .linkage = .dynamic,
+        .name = "SonicSuite",
+        .root_module = b.createModule(.{
+            .target = target,
+            .optimize = optimize,
+            .link_libc = true,
+            .link_libcpp = true,
+        }),
+    });
+    suite_lib.addCSourceFile(.{
+        .file = b.path("native/PluginWrapper.cpp"),
+        .flags = cpp_flags,
+    });
+    suite_lib.linkLibrary(suite_kernel);
+    suite_lib.addIncludePath(b.path("native"));
+
+    const suite_step = b.step("suite", "Build the SonicSuite VST3 bundle (all plugins)");
+    suite_step.dependOn(&b.addInstallArtifact(suite_lib, .{}).step);
+
+    const suite_bench = b.addExecutable(.{
+        .name = "bench-suite-load",
+        .root_module = b.createModule(.{
+            .target = target,
+            .optimize = optimize,
+            .link_libc = true,
+            .link_libcpp = true,
+        }),
+    });
+    suite_bench.addCSourceFile(.{
+        .file = b.path("bench/suite_load_bench.cpp"),
+        .flags = &.{ "-std=c++17" },
+    });
+    suite_bench.addIncludePath(b.path("native"));
+    suite_bench.linkSystemLibrary("dl");
+    suite_step.dependOn(&b.addInstallArtifact(suite_bench, .{}).step);
+
+    // Sparse multitrack session through the suite's VST3 wrapper, with and
+    // without skipping silent blocks once a kernel's tail has decayed.
+    const silence_step = b.step("bench-silence", "Compare CPU for a sparse session with and without silence skipping");
+    const silence_variants = [_]struct { name: []const u8, flags: []const []const u8 }{
+        .{ .name = "bench-silence", .flags = cpp_flags },
+        .{ .name = "bench-silence-off", .flags = &.{ "-std=c++17", "-fPIC", "-DSONIC_NO_SILENCE_SKIP" } },
+    };
+    for (silence_variants) |variant| {
+        const silence_bench = addNativeHarness(b, suite_kernel, target, optimize, variant.name, variant.flags, &.{
+            "bench/silence_bench.cpp",
+            "native/PluginWrapper.cpp",
+        });
+        const silence_run = b.addRunArtifact(silence_bench);
+        bench_step.dependOn(&silence_run.step);
+        silence_step.dependOn(&silence_run.step);
+    }
+
+    // Negotiated mono, stereo and 7.1.4 buses through the suite's VST3
+    // wrapper, timed per channel.
+    const channels_bench = addNativeHarness(b, suite_kernel, target, optimize, "bench-channels", cpp_flags, &.{
+        "bench/channels_bench.cpp",
+        "native/PluginWrapper.cpp",
+    });
+    const channels_run = b.addRunArtifact(channels_bench);
+    bench_step.dependOn(&channels_run.step);
+    const channels_step = b.step("bench-channels", "Cost per channel for mono, stereo and 12-channel buses");
+    channels_step.dependOn(&channels_run.step);
+
+    // The nonlinear plugins' 4x oversampling against a 4x faster host
+    const oversample_bench = addNativeHarness(b, suite_kernel, target, optimize, "bench-oversample", cpp_flags, &.{
+        "bench/oversample_bench.cpp",
+        "native/PluginWrapper.cpp",
+    });
+    const oversample_run = b.addRunArtifact(oversample_bench);
+    bench_step.dependOn(&oversample_run.step);
+    const oversample_step = b.step("bench-oversample", "4x oversampled nonlinear plugins at 48 kHz vs plain at 192 kHz");
+    oversample_step.dependOn(&oversample_run.step);
+
+    // getState/setState round trips for every class, and what recalling a
+    // 500-instance session costs
+    const state_test = addNativeHarness(b, suite_kernel, target, optimize, "test-state", cpp_flags, &.{
+        "tests/state_test.cpp",
+        "native/PluginWrapper.cpp",
+    });
+    test_step.dependOn(&b.addRunArtifact(state_test).step);
+
+    const state_bench = addNativeHarness(b, suite_kernel, target, optimize, "bench-state", cpp_flags, &.{
+        "bench/state_bench.cpp",
+        "native/PluginWrapper.cpp",
+    });
+    const state_run = b.addRunArtifact(state_bench);
+    bench_step.dependOn(&state_run.step);
+    const state_step = b.step("bench-state", "Save and recall a 500-instance session");
+    state_step.dependOn(&state_run.step);
+
+    // sonicchain against the same modules as separate instances: equal
+    // output and latency, and the CPU a fused strip saves
+    const chain_test = addNativeHarness(b, suite_kernel, target, optimize, "test-chain", cpp_flags, &.{
+        "tests/chain_test.cpp",
+        "native/PluginWrapper.cpp",
+    });
+    test_step.dependOn(&b.addRunArtifact(chain_test).step);
+
+    const chain_bench = addNativeHarness(b, suite_kernel, target, optimize, "bench-chain", cpp_flags, &.{
+        "bench/chain_bench.cpp",
+        "native/PluginWrapper.cpp",
+    });
+    const chain_run = b.addRunArtifact(chain_bench);
+    bench_step.dependOn(&chain_run.step);
+    const chain_step = b.step("bench-chain", "Six-module strips as one sonicchain vs six instances");
+    chain_step.dependOn(&chain_run.step);
+
+    // Offline bounces of the heavy spectral classes on worker threads:
+    // bit-identical to real time, and how far they scale
+    const offline_test = addNativeHarness(b, suite_kernel, target, optimize, "test-offline", cpp_flags, &.{
+        "tests/offline_test.cpp",
+        "native/PluginWrapper.cpp",
+    });
+    test_step.dependOn(&b.addRunArtifact(offline_test).step);
+
+    const offline_bench = addNativeHarness(b, suite_kernel, target, optimize, "bench-offline", cpp_flags, &.{
+        "bench/offline_bench.cpp",
+        "native/PluginWrapper.cpp",
+    });
+    const offline_run = b.addRunArtifact(offline_bench);
+    bench_step.dependOn(&offline_run.step);
+    const offline_step = b.step("bench-offline", "Offline spectral rendering scaling from 1 to 16 threads");
+    offline_step.dependOn(&offline_run.step);
+
+    // The FFT YIN tracker against the detector it replaced, and the
+    // real-time tape stabilizer built on it
+    const pitch_test = addNativeHarness(b, suite_kernel, target, optimize, "test-pitch", cpp_flags, &.{
+        "tests/pitch_test.cpp",
+        "native/PluginWrapper.cpp",
+    });
+    test_step.dependOn(&b.addRunArtifact(pitch_test).step);
+
+    // Online WPE dereverberation, and its memory and speed against input
+    // length (the bench forks a process per run, so POSIX only)
+    const echovanish_test = addNativeHarness(b, suite_kernel, target, optimize, "test-echovanish", cpp_flags, &.{
+        "tests/echovanish_test.cpp",
+        "native/PluginWrapper.cpp",
+    });
+    test_step.dependOn(&b.addRunArtifact(echovanish_test).step);
+    if (target.result.os.tag != .windows) {
+        const echovanish_bench = addNativeHarness(b, suite_kernel, target, optimize, "bench-echovanish", cpp_flags, &.{
+            "bench/echovanish_bench.cpp",
+            "native/PluginWrapper.cpp",
+        });
+        const echovanish_run = b.addRunArtifact(echovanish_bench);
+        bench_step.dependOn(&echovanish_run.step);
+        const echovanish_step = b.step("bench-echovanish", "Dereverberation peak RSS and throughput at 1, 10 and 60 minutes");
+        echovanish_step.dependOn(&echovanish_run.step);
+    }
+
+    // Every class's process cost over the block size and sample rate
+    // matrix, as JSON, and the gate against a stored baseline:
+    // zig build bench-plugins -- --json FILE | --compare FILE
+    const plugin_bench = addNativeHarness(b, suite_kernel, target, optimize, "bench-plugins", cpp_flags, &.{
+        "bench/plugin_bench.cpp",
+    });
+    const plugin_bench_run = b.addRunArtifact(plugin_bench);
+    if (b.args) |args| plugin_bench_run.addArgs(args);
+    bench_step.dependOn(&plugin_bench_run.step);
+    const plugin_bench_step = b.step("bench-plugins", "Per-class cost across block sizes and sample rates, JSON and baseline compare");
+    plugin_bench_step.dependOn(&plugin_bench_run.step);
+
+    // Snapshots of full DSP state: bit-exact restores for every class, and
+    // edit-to-preview on a 30-minute file from checkpoints vs from the top
+    const snapshot_test = addNativeHarness(b, suite_kernel, target, optimize, "test-snapshot", cpp_flags, &.{
+        "tests/snapshot_test.cpp",
+    });
+    test_step.dependOn(&b.addRunArtifact(snapshot_test).step);
+
+    const snapshot_bench = addNativeHarness(b, suite_kernel, target, optimize, "bench-snapshot", cpp_flags, &.{
+        "bench/snapshot_bench.cpp",
+    });
+    const snapshot_run = b.addRunArtifact(snapshot_bench);
+    bench_step.dependOn(&snapshot_run.step);
+    const snapshot_step = b.step("bench-snapshot", "Edit-to-preview latency on a 30-minute file, from checkpoints vs from the top");
+    snapshot_step.dependOn(&snapshot_run.step);
+
+    // Real-time meters: readings, gain reduction, a concurrent reader and
+    // the VST3 output parameters, and what metering costs per block
+    const meter_test = addNativeHarness(b, suite_kernel, target, optimize, "test-meter", cpp_flags, &.{
+        "tests/meter_test.cpp",
+        "native/PluginWrapper.cpp",
+    });
+    test_step.dependOn(&b.addRunArtifact(meter_test).step);
+
+    const meter_bench = addNativeHarness(b, suite_kernel, target, optimize, "bench-meter", cpp_flags, &.{
+        "bench/meter_bench.cpp",
+    });
+    const meter_run = b.addRunArtifact(meter_bench);
+    bench_step.dependOn(&meter_run.step);
+    const meter_step = b.step("bench-meter", "Per-block cost of the real-time meters, with a reader polling");
+    meter_step.dependOn(&meter_run.step);
+
+    // Profiling: the sonic-stats reader for the wrappers' shared-memory
+    // counters, and the instrumentation's overhead at small blocks. Both
+    // need POSIX shared memory.
+    if (target.result.os.tag != .windows) {
+        const stats_cli = b.addExecutable(.{
+            .name = "sonic-stats",
+            .root_module = b.createModule(.{
+                .target = target,
+                .optimize = optimize,
+                .link_libc = true,
+                .link_libcpp = true,
+            }),
+        });
+        stats_cli.addCSourceFile(.{
+            .file = b.path("native/stats_cli.cpp"),
+            .flags = &.{ "-std=c++17" },
+        });
+        stats_cli.addIncludePath(b.path("native"));
+        const stats_step = b.step("stats", "Build the sonic-stats profiling reader");
+        stats_step.dependOn(&b.addInstallArtifact(stats_cli, .{}).step);
+
+        const profile_bench = addNativeHarness(b, suite_kernel, target, optimize, "bench-profile", cpp_flags, &.{
+            "bench/profile_bench.cpp",
+            "native/PluginWrapper.cpp",
+        });
+        const profile_run = b.addRunArtifact(profile_bench);
+        bench_step.dependOn(&profile_run.step);
+        const profile_step = b.step("bench-profile", "Measure the profiling overhead at 64-frame blocks");
+        profile_step.dependOn(&profile_run.step);
+    }
+
+    // Many instances across every class, through the C ABI. Linux-only for
+    // the perf_event_open cache-miss counters.
+    if (target.result.os.tag == .linux) {
+        const arena_bench = addNativeHarness(b, suite_kernel, target, optimize, "bench-arena", cpp_flags, &.{
+            "bench/arena_bench.cpp",
+        });
+        const arena_run = b.addRunArtifact(arena_bench);
+        bench_step.dependOn(&arena_run.step);
+        const arena_step = b.step("bench-arena", "Process 200 instances and count cache misses");
+        arena_step.dependOn(&arena_run.step);
+
+        // Headless offline renderer over the same C ABI (mmap'd WAV in and out):
+        // zig build render, then zig-out/bin/sonic-render in.wav out.wav plugin ...
+        // (--normalize LUFS adds a measuring pass; bench/run_normalize_bench.sh)
+        const render = addNativeHarness(b, suite_kernel, target, optimize, "sonic-render", cpp_flags, &.{
+            "native/render_host.cpp",
+        });
+        const render_step = b.step("render", "Build the offline render host");
+        render_step.dependOn(&b.addInstallArtifact(render, .{}).step);
+
+        // Throughput baseline: a minute of generated noise through every plugin in turn
+        const render_run = b.addRunArtifact(render);
+        render_run.addArgs(&.{ "noise:60", "null" });
+        for (suite_entries) |entry| render_run.addArg(entry.id);
+        bench_step.dependOn(&render_run.step);
+        const render_bench_step = b.step("bench-render", "Render a minute of noise through every plugin and report x-RT");
+        render_bench_step.dependOn(&render_run.step);
+    }
+
     // --- AU Shared Library (Native Wrapper) ---
     const au_lib = b.addLibrary(.{
         .linkage = .dynamic,
@@ -85,7 +457,7 @@ pub fn build(b: *std.Build) void {
 
     au_lib.addCSourceFile(.{
         .file = b.path("native/AUWrapper.cpp"),
-        .flags = &.{ "-std=c++17", "-fPIC" },
+        .flags = cpp_flags,
     });
 
     au_lib.linkLibrary(lib);
@@ -152,3 +524,110 @@ pub fn build(b: *std.Build) void {
     mv_cmd.step.dependOn(&mkdir_dist_cmd.step);
     au_step.dependOn(&mv_cmd.step);
 }
+
+const PluginEntry = struct {
+    id: []const u8, // lowercase file stem under plugins/, also seeds the class ID
+    name: []const u8,
+};
+
+/// Writes a module exposing `plugins`, a tuple of { id, name, impl } that
+/// c_export.zig turns into its comptime class table, plus `math`, `cascade`,
+/// `analysis`, `pitch` and `echovanish` for the FFT, EQ cascade, loudness
+/// analysis, pitch tracker and dereverberation exports, and `suite`, which
+/// adds the module chain class.
+fn writePluginTable(sub_path: []const u8, entries: []const PluginEntry, suite: bool) void {
+    var buf: [16 * 1024]u8 = undefined;
+    var stream = std.io.fixedBufferStream(&buf);
+    const w = stream.writer();
+    w.writeAll("pub const math = @import(\"math_utils.zig\");\n") catch @panic("plugin table too large");
+    w.writeAll("pub const cascade = @import(\"dsp/cascade.zig\");\n") catch @panic("plugin table too large");
+    w.writeAll("pub const analysis = @import(\"analysis.zig\");\n") catch @panic("plugin table too large");
+    w.writeAll("pub const pitch = @import(\"pitch_detect.zig\");\n") catch @panic("plugin table too large");
+    w.writeAll("pub const echovanish = @import(\"echovanish.zig\");\n") catch @panic("plugin table too large");
+    w.print("pub const suite = {};\n", .{suite}) catch @panic("plugin table too large");
+    w.writeAll("pub const plugins = .{\n") catch @panic("plugin table too large");
+    for (entries) |e| {
+        w.print("    .{{ .id = \"{s}\", .name = \"{s}\", .impl = @import(\"plugins/{s}.zig\").plugin_impl }},\n", .{ e.id, e.name, e.id }) catch @panic("plugin table too large");
+    }
+    w.writeAll("};\n") catch @panic("plugin table too large");
+    std.fs.cwd().writeFile(.{ .sub_path = sub_path, .data = stream.getWritten() }) catch {};
+}
+
+/// Every plugin source under plugins/, sorted so class indices are stable.
+fn listPlugins(b: *std.Build) []const PluginEntry {
+    var list = std.ArrayList(PluginEntry).init(b.allocator);
+    var dir = std.fs.cwd().openDir("plugins", .{ .iterate = true }) catch @panic("cannot open plugins/");
+    defer dir.close();
+    var it = dir.iterate();
+    while (it.next() catch null) |entry| {
+        if (entry.kind != .file or !std.mem.endsWith(u8, entry.name, ".zig")) continue;
+        const stem = b.dupe(entry.name[0 .. entry.name.len - 4]);
+        list.append(.{ .id = stem, .name = stem }) catch @panic("OOM");
+    }
+    std.mem.sort(PluginEntry, list.items, {}, struct {
+        fn lessThan(_: void, a: PluginEntry, c: PluginEntry) bool {
+            return std.mem.lessThan(u8, a.id, c.id);
+        }
+    }.lessThan);
+    return list.items;
+}
+
+/// Static DSP kernel rooted at c_export.zig over the given generated plugin table.
+fn addKernel(
+    b: *std.Build,
+    entry_path: []const u8,
+    name: []const u8,
+    target: std.Build.ResolvedTarget,
+    optimize: std.builtin.OptimizeMode,
+    build_options: *std.Build.Step.Options,
+) *std.Build.Step.Compile {
+    const plugin_mod = b.createModule(.{
+        .root_source_file = b.path(entry_path),
+        .pic = true,
+    });
+
+    // This compiles the Zig code into a static lib that C++ can link against.
+    const lib_mod = b.createModule(.{
+        .root_source_file = b.path("c_export.zig"),
+        .target = target,
+        .optimize = optimize,
+        .pic = true,
+    });
+    lib_mod.addImport("plugin_impl", plugin_mod);
+    lib_mod.addOptions("build_options", build_options);
+
+    return b.addLibrary(.{
+        .linkage = .static,
+        .name = name,
+        .root_module = lib_mod,
+    });
+}
+
+/// Builds a C++ executable that embeds the given wrapper sources and links the DSP kernel.
+fn addNativeHarness(
+    b: *std.Build,
+    lib: *std.Build.Step.Compile,
+    target: std.Build.ResolvedTarget,
+    optimize: std.builtin.OptimizeMode,
+    name: []const u8,
+    flags: []const []const u8,
+    sources: []const []const u8,
+) *std.Build.Step.Compile {
+    const exe = b.addExecutable(.{
+        .name = name,
+        .root_module = b.createModule(.{
+            .target = target,
+            .optimize = optimize,
+            .link_libc = true,
+            .link_libcpp = true,
+        }),
+    });
+    exe.addCSourceFiles(.{
+        .files = sources,
+        .flags = flags,
+    });
+    exe.linkLibrary(lib);
+    exe.addIncludePath(b.path("native"));
+    exe.addIncludePath(b.path("bench"));
+    return exe;
+}
@@ -1,30 +1,1393 @@
 const std = @import("std");
-const PluginModule = @import("plugin_impl");
+const PluginTable = @import("plugin_impl");
+const PluginInterface = @import("plugin_interface.zig").PluginInterface;
+const instance_arena = @import("instance_arena.zig");
+const InstanceArena = instance_arena.InstanceArena;
+const module_chain = @import("module_chain.zig");
+// math_utils.zig and dsp/ already belong to the plugin module and a file can
+// only be in one, so the FFT, EQ, analysis, pitch and dereverberation
+// exports reach them through the table.
+const math = PluginTable.math;
+const cascade = PluginTable.cascade;
+const analysis = PluginTable.analysis;
+const pitch = PluginTable.pitch;
+const echovanish = PluginTable.echovanish;
+const build_options = @import("build_options");
 
-// The plugin module must export 'plugin_impl' struct
+// The generated plugin module (plugin_entry.zig or suite_entry.zig) exports
+// 'plugins', a tuple of .{ .id, .name, .impl } where impl is a plugin's
+// 'plugin_impl' struct, 'math' (math_utils.zig), 'cascade'
+// (dsp/cascade.zig), 'analysis' (analysis.zig), 'pitch' (pitch_detect.zig),
+// 'echovanish' (echovanish.zig) and 'suite', true for the SonicSuite table,
+// which also gets the module chain class.
 // plugin_impl must have: create, destroy, process, set_parameter, get_parameter.
-const PluginImpl = PluginModule.plugin_impl;
+// Optional: prepare, latency, tail, decayed, and set_channels together with
+// max_channels for plugins that process more (or fewer) than two channels,
+// set_threads for plugins that can spread offline blocks over worker threads,
+// oversampling_param for the index of a latency-changing factor setting,
+// param_count and param_steps for classes that don't have the generic 16
+// continuous parameters, instance_param_steps for stepped parameters that
+// depend on the instance's settings, state_size, save_state and load_state together for learned state,
+// nested for a class that drives other kernel instances, and gain_reduction
+// for dynamics processors the meters should read.
 
-// Global allocator for the DLL
+// Global allocator for the DLL. It backs the instances' handles and arena
+// blocks; plugins themselves only see their arena.
 var gpa = std.heap.GeneralPurposeAllocator(.{}){};
-const allocator = gpa.allocator();
+const allocator = if (build_options.rt_guard) rt_guarded.allocator() else gpa.allocator();
 
+// --- Real-time guard (-Drt-guard) ---
+// The GPA serves small requests from pages it already owns, so a malloc
+// interposer never sees them. With the guard enabled every kernel
+// allocation that reaches the GPA is reported to native/rt_guard.cpp, which flags it when it
+// happens inside a render call.
+const RtGuardCheck = *const fn (what: [*:0]const u8) callconv(.c) void;
+const rt_guard_check = @extern(?RtGuardCheck, .{ .name = "sonic_rt_guard_check", .linkage = .weak });
+
+const rt_guarded = struct {
+    fn allocator() std.mem.Allocator {
+        return .{ .ptr = undefined, .vtable = &vtable };
+    }
+
+    const vtable: std.mem.Allocator.VTable = .{
+        .alloc = alloc,
+        .resize = resize,
+        .remap = remap,
+        .free = free,
+    };
+
+    fn check(what: [*:0]const u8) void {
+        if (rt_guard_check) |f| f(what);
+    }
+
+    fn alloc(_: *anyopaque, len: usize, alignment: std.mem.Alignment, ret_addr: usize) ?[*]u8 {
+        check("zig alloc");
+        return gpa.allocator().rawAlloc(len, alignment, ret_addr);
+    }
+
+    fn resize(_: *anyopaque, memory: []u8, alignment: std.mem.Alignment, new_len: usize, ret_addr: usize) bool {
+        check("zig resize");
+        return gpa.allocator().rawResize(memory, alignment, new_len, ret_addr);
+    }
+
+    fn remap(_: *anyopaque, memory: []u8, alignment: std.mem.Alignment, new_len: usize, ret_addr: usize) ?[*]u8 {
+        check("zig remap");
+        return gpa.allocator().rawRemap(memory, alignment, new_len, ret_addr);
+    }
+
+    fn free(_: *anyopaque, memory: []u8, alignment: std.mem.Alignment, ret_addr: usize) void {
+        check("zig free");
+        gpa.allocator().rawFree(memory, alignment, ret_addr);
+    }
+};
+
+const Class = struct {
+    id: [:0]const u8,
+    name: [:0]const u8,
+    /// FNV-1a of id, stamped into saved state
+    id_hash: u32,
+    vtable: PluginInterface,
+};
+
+/// What the wrappers hold: the class vtable, the plugin's own instance and
+/// the arena block it lives in. plugin_prepare may move the plugin to a
+/// block sized for it, so the Instance is kept apart from the block and
+/// stays put; everything the plugin allocates is freed with the block.
+const Instance = struct {
+    vtable: *const PluginInterface align(instance_arena.cache_line),
+    plugin: *anyopaque,
+    arena: *InstanceArena,
+    /// Frames since the input was last non-zero or the output last above
+    /// quiet_level, saturating. See plugin_tail_decayed.
+    quiet_frames: usize,
+    /// Bus width set by plugin_set_channels; 2 until a wrapper sets one.
+    channels: u32,
+    /// Set by plugin_set_worker_threads; 1 until a wrapper sets more.
+    threads: u32,
+    /// Where the right output of a stereo-only plugin goes on a mono bus.
+    /// Empty unless that adaptation is active. See processMono.
+    mono_sink: []f32,
+    /// Bumped whenever the plugin may have moved or swapped what it holds
+    /// (prepare, a bus width, a thread count), so a snapshot taken before
+    /// is refused. See plugin_restore.
+    layout: u32,
+    /// Rate of the last create or prepare, for the meters' K-weighting.
+    sample_rate: f32,
+    /// Set by plugin_set_metering
+    metering: bool,
+    /// In the arena block's reservation while metering is on; null until a
+    /// prepare has given the block room for it.
+    meter: ?*Meter,
+};
+
+/// Widest bus any class may declare, matching dsp/shared.zig max_channels.
+/// The wrappers size their channel pointer arrays to it.
+const max_bus_channels = 16;
+
+/// Most parameters a class may declare. The wrappers size their parameter
+/// channels to it.
+const max_params = 256;
+
+/// Frames per plugin call when adapting a stereo-only plugin to mono.
+const mono_chunk_frames = 1024;
+
+const instance_header = std.mem.alignForward(usize, @sizeOf(Instance), instance_arena.cache_line);
+
+fn preparedAlready(instance: *anyopaque, alloc: std.mem.Allocator, sample_rate: f32, max_block: usize) bool {
+    _ = instance;
+    _ = alloc;
+    _ = sample_rate;
+    _ = max_block;
+    return true;
+}
+
+fn noDelay(instance: *anyopaque) u32 {
+    _ = instance;
+    return 0;
+}
+
+fn nothingHeld(instance: *anyopaque) bool {
+    _ = instance;
+    return true;
+}
+
+fn stereoOnly(instance: *anyopaque, channels: u32) void {
+    _ = instance;
+    _ = channels;
+}
+
+fn continuous(index: i32) u32 {
+    _ = index;
+    return 0;
+}
+
+fn noLearnedState(instance: *anyopaque) usize {
+    _ = instance;
+    return 0;
+}
+
+fn saveNothing(instance: *anyopaque, out: []u8) void {
+    _ = instance;
+    _ = out;
+}
+
+fn singleThreaded(instance: *anyopaque, threads: u32) void {
+    _ = instance;
+    _ = threads;
+}
+
+fn loadNothing(instance: *anyopaque, data: []const u8) void {
+    _ = instance;
+    _ = data;
+}
+
+fn nothingNested(instance: *anyopaque) []const ?*anyopaque {
+    _ = instance;
+    return &.{};
+}
+
+fn noGainReduction(instance: *anyopaque) f32 {
+    _ = instance;
+    return 0;
+}
+
+fn classStepsOnly(instance: *anyopaque, index: i32) u32 {
+    _ = instance;
+    _ = index;
+    return 0;
+}
+
+fn vtableFor(comptime Impl: type) PluginInterface {
+    if (@hasDecl(Impl, "max_channels") != @hasDecl(Impl, "set_channels"))
+        @compileError("plugin_impl must declare max_channels and set_channels together");
+    if (@hasDecl(Impl, "max_channels") and (Impl.max_channels < 1 or Impl.max_channels > max_bus_channels))
+        @compileError("plugin_impl.max_channels must be between 1 and 16");
+    if (@hasDecl(Impl, "param_count") and (Impl.param_count < 1 or Impl.param_count > max_params))
+        @compileError("plugin_impl.param_count must be between 1 and 256");
+    if (@hasDecl(Impl, "state_size") != @hasDecl(Impl, "save_state") or @hasDecl(Impl, "state_size") != @hasDecl(Impl, "load_state"))
+        @compileError("plugin_impl must declare state_size, save_state and load_state together");
+    return .{
+        .create = &Impl.create,
+        .prepare = if (@hasDecl(Impl, "prepare")) &Impl.prepare else &preparedAlready,
+        .process = &Impl.process,
+        .set_parameter = &Impl.set_parameter,
+        .get_parameter = &Impl.get_parameter,
+        .latency = if (@hasDecl(Impl, "latency")) &Impl.latency else &noDelay,
+        .tail = if (@hasDecl(Impl, "tail")) &Impl.tail else &noDelay,
+        .decayed = if (@hasDecl(Impl, "decayed")) &Impl.decayed else &nothingHeld,
+        .set_channels = if (@hasDecl(Impl, "set_channels")) &Impl.set_channels else &stereoOnly,
+        .set_threads = if (@hasDecl(Impl, "set_threads")) &Impl.set_threads else &singleThreaded,
+        .max_channels = if (@hasDecl(Impl, "max_channels")) Impl.max_channels else 2,
+        .oversampling_param = if (@hasDecl(Impl, "oversampling_param")) Impl.oversampling_param else -1,
+        .param_count = if (@hasDecl(Impl, "param_count")) Impl.param_count else 16,
+        .param_steps = if (@hasDecl(Impl, "param_steps")) &Impl.param_steps else &continuous,
+        .instance_param_steps = if (@hasDecl(Impl, "instance_param_steps")) &Impl.instance_param_steps else &classStepsOnly,
+        .state_size = if (@hasDecl(Impl, "state_size")) &Impl.state_size else &noLearnedState,
+        .save_state = if (@hasDecl(Impl, "save_state")) &Impl.save_state else &saveNothing,
+        .load_state = if (@hasDecl(Impl, "load_state")) &Impl.load_state else &loadNothing,
+        .nested = if (@hasDecl(Impl, "nested")) &Impl.nested else &nothingNested,
+        .gain_reduction = if (@hasDecl(Impl, "gain_reduction")) &Impl.gain_reduction else &noGainReduction,
+        .destroy = &Impl.destroy,
+    };
+}
+
+/// The module chain drives its slots through the same exports a wrapper
+/// uses, so each module keeps its own arena, mono adaptation and silence
+/// tracking.
+const ModuleChain = module_chain.ModuleChain(struct {
+    /// Every class but the chain itself
+    pub const module_classes: u32 = PluginTable.plugins.len;
+    pub const create = plugin_create_class;
+    pub const destroy = plugin_destroy;
+    pub const set_channels = plugin_set_channels;
+    pub const prepare = plugin_prepare;
+    pub const process = plugin_process;
+    pub const set_parameter = plugin_set_parameter;
+    pub const get_parameter = plugin_get_parameter;
+    pub const class_param_steps = plugin_class_param_steps;
+    pub const latency = plugin_get_latency;
+    pub const tail = plugin_get_tail;
+    pub const decayed = plugin_tail_decayed;
+});
+
+/// One class per plugin compiled into this binary, built at comptime, and
+/// in the suite the module chain after them.
+const classes = blk: {
+    // Hashing every id at comptime
+    @setEvalBranchQuota(100_000);
+    const chain = PluginTable.suite;
+    var list: [PluginTable.plugins.len + @intFromBool(chain)]Class = undefined;
+    inline for (PluginTable.plugins, 0..) |p, i| {
+        list[i] = .{ .id = p.id, .name = p.name, .id_hash = std.hash.Fnv1a_32.hash(p.id), .vtable = vtableFor(p.impl) };
+    }
+    if (chain) {
+        const id = "sonicchain";
+        list[PluginTable.plugins.len] = .{ .id = id, .name = id, .id_hash = std.hash.Fnv1a_32.hash(id), .vtable = vtableFor(ModuleChain.plugin_impl) };
+    }
+    break :blk list;
+};
+
+fn instanceFrom(ptr: *anyopaque) *Instance {
+    return @ptrCast(@alignCast(ptr));
+}
+
+fn classOf(inst: *const Instance) *const Class {
+    return @fieldParentPtr("vtable", inst.vtable);
+}
+
+export fn plugin_class_count() u32 {
+    return classes.len;
+}
+
+/// Stable lowercase identifier (the file stem under plugins/).
+export fn plugin_class_id(index: u32) ?[*:0]const u8 {
+    if (index >= classes.len) return null;
+    return classes[index].id.ptr;
+}
+
+export fn plugin_class_name(index: u32) ?[*:0]const u8 {
+    if (index >= classes.len) return null;
+    return classes[index].name.ptr;
+}
+
+/// Widest bus an instance of this class accepts in plugin_set_channels, so
+/// wrappers can answer speaker-arrangement queries before creating one.
+/// 0 if the class is unknown.
+export fn plugin_class_max_channels(index: u32) u32 {
+    if (index >= classes.len) return 0;
+    return classes[index].vtable.max_channels;
+}
+
+/// Parameter selecting the oversampling factor (normalised 0, 1/3, 2/3, 1
+/// for 1x, 2x, 4x, 8x), or -1 if the class has none or is unknown.
+export fn plugin_class_oversampling_param(index: u32) i32 {
+    if (index >= classes.len) return -1;
+    return classes[index].vtable.oversampling_param;
+}
+
+/// Parameters an instance of this class takes, 0 if the class is unknown.
+/// 16 for everything but the module chain.
+export fn plugin_class_param_count(index: u32) u32 {
+    if (index >= classes.len) return 0;
+    return classes[index].vtable.param_count;
+}
+
+/// For a parameter that picks one of several discrete settings which can
+/// change latency (oversampling factor, a chain slot's module), the number
+/// of steps above 0: normalised values k / steps. 0 for a continuous,
+/// automatable parameter or an unknown class. A wrapper should re-prepare
+/// the instance once such a setting has moved, outside processing; a chain
+/// only swaps modules then.
+export fn plugin_class_param_steps(index: u32, param: i32) u32 {
+    if (index >= classes.len) return 0;
+    const vtable = &classes[index].vtable;
+    if (param == vtable.oversampling_param) return 3;
+    return vtable.param_steps(param);
+}
+
+/// plugin_class_param_steps, plus stepped parameters that only this
+/// instance's settings make so: in a chain, the oversampling factor of the
+/// module a slot selects. May change when such a selector moves; safe to
+/// call from a UI thread while the instance processes.
+export fn plugin_param_steps(instance: *anyopaque, param: i32) u32 {
+    const inst = instanceFrom(instance);
+    if (param == inst.vtable.oversampling_param) return 3;
+    const steps = inst.vtable.param_steps(param);
+    if (steps > 0) return steps;
+    return inst.vtable.instance_param_steps(inst.plugin, param);
+}
+
+// Create-time footprints depend only on class and sample rate, so the
+// measuring pass runs once per class until the rate changes.
+const Footprint = struct { sample_rate: f32 = 0, bytes: usize = 0 };
+var footprint_lock: std.Thread.Mutex = .{};
+var footprints = [_]Footprint{.{}} ** classes.len;
+
+fn measureFootprint(index: u32, sample_rate: f32) ?usize {
+    footprint_lock.lock();
+    defer footprint_lock.unlock();
+    const cached = &footprints[index];
+    if (cached.bytes != 0 and cached.sample_rate == sample_rate) return cached.bytes;
+
+    // Create and destroy a throwaway instance to see what it allocates
+    const vtable = &classes[index].vtable;
+    var sizer = instance_arena.Sizer.init(allocator, 0);
+    const plugin = vtable.create(sizer.allocator(), sample_rate) orelse return null;
+    vtable.destroy(plugin, sizer.allocator());
+
+    cached.* = .{ .sample_rate = sample_rate, .bytes = sizer.footprint() };
+    return cached.bytes;
+}
+
+/// Arena capacity a new instance of this class gets, or null if the class
+/// can't be created. With -Dinstance-arena=false the block holds only the
+/// arena's own fields and plugins allocate from the shared GPA, as before.
+fn createCapacity(index: u32, sample_rate: f32) ?usize {
+    if (!build_options.instance_arena) return 0;
+    return measureFootprint(index, sample_rate);
+}
+
+/// Bytes an instance of this class takes at this sample rate until its
+/// first plugin_prepare: the kernel's handle and the arena block. 0 if the
+/// class is unknown or cannot be created. Prepare sizes the block again for
+/// the rate, block size, bus width and thread count it is given; see
+/// plugin_instance_footprint for what an instance holds now.
+export fn plugin_memory_footprint(index: u32, sample_rate: f32) usize {
+    if (index >= classes.len) return 0;
+    const capacity = createCapacity(index, sample_rate) orelse return 0;
+    return instance_header + InstanceArena.header + capacity;
+}
+
+/// Bytes the instance holds right now: its handle and its arena block.
+export fn plugin_instance_footprint(instance: *anyopaque) usize {
+    return instance_header + instanceFrom(instance).arena.buffer.len;
+}
+
+export fn plugin_create_class(index: u32, sample_rate: f32) ?*anyopaque {
+    if (index >= classes.len) return null;
+    const capacity = createCapacity(index, sample_rate) orelse return null;
+    const vtable = &classes[index].vtable;
+    const overflow: ?std.mem.Allocator = if (build_options.instance_arena) null else allocator;
+
+    const inst = allocator.create(Instance) catch return null;
+    const arena = InstanceArena.create(allocator, 0, capacity, overflow) catch {
+        allocator.destroy(inst);
+        return null;
+    };
+    inst.* = .{
+        .vtable = vtable,
+        .plugin = undefined,
+        .arena = arena,
+        .quiet_frames = 0,
+        .channels = 2,
+        .threads = 1,
+        .mono_sink = &.{},
+        .layout = 0,
+        .sample_rate = sample_rate,
+        .metering = false,
+        .meter = null,
+    };
+    inst.plugin = vtable.create(arena.allocator(), sample_rate) orelse {
+        arena.destroy(allocator);
+        allocator.destroy(inst);
+        return null;
+    };
+    return inst;
+}
+
+/// Creates the first (in single-plugin builds, the only) class.
 export fn plugin_create(sample_rate: f32) ?*anyopaque {
-    return PluginImpl.create(allocator, sample_rate);
+    return plugin_create_class(0, sample_rate);
 }
 
 export fn plugin_destroy(instance: *anyopaque) void {
-    PluginImpl.destroy(instance, allocator);
+    const inst = instanceFrom(instance);
+    inst.vtable.destroy(inst.plugin, inst.arena.allocator());
+    if (inst.mono_sink.len != 0) allocator.free(inst.mono_sink);
+    inst.arena.destroy(allocator);
+    allocator.destroy(inst);
+}
+
+/// Sets how many channel pointers the following plugin_process calls pass
+/// in each of inputs and outputs. Every class takes 1 or 2; wider buses
+/// need a class whose plugin_class_max_channels allows them. A stereo-only
+/// class on a mono bus is fed the one channel on both inputs. Changing the
+/// width clears per-channel state. Never concurrent with plugin_process.
+/// Returns 0, or -1 if the width is unsupported and the previous one stays.
+export fn plugin_set_channels(instance: *anyopaque, channels: u32) i32 {
+    const inst = instanceFrom(instance);
+    if (channels == 0 or channels > inst.vtable.max_channels) return -1;
+    if (channels == inst.channels) return 0;
+
+    const adapt_mono = channels == 1 and inst.vtable.set_channels == &stereoOnly;
+    if (adapt_mono) {
+        if (inst.mono_sink.len == 0) inst.mono_sink = allocator.alloc(f32, mono_chunk_frames) catch return -1;
+    } else {
+        if (inst.mono_sink.len != 0) allocator.free(inst.mono_sink);
+        inst.mono_sink = &.{};
+        inst.vtable.set_channels(inst.plugin, channels);
+    }
+    inst.channels = channels;
+    inst.quiet_frames = 0;
+    inst.layout +%= 1;
+    if (inst.meter) |meter| meter.restart(channels, inst.sample_rate);
+    return 0;
+}
+
+/// Lets plugin_process spread large blocks over `threads` threads, the
+/// caller's included, for offline rendering; 0 or 1 keeps it on the
+/// caller's thread, which is what a real-time host needs. Instances share
+/// one set of worker threads, started here, never in process. Takes effect
+/// at the next plugin_prepare; the output is bit-identical for any count.
+/// Classes without a parallel path ignore it. Never concurrent with
+/// plugin_process.
+export fn plugin_set_worker_threads(instance: *anyopaque, threads: u32) void {
+    const inst = instanceFrom(instance);
+    inst.threads = @max(threads, 1);
+    inst.vtable.set_threads(inst.plugin, inst.threads);
+    inst.layout +%= 1;
+}
+
+/// Bus width and thread count as the instance's plugin has them, for a
+/// plugin made to stand in for it
+fn applyLayout(inst: *const Instance, plugin: *anyopaque) void {
+    if (inst.channels != 2) inst.vtable.set_channels(plugin, inst.channels);
+    if (inst.threads != 1) inst.vtable.set_threads(plugin, inst.threads);
+}
+
+/// Arena capacity the instance's plugin needs once prepared like this: a
+/// throwaway one is created, given the same layout and prepared on a Sizer.
+fn measurePrepared(inst: *const Instance, sample_rate: f32, max_block: usize) ?usize {
+    var sizer = instance_arena.Sizer.init(allocator, 0);
+    const plugin = inst.vtable.create(sizer.allocator(), sample_rate) orelse return null;
+    defer inst.vtable.destroy(plugin, sizer.allocator());
+    applyLayout(inst, plugin);
+    if (!inst.vtable.prepare(plugin, sizer.allocator(), sample_rate, max_block)) return null;
+    return sizer.footprint();
+}
+
+/// Hands the instance's learned state (plugin_save_state's payload) to a
+/// plugin made to stand in for it. Allocates, so never on the audio thread.
+fn copyLearnedState(inst: *const Instance, plugin: *anyopaque) bool {
+    const size = inst.vtable.state_size(inst.plugin);
+    if (size == 0 or inst.vtable.state_size(plugin) != size) return true;
+    const bytes = allocator.alloc(u8, size) catch return false;
+    defer allocator.free(bytes);
+    inst.vtable.save_state(inst.plugin, bytes);
+    inst.vtable.load_state(plugin, bytes);
+    return true;
+}
+
+/// Bytes the instance's block reserves ahead of the plugin: its meter
+/// while metering is on
+fn reserveFor(inst: *const Instance) usize {
+    return if (inst.metering) @sizeOf(Meter) else 0;
+}
+
+/// Moves the instance to a block sized for this prepare. The plugin is
+/// created again there and given the old one's layout, parameters and
+/// learned state before it is prepared; what it was running (delay lines,
+/// envelopes) starts over, and so do the meters. On failure the old block
+/// and plugin stay.
+fn rebuild(inst: *Instance, sample_rate: f32, max_block: usize) bool {
+    const vtable = inst.vtable;
+    const capacity = if (build_options.instance_arena)
+        (measurePrepared(inst, sample_rate, max_block) orelse return false)
+    else
+        0;
+    const arena = InstanceArena.create(allocator, reserveFor(inst), capacity, inst.arena.overflow) catch return false;
+    const plugin = vtable.create(arena.allocator(), sample_rate) orelse {
+        arena.destroy(allocator);
+        return false;
+    };
+    applyLayout(inst, plugin);
+    for (0..vtable.param_count) |p| {
+        vtable.set_parameter(plugin, @intCast(p), vtable.get_parameter(inst.plugin, @intCast(p)));
+    }
+    if (!copyLearnedState(inst, plugin) or !vtable.prepare(plugin, arena.allocator(), sample_rate, max_block)) {
+        vtable.destroy(plugin, arena.allocator());
+        arena.destroy(allocator);
+        return false;
+    }
+    vtable.destroy(inst.plugin, inst.arena.allocator());
+    inst.arena.destroy(allocator);
+    inst.plugin = plugin;
+    inst.arena = arena;
+    inst.meter = null;
+    return true;
+}
+
+/// Sizes the instance for the rate, block size, bus width and thread count
+/// it now has. The plugin prepares in its block if that holds what it
+/// allocates and the meter (plugin_set_metering); if not, it is moved to
+/// one that does (see rebuild), so no part of an instance ever lives
+/// outside its block. Returns 0 on success, -1 if the instance kept its
+/// previous configuration.
+export fn plugin_prepare(instance: *anyopaque, sample_rate: f32, max_block: usize) i32 {
+    const inst = instanceFrom(instance);
+    // Latency and tail may have changed with the rate
+    inst.quiet_frames = 0;
+    inst.layout +%= 1;
+    if (inst.arena.reservation().len < reserveFor(inst)) {
+        if (!rebuild(inst, sample_rate, max_block)) return -1;
+    } else {
+        const misses = inst.arena.misses;
+        if (!inst.vtable.prepare(inst.plugin, inst.arena.allocator(), sample_rate, max_block)) {
+            // Only a block that ran out of room is worth building again
+            const out_of_room = inst.arena.overflow == null and inst.arena.misses != misses;
+            if (!out_of_room or !rebuild(inst, sample_rate, max_block)) return -1;
+        }
+    }
+    inst.sample_rate = sample_rate;
+    if (inst.meter) |meter| {
+        meter.restart(inst.channels, sample_rate);
+    } else if (inst.metering) {
+        placeMeter(inst);
+    }
+    return 0;
 }
 
+/// Output at or below this (-100 dBFS) counts as silent when deciding
+/// whether a tail has decayed. Matches dsp/delay.zig silence_threshold.
+const quiet_level: f32 = 1e-5;
+
+fn allZero(samples: []const f32) bool {
+    for (samples) |s| {
+        if (s != 0) return false;
+    }
+    return true;
+}
+
+fn allQuiet(samples: []const f32) bool {
+    for (samples) |s| {
+        if (@abs(s) > quiet_level) return false;
+    }
+    return true;
+}
+
+fn busSilent(inputs: [*]const [*]const f32, outputs: [*][*]f32, channels: usize, frames: usize) bool {
+    for (0..channels) |c| {
+        if (!allZero(inputs[c][0..frames])) return false;
+    }
+    for (0..channels) |c| {
+        if (!allQuiet(outputs[c][0..frames])) return false;
+    }
+    return true;
+}
+
+/// Counts how long the instance has been fed digital silence and answered
+/// with (near) silence. Outputs are only scanned while the input is silent,
+/// so a busy track pays for one early-exiting pass over its input.
+fn trackSilence(inst: *Instance, inputs: [*]const [*]const f32, outputs: [*][*]f32, frames: usize) void {
+    const silent = busSilent(inputs, outputs, inst.channels, frames);
+    inst.quiet_frames = if (silent) inst.quiet_frames +| frames else 0;
+}
+
+/// A stereo-only plugin on a mono bus: both of its inputs read the one
+/// channel, its left output is the bus output and its right output is
+/// dropped into mono_sink, one sink-sized chunk at a time.
+fn processMono(inst: *Instance, input: [*]const f32, output: [*]f32, frames: usize) void {
+    var pos: usize = 0;
+    while (pos < frames) {
+        const n = @min(inst.mono_sink.len, frames - pos);
+        const ins = [2][*]const f32{ input + pos, input + pos };
+        var outs = [2][*]f32{ output + pos, inst.mono_sink.ptr };
+        inst.vtable.process(inst.plugin, &ins, &outs, n);
+        pos += n;
+    }
+}
+
+/// inputs and outputs each hold one pointer per channel of the bus set with
+/// plugin_set_channels (two by default).
 export fn plugin_process(instance: *anyopaque, inputs: [*]const [*]const f32, outputs: [*][*]f32, frames: usize) void {
-    PluginImpl.process(instance, inputs, outputs, frames);
+    const inst = instanceFrom(instance);
+    if (inst.mono_sink.len != 0) {
+        processMono(inst, inputs[0], outputs[0], frames);
+    } else {
+        inst.vtable.process(inst.plugin, inputs, outputs, frames);
+    }
+    trackSilence(inst, inputs, outputs, frames);
+    if (inst.meter) |meter| meter.measure(outputs, frames, gainReduction(inst));
 }
 
 export fn plugin_set_parameter(instance: *anyopaque, index: i32, value: f32) void {
-    PluginImpl.set_parameter(instance, index, value);
+    const inst = instanceFrom(instance);
+    inst.vtable.set_parameter(inst.plugin, index, value);
 }
 
 export fn plugin_get_parameter(instance: *anyopaque, index: i32) f32 {
-    return PluginImpl.get_parameter(instance, index);
+    const inst = instanceFrom(instance);
+    return inst.vtable.get_parameter(inst.plugin, index);
+}
+
+/// Processing delay in samples, for host delay compensation.
+export fn plugin_get_latency(instance: *anyopaque) u32 {
+    const inst = instanceFrom(instance);
+    return inst.vtable.latency(inst.plugin);
+}
+
+/// Samples of output after the input goes silent, not counting latency.
+export fn plugin_get_tail(instance: *anyopaque) u32 {
+    const inst = instanceFrom(instance);
+    return inst.vtable.tail(inst.plugin);
+}
+
+/// Running count of allocations the instance asked for that its block
+/// couldn't hold: refused, or with -Dinstance-arena=false served from the
+/// shared heap. The wrappers' profiler samples it around each process
+/// call; it only ever grows, wrapping at 2^64.
+export fn plugin_heap_allocs(instance: *anyopaque) u64 {
+    const inst = instanceFrom(instance);
+    return inst.arena.misses;
+}
+
+/// 1 once the instance's output can no longer change while its input stays
+/// digitally silent: input and output have been silent for at least latency
+/// + tail samples and the plugin reports nothing left in its delay lines or
+/// envelopes. Until the input changes, a wrapper may then skip
+/// plugin_process and write silence instead; the counter only advances in
+/// plugin_process, so it stays decayed for as long as processing is skipped.
+export fn plugin_tail_decayed(instance: *anyopaque) i32 {
+    const inst = instanceFrom(instance);
+    const window = @max(@as(usize, inst.vtable.latency(inst.plugin)) + inst.vtable.tail(inst.plugin), 1);
+    if (inst.quiet_frames < window) return 0;
+    return if (inst.vtable.decayed(inst.plugin)) 1 else 0;
+}
+
+// --- State ---
+// plugin_save_state writes a versioned, little-endian blob:
+//   u32 magic "SNST", u16 format version, u16 parameter count,
+//   u32 FNV-1a hash of the class id, u32 learned-state bytes,
+//   one f32 per parameter (plugin_get_parameter, normalised),
+//   then the plugin's learned state (plugin_interface.zig save_state).
+// Any host or wrapper can store it as-is.
+
+const state_magic: u32 = 0x54534E53; // "SNST"
+const state_version: u16 = 1;
+const state_header = 16;
+fn stateSize(inst: *Instance) usize {
+    return state_header + 4 * inst.vtable.param_count + inst.vtable.state_size(inst.plugin);
+}
+
+/// Bytes plugin_save_state needs right now. Only changes with the learned
+/// state's size, which is fixed for an instance.
+export fn plugin_get_state_size(instance: *anyopaque) usize {
+    return stateSize(instanceFrom(instance));
+}
+
+/// Writes the instance's state to `out`. Returns the bytes written, or 0 if
+/// capacity is below plugin_get_state_size. Not synchronised with
+/// plugin_process; learned state read mid-learn may be a mix of two blocks.
+export fn plugin_save_state(instance: *anyopaque, out: [*]u8, capacity: usize) usize {
+    const inst = instanceFrom(instance);
+    const size = stateSize(inst);
+    if (capacity < size) return 0;
+    const bytes = out[0..size];
+    const params = inst.vtable.param_count;
+    const learned = size - state_header - 4 * params;
+
+    std.mem.writeInt(u32, bytes[0..4], state_magic, .little);
+    std.mem.writeInt(u16, bytes[4..6], state_version, .little);
+    std.mem.writeInt(u16, bytes[6..8], @intCast(params), .little);
+    std.mem.writeInt(u32, bytes[8..12], classOf(inst).id_hash, .little);
+    std.mem.writeInt(u32, bytes[12..16], @intCast(learned), .little);
+    for (0..params) |i| {
+        const value = inst.vtable.get_parameter(inst.plugin, @intCast(i));
+        std.mem.writeInt(u32, bytes[state_header + 4 * i ..][0..4], @bitCast(value), .little);
+    }
+    inst.vtable.save_state(inst.plugin, bytes[state_header + 4 * params ..]);
+    return size;
+}
+
+/// Restores a blob from plugin_save_state of the same class: parameters
+/// first, then learned state. Never allocates, so a wrapper may apply it
+/// on the audio thread between plugin_process calls. Returns 0, or -1 if
+/// the blob is damaged, newer than this build, from another class or
+/// carries learned state of the wrong size; the instance is then
+/// untouched.
+export fn plugin_load_state(instance: *anyopaque, data: [*]const u8, len: usize) i32 {
+    const inst = instanceFrom(instance);
+    if (len < state_header) return -1;
+    const bytes = data[0..len];
+    if (std.mem.readInt(u32, bytes[0..4], .little) != state_magic) return -1;
+    const version = std.mem.readInt(u16, bytes[4..6], .little);
+    if (version == 0 or version > state_version) return -1;
+    const params: usize = std.mem.readInt(u16, bytes[6..8], .little);
+    if (std.mem.readInt(u32, bytes[8..12], .little) != classOf(inst).id_hash) return -1;
+    const learned: usize = std.mem.readInt(u32, bytes[12..16], .little);
+    if (len != state_header + 4 * params + learned) return -1;
+    if (learned != inst.vtable.state_size(inst.plugin)) return -1;
+
+    for (0..@min(params, inst.vtable.param_count)) |i| {
+        const value: f32 = @bitCast(std.mem.readInt(u32, bytes[state_header + 4 * i ..][0..4], .little));
+        inst.vtable.set_parameter(inst.plugin, @intCast(i), value);
+    }
+    inst.vtable.load_state(inst.plugin, bytes[state_header + 4 * params ..]);
+    inst.quiet_frames = 0;
+    return 0;
+}
+
+// --- Snapshots ---
+// plugin_snapshot copies everything an instance has running, delay lines,
+// envelopes and STFT frames along with parameters and learned state, so a
+// renderer can keep checkpoints along a file and, after an edit, restart
+// from the last one before it instead of from the top. All of an instance
+// lives in its arena block, however it was prepared (plugin_prepare moves
+// it to a bigger block rather than let anything spill out), so a snapshot
+// is the block's used bytes as they are, pointers included, behind a
+// header:
+//   u32 magic "SNSN", u16 format version, u16 nested snapshots,
+//   u32 FNV-1a hash of the class id, u32 layout (Instance.layout),
+//   u64 block address, u64 quiet frames, u64 arena bytes,
+//   the arena bytes, then a snapshot of each nested instance (a chain's
+//   loaded modules, in slot order).
+// The pointers are into the block itself or to kernel-wide objects that
+// outlive every instance (the worker pool), so they hold for as long as
+// the instance keeps that block and layout, and a restore checks both.
+// Unlike plugin_save_state's blob a snapshot is therefore no use to store
+// or to give another instance.
+
+const snapshot_magic: u32 = 0x4E534E53; // "SNSN"
+const snapshot_version: u16 = 2;
+const snapshot_header = 40;
+
+/// Arena bytes in use
+fn arenaImage(inst: *const Instance) []u8 {
+    return inst.arena.used();
+}
+
+/// null if some of the instance, or of one it drives, is outside its
+/// arena, which only happens with -Dinstance-arena=false
+fn snapshotSize(inst: *Instance) ?usize {
+    if (inst.arena.overflow_live != 0) return null;
+    var size = snapshot_header + arenaImage(inst).len;
+    for (inst.vtable.nested(inst.plugin)) |slot| {
+        if (slot) |m| size += snapshotSize(instanceFrom(m)) orelse return null;
+    }
+    return size;
+}
+
+fn writeSnapshot(inst: *Instance, out: []u8) usize {
+    const image = arenaImage(inst);
+    const nested = inst.vtable.nested(inst.plugin);
+    var count: u16 = 0;
+    for (nested) |slot| count += @intFromBool(slot != null);
+
+    std.mem.writeInt(u32, out[0..4], snapshot_magic, .little);
+    std.mem.writeInt(u16, out[4..6], snapshot_version, .little);
+    std.mem.writeInt(u16, out[6..8], count, .little);
+    std.mem.writeInt(u32, out[8..12], classOf(inst).id_hash, .little);
+    std.mem.writeInt(u32, out[12..16], inst.layout, .little);
+    std.mem.writeInt(u64, out[16..24], @intFromPtr(inst.arena.buffer.ptr), .little);
+    std.mem.writeInt(u64, out[24..32], inst.quiet_frames, .little);
+    std.mem.writeInt(u64, out[32..40], image.len, .little);
+    @memcpy(out[snapshot_header..][0..image.len], image);
+
+    var pos = snapshot_header + image.len;
+    for (nested) |slot| {
+        if (slot) |m| pos += writeSnapshot(instanceFrom(m), out[pos..]);
+    }
+    return pos;
+}
+
+/// Length of the snapshot of `inst` at the start of `bytes`, or null if
+/// it isn't one this instance can take back as it is now
+fn checkSnapshot(inst: *Instance, bytes: []const u8) ?usize {
+    if (bytes.len < snapshot_header) return null;
+    if (std.mem.readInt(u32, bytes[0..4], .little) != snapshot_magic) return null;
+    if (std.mem.readInt(u16, bytes[4..6], .little) != snapshot_version) return null;
+    if (std.mem.readInt(u32, bytes[8..12], .little) != classOf(inst).id_hash) return null;
+    if (std.mem.readInt(u32, bytes[12..16], .little) != inst.layout) return null;
+    if (std.mem.readInt(u64, bytes[16..24], .little) != @intFromPtr(inst.arena.buffer.ptr)) return null;
+    if (std.mem.readInt(u64, bytes[32..40], .little) != arenaImage(inst).len) return null;
+    if (inst.arena.overflow_live != 0) return null;
+
+    var pos = snapshot_header + arenaImage(inst).len;
+    if (bytes.len < pos) return null;
+    var count: usize = 0;
+    for (inst.vtable.nested(inst.plugin)) |slot| {
+        const m = slot orelse continue;
+        pos += checkSnapshot(instanceFrom(m), bytes[pos..]) orelse return null;
+        count += 1;
+    }
+    if (std.mem.readInt(u16, bytes[6..8], .little) != count) return null;
+    return pos;
+}
+
+fn applySnapshot(inst: *Instance, bytes: []const u8) usize {
+    const image = arenaImage(inst);
+    @memcpy(image, bytes[snapshot_header..][0..image.len]);
+    inst.quiet_frames = @intCast(std.mem.readInt(u64, bytes[24..32], .little));
+
+    var pos = snapshot_header + image.len;
+    for (inst.vtable.nested(inst.plugin)) |slot| {
+        if (slot) |m| pos += applySnapshot(instanceFrom(m), bytes[pos..]);
+    }
+    return pos;
+}
+
+/// Bytes plugin_snapshot needs right now: the instance's arena in use
+/// plus a header, and the same for each instance it drives. Changes only
+/// with prepare. 0 with -Dinstance-arena=false, where plugins allocate
+/// from the shared heap and can't be snapshotted.
+export fn plugin_snapshot_size(instance: *anyopaque) usize {
+    return snapshotSize(instanceFrom(instance)) orelse 0;
+}
+
+/// Copies the instance's full DSP state to `out`, parameters included.
+/// Costs a memcpy of plugin_snapshot_size bytes and never allocates.
+/// Returns the bytes written, or 0 if capacity is below
+/// plugin_snapshot_size or the instance can't be snapshotted. Never
+/// concurrent with plugin_process or parameter changes.
+export fn plugin_snapshot(instance: *anyopaque, out: [*]u8, capacity: usize) usize {
+    const inst = instanceFrom(instance);
+    const size = snapshotSize(inst) orelse return 0;
+    if (capacity < size) return 0;
+    return writeSnapshot(inst, out[0..size]);
+}
+
+/// Puts the instance back exactly as plugin_snapshot found it: fed the
+/// same input from there, it gives the same output, bit for bit. Parameters
+/// come back too, so a renderer re-applies any edit after restoring.
+/// Never allocates. Returns 0, or -1 if the snapshot is damaged, from
+/// another instance, or from before the instance was last prepared, given
+/// a bus width or a thread count; the instance is then untouched. Never
+/// concurrent with plugin_process or parameter changes.
+export fn plugin_restore(instance: *anyopaque, data: [*]const u8, len: usize) i32 {
+    const inst = instanceFrom(instance);
+    const bytes = data[0..len];
+    const size = checkSnapshot(inst, bytes) orelse return -1;
+    if (size != len) return -1;
+    _ = applySnapshot(inst, bytes);
+    return 0;
+}
+
+// --- Meters ---
+// Levels for the wrappers' meters: plugin_process publishes them on the
+// audio thread and plugin_read_meters reads them from one other thread, or
+// from the audio thread between blocks. Neither side waits for the other.
+// The audio thread publishes through a seqlock (an odd sequence number
+// while it stores, even once the values are whole); a read that overlaps a
+// store tries again a few times and then gives up until the next poll.
+//
+// Peak, RMS and gain reduction cover everything processed since the last
+// read, so a UI polling at 30 Hz still sees a peak between two polls, and a
+// wrapper reading after every block gets that block's figures. Momentary
+// loudness is the last 400 ms. Peak and RMS are of the first two output
+// channels (a mono bus's one channel on both sides), loudness of the whole
+// bus, gain reduction the class's own or, in a chain, the deepest module's.
+
+/// plugin_read_meters' result; native/meters.h is the C side.
+const MeterReadings = extern struct {
+    peak_db: [2]f32,
+    rms_db: [2]f32,
+    momentary_lufs: f32,
+    gain_reduction_db: f32,
+    /// plugin_process calls measured since metering was turned on
+    blocks: u64,
+};
+
+/// Level reported for silence and anything below it
+const meter_floor_db: f32 = -100;
+/// Attempts plugin_read_meters makes at a seqlock the audio thread holds
+const meter_read_tries = 16;
+
+const Meter = struct {
+    // Audio thread only
+    loudness: analysis.GatedLoudness,
+    peak: [2]f32 = .{ 0, 0 },
+    energy: [2]f64 = .{ 0, 0 },
+    frames: u64 = 0,
+    gain_reduction: f32 = 0,
+    blocks: u64 = 0,
+
+    // Shared with the reader
+    sequence: std.atomic.Value(u32) = std.atomic.Value(u32).init(0),
+    /// f32 bit patterns: the peaks, the mean squares, momentary loudness
+    /// and gain reduction
+    values: [6]std.atomic.Value(u32) = [_]std.atomic.Value(u32){std.atomic.Value(u32).init(0)} ** 6,
+    published: std.atomic.Value(u64) = std.atomic.Value(u64).init(0),
+    /// The `published` count the reader last got. Only the reader writes
+    /// it, on a line of its own so polling doesn't steal the audio
+    /// thread's.
+    acknowledged: std.atomic.Value(u64) align(instance_arena.cache_line) = std.atomic.Value(u64).init(0),
+
+    /// A new bus width or rate: the loudness filters start over, the
+    /// running figures carry on.
+    fn restart(self: *Meter, channels: u32, sample_rate: f32) void {
+        self.loudness = analysis.GatedLoudness.init(channels, sample_rate);
+    }
+
+    /// Once the reader has everything published so far, the figures start
+    /// over; until then they keep accumulating, so a block published
+    /// while a read was under way is never lost.
+    fn startBlock(self: *Meter) void {
+        if (self.acknowledged.load(.acquire) != self.blocks) return;
+        self.peak = .{ 0, 0 };
+        self.energy = .{ 0, 0 };
+        self.frames = 0;
+        self.gain_reduction = 0;
+    }
+
+    fn measure(self: *Meter, outputs: [*]const [*]f32, frames: usize, gain_reduction: f32) void {
+        self.startBlock();
+        const channels = self.loudness.channels;
+        for (0..@min(channels, 2)) |c| {
+            const level = levels(outputs[c][0..frames]);
+            self.peak[c] = @max(self.peak[c], level.peak);
+            self.energy[c] += level.energy;
+        }
+        if (channels == 1) {
+            self.peak[1] = self.peak[0];
+            self.energy[1] = self.energy[0];
+        }
+        self.frames += frames;
+        self.gain_reduction = @max(self.gain_reduction, gain_reduction);
+        self.loudness.pushPlanar(@ptrCast(outputs), frames);
+        self.publish();
+    }
+
+    fn silence(self: *Meter, frames: usize) void {
+        self.startBlock();
+        self.frames += frames;
+        self.loudness.pushSilence(frames);
+        self.publish();
+    }
+
+    fn publish(self: *Meter) void {
+        self.blocks += 1;
+        const frames: f64 = @floatFromInt(@max(self.frames, 1));
+        const values = [6]f32{
+            self.peak[0],
+            self.peak[1],
+            @floatCast(self.energy[0] / frames),
+            @floatCast(self.energy[1] / frames),
+            self.loudness.momentary(),
+            self.gain_reduction,
+        };
+        // A reader that sees any of the new values also sees the odd
+        // sequence number, since each value is a release store after it
+        const sequence = self.sequence.load(.monotonic);
+        self.sequence.store(sequence +% 1, .monotonic);
+        for (&self.values, values) |*slot, value| slot.store(@bitCast(value), .release);
+        self.published.store(self.blocks, .release);
+        self.sequence.store(sequence +% 2, .release);
+    }
+
+    fn read(self: *Meter, out: *MeterReadings) bool {
+        var values: [6]f32 = undefined;
+        for (0..meter_read_tries) |_| {
+            const before = self.sequence.load(.acquire);
+            if (before & 1 != 0) {
+                std.atomic.spinLoopHint();
+                continue;
+            }
+            for (&values, &self.values) |*value, *slot| value.* = @bitCast(slot.load(.acquire));
+            const blocks = self.published.load(.acquire);
+            if (self.sequence.load(.monotonic) != before) continue;
+
+            out.* = .{
+                .peak_db = .{ amplitudeDb(values[0]), amplitudeDb(values[1]) },
+                .rms_db = .{ powerDb(values[2]), powerDb(values[3]) },
+                .momentary_lufs = values[4],
+                .gain_reduction_db = values[5],
+                .blocks = blocks,
+            };
+            self.acknowledged.store(blocks, .release);
+            return true;
+        }
+        return false;
+    }
+};
+
+const Levels = struct { peak: f32, energy: f64 };
+
+fn levels(samples: []const f32) Levels {
+    const lanes = 8;
+    const V = @Vector(lanes, f32);
+    var peak: V = @splat(0);
+    var sum: V = @splat(0);
+    var i: usize = 0;
+    while (i + lanes <= samples.len) : (i += lanes) {
+        const x: V = samples[i..][0..lanes].*;
+        peak = @max(peak, @abs(x));
+        sum += x * x;
+    }
+    var result = Levels{ .peak = @reduce(.Max, peak), .energy = @reduce(.Add, sum) };
+    for (samples[i..]) |x| {
+        result.peak = @max(result.peak, @abs(x));
+        result.energy += x * x;
+    }
+    return result;
+}
+
+fn amplitudeDb(amplitude: f32) f32 {
+    return if (amplitude > 1e-5) 20.0 * std.math.log10(amplitude) else meter_floor_db;
+}
+
+fn powerDb(power: f32) f32 {
+    return if (power > 1e-10) 10.0 * std.math.log10(power) else meter_floor_db;
+}
+
+/// The class's own gain reduction, or for a chain the deepest of its
+/// modules'.
+fn gainReduction(inst: *Instance) f32 {
+    var deepest = inst.vtable.gain_reduction(inst.plugin);
+    for (inst.vtable.nested(inst.plugin)) |slot| {
+        if (slot) |nested| deepest = @max(deepest, gainReduction(instanceFrom(nested)));
+    }
+    return deepest;
+}
+
+/// Starts a meter in the block's reservation
+fn placeMeter(inst: *Instance) void {
+    const meter: *Meter = @ptrCast(inst.arena.reservation().ptr);
+    meter.* = .{ .loudness = analysis.GatedLoudness.init(inst.channels, inst.sample_rate) };
+    inst.meter = meter;
+}
+
+/// Turns the meters on (enabled != 0) or off; they are off for a new
+/// instance. The meter lives in the instance's block, so unless an
+/// earlier prepare left room for it, turning them on takes effect at the
+/// next plugin_prepare, which moves the instance to a block that has.
+/// Never concurrent with plugin_process or a read. Returns 0.
+export fn plugin_set_metering(instance: *anyopaque, enabled: i32) i32 {
+    const inst = instanceFrom(instance);
+    inst.metering = enabled != 0;
+    if (!inst.metering) {
+        inst.meter = null;
+    } else if (inst.meter == null and inst.arena.reservation().len >= reserveFor(inst)) {
+        placeMeter(inst);
+    }
+    return 0;
+}
+
+/// For a wrapper that skipped plugin_process on silent input once
+/// plugin_tail_decayed said so: the meters take `frames` of silence and
+/// fall as if the block had run. Audio thread; never allocates.
+export fn plugin_meter_silence(instance: *anyopaque, frames: usize) void {
+    const inst = instanceFrom(instance);
+    if (inst.meter) |meter| meter.silence(frames);
+}
+
+/// Copies the latest readings into out and starts a new measuring period.
+/// Never calls into the plugin or makes the audio thread wait, so one
+/// thread at a time may poll it while plugin_process runs on another.
+/// Returns 0, or -1 if metering is off or every attempt overlapped a
+/// publish; out is then untouched and the next poll will do.
+export fn plugin_read_meters(instance: *anyopaque, out: *MeterReadings) i32 {
+    const inst = instanceFrom(instance);
+    const meter = inst.meter orelse return -1;
+    return if (meter.read(out)) 0 else -1;
+}
+
+// --- FFT ---
+// Plans for native code (wrappers, tests, benchmarks). Complex data is
+// interleaved re/im floats; a real plan of size n takes n samples and
+// produces n/2 + 1 complex bins. Same conventions as math_utils.fft_iterative.
+
+export fn fft_plan_create(n: usize) ?*anyopaque {
+    const plan = allocator.create(math.FftPlan) catch return null;
+    plan.* = math.FftPlan.init(allocator, n) catch {
+        allocator.destroy(plan);
+        return null;
+    };
+    return plan;
+}
+
+export fn fft_plan_destroy(ptr: *anyopaque) void {
+    const plan: *math.FftPlan = @ptrCast(@alignCast(ptr));
+    plan.deinit(allocator);
+    allocator.destroy(plan);
+}
+
+/// In place on n interleaved complex values; inverse != 0 scales by 1/n.
+export fn fft_plan_transform(ptr: *anyopaque, data: [*]f32, inverse: i32) void {
+    const plan: *const math.FftPlan = @ptrCast(@alignCast(ptr));
+    const buffer = @as([*]math.Complex, @ptrCast(@alignCast(data)))[0..plan.n];
+    plan.transform(buffer, inverse != 0);
+}
+
+export fn fft_real_plan_create(n: usize) ?*anyopaque {
+    const plan = allocator.create(math.RealFftPlan) catch return null;
+    plan.* = math.RealFftPlan.init(allocator, n) catch {
+        allocator.destroy(plan);
+        return null;
+    };
+    return plan;
+}
+
+export fn fft_real_plan_destroy(ptr: *anyopaque) void {
+    const plan: *math.RealFftPlan = @ptrCast(@alignCast(ptr));
+    plan.deinit(allocator);
+    allocator.destroy(plan);
+}
+
+export fn fft_real_forward(ptr: *anyopaque, input: [*]const f32, output: [*]f32) void {
+    const plan: *const math.RealFftPlan = @ptrCast(@alignCast(ptr));
+    const bins = @as([*]math.Complex, @ptrCast(@alignCast(output)))[0 .. plan.n / 2 + 1];
+    plan.forward(input[0..plan.n], bins);
+}
+
+export fn fft_real_inverse(ptr: *anyopaque, input: [*]const f32, output: [*]f32) void {
+    const plan: *const math.RealFftPlan = @ptrCast(@alignCast(ptr));
+    const bins = @as([*]const math.Complex, @ptrCast(@alignCast(input)))[0 .. plan.n / 2 + 1];
+    plan.inverse(bins, output[0..plan.n]);
+}
+
+/// The pre-plan scalar transform, for accuracy and speed comparisons.
+export fn fft_reference_transform(data: [*]f32, n: usize, inverse: i32) void {
+    const buffer = @as([*]math.Complex, @ptrCast(@alignCast(data)))[0..n];
+    math.fft_radix2_reference(buffer, inverse != 0);
+}
+
+// --- EQ cascade ---
+// Standalone biquad cascades for benchmarks and tests: the vectorised
+// engine the EQ plugins run on, or the scalar chain it replaced. Band k is
+// a +3 dB peak at 100 * 2^k Hz, Q 1, on every channel.
+
+const max_eq_bands = 8;
+
+const EqBench = struct {
+    channels: usize,
+    engine: *anyopaque,
+    process: *const fn (*anyopaque, [*]const [*]const f32, [*][*]f32, usize, usize) void,
+    destroy: *const fn (*anyopaque) void,
+
+    fn init(comptime Engine: type, bands: usize, sample_rate: f32) ?EqBench {
+        const engine = allocator.create(Engine) catch return null;
+        engine.* = .{};
+        if (@hasDecl(Engine, "prepare")) engine.prepare(sample_rate);
+        for (0..bands) |k| {
+            const freq = 100.0 * std.math.pow(f32, 2.0, @floatFromInt(k));
+            engine.setSection(k, cascade.Coefficients.design(.peaking, freq, 3.0, 1.0, sample_rate));
+        }
+        return .{
+            .channels = 0,
+            .engine = engine,
+            .process = struct {
+                fn f(ptr: *anyopaque, inputs: [*]const [*]const f32, outputs: [*][*]f32, channels: usize, frames: usize) void {
+                    const e: *Engine = @ptrCast(@alignCast(ptr));
+                    e.processChannels(inputs, outputs, channels, frames);
+                }
+            }.f,
+            .destroy = struct {
+                fn f(ptr: *anyopaque) void {
+                    allocator.destroy(@as(*Engine, @ptrCast(@alignCast(ptr))));
+                }
+            }.f,
+        };
+    }
+};
+
+/// engine 0 is the cascade, 1 the scalar chain. bands 1-8, channels 1-16.
+export fn eq_bench_create(engine: u32, bands: u32, channels: u32, sample_rate: f32) ?*anyopaque {
+    if (engine > 1 or bands < 1 or bands > max_eq_bands or channels < 1 or channels > max_bus_channels) return null;
+    var made: ?EqBench = null;
+    inline for (1..max_eq_bands + 1) |sections| {
+        if (bands == sections) {
+            made = if (engine == 0)
+                EqBench.init(cascade.Cascade(sections), bands, sample_rate)
+            else
+                EqBench.init(cascade.ScalarCascade(sections), bands, sample_rate);
+        }
+    }
+    var eq = made orelse return null;
+    eq.channels = channels;
+    const ptr = allocator.create(EqBench) catch {
+        eq.destroy(eq.engine);
+        return null;
+    };
+    ptr.* = eq;
+    return ptr;
+}
+
+export fn eq_bench_destroy(ptr: *anyopaque) void {
+    const eq: *EqBench = @ptrCast(@alignCast(ptr));
+    eq.destroy(eq.engine);
+    allocator.destroy(eq);
+}
+
+/// Planar, one pointer per channel; inputs and outputs may alias.
+export fn eq_bench_process(ptr: *anyopaque, inputs: [*]const [*]const f32, outputs: [*][*]f32, frames: u32) void {
+    const eq: *EqBench = @ptrCast(@alignCast(ptr));
+    eq.process(eq.engine, inputs, outputs, eq.channels, frames);
+}
+
+// --- Loudness analysis ---
+// analyze_audio_comprehensive for native callers, without holding the file
+// in one buffer: accumulators take interleaved audio in any block sizes,
+// and consecutive stretches analysed separately (e.g. on several threads)
+// merge into the result of one pass. Results are the same 14 values.
+
+export fn loudness_analysis_create(channels: u32, sample_rate: f32) ?*anyopaque {
+    if (channels == 0 or !(sample_rate > 0)) return null;
+    const acc = allocator.create(analysis.Accumulator) catch return null;
+    acc.* = analysis.Accumulator.init(channels, sample_rate);
+    return acc;
+}
+
+export fn loudness_analysis_destroy(ptr: *anyopaque) void {
+    allocator.destroy(@as(*analysis.Accumulator, @ptrCast(@alignCast(ptr))));
+}
+
+export fn loudness_analysis_hop_frames(sample_rate: f32) usize {
+    return analysis.hopFrames(sample_rate);
+}
+
+export fn loudness_analysis_warmup_frames(sample_rate: f32) usize {
+    return analysis.warmupFrames(sample_rate);
+}
+
+/// Runs the filters over audio preceding the stretch without counting it.
+export fn loudness_analysis_warmup(ptr: *anyopaque, interleaved: [*]const f32, frames: usize) void {
+    const acc: *analysis.Accumulator = @ptrCast(@alignCast(ptr));
+    acc.warmup(interleaved[0 .. frames * acc.stride]);
+}
+
+export fn loudness_analysis_push(ptr: *anyopaque, interleaved: [*]const f32, frames: usize) void {
+    const acc: *analysis.Accumulator = @ptrCast(@alignCast(ptr));
+    acc.push(interleaved[0 .. frames * acc.stride]);
+}
+
+/// Appends the stretch that follows; -1 if `into` doesn't end on a hop
+/// boundary or the two differ in channels or rate.
+export fn loudness_analysis_merge(into: *anyopaque, next: *const anyopaque) i32 {
+    const acc: *analysis.Accumulator = @ptrCast(@alignCast(into));
+    acc.merge(@ptrCast(@alignCast(next))) catch return -1;
+    return 0;
+}
+
+export fn loudness_analysis_result(ptr: *const anyopaque, out: [*]f32) void {
+    const acc: *const analysis.Accumulator = @ptrCast(@alignCast(ptr));
+    acc.result().write(out[0..analysis.result_len]);
+}
+
+/// A whole interleaved buffer on `threads` threads, 0 for one per core.
+export fn loudness_analyze(interleaved: [*]const f32, frames: usize, channels: u32, sample_rate: f32, threads: u32, out: [*]f32) i32 {
+    if (channels == 0 or !(sample_rate > 0)) return -1;
+    const workers = if (threads > 0) threads else std.Thread.getCpuCount() catch 1;
+    const stats = analysis.analyzeParallel(allocator, interleaved[0 .. frames * channels], channels, sample_rate, workers) catch return -1;
+    stats.write(out[0..analysis.result_len]);
+    return 0;
+}
+
+// Gated integrated loudness (BS.1770) as the normalizers measure it, for
+// two-pass normalization of files in constant memory.
+
+export fn lufs_meter_create(channels: u32, sample_rate: f32) ?*anyopaque {
+    if (channels == 0 or channels > max_bus_channels or !(sample_rate > 0)) return null;
+    const meter = allocator.create(analysis.GatedLoudness) catch return null;
+    meter.* = analysis.GatedLoudness.init(channels, sample_rate);
+    return meter;
+}
+
+export fn lufs_meter_destroy(ptr: *anyopaque) void {
+    allocator.destroy(@as(*analysis.GatedLoudness, @ptrCast(@alignCast(ptr))));
+}
+
+export fn lufs_meter_push(ptr: *anyopaque, interleaved: [*]const f32, frames: usize) void {
+    const meter: *analysis.GatedLoudness = @ptrCast(@alignCast(ptr));
+    meter.pushInterleaved(interleaved[0 .. frames * meter.channels]);
+}
+
+export fn lufs_meter_push_planar(ptr: *anyopaque, channels: [*]const [*]const f32, frames: usize) void {
+    const meter: *analysis.GatedLoudness = @ptrCast(@alignCast(ptr));
+    meter.pushPlanar(channels, frames);
+}
+
+/// 0 and the loudness in LUFS, or -1 if nothing has passed the gates yet.
+export fn lufs_meter_integrated(ptr: *const anyopaque, lufs: *f32) i32 {
+    const meter: *const analysis.GatedLoudness = @ptrCast(@alignCast(ptr));
+    lufs.* = meter.integrated() orelse return -1;
+    return 0;
+}
+
+// --- Pitch tracking ---
+// The tape stabilizer's YIN tracker, and the brute-force detector it
+// replaced, for native tests and benchmarks.
+
+export fn pitch_tracker_create(size: usize, hop: usize, sample_rate: f32, min_freq: f32, max_freq: f32) ?*anyopaque {
+    if (size < 4 or !std.math.isPowerOfTwo(size) or !(sample_rate > 0)) return null;
+    const tracker = allocator.create(pitch.YinTracker) catch return null;
+    tracker.* = pitch.YinTracker.init(allocator, .{
+        .size = size,
+        .hop = hop,
+        .sample_rate = sample_rate,
+        .min_freq = min_freq,
+        .max_freq = max_freq,
+    }) catch {
+        allocator.destroy(tracker);
+        return null;
+    };
+    return tracker;
+}
+
+export fn pitch_tracker_destroy(ptr: *anyopaque) void {
+    const tracker: *pitch.YinTracker = @ptrCast(@alignCast(ptr));
+    tracker.deinit(allocator);
+    allocator.destroy(tracker);
+}
+
+/// Streams `len` samples, writing the estimate of each frame completed to
+/// freqs (0 where no period was found); returns how many there were.
+/// freqs must have room for len / hop + 1.
+export fn pitch_tracker_push(ptr: *anyopaque, samples: [*]const f32, len: usize, freqs: [*]f32) usize {
+    const tracker: *pitch.YinTracker = @ptrCast(@alignCast(ptr));
+    var done: usize = 0;
+    var count: usize = 0;
+    while (done < len) {
+        const completes = len - done >= tracker.pending();
+        done += tracker.push(samples[done..len]);
+        if (completes) {
+            freqs[count] = tracker.latest.freq;
+            count += 1;
+        }
+    }
+    return count;
+}
+
+/// One frame of the tracker's size; the aperiodicity goes to *aperiodicity
+/// if it isn't null.
+export fn pitch_tracker_analyse(ptr: *anyopaque, frame: [*]const f32, aperiodicity: ?*f32) f32 {
+    const tracker: *pitch.YinTracker = @ptrCast(@alignCast(ptr));
+    const estimate = tracker.analyse(frame[0..tracker.size]);
+    if (aperiodicity) |a| a.* = estimate.aperiodicity;
+    return estimate.freq;
+}
+
+/// Yin.detect, allocation included; 0 if the frame is too short for the
+/// range or nothing was found.
+export fn pitch_reference_detect(frame: [*]const f32, len: usize, sample_rate: f32, min_freq: f32, max_freq: f32) f32 {
+    return pitch.Yin.detect(allocator, frame[0..len], sample_rate, min_freq, max_freq) catch 0;
+}
+
+// --- Dereverberation ---
+// echovanish's whole-buffer path, for native tests and benchmarks. The
+// sonicechovanish class runs the same online WPE block by block.
+
+/// Dereverberates `len` mono samples in place; memory does not depend on len.
+export fn echovanish_process(data: [*]f32, len: usize, sample_rate: f32, reduction: f32, tail_ms: f32) void {
+    if (!(sample_rate > 0)) return;
+    echovanish.process_echovanish(data, len, sample_rate, reduction, tail_ms);
 }
@@ -1,6 +1,36 @@
 const std = @import("std");
 const math = @import("math_utils.zig");
 
+/// RMS of the raw (unwindowed) samples of a frame, for the gate logic.
+pub fn frameRms(frame: []const f32) f32 {
+    var sum_sq: f32 = 0;
+    for (frame) |x| sum_sq += x * x;
+    return std.math.sqrt(sum_sq / @as(f32, @floatFromInt(frame.len)));
+}
+
+/// Spectral subtraction of the bleed estimate from one frame of the target,
+/// bins 0..N/2. Only applied while the source is above the threshold and
+/// clearly louder than the target.
+pub fn subtractBleed(target: []math.Complex, source: []const math.Complex, rms_target: f32, rms_source: f32, sensitivity: f32, threshold_linear: f32) void {
+    const active_b = rms_source > threshold_linear;
+    const dominant_b = rms_source > (rms_target * 1.5); // +3.5dB approx, stricter than 6dB
+    if (!(active_b and dominant_b)) return;
+
+    for (target, source) |*t, src| {
+        const mag_a = t.magnitude();
+        if (mag_a <= 0) continue;
+        // Estimate bleed magnitude
+        const bleed_est = src.magnitude() * 0.3; // BleedFactor
+
+        // Subtract, keeping the target's phase
+        var new_mag_a = mag_a - (bleed_est * sensitivity);
+        if (new_mag_a < 0) new_mag_a = 0;
+        const gain = new_mag_a / mag_a;
+        t.re *= gain;
+        t.im *= gain;
+    }
+}
+
 pub fn process(allocator: std.mem.Allocator, target: []f32, source: []f32, sensitivity: f32, threshold_db: f32) !void {
     const len = target.len;
     if (source.len != len) return;
@@ -15,6 +45,9 @@ pub fn process(allocator: std.mem.Allocator, target: []f32, source: []f32, sensi
     const fft_source = try allocator.alloc(math.Complex, window_size);
     defer allocator.free(fft_source);
 
+    var plan = math.fftPlan(allocator, window_size);
+    defer math.deinitFftPlan(&plan, allocator);
+
     const output_buf = try allocator.alloc(f32, len);
     defer allocator.free(output_buf);
     @memset(output_buf, 0);
@@ -38,8 +71,8 @@ pub fn process(allocator: std.mem.Allocator, target: []f32, source: []f32, sensi
         }
 
         // 2. FFT
-        math.fft_iterative(fft_target, false);
-        math.fft_iterative(fft_source, false);
+        math.fft_iterative(&plan, fft_target, false);
+        math.fft_iterative(&plan, fft_source, false);
 
         // 3. Process Logic
         // RMS of current frame (time domain would be better but we have access to windowed chunks here)
@@ -47,49 +80,17 @@ pub fn process(allocator: std.mem.Allocator, target: []f32, source: []f32, sensi
         // Actually we have the data in `target[pos+k]`.
         // But `target` is modified in place? No, we write to `output_buf`. `target` is read-only for analysis logic.
 
-        var sum_sq_a: f32 = 0;
-        var sum_sq_b: f32 = 0;
-        // Check raw samples for RMS (ignoring window effect for gate logic roughly)
-        for (0..window_size) |k| {
-            const val_a = target[pos+k];
-            const val_b = source[pos+k];
-            sum_sq_a += val_a * val_a;
-            sum_sq_b += val_b * val_b;
-        }
-        const rms_a = std.math.sqrt(sum_sq_a / @as(f32, @floatFromInt(window_size)));
-        const rms_b = std.math.sqrt(sum_sq_b / @as(f32, @floatFromInt(window_size)));
-
-        const active_b = rms_b > threshold_linear;
-        const dominant_b = rms_b > (rms_a * 1.5); // +3.5dB approx, stricter than 6dB
-
-        if (active_b and dominant_b) {
-            // Apply Spectral Subtraction
-            for (0..(window_size/2 + 1)) |k| {
-                const mag_a = fft_target[k].magnitude();
-                const mag_b = fft_source[k].magnitude();
-                const phase_a = std.math.atan2(fft_target[k].im, fft_target[k].re);
-
-                // Estimate bleed magnitude
-                const bleed_est = mag_b * 0.3; // BleedFactor
-
-                // Subtract
-                var new_mag_a = mag_a - (bleed_est * sensitivity);
-                if (new_mag_a < 0) new_mag_a = 0;
-
-                fft_target[k] = .{
-                    .re = new_mag_a * std.math.cos(phase_a),
-                    .im = new_mag_a * std.math.sin(phase_a)
-                };
-
-                // Symmetric
-                if (k > 0 and k < window_size/2) {
-                     fft_target[window_size - k] = .{ .re = fft_target[k].re, .im = -fft_target[k].im };
-                }
-            }
+        const rms_a = frameRms(target[pos .. pos + window_size]);
+        const rms_b = frameRms(source[pos .. pos + window_size]);
+        subtractBleed(fft_target[0 .. window_size / 2 + 1], fft_source[0 .. window_size / 2 + 1], rms_a, rms_b, sensitivity, threshold_linear);
+
+        // Symmetric
+        for (1..window_size / 2) |k| {
+            fft_target[window_size - k] = fft_target[k].conjugate();
         }
 
         // 4. IFFT
-        math.fft_iterative(fft_target, true);
+        math.fft_iterative(&plan, fft_target, true);
 
         // 5. Overlap-Add
         for (0..window_size) |k| {
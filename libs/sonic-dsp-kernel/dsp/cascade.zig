@@ -0,0 +1,300 @@
+const std = @import("std");
+const shared = @import("shared.zig");
+const filters = @import("filters.zig");
+
+pub const Coefficients = filters.Coefficients;
+
+/// Frames between coefficient steps while a change glides in.
+pub const smoothing_chunk = 64;
+/// Time constant of the glide.
+const smoothing_ms: f32 = 20.0;
+/// Widest vector the section pipeline uses (sections x channels).
+const pipeline_lanes = 16;
+
+/// `sections` biquads in series on every channel of a bus, in transposed
+/// direct form II. Sections may differ per channel (setSectionChannel), so
+/// one engine can also run unrelated filters side by side, e.g. a mid and
+/// a side band, or the two halves of a crossover.
+///
+/// On narrow buses the sections run as a skewed pipeline: a single vector
+/// holds every (section, channel) pair and at step t section k works on
+/// sample t - k, fed by what section k - 1 produced one step earlier. A
+/// block of n frames then takes n + sections - 1 vector steps instead of
+/// n x sections scalar ones. The pipeline is filled and drained inside
+/// each call, so there is no added latency, and every section sees the
+/// same samples in the same order as when run one after another. Buses too
+/// wide for that already fill a vector with channels and run the sections
+/// in turn.
+///
+/// Coefficient changes glide towards their target in steps every
+/// smoothing_chunk frames. Any blend of two stable sections' normalised
+/// feedback coefficients is stable too (the stable a1/a2 region is a
+/// triangle), so the glide cannot blow up.
+pub fn Cascade(comptime sections: usize) type {
+    return struct {
+        const Self = @This();
+        const Bank = [sections][shared.max_channels]Coefficients;
+        const State = [sections][shared.max_channels]f32;
+
+        target: Bank = [_][shared.max_channels]Coefficients{[_]Coefficients{.{}} ** shared.max_channels} ** sections,
+        current: Bank = [_][shared.max_channels]Coefficients{[_]Coefficients{.{}} ** shared.max_channels} ** sections,
+        s1: State = [_][shared.max_channels]f32{[_]f32{0} ** shared.max_channels} ** sections,
+        s2: State = [_][shared.max_channels]f32{[_]f32{0} ** shared.max_channels} ** sections,
+        /// Share of the remaining distance covered per smoothing_chunk
+        glide: f32 = 1,
+        settled: bool = true,
+        primed: bool = false,
+
+        pub fn prepare(self: *Self, sample_rate: f32) void {
+            const chunks_per_tau = smoothing_ms * 0.001 * sample_rate / @as(f32, smoothing_chunk);
+            self.glide = 1.0 - std.math.exp(-1.0 / @max(chunks_per_tau, 1.0));
+        }
+
+        /// Sets the target of one section on every channel. The first
+        /// settings after creation apply immediately; later ones glide.
+        pub fn setSection(self: *Self, index: usize, coeffs: Coefficients) void {
+            for (&self.target[index]) |*c| c.* = coeffs;
+            self.settled = false;
+        }
+
+        pub fn setSectionChannel(self: *Self, index: usize, channel: usize, coeffs: Coefficients) void {
+            self.target[index][channel] = coeffs;
+            self.settled = false;
+        }
+
+        /// Jumps straight to the targets, e.g. after a sample-rate change.
+        pub fn snap(self: *Self) void {
+            self.current = self.target;
+            self.settled = true;
+            self.primed = true;
+        }
+
+        pub fn reset(self: *Self) void {
+            self.s1 = [_][shared.max_channels]f32{[_]f32{0} ** shared.max_channels} ** sections;
+            self.s2 = self.s1;
+        }
+
+        pub fn processChannels(self: *Self, inputs: [*]const [*]const f32, outputs: [*][*]f32, channels: usize, frames: usize) void {
+            if (!self.primed) self.snap();
+            if (self.settled) return self.run(inputs, outputs, channels, frames);
+
+            var ins: [shared.max_channels][*]const f32 = undefined;
+            var outs: [shared.max_channels][*]f32 = undefined;
+            var pos: usize = 0;
+            while (pos < frames) {
+                const n = if (self.settled) frames - pos else @min(smoothing_chunk, frames - pos);
+                if (!self.settled) self.step(channels);
+                for (0..channels) |c| {
+                    ins[c] = inputs[c] + pos;
+                    outs[c] = outputs[c] + pos;
+                }
+                self.run(&ins, &outs, channels, n);
+                pos += n;
+            }
+        }
+
+        /// One glide step on the channels in use; settles once every
+        /// coefficient is within rounding of its target.
+        fn step(self: *Self, channels: usize) void {
+            var furthest: f32 = 0;
+            for (0..sections) |k| {
+                for (0..channels) |c| {
+                    const t = self.target[k][c];
+                    const cur = &self.current[k][c];
+                    inline for (.{ "b0", "b1", "b2", "a1", "a2" }) |name| {
+                        const diff = @field(t, name) - @field(cur.*, name);
+                        @field(cur.*, name) += diff * self.glide;
+                        furthest = @max(furthest, @abs(diff));
+                    }
+                }
+            }
+            if (furthest < 1e-6) {
+                for (0..sections) |k| {
+                    for (0..channels) |c| self.current[k][c] = self.target[k][c];
+                }
+                self.settled = true;
+            }
+        }
+
+        fn run(self: *Self, inputs: [*]const [*]const f32, outputs: [*][*]f32, channels: usize, frames: usize) void {
+            switch (shared.lanesFor(channels)) {
+                inline 1, 2, 4, 8, 16 => |width| {
+                    if (comptime sections > 1 and sections * width <= pipeline_lanes) {
+                        self.runPipelined(width, inputs, outputs, channels, frames);
+                    } else {
+                        self.runSerial(width, inputs, outputs, channels, frames);
+                    }
+                },
+                else => unreachable,
+            }
+        }
+
+        /// One lane per channel, sections one after another.
+        fn runSerial(self: *Self, comptime width: usize, inputs: [*]const [*]const f32, outputs: [*][*]f32, channels: usize, frames: usize) void {
+            const V = @Vector(width, f32);
+            var b0: [sections]V = undefined;
+            var b1: [sections]V = undefined;
+            var b2: [sections]V = undefined;
+            var a1: [sections]V = undefined;
+            var a2: [sections]V = undefined;
+            var s1: [sections]V = undefined;
+            var s2: [sections]V = undefined;
+            inline for (0..sections) |k| {
+                var c0: [width]f32 = undefined;
+                var c1: [width]f32 = undefined;
+                var c2: [width]f32 = undefined;
+                var d1: [width]f32 = undefined;
+                var d2: [width]f32 = undefined;
+                for (0..width) |c| {
+                    const coeffs = self.current[k][c];
+                    c0[c] = coeffs.b0;
+                    c1[c] = coeffs.b1;
+                    c2[c] = coeffs.b2;
+                    d1[c] = coeffs.a1;
+                    d2[c] = coeffs.a2;
+                }
+                b0[k] = c0;
+                b1[k] = c1;
+                b2[k] = c2;
+                a1[k] = d1;
+                a2[k] = d2;
+                s1[k] = self.s1[k][0..width].*;
+                s2[k] = self.s2[k][0..width].*;
+            }
+
+            for (0..frames) |i| {
+                var x = shared.loadFrame(width, inputs, channels, i);
+                inline for (0..sections) |k| {
+                    const y = b0[k] * x + s1[k];
+                    s1[k] = b1[k] * x - a1[k] * y + s2[k];
+                    s2[k] = b2[k] * x - a2[k] * y;
+                    x = y;
+                }
+                shared.storeFrame(width, outputs, channels, i, x);
+            }
+
+            inline for (0..sections) |k| {
+                self.s1[k][0..width].* = s1[k];
+                self.s2[k][0..width].* = s2[k];
+            }
+        }
+
+        /// Lane k * width + c is section k on channel c.
+        fn runPipelined(self: *Self, comptime width: usize, inputs: [*]const [*]const f32, outputs: [*][*]f32, channels: usize, frames: usize) void {
+            const lanes = sections * width;
+            const V = @Vector(lanes, f32);
+            const Frame = @Vector(width, f32);
+            const Index = @Vector(lanes, u32);
+
+            // Section 0 takes the new frame, section k the previous output of k - 1
+            const feed = comptime blk: {
+                var mask: [lanes]i32 = undefined;
+                for (0..lanes) |i| mask[i] = if (i < width) ~@as(i32, @intCast(i)) else @intCast(i - width);
+                break :blk mask;
+            };
+            // The last section's lanes hold the finished samples
+            const tail = comptime blk: {
+                var mask: [width]i32 = undefined;
+                for (0..width) |c| mask[c] = @intCast((sections - 1) * width + c);
+                break :blk mask;
+            };
+            const section_of: Index = comptime blk: {
+                var idx: [lanes]u32 = undefined;
+                for (0..lanes) |i| idx[i] = @intCast(i / width);
+                break :blk idx;
+            };
+
+            var c0: [lanes]f32 = undefined;
+            var c1: [lanes]f32 = undefined;
+            var c2: [lanes]f32 = undefined;
+            var d1: [lanes]f32 = undefined;
+            var d2: [lanes]f32 = undefined;
+            var z1: [lanes]f32 = undefined;
+            var z2: [lanes]f32 = undefined;
+            for (0..sections) |k| {
+                for (0..width) |c| {
+                    const coeffs = self.current[k][c];
+                    const i = k * width + c;
+                    c0[i] = coeffs.b0;
+                    c1[i] = coeffs.b1;
+                    c2[i] = coeffs.b2;
+                    d1[i] = coeffs.a1;
+                    d2[i] = coeffs.a2;
+                    z1[i] = self.s1[k][c];
+                    z2[i] = self.s2[k][c];
+                }
+            }
+            const b0: V = c0;
+            const b1: V = c1;
+            const b2: V = c2;
+            const a1: V = d1;
+            const a2: V = d2;
+            var s1: V = z1;
+            var s2: V = z2;
+            var y: V = @splat(0);
+
+            const steps = frames + sections - 1;
+            const n: Index = @splat(@intCast(frames));
+            for (0..steps) |t| {
+                const x: Frame = if (t < frames) shared.loadFrame(width, inputs, channels, t) else @splat(0);
+                const v = @shuffle(f32, y, x, feed);
+                const out = b0 * v + s1;
+                const next1 = b1 * v - a1 * out + s2;
+                const next2 = b2 * v - a2 * out;
+                if (t >= sections - 1 and t < frames) {
+                    s1 = next1;
+                    s2 = next2;
+                } else {
+                    // Filling or draining: only lanes with a real sample
+                    // (0 <= t - k < frames) may advance their state
+                    const live = (@as(Index, @splat(@intCast(t))) -% section_of) < n;
+                    s1 = @select(f32, live, next1, s1);
+                    s2 = @select(f32, live, next2, s2);
+                }
+                y = out;
+                if (t >= sections - 1) {
+                    shared.storeFrame(width, outputs, channels, t - (sections - 1), @shuffle(f32, out, undefined, tail));
+                }
+            }
+
+            z1 = s1;
+            z2 = s2;
+            for (0..sections) |k| {
+                for (0..width) |c| {
+                    self.s1[k][c] = z1[k * width + c];
+                    self.s2[k][c] = z2[k * width + c];
+                }
+            }
+        }
+    };
+}
+
+/// The per-sample, per-section Biquad chain the EQ plugins ran before the
+/// cascade engine, with the same interface. Kept as the benchmark baseline.
+pub fn ScalarCascade(comptime sections: usize) type {
+    return struct {
+        const Self = @This();
+
+        chains: [shared.max_channels][sections]filters.Biquad = [_][sections]filters.Biquad{[_]filters.Biquad{.{}} ** sections} ** shared.max_channels,
+
+        pub fn setSection(self: *Self, index: usize, coeffs: Coefficients) void {
+            for (&self.chains) |*chain| {
+                const f = &chain[index];
+                f.b0 = coeffs.b0; f.b1 = coeffs.b1; f.b2 = coeffs.b2;
+                f.a1 = coeffs.a1; f.a2 = coeffs.a2;
+            }
+        }
+
+        pub fn processChannels(self: *Self, inputs: [*]const [*]const f32, outputs: [*][*]f32, channels: usize, frames: usize) void {
+            for (0..frames) |i| {
+                for (0..channels) |c| {
+                    var s = inputs[c][i];
+                    inline for (0..sections) |k| {
+                        s = self.chains[c][k].process(s);
+                    }
+                    outputs[c][i] = s;
+                }
+            }
+        }
+    };
+}
@@ -1,19 +1,50 @@
 const std = @import("std");
 const math = @import("../math_utils.zig");
 
+/// Level below which a delay line counts as empty: -100 dBFS, the same
+/// threshold the C ABI uses to decide a tail has decayed (c_export.zig).
+pub const silence_threshold: f32 = 1e-5;
+
+/// Samples until a recirculating delay has rung out to -60 dB: one pass
+/// through the line plus as many repeats as the feedback needs, capped at
+/// `max_samples` since a feedback near 1 rings for minutes.
+pub fn feedbackTail(delay_samples: f32, feedback: f32, max_samples: u32) u32 {
+    var repeats: f32 = 0;
+    const fb = @abs(feedback);
+    if (fb >= 1.0) return max_samples;
+    if (fb > 0) repeats = @ceil(@log(@as(f32, 1e-3)) / @log(fb));
+    const samples = @ceil(delay_samples * (1.0 + repeats));
+    if (samples >= @as(f32, @floatFromInt(max_samples))) return max_samples;
+    return @intFromFloat(samples);
+}
+
 pub fn DelayLine(comptime MaxSize: usize) type {
     return struct {
         buffer: [MaxSize]f32 = [_]f32{0} ** MaxSize,
         write_ptr: usize = 0,
+        /// Consecutive writes below silence_threshold; the buffer starts
+        /// zeroed, so it starts out silent
+        quiet_run: usize = MaxSize,
 
         pub fn process(self: *DelayLine(MaxSize), input: f32, delay_samples: f32) f32 {
             const read_ptr = @as(f32, @floatFromInt(self.write_ptr)) - delay_samples;
             const output = self.readInterpolated(read_ptr);
             
+            self.write(input);
+            return output;
+        }
+
+        /// Stores one sample at the write position and advances it.
+        pub fn write(self: *DelayLine(MaxSize), input: f32) void {
             self.buffer[self.write_ptr] = input;
             self.write_ptr = (self.write_ptr + 1) % MaxSize;
-            
-            return output;
+            self.quiet_run = if (@abs(input) <= silence_threshold) self.quiet_run +| 1 else 0;
+        }
+
+        /// True once every sample in the buffer is below silence_threshold,
+        /// so nothing can be read back out of it whatever the delay time.
+        pub fn isSilent(self: *const DelayLine(MaxSize)) bool {
+            return self.quiet_run >= MaxSize;
         }
 
         pub fn readInterpolated(self: *DelayLine(MaxSize), ptr: f32) f32 {
@@ -34,6 +65,7 @@ pub fn DelayLine(comptime MaxSize: usize) type {
         pub fn reset(self: *DelayLine(MaxSize)) void {
             @memset(&self.buffer, 0);
             self.write_ptr = 0;
+            self.quiet_run = MaxSize;
         }
     };
 }
@@ -26,6 +26,56 @@ pub const EnvelopeFollower = struct {
     }
 };
 
+/// EnvelopeFollower per channel of a bus, on shared attack and release
+/// times. Runs through EnvelopeLanes, one vector lane per channel.
+pub const EnvelopeBank = struct {
+    attack_coeff: f32 = 0,
+    release_coeff: f32 = 0,
+    envelope: [shared.max_channels]f32 = [_]f32{0} ** shared.max_channels,
+
+    pub fn setParams(self: *EnvelopeBank, attack_ms: f32, release_ms: f32, sample_rate: f32) void {
+        var follower = EnvelopeFollower{};
+        follower.setParams(attack_ms, release_ms, sample_rate);
+        self.attack_coeff = follower.attack_coeff;
+        self.release_coeff = follower.release_coeff;
+    }
+
+    pub fn load(self: *const EnvelopeBank, comptime lanes: usize) EnvelopeLanes(lanes) {
+        return .{
+            .attack_coeff = @splat(self.attack_coeff),
+            .release_coeff = @splat(self.release_coeff),
+            .envelope = self.envelope[0..lanes].*,
+        };
+    }
+
+    pub fn store(self: *EnvelopeBank, comptime lanes: usize, state: EnvelopeLanes(lanes)) void {
+        self.envelope[0..lanes].* = state.envelope;
+    }
+
+    pub fn reset(self: *EnvelopeBank) void {
+        self.envelope = [_]f32{0} ** shared.max_channels;
+    }
+};
+
+/// EnvelopeFollower.process on `lanes` channels at once; the attack/release
+/// branch becomes a per-lane select.
+pub fn EnvelopeLanes(comptime lanes: usize) type {
+    return struct {
+        const V = @Vector(lanes, f32);
+
+        attack_coeff: V,
+        release_coeff: V,
+        envelope: V,
+
+        pub inline fn process(self: *@This(), input: V) V {
+            const abs_in = @abs(input);
+            const coeff = @select(f32, abs_in > self.envelope, self.attack_coeff, self.release_coeff);
+            self.envelope = coeff * self.envelope + (@as(V, @splat(1.0)) - coeff) * abs_in;
+            return self.envelope;
+        }
+    };
+}
+
 pub const GainComputer = struct {
     pub fn compute(threshold_db: f32, ratio: f32, knee_db: f32, input_db: f32) f32 {
         const overshoot = input_db - threshold_db;
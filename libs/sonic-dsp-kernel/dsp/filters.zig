@@ -12,13 +12,12 @@ pub const FilterType = enum {
     allpass,
 };
 
-pub const Biquad = struct {
-    a1: f32 = 0, a2: f32 = 0,
+/// Normalised RBJ cookbook coefficients (a0 divided out).
+pub const Coefficients = struct {
     b0: f32 = 1, b1: f32 = 0, b2: f32 = 0,
-    x1: f32 = 0, x2: f32 = 0,
-    y1: f32 = 0, y2: f32 = 0,
+    a1: f32 = 0, a2: f32 = 0,
 
-    pub fn setParams(self: *Biquad, f_type: FilterType, frequency: f32, gain_db: f32, Q: f32, sample_rate: f32) void {
+    pub fn design(f_type: FilterType, frequency: f32, gain_db: f32, Q: f32, sample_rate: f32) Coefficients {
         const w0 = shared.TWO_PI * frequency / sample_rate;
         const cos_w0 = std.math.cos(w0);
         const sin_w0 = std.math.sin(w0);
@@ -97,8 +96,20 @@ pub const Biquad = struct {
             },
         }
 
-        self.b0 = b0 / a0; self.b1 = b1 / a0; self.b2 = b2 / a0;
-        self.a1 = a1 / a0; self.a2 = a2 / a0;
+        return .{ .b0 = b0 / a0, .b1 = b1 / a0, .b2 = b2 / a0, .a1 = a1 / a0, .a2 = a2 / a0 };
+    }
+};
+
+pub const Biquad = struct {
+    a1: f32 = 0, a2: f32 = 0,
+    b0: f32 = 1, b1: f32 = 0, b2: f32 = 0,
+    x1: f32 = 0, x2: f32 = 0,
+    y1: f32 = 0, y2: f32 = 0,
+
+    pub fn setParams(self: *Biquad, f_type: FilterType, frequency: f32, gain_db: f32, Q: f32, sample_rate: f32) void {
+        const c = Coefficients.design(f_type, frequency, gain_db, Q, sample_rate);
+        self.b0 = c.b0; self.b1 = c.b1; self.b2 = c.b2;
+        self.a1 = c.a1; self.a2 = c.a2;
     }
 
     pub fn process(self: *Biquad, input: f32) f32 {
@@ -0,0 +1,235 @@
+const std = @import("std");
+
+/// Highest oversampling factor, as three cascaded 2x stages.
+pub const max_factor = 8;
+/// Base-rate frames per pass through the stages, so the oversampled
+/// scratch (chunk_frames * max_factor per channel) fits on the stack.
+const chunk_frames = 64;
+
+/// Side taps per branch of the first stage, which sets the passband edge
+/// (about 20 kHz at 48 kHz). Later stages only have to clear images an
+/// octave or more away and get by with half as many.
+const first_branch = 32;
+const later_branch = 16;
+const kaiser_beta = 8.0;
+
+/// Normalised parameter value <-> factor, over the steps 1x, 2x, 4x, 8x.
+pub fn factorFromParameter(value: f32) usize {
+    const step: u3 = @intFromFloat(@round(std.math.clamp(value, 0.0, 1.0) * 3.0));
+    return @as(usize, 1) << step;
+}
+
+pub fn parameterFromFactor(factor: usize) f32 {
+    return @as(f32, @floatFromInt(std.math.log2_int(usize, factor))) / 3.0;
+}
+
+/// Kaiser-windowed half-band lowpass at a quarter of the rate, length
+/// 2 * branch - 1. Every other tap is zero except the centre one (0.5), so
+/// only the `branch` taps of the other polyphase branch are returned. They
+/// are symmetric and sum to 0.5, for unity gain at DC.
+fn halfBandBranch(comptime branch: usize) [branch]f32 {
+    @setEvalBranchQuota(100_000);
+    const centre: f64 = @floatFromInt(branch - 1);
+    var taps: [branch]f32 = undefined;
+    var raw: [branch]f64 = undefined;
+    var sum: f64 = 0;
+    for (0..branch) |j| {
+        // Offset from the centre of the full filter; always odd
+        const d = @as(f64, @floatFromInt(2 * j)) - centre;
+        const r = d / (centre + 1.0);
+        const window = besselI0(kaiser_beta * @sqrt(1.0 - r * r)) / besselI0(kaiser_beta);
+        raw[j] = @sin(std.math.pi * d / 2.0) / (std.math.pi * d) * window;
+        sum += raw[j];
+    }
+    for (0..branch) |j| taps[j] = @floatCast(raw[j] * 0.5 / sum);
+    return taps;
+}
+
+fn besselI0(x: f64) f64 {
+    var term: f64 = 1;
+    var sum: f64 = 1;
+    var k: f64 = 1;
+    while (k < 40) : (k += 1) {
+        term *= (x / (2.0 * k)) * (x / (2.0 * k));
+        sum += term;
+    }
+    return sum;
+}
+
+/// One polyphase 2x stage for one channel: an interpolator and a decimator
+/// on the same half-band filter. Each output (or input pair) costs one
+/// `branch`-wide vector multiply and reduce; the other branch is a pure
+/// delay. Both directions delay by branch - 1 samples at the higher rate.
+fn HalfBand(comptime branch: usize) type {
+    return struct {
+        const Self = @This();
+        const V = @Vector(branch, f32);
+        const taps: V = halfBandBranch(branch);
+        const up_taps: V = taps * @as(V, @splat(2.0));
+        pub const delay = branch - 1;
+
+        // Histories hold each sample twice, `branch` apart, so the newest
+        // `branch` samples are always one contiguous window
+        up_hist: [2 * branch]f32 = [_]f32{0} ** (2 * branch),
+        up_pos: usize = 0,
+        even_hist: [2 * branch]f32 = [_]f32{0} ** (2 * branch),
+        odd_hist: [2 * branch]f32 = [_]f32{0} ** (2 * branch),
+        down_pos: usize = 0,
+
+        inline fn push(hist: *[2 * branch]f32, pos: usize, x: f32) V {
+            hist[pos] = x;
+            hist[pos + branch] = x;
+            return hist[pos + 1 ..][0..branch].*;
+        }
+
+        /// output.len == 2 * input.len
+        pub fn up(self: *Self, input: []const f32, output: []f32) void {
+            for (input, 0..) |x, n| {
+                const window = push(&self.up_hist, self.up_pos, x);
+                self.up_pos = (self.up_pos + 1) % branch;
+                output[2 * n] = @reduce(.Add, window * up_taps);
+                output[2 * n + 1] = window[branch / 2];
+            }
+        }
+
+        /// input.len == 2 * output.len
+        pub fn down(self: *Self, input: []const f32, output: []f32) void {
+            for (output, 0..) |*y, n| {
+                const even = push(&self.even_hist, self.down_pos, input[2 * n]);
+                const odd = push(&self.odd_hist, self.down_pos, input[2 * n + 1]);
+                self.down_pos = (self.down_pos + 1) % branch;
+                y.* = @reduce(.Add, even * taps) + 0.5 * odd[branch / 2 - 1];
+            }
+        }
+    };
+}
+
+const FirstStage = HalfBand(first_branch);
+const LaterStage = HalfBand(later_branch);
+
+/// Extra delay at the top rate that rounds the stages' combined delay up
+/// to whole base-rate samples, and the resulting latency, per log2 factor.
+const Alignment = struct { pad: [4]usize, latency: [4]u32 };
+const alignment: Alignment = blk: {
+    var pad: [4]usize = .{ 0, 0, 0, 0 };
+    var latency: [4]u32 = .{ 0, 0, 0, 0 };
+    for (1..4) |stages| {
+        const rate = 1 << stages;
+        // Interpolator plus decimator of each stage, in top-rate samples
+        var total: usize = 2 * FirstStage.delay * (rate / 2);
+        for (2..stages + 1) |s| total += 2 * LaterStage.delay * (rate >> s);
+        pad[stages] = (rate - total % rate) % rate;
+        latency[stages] = @intCast((total + pad[stages]) / rate);
+    }
+    break :blk .{ .pad = pad, .latency = latency };
+};
+
+/// Runs a memoryless nonlinearity at 2x, 4x or 8x the host rate on up to
+/// `channels` planar channels: polyphase half-band interpolation, the
+/// shaper on the oversampled signal, then matching decimation. Factor 1
+/// calls the shaper on the output directly and costs nothing else.
+///
+/// The chain delays by latency() base-rate samples, a whole number, and
+/// rings for about as long again after the input stops.
+pub fn Oversampler(comptime channels: usize) type {
+    return struct {
+        const Self = @This();
+        const scratch_len = chunk_frames * max_factor;
+
+        stages: u2 = 0,
+        first: [channels]FirstStage = [_]FirstStage{.{}} ** channels,
+        later: [channels][2]LaterStage = [_][2]LaterStage{[_]LaterStage{.{}} ** 2} ** channels,
+        pad: [channels][max_factor]f32 = [_][max_factor]f32{[_]f32{0} ** max_factor} ** channels,
+        pad_pos: usize = 0,
+
+        /// 1, 2, 4 or 8. Clears the filter state when the factor changes.
+        pub fn setFactor(self: *Self, new_factor: usize) void {
+            const stages: u2 = @intCast(std.math.log2_int(usize, std.math.clamp(new_factor, 1, max_factor)));
+            if (stages == self.stages) return;
+            self.stages = stages;
+            self.reset();
+        }
+
+        pub fn factor(self: *const Self) usize {
+            return @as(usize, 1) << self.stages;
+        }
+
+        pub fn latency(self: *const Self) u32 {
+            return alignment.latency[self.stages];
+        }
+
+        pub fn reset(self: *Self) void {
+            const stages = self.stages;
+            self.* = .{ .stages = stages };
+        }
+
+        /// shape(ctx, buffers) is called with one slice per channel at the
+        /// oversampled rate and works on them in place. Inputs and outputs
+        /// must not alias.
+        pub fn process(
+            self: *Self,
+            inputs: [*]const [*]const f32,
+            outputs: [*][*]f32,
+            frames: usize,
+            ctx: anytype,
+            comptime shape: fn (@TypeOf(ctx), [channels][]f32) void,
+        ) void {
+            if (self.stages == 0) {
+                var direct: [channels][]f32 = undefined;
+                for (0..channels) |c| {
+                    @memcpy(outputs[c][0..frames], inputs[c][0..frames]);
+                    direct[c] = outputs[c][0..frames];
+                }
+                shape(ctx, direct);
+                return;
+            }
+
+            var scratch: [2][channels][scratch_len]f32 = undefined;
+            var top: [channels][]f32 = undefined;
+            var pos: usize = 0;
+            while (pos < frames) : (pos += chunk_frames) {
+                const n: usize = @min(chunk_frames, frames - pos);
+                const top_len = n << self.stages;
+                // Which scratch buffer holds the top-rate signal
+                const top_buf = (self.stages - 1) & 1;
+
+                for (0..channels) |c| {
+                    self.first[c].up(inputs[c][pos..][0..n], scratch[0][c][0 .. 2 * n]);
+                    var len = 2 * n;
+                    for (1..self.stages) |s| {
+                        self.later[c][s - 1].up(scratch[(s - 1) & 1][c][0..len], scratch[s & 1][c][0 .. 2 * len]);
+                        len *= 2;
+                    }
+                    top[c] = scratch[top_buf][c][0..top_len];
+                    self.delayPad(c, top[c]);
+                }
+
+                shape(ctx, top);
+
+                for (0..channels) |c| {
+                    var len = top_len;
+                    var s: usize = self.stages - 1;
+                    while (s >= 1) : (s -= 1) {
+                        self.later[c][s - 1].down(scratch[s & 1][c][0..len], scratch[(s - 1) & 1][c][0 .. len / 2]);
+                        len /= 2;
+                    }
+                    self.first[c].down(scratch[0][c][0 .. 2 * n], outputs[c][pos..][0..n]);
+                }
+                self.pad_pos = (self.pad_pos + top_len) % max_factor;
+            }
+        }
+
+        fn delayPad(self: *Self, channel: usize, buffer: []f32) void {
+            const pad = alignment.pad[self.stages];
+            if (pad == 0) return;
+            const ring = &self.pad[channel];
+            var p = self.pad_pos;
+            for (buffer) |*x| {
+                const delayed = ring[(p + max_factor - pad) % max_factor];
+                ring[p] = x.*;
+                x.* = delayed;
+                p = (p + 1) % max_factor;
+            }
+        }
+    };
+}
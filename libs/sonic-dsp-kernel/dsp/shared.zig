@@ -11,3 +11,103 @@ pub fn linearToDb(linear: f32) f32 {
     if (linear <= 0.000001) return -120.0;
     return 20.0 * std.math.log10(linear);
 }
+
+/// Frames per chunk for modules that work on interleaved [L, R, L, R] data.
+/// Small enough that the scratch buffer stays on the stack.
+pub const interleave_chunk_frames = 512;
+
+/// Feeds a planar stereo block through `process` in interleaved chunks of at
+/// most interleave_chunk_frames, so any host block size is fully processed.
+/// `process` must keep its state across calls for chunk edges to be inaudible.
+pub fn processInterleavedStereo(
+    ctx: anytype,
+    comptime process: fn (@TypeOf(ctx), []f32) void,
+    inputs: [*]const [*]const f32,
+    outputs: [*][*]f32,
+    frames: usize,
+) void {
+    var interleaved: [interleave_chunk_frames * 2]f32 = undefined;
+
+    var pos: usize = 0;
+    while (pos < frames) {
+        const n: usize = @min(interleave_chunk_frames, frames - pos);
+        const in_l = inputs[0][pos .. pos + n];
+        const in_r = inputs[1][pos .. pos + n];
+        const out_l = outputs[0][pos .. pos + n];
+        const out_r = outputs[1][pos .. pos + n];
+
+        for (0..n) |i| {
+            interleaved[i * 2] = in_l[i];
+            interleaved[i * 2 + 1] = in_r[i];
+        }
+
+        process(ctx, interleaved[0 .. n * 2]);
+
+        for (0..n) |i| {
+            out_l[i] = interleaved[i * 2];
+            out_r[i] = interleaved[i * 2 + 1];
+        }
+        pos += n;
+    }
+}
+
+/// Widest bus the kernel processes natively. Multichannel modules run one
+/// @Vector lane per channel, so this is also the widest vector they use.
+pub const max_channels = 16;
+
+/// Vector width for a bus of `channels`: the next of 1, 2, 4, 8 or 16.
+/// Lanes past the channel count read silence and are never written back.
+pub fn lanesFor(channels: usize) usize {
+    if (channels <= 1) return 1;
+    if (channels <= 2) return 2;
+    if (channels <= 4) return 4;
+    if (channels <= 8) return 8;
+    return 16;
+}
+
+/// Frame `i` of a planar bus as one vector lane per channel.
+pub inline fn loadFrame(comptime lanes: usize, inputs: [*]const [*]const f32, channels: usize, i: usize) @Vector(lanes, f32) {
+    var frame = [_]f32{0} ** lanes;
+    for (0..channels) |c| frame[c] = inputs[c][i];
+    return frame;
+}
+
+pub inline fn storeFrame(comptime lanes: usize, outputs: [*][*]f32, channels: usize, i: usize, value: @Vector(lanes, f32)) void {
+    const frame: [lanes]f32 = value;
+    for (0..channels) |c| outputs[c][i] = frame[c];
+}
+
+/// The reverse of processInterleavedStereo, for offline entry points that
+/// hand interleaved [L, R, L, R] data to a module working on planar buses.
+pub fn processPlanarStereo(
+    ctx: anytype,
+    comptime process: fn (@TypeOf(ctx), [*]const [*]const f32, [*][*]f32, usize, usize) void,
+    data: []f32,
+) void {
+    var in_l: [interleave_chunk_frames]f32 = undefined;
+    var in_r: [interleave_chunk_frames]f32 = undefined;
+    var out_l: [interleave_chunk_frames]f32 = undefined;
+    var out_r: [interleave_chunk_frames]f32 = undefined;
+    const inputs = [2][*]const f32{ &in_l, &in_r };
+    var outputs = [2][*]f32{ &out_l, &out_r };
+
+    const frames = data.len / 2;
+    var pos: usize = 0;
+    while (pos < frames) {
+        const n = @min(interleave_chunk_frames, frames - pos);
+        const chunk = data[pos * 2 .. (pos + n) * 2];
+
+        for (0..n) |i| {
+            in_l[i] = chunk[i * 2];
+            in_r[i] = chunk[i * 2 + 1];
+        }
+
+        process(ctx, &inputs, &outputs, 2, n);
+
+        for (0..n) |i| {
+            chunk[i * 2] = out_l[i];
+            chunk[i * 2 + 1] = out_r[i];
+        }
+        pos += n;
+    }
+}
@@ -0,0 +1,35 @@
+const std = @import("std");
+
+/// Little-endian cursor over the buffer a plugin's save_state fills. The
+/// kernel sizes the buffer from the plugin's state_size, so writes past
+/// the end are a bug in that plugin and trip the slice bounds check.
+pub const Writer = struct {
+    bytes: []u8,
+    pos: usize = 0,
+
+    pub fn int(self: *Writer, comptime T: type, value: T) void {
+        std.mem.writeInt(T, self.bytes[self.pos..][0..@sizeOf(T)], value, .little);
+        self.pos += @sizeOf(T);
+    }
+
+    pub fn floats(self: *Writer, values: []const f32) void {
+        for (values) |v| self.int(u32, @bitCast(v));
+    }
+};
+
+/// Reading side of Writer, for load_state. The kernel has already checked
+/// that the data is exactly state_size bytes long.
+pub const Reader = struct {
+    bytes: []const u8,
+    pos: usize = 0,
+
+    pub fn int(self: *Reader, comptime T: type) T {
+        const value = std.mem.readInt(T, self.bytes[self.pos..][0..@sizeOf(T)], .little);
+        self.pos += @sizeOf(T);
+        return value;
+    }
+
+    pub fn floats(self: *Reader, values: []f32) void {
+        for (values) |*v| v.* = @bitCast(self.int(u32));
+    }
+};
@@ -0,0 +1,441 @@
+const std = @import("std");
+const math = @import("../math_utils.zig");
+const workers = @import("workers.zig");
+
+/// Streaming short-time Fourier transform with overlap-add resynthesis, for
+/// spectral plugins that run inside a host's block loop.
+///
+/// Input is collected in a FIFO of the last `size` samples per channel. Every
+/// `hop` samples the FIFO is windowed and transformed, the plugin's frame
+/// callback edits the spectra in place, and the first `outputs` channels are
+/// transformed back and overlap-added into an accumulator. The oldest hop of
+/// the accumulator is then complete and is played out over the next hop, so
+/// output lags input by exactly `size` samples for any host block size.
+///
+/// Analysis and synthesis both use a periodic sqrt-Hann window, which is
+/// constant-overlap-add for any hop that divides size/2; the sum is
+/// normalised at init, so a callback that leaves the spectra alone gives
+/// back the input, delayed.
+///
+/// With worker threads (setThreads, for offline rendering) and a prepare
+/// for the host's block size, a block that completes several hops runs
+/// them as a batch: every frame is gathered and transformed on the workers,
+/// the callback sees the whole batch, the inverse transforms run on the
+/// workers again and the overlap-add is done on the calling thread in frame
+/// order. Each frame goes through exactly the arithmetic it would alone, so
+/// the output is bit-identical to processing one hop at a time.
+///
+/// All buffers are allocated in init and prepare; process never allocates.
+pub const StreamingStft = struct {
+    pub const Config = struct {
+        size: usize = 2048,
+        hop: usize = 1024,
+        /// Channels analysed each frame (e.g. 2 for a signal plus sidechain)
+        channels: usize = 1,
+        /// Leading channels resynthesised; the rest are analysis only
+        outputs: usize = 1,
+    };
+
+    size: usize,
+    hop: usize,
+    channels: usize,
+    outputs: usize,
+    plan: math.RealFftPlan,
+    window: []f32,
+    /// channels * size, oldest sample first
+    input: []f32,
+    /// outputs * size
+    accum: []f32,
+    /// outputs * hop: the completed samples being played out
+    ready: []f32,
+    /// channels * bins
+    spectra: []math.Complex,
+    scratch: []f32,
+    /// Samples into the current hop
+    pos: usize,
+    /// Shared worker pool while more than one thread is allowed
+    pool: ?*workers.WorkerPool,
+    threads: usize,
+    batch: Batch,
+
+    /// Most frames in one batch; longer blocks take several.
+    pub const max_batch = 256;
+
+    /// Per-frame buffers for batched hops; empty until prepare sizes them.
+    const Batch = struct {
+        capacity: usize = 0,
+        /// capacity * channels * size: each frame's unwindowed input
+        input: []f32 = &.{},
+        /// capacity * channels * size: windowed input, then windowed output
+        signal: []f32 = &.{},
+        /// capacity * channels * bins
+        spectra: []math.Complex = &.{},
+        /// What the callback gets for each frame
+        views: []StreamingStft = &.{},
+    };
+
+    pub fn init(allocator: std.mem.Allocator, config: Config) !StreamingStft {
+        const size = config.size;
+        const hop = config.hop;
+        if (hop == 0 or size % hop != 0 or size / hop < 2) return error.InvalidHop;
+        if (config.outputs > config.channels) return error.InvalidChannels;
+
+        var plan = try math.RealFftPlan.init(allocator, size);
+        errdefer plan.deinit(allocator);
+        const window = try allocator.alloc(f32, size);
+        errdefer allocator.free(window);
+        const input = try allocator.alloc(f32, config.channels * size);
+        errdefer allocator.free(input);
+        const accum = try allocator.alloc(f32, config.outputs * size);
+        errdefer allocator.free(accum);
+        const ready = try allocator.alloc(f32, config.outputs * hop);
+        errdefer allocator.free(ready);
+        const spectra = try allocator.alloc(math.Complex, config.channels * (size / 2 + 1));
+        errdefer allocator.free(spectra);
+        const scratch = try allocator.alloc(f32, size);
+
+        const n: f64 = @floatFromInt(size);
+        for (window, 0..) |*w, i| {
+            w.* = @floatCast(@sin(std.math.pi * @as(f64, @floatFromInt(i)) / n));
+        }
+        // Overlap-added window product; constant for a periodic sqrt-Hann
+        var sum: f32 = 0;
+        var i: usize = 0;
+        while (i < size) : (i += hop) sum += window[i] * window[i];
+        // The inverse transform already scales by 1/size
+        for (window) |*w| w.* /= @sqrt(sum);
+
+        var self = StreamingStft{
+            .size = size,
+            .hop = hop,
+            .channels = config.channels,
+            .outputs = config.outputs,
+            .plan = plan,
+            .window = window,
+            .input = input,
+            .accum = accum,
+            .ready = ready,
+            .spectra = spectra,
+            .scratch = scratch,
+            .pos = 0,
+            .pool = null,
+            .threads = 1,
+            .batch = .{},
+        };
+        self.reset();
+        return self;
+    }
+
+    pub fn deinit(self: *StreamingStft, allocator: std.mem.Allocator) void {
+        self.setThreads(1);
+        self.freeBatch(allocator);
+        allocator.free(self.scratch);
+        allocator.free(self.spectra);
+        allocator.free(self.ready);
+        allocator.free(self.accum);
+        allocator.free(self.input);
+        allocator.free(self.window);
+        self.plan.deinit(allocator);
+    }
+
+    /// Threads process may use, the caller's included. More than one
+    /// attaches the shared worker pool (starting its threads if needed), so
+    /// call it outside processing, and prepare afterwards to size the
+    /// batch buffers. 1 detaches.
+    pub fn setThreads(self: *StreamingStft, threads: usize) void {
+        if (self.pool) |pool| workers.release(pool);
+        self.pool = workers.acquire(threads);
+        self.threads = if (self.pool != null) @min(threads, workers.max_threads) else 1;
+    }
+
+    /// Sizes the batch buffers for blocks of up to max_block frames when
+    /// worker threads are set, or frees them when not. Keeps all history.
+    pub fn prepare(self: *StreamingStft, allocator: std.mem.Allocator, max_block: usize) !void {
+        const wanted = if (self.pool != null) @min(max_block / self.hop + 1, max_batch) else 0;
+        const capacity = if (wanted >= 2) wanted else 0;
+        if (capacity == self.batch.capacity) return;
+        self.freeBatch(allocator);
+        if (capacity == 0) return;
+
+        const samples = capacity * self.channels * self.size;
+        const input = try allocator.alloc(f32, samples);
+        errdefer allocator.free(input);
+        const signal = try allocator.alloc(f32, samples);
+        errdefer allocator.free(signal);
+        const spectra = try allocator.alloc(math.Complex, capacity * self.channels * self.bins());
+        errdefer allocator.free(spectra);
+        const views = try allocator.alloc(StreamingStft, capacity);
+        self.batch = .{ .capacity = capacity, .input = input, .signal = signal, .spectra = spectra, .views = views };
+    }
+
+    fn freeBatch(self: *StreamingStft, allocator: std.mem.Allocator) void {
+        if (self.batch.capacity == 0) return;
+        allocator.free(self.batch.views);
+        allocator.free(self.batch.spectra);
+        allocator.free(self.batch.signal);
+        allocator.free(self.batch.input);
+        self.batch = .{};
+    }
+
+    /// Clears all history, as if the stream had just started.
+    pub fn reset(self: *StreamingStft) void {
+        @memset(self.input, 0);
+        @memset(self.accum, 0);
+        @memset(self.ready, 0);
+        self.pos = 0;
+    }
+
+    /// Samples between a sample entering process and it leaving.
+    pub fn latency(self: *const StreamingStft) usize {
+        return self.size;
+    }
+
+    /// How long output can keep changing after the input goes silent,
+    /// measured from the delay-compensated end of the input: spectral edits
+    /// spread each frame's contribution across the whole window.
+    pub fn tail(self: *const StreamingStft) usize {
+        return self.size;
+    }
+
+    pub fn bins(self: *const StreamingStft) usize {
+        return self.size / 2 + 1;
+    }
+
+    /// Spectrum of the current frame for one channel, valid inside the
+    /// frame callback. Bin k is k * sample_rate / size Hz.
+    pub fn spectrum(self: *StreamingStft, channel: usize) []math.Complex {
+        const n = self.bins();
+        return self.spectra[channel * n ..][0..n];
+    }
+
+    /// Unwindowed input samples of the current frame, oldest first.
+    pub fn frameInput(self: *const StreamingStft, channel: usize) []const f32 {
+        return self.input[channel * self.size ..][0..self.size];
+    }
+
+    /// Feeds `frames` samples of each analysed channel and writes the same
+    /// number of delayed output samples for each resynthesised one. Calls
+    /// `onFrame(ctx, frame)` once per completed hop, in order, on the
+    /// calling thread.
+    pub fn process(
+        self: *StreamingStft,
+        inputs: []const []const f32,
+        outputs: []const []f32,
+        frames: usize,
+        ctx: anytype,
+        comptime onFrame: fn (@TypeOf(ctx), *StreamingStft) void,
+    ) void {
+        self.processBatches(inputs, outputs, frames, ctx, InOrder(@TypeOf(ctx), onFrame).call);
+    }
+
+    /// process for callbacks that only touch their own frame (no state
+    /// carried from frame to frame): with worker threads, the frames of a
+    /// batch are handed out to the workers in no particular order.
+    pub fn processIndependent(
+        self: *StreamingStft,
+        inputs: []const []const f32,
+        outputs: []const []f32,
+        frames: usize,
+        ctx: anytype,
+        comptime onFrame: fn (@TypeOf(ctx), *StreamingStft) void,
+    ) void {
+        self.processBatches(inputs, outputs, frames, ctx, AnyOrder(@TypeOf(ctx), onFrame).call);
+    }
+
+    /// process with a callback per batch: `onBatch(ctx, self, frames)` gets
+    /// consecutive frames, oldest first (a single one without worker
+    /// threads), and may split its work with parallelFor.
+    pub fn processBatches(
+        self: *StreamingStft,
+        inputs: []const []const f32,
+        outputs: []const []f32,
+        frames: usize,
+        ctx: anytype,
+        comptime onBatch: fn (@TypeOf(ctx), *StreamingStft, []StreamingStft) void,
+    ) void {
+        std.debug.assert(inputs.len == self.channels and outputs.len == self.outputs);
+        var done: usize = 0;
+        while (done < frames) {
+            const due = @min((self.pos + frames - done) / self.hop, self.batch.capacity);
+            if (due >= 2) {
+                done += self.runBatch(inputs, outputs, done, due, ctx, onBatch);
+                continue;
+            }
+            const n = @min(frames - done, self.hop - self.pos);
+            for (inputs, 0..) |in, ch| {
+                @memcpy(self.input[ch * self.size + self.size - self.hop + self.pos ..][0..n], in[done..][0..n]);
+            }
+            for (outputs, 0..) |out, ch| {
+                @memcpy(out[done..][0..n], self.ready[ch * self.hop + self.pos ..][0..n]);
+            }
+            self.pos += n;
+            done += n;
+            if (self.pos == self.hop) {
+                self.runFrame(ctx, onBatch);
+                self.pos = 0;
+            }
+        }
+    }
+
+    /// Calls f(ctx, i) for every i in 0..count, spread over the worker
+    /// threads if there are any; returns when all are done.
+    pub fn parallelFor(self: *const StreamingStft, count: usize, ctx: anytype, comptime f: fn (@TypeOf(ctx), usize) void) void {
+        if (self.pool) |pool| return pool.run(self.threads, count, ctx, f);
+        for (0..count) |i| f(ctx, i);
+    }
+
+    fn runFrame(self: *StreamingStft, ctx: anytype, comptime onBatch: fn (@TypeOf(ctx), *StreamingStft, []StreamingStft) void) void {
+        const size = self.size;
+        const hop = self.hop;
+
+        for (0..self.channels) |ch| {
+            const frame = self.input[ch * size ..][0..size];
+            for (self.scratch, frame, self.window) |*s, x, w| s.* = x * w;
+            self.plan.forward(self.scratch, self.spectrum(ch));
+        }
+
+        onBatch(ctx, self, @as(*[1]StreamingStft, self));
+
+        for (0..self.outputs) |ch| {
+            self.plan.inverse(self.spectrum(ch), self.scratch);
+            for (self.scratch, self.window) |*y, w| y.* *= w;
+            self.overlapAdd(ch, self.scratch);
+        }
+
+        for (0..self.channels) |ch| {
+            const frame = self.input[ch * size ..][0..size];
+            std.mem.copyForwards(f32, frame[0 .. size - hop], frame[hop..]);
+        }
+    }
+
+    /// Adds one frame's windowed output to the accumulator and moves the
+    /// completed hop to `ready`.
+    fn overlapAdd(self: *StreamingStft, ch: usize, windowed: []const f32) void {
+        const size = self.size;
+        const hop = self.hop;
+        const accum = self.accum[ch * size ..][0..size];
+        for (accum, windowed) |*a, y| a.* += y;
+
+        @memcpy(self.ready[ch * hop ..][0..hop], accum[0..hop]);
+        std.mem.copyForwards(f32, accum[0 .. size - hop], accum[hop..]);
+        @memset(accum[size - hop ..], 0);
+    }
+
+    const BatchJob = struct {
+        stft: *StreamingStft,
+        inputs: []const []const f32,
+        /// Where this batch starts in inputs
+        offset: usize,
+    };
+
+    /// Runs the next `count` hops, starting `done` samples into this call,
+    /// as one batch. Returns the samples consumed.
+    fn runBatch(
+        self: *StreamingStft,
+        inputs: []const []const f32,
+        outputs: []const []f32,
+        done: usize,
+        count: usize,
+        ctx: anytype,
+        comptime onBatch: fn (@TypeOf(ctx), *StreamingStft, []StreamingStft) void,
+    ) usize {
+        const size = self.size;
+        const hop = self.hop;
+        const batch = &self.batch;
+        const job = BatchJob{ .stft = self, .inputs = inputs, .offset = done };
+
+        self.parallelFor(count * self.channels, job, analyse);
+        const views = batch.views[0..count];
+        for (views, 0..) |*view, j| {
+            view.* = self.*;
+            view.input = batch.input[j * self.channels * size ..][0 .. self.channels * size];
+            view.spectra = batch.spectra[j * self.channels * self.bins() ..][0 .. self.channels * self.bins()];
+        }
+        onBatch(ctx, self, views);
+        self.parallelFor(count * self.outputs, job, synthesise);
+
+        // Play out and overlap-add hop by hop, as runFrame would have
+        var consumed: usize = 0;
+        for (0..count) |j| {
+            const start = if (j == 0) self.pos else 0;
+            const n = hop - start;
+            for (outputs, 0..) |out, ch| {
+                @memcpy(out[done + consumed ..][0..n], self.ready[ch * hop + start ..][0..n]);
+            }
+            consumed += n;
+            for (0..self.outputs) |ch| self.overlapAdd(ch, self.batchSignal(j, ch));
+        }
+
+        // The FIFO carries on from the last frame, shifted by a hop
+        for (0..self.channels) |ch| {
+            const last = batch.input[((count - 1) * self.channels + ch) * size ..][0..size];
+            @memcpy(self.input[ch * size ..][0 .. size - hop], last[hop..]);
+        }
+        self.pos = 0;
+        return consumed;
+    }
+
+    fn batchSignal(self: *const StreamingStft, frame: usize, ch: usize) []f32 {
+        return self.batch.signal[(frame * self.channels + ch) * self.size ..][0..self.size];
+    }
+
+    fn batchSpectrum(self: *const StreamingStft, frame: usize, ch: usize) []math.Complex {
+        const n = self.bins();
+        return self.batch.spectra[(frame * self.channels + ch) * n ..][0..n];
+    }
+
+    /// Gathers and transforms frame i / channels, channel i % channels.
+    /// Counting from the start of the FIFO, frame j covers samples
+    /// j * hop .. j * hop + size; the FIFO holds the first `held` of them
+    /// and the rest come from this call's input.
+    fn analyse(job: BatchJob, i: usize) void {
+        const self = job.stft;
+        const size = self.size;
+        const j = i / self.channels;
+        const ch = i % self.channels;
+        const frame = self.batch.input[i * size ..][0..size];
+
+        const held = size - self.hop + self.pos;
+        const from_fifo = if (j * self.hop < held) held - j * self.hop else 0;
+        @memcpy(frame[0..from_fifo], self.input[ch * size + j * self.hop ..][0..from_fifo]);
+        const from_input = job.offset + j * self.hop + from_fifo - held;
+        @memcpy(frame[from_fifo..], job.inputs[ch][from_input..][0 .. size - from_fifo]);
+
+        const windowed = self.batchSignal(j, ch);
+        for (windowed, frame, self.window) |*s, x, w| s.* = x * w;
+        self.plan.forward(windowed, self.batchSpectrum(j, ch));
+    }
+
+    /// Inverse-transforms frame i / outputs, channel i % outputs, windowed.
+    fn synthesise(job: BatchJob, i: usize) void {
+        const self = job.stft;
+        const j = i / self.outputs;
+        const ch = i % self.outputs;
+        const signal = self.batchSignal(j, ch);
+        self.plan.inverse(self.batchSpectrum(j, ch), signal);
+        for (signal, self.window) |*y, w| y.* *= w;
+    }
+
+    fn InOrder(comptime Ctx: type, comptime onFrame: fn (Ctx, *StreamingStft) void) type {
+        return struct {
+            fn call(ctx: Ctx, stft: *StreamingStft, frames: []StreamingStft) void {
+                _ = stft;
+                for (frames) |*frame| onFrame(ctx, frame);
+            }
+        };
+    }
+
+    fn AnyOrder(comptime Ctx: type, comptime onFrame: fn (Ctx, *StreamingStft) void) type {
+        return struct {
+            const Job = struct { ctx: Ctx, frames: []StreamingStft };
+
+            fn one(job: Job, i: usize) void {
+                onFrame(job.ctx, &job.frames[i]);
+            }
+
+            fn call(ctx: Ctx, stft: *StreamingStft, frames: []StreamingStft) void {
+                stft.parallelFor(frames.len, Job{ .ctx = ctx, .frames = frames }, one);
+            }
+        };
+    }
+};
@@ -0,0 +1,145 @@
+const std = @import("std");
+
+/// Most threads one parallel section runs on, the caller's included.
+pub const max_threads = 64;
+
+/// Fork-join worker threads for offline rendering, where a host hands over
+/// blocks of many STFT frames and nothing waits on them in real time.
+///
+/// run() splits a loop of `count` independent items between the caller and
+/// up to `threads - 1` workers, which take items off a shared counter until
+/// none are left, and returns once every item is done. Which thread runs
+/// which item varies from call to call, so results must not depend on it.
+///
+/// One parallel section at a time: a caller that finds the pool busy (another
+/// instance rendering concurrently) runs its items itself rather than wait.
+/// run never allocates; threads are only started in acquire.
+pub const WorkerPool = struct {
+    /// Held by the caller of run for the whole section
+    busy: std.Thread.Mutex = .{},
+    /// Guards everything below
+    state: std.Thread.Mutex = .{},
+    wake: std.Thread.Condition = .{},
+    idle: std.Thread.Condition = .{},
+    threads: [max_threads - 1]std.Thread = undefined,
+    spawned: usize = 0,
+    /// Workers that may still join the current section
+    seats: usize = 0,
+    /// Workers inside the current section
+    active: usize = 0,
+    quit: bool = false,
+    job: Job = undefined,
+    next: std.atomic.Value(usize) = std.atomic.Value(usize).init(0),
+
+    const Job = struct {
+        ctx: *const anyopaque,
+        call: *const fn (*const anyopaque, usize) void,
+        count: usize,
+    };
+
+    /// Calls f(ctx, i) for every i in 0..count on up to `threads` threads,
+    /// the caller's included, and returns when all have finished.
+    pub fn run(self: *WorkerPool, threads: usize, count: usize, ctx: anytype, comptime f: fn (@TypeOf(ctx), usize) void) void {
+        const Ctx = @TypeOf(ctx);
+        const erased = struct {
+            fn call(ptr: *const anyopaque, i: usize) void {
+                f(@as(*const Ctx, @ptrCast(@alignCast(ptr))).*, i);
+            }
+        };
+        if (threads <= 1 or count <= 1 or !self.busy.tryLock()) {
+            for (0..count) |i| f(ctx, i);
+            return;
+        }
+        defer self.busy.unlock();
+
+        self.state.lock();
+        self.job = .{ .ctx = &ctx, .call = erased.call, .count = count };
+        self.next.store(0, .monotonic);
+        self.seats = @min(threads - 1, self.spawned, count - 1);
+        self.state.unlock();
+        self.wake.broadcast();
+
+        drain(self.job, &self.next);
+
+        // Late workers have nothing left to do; don't wait for them to start
+        self.state.lock();
+        self.seats = 0;
+        while (self.active > 0) self.idle.wait(&self.state);
+        self.state.unlock();
+    }
+
+    fn drain(job: Job, next: *std.atomic.Value(usize)) void {
+        while (true) {
+            const i = next.fetchAdd(1, .monotonic);
+            if (i >= job.count) return;
+            job.call(job.ctx, i);
+        }
+    }
+
+    fn workerMain(self: *WorkerPool) void {
+        self.state.lock();
+        defer self.state.unlock();
+        while (true) {
+            while (!self.quit and self.seats == 0) self.wake.wait(&self.state);
+            if (self.quit) return;
+            self.seats -= 1;
+            self.active += 1;
+            const job = self.job;
+            self.state.unlock();
+            drain(job, &self.next);
+            self.state.lock();
+            self.active -= 1;
+            if (self.active == 0) self.idle.signal();
+        }
+    }
+
+    /// Starts workers until `workers` are running, or as many as could be.
+    fn grow(self: *WorkerPool, workers: usize) void {
+        self.state.lock();
+        defer self.state.unlock();
+        while (self.spawned < @min(workers, self.threads.len)) {
+            self.threads[self.spawned] = std.Thread.spawn(.{}, workerMain, .{self}) catch return;
+            self.spawned += 1;
+        }
+    }
+
+    fn stop(self: *WorkerPool) void {
+        self.state.lock();
+        self.quit = true;
+        self.state.unlock();
+        self.wake.broadcast();
+        for (self.threads[0..self.spawned]) |t| t.join();
+        self.spawned = 0;
+        self.quit = false;
+    }
+};
+
+// --- Shared pool ---
+// One set of workers for every instance that renders offline, so a host
+// bouncing many tracks doesn't start threads per instance. It grows to the
+// largest thread count asked for and stops when its last user releases it,
+// before the library can be unloaded.
+
+var shared_lock: std.Thread.Mutex = .{};
+var shared: WorkerPool = .{};
+var shared_users: usize = 0;
+
+/// The shared pool with at least `threads - 1` workers started, or null if
+/// threads <= 1. Starts threads: call from prepare-time code, never from
+/// process. Pair with release.
+pub fn acquire(threads: usize) ?*WorkerPool {
+    if (threads <= 1) return null;
+    shared_lock.lock();
+    defer shared_lock.unlock();
+    shared.grow(@min(threads, max_threads) - 1);
+    shared_users += 1;
+    return &shared;
+}
+
+pub fn release(pool: *WorkerPool) void {
+    shared_lock.lock();
+    defer shared_lock.unlock();
+    std.debug.assert(pool == &shared and shared_users > 0);
+    shared_users -= 1;
+    if (shared_users == 0) shared.stop();
+}
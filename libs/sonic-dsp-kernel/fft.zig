@@ -0,0 +1,284 @@
+const std = @import("std");
+const Complex = @import("math_utils.zig").Complex;
+
+// Transforms follow math_utils.fft_iterative: the forward kernel is
+// e^{+i 2 pi k n / N} and the inverse scales by 1/N, so a plan can replace
+// it anywhere without touching the spectral code around it.
+
+const lanes = 8;
+const V = @Vector(lanes, f32);
+
+/// Power-of-two complex FFT with its bit-reversal and twiddle tables built
+/// once. Butterflies are radix-4 (two radix-2 stages per pass over the data,
+/// three complex multiplies per four points) with a leading radix-2 pass when
+/// log2(n) is odd; passes with at least eight butterflies per group run on
+/// @Vector lanes. Twiddles are evaluated directly in f64, not by repeated
+/// multiplication, so error does not grow along a pass.
+///
+/// A plan is immutable after init: one plan can serve any number of
+/// buffers and threads at once.
+pub const FftPlan = struct {
+    n: usize,
+    log2n: u6,
+    bitrev: []u32,
+    /// Per radix-4 pass with quarter span h, three runs of h twiddles
+    /// (W^2k, W^k, W^3k of the 4h-point transform), stored re/im apart so
+    /// a vector pass loads them contiguously.
+    tw_re: []f32,
+    tw_im: []f32,
+
+    pub fn init(allocator: std.mem.Allocator, n: usize) !FftPlan {
+        if (n == 0 or !std.math.isPowerOfTwo(n) or n > std.math.maxInt(u32)) return error.InvalidSize;
+        const log2n: u6 = @intCast(std.math.log2_int(usize, n));
+
+        const bitrev = try allocator.alloc(u32, n);
+        errdefer allocator.free(bitrev);
+        for (bitrev, 0..) |*r, i| {
+            r.* = if (log2n == 0) 0 else @intCast(@bitReverse(@as(u32, @intCast(i))) >> @intCast(32 - @as(u32, log2n)));
+        }
+
+        var count: usize = 0;
+        var h: usize = firstQuarterSpan(log2n);
+        while (4 * h <= n) : (h *= 4) count += 3 * h;
+
+        const tw_re = try allocator.alloc(f32, count);
+        errdefer allocator.free(tw_re);
+        const tw_im = try allocator.alloc(f32, count);
+
+        var off: usize = 0;
+        h = firstQuarterSpan(log2n);
+        while (4 * h <= n) : (h *= 4) {
+            const step = 2.0 * std.math.pi / @as(f64, @floatFromInt(4 * h));
+            for (0..h) |k| {
+                const kf: f64 = @floatFromInt(k);
+                inline for (.{ 2.0, 1.0, 3.0 }, 0..) |mult, set| {
+                    tw_re[off + set * h + k] = @floatCast(@cos(step * kf * mult));
+                    tw_im[off + set * h + k] = @floatCast(@sin(step * kf * mult));
+                }
+            }
+            off += 3 * h;
+        }
+
+        return .{ .n = n, .log2n = log2n, .bitrev = bitrev, .tw_re = tw_re, .tw_im = tw_im };
+    }
+
+    pub fn deinit(self: *FftPlan, allocator: std.mem.Allocator) void {
+        allocator.free(self.bitrev);
+        allocator.free(self.tw_re);
+        allocator.free(self.tw_im);
+    }
+
+    pub fn forward(self: *const FftPlan, buffer: []Complex) void {
+        self.run(buffer, false);
+    }
+
+    pub fn inverse(self: *const FftPlan, buffer: []Complex) void {
+        self.run(buffer, true);
+    }
+
+    pub fn transform(self: *const FftPlan, buffer: []Complex, inverse_dir: bool) void {
+        if (inverse_dir) self.run(buffer, true) else self.run(buffer, false);
+    }
+
+    fn firstQuarterSpan(log2n: u6) usize {
+        return if (log2n % 2 == 1) 2 else 1;
+    }
+
+    fn run(self: *const FftPlan, buffer: []Complex, comptime inv: bool) void {
+        std.debug.assert(buffer.len == self.n);
+        const n = self.n;
+
+        for (self.bitrev, 0..) |r, i| {
+            if (i < r) std.mem.swap(Complex, &buffer[i], &buffer[r]);
+        }
+
+        if (self.log2n % 2 == 1) {
+            var i: usize = 0;
+            while (i < n) : (i += 2) {
+                const a = buffer[i];
+                const b = buffer[i + 1];
+                buffer[i] = a.add(b);
+                buffer[i + 1] = a.sub(b);
+            }
+        }
+
+        var off: usize = 0;
+        var h: usize = firstQuarterSpan(self.log2n);
+        while (4 * h <= n) : (h *= 4) {
+            const tw_re = self.tw_re[off .. off + 3 * h];
+            const tw_im = self.tw_im[off .. off + 3 * h];
+            if (h >= lanes) radix4Vector(buffer, h, tw_re, tw_im, inv) else radix4Scalar(buffer, h, tw_re, tw_im, inv);
+            off += 3 * h;
+        }
+
+        if (inv) {
+            const floats: [*]f32 = @ptrCast(buffer.ptr);
+            const scale = 1.0 / @as(f32, @floatFromInt(n));
+            for (floats[0 .. 2 * n]) |*v| v.* *= scale;
+        }
+    }
+};
+
+fn radix4Scalar(buffer: []Complex, h: usize, tw_re: []const f32, tw_im: []const f32, comptime inv: bool) void {
+    const s: f32 = if (inv) -1.0 else 1.0;
+    var base: usize = 0;
+    while (base < buffer.len) : (base += 4 * h) {
+        for (0..h) |k| {
+            const x0 = buffer[base + k];
+            const t1 = buffer[base + k + h].mul(.{ .re = tw_re[k], .im = s * tw_im[k] });
+            const t2 = buffer[base + k + 2 * h].mul(.{ .re = tw_re[h + k], .im = s * tw_im[h + k] });
+            const t3 = buffer[base + k + 3 * h].mul(.{ .re = tw_re[2 * h + k], .im = s * tw_im[2 * h + k] });
+            const a0 = x0.add(t1);
+            const a1 = x0.sub(t1);
+            const a2 = t2.add(t3);
+            const a3 = t2.sub(t3);
+            buffer[base + k] = a0.add(a2);
+            buffer[base + k + 2 * h] = a0.sub(a2);
+            // a3 times W^h = +i forward, -i inverse
+            buffer[base + k + h] = .{ .re = a1.re - s * a3.im, .im = a1.im + s * a3.re };
+            buffer[base + k + 3 * h] = .{ .re = a1.re + s * a3.im, .im = a1.im - s * a3.re };
+        }
+    }
+}
+
+const Split = struct { re: V, im: V };
+
+fn loadSplit(floats: [*]const f32, index: usize) Split {
+    const a: V = floats[2 * index ..][0..lanes].*;
+    const b: V = floats[2 * index + lanes ..][0..lanes].*;
+    return .{
+        .re = @shuffle(f32, a, b, [lanes]i32{ 0, 2, 4, 6, ~@as(i32, 0), ~@as(i32, 2), ~@as(i32, 4), ~@as(i32, 6) }),
+        .im = @shuffle(f32, a, b, [lanes]i32{ 1, 3, 5, 7, ~@as(i32, 1), ~@as(i32, 3), ~@as(i32, 5), ~@as(i32, 7) }),
+    };
+}
+
+fn storeSplit(floats: [*]f32, index: usize, re: V, im: V) void {
+    floats[2 * index ..][0..lanes].* = @shuffle(f32, re, im, [lanes]i32{ 0, ~@as(i32, 0), 1, ~@as(i32, 1), 2, ~@as(i32, 2), 3, ~@as(i32, 3) });
+    floats[2 * index + lanes ..][0..lanes].* = @shuffle(f32, re, im, [lanes]i32{ 4, ~@as(i32, 4), 5, ~@as(i32, 5), 6, ~@as(i32, 6), 7, ~@as(i32, 7) });
+}
+
+fn mulSplit(x: Split, wr: V, wi: V) Split {
+    return .{ .re = x.re * wr - x.im * wi, .im = x.re * wi + x.im * wr };
+}
+
+fn radix4Vector(buffer: []Complex, h: usize, tw_re: []const f32, tw_im: []const f32, comptime inv: bool) void {
+    const floats: [*]f32 = @ptrCast(buffer.ptr);
+    const s: V = @splat(if (inv) -1.0 else 1.0);
+    var base: usize = 0;
+    while (base < buffer.len) : (base += 4 * h) {
+        var k: usize = 0;
+        while (k < h) : (k += lanes) {
+            const x0 = loadSplit(floats, base + k);
+            const t1 = mulSplit(loadSplit(floats, base + k + h), tw_re[k..][0..lanes].*, s * @as(V, tw_im[k..][0..lanes].*));
+            const t2 = mulSplit(loadSplit(floats, base + k + 2 * h), tw_re[h + k ..][0..lanes].*, s * @as(V, tw_im[h + k ..][0..lanes].*));
+            const t3 = mulSplit(loadSplit(floats, base + k + 3 * h), tw_re[2 * h + k ..][0..lanes].*, s * @as(V, tw_im[2 * h + k ..][0..lanes].*));
+            const a0_re = x0.re + t1.re;
+            const a0_im = x0.im + t1.im;
+            const a1_re = x0.re - t1.re;
+            const a1_im = x0.im - t1.im;
+            const a2_re = t2.re + t3.re;
+            const a2_im = t2.im + t3.im;
+            const a3_re = t2.re - t3.re;
+            const a3_im = t2.im - t3.im;
+            storeSplit(floats, base + k, a0_re + a2_re, a0_im + a2_im);
+            storeSplit(floats, base + k + 2 * h, a0_re - a2_re, a0_im - a2_im);
+            storeSplit(floats, base + k + h, a1_re - s * a3_im, a1_im + s * a3_re);
+            storeSplit(floats, base + k + 3 * h, a1_re + s * a3_im, a1_im - s * a3_re);
+        }
+    }
+}
+
+/// Real-input FFT of power-of-two size n >= 4, computed as an n/2-point
+/// complex FFT of the even/odd sample pairs plus one split pass. The
+/// spectrum is the n/2 + 1 non-redundant bins; the rest follow from
+/// conjugate symmetry.
+pub const RealFftPlan = struct {
+    n: usize,
+    half: FftPlan,
+    /// W_n^k for k in 0..n/4 (the split pass handles bins k and n/2 - k together)
+    tw_re: []f32,
+    tw_im: []f32,
+
+    pub fn init(allocator: std.mem.Allocator, n: usize) !RealFftPlan {
+        if (n < 4 or !std.math.isPowerOfTwo(n)) return error.InvalidSize;
+        var half = try FftPlan.init(allocator, n / 2);
+        errdefer half.deinit(allocator);
+
+        const tw_re = try allocator.alloc(f32, n / 4 + 1);
+        errdefer allocator.free(tw_re);
+        const tw_im = try allocator.alloc(f32, n / 4 + 1);
+        const step = 2.0 * std.math.pi / @as(f64, @floatFromInt(n));
+        for (tw_re, tw_im, 0..) |*re, *im, k| {
+            const angle = step * @as(f64, @floatFromInt(k));
+            re.* = @floatCast(@cos(angle));
+            im.* = @floatCast(@sin(angle));
+        }
+        return .{ .n = n, .half = half, .tw_re = tw_re, .tw_im = tw_im };
+    }
+
+    pub fn deinit(self: *RealFftPlan, allocator: std.mem.Allocator) void {
+        self.half.deinit(allocator);
+        allocator.free(self.tw_re);
+        allocator.free(self.tw_im);
+    }
+
+    /// input: n samples. output: n/2 + 1 bins, equal to bins 0..n/2 of the
+    /// complex transform of the same signal.
+    pub fn forward(self: *const RealFftPlan, input: []const f32, output: []Complex) void {
+        const half_n = self.n / 2;
+        std.debug.assert(input.len == self.n and output.len == half_n + 1);
+
+        const z = output[0..half_n];
+        for (z, 0..) |*c, m| c.* = .{ .re = input[2 * m], .im = input[2 * m + 1] };
+        self.half.forward(z);
+
+        const z0 = z[0];
+        output[0] = .{ .re = z0.re + z0.im, .im = 0 };
+        output[half_n] = .{ .re = z0.re - z0.im, .im = 0 };
+
+        // Z = E + iO, with E, O the spectra of the even and odd samples;
+        // X[k] = E[k] + W^k O[k] and X[N-k] = conj(E[k] - W^k O[k]).
+        var k: usize = 1;
+        while (k <= half_n / 2) : (k += 1) {
+            const zk = output[k];
+            const zm = output[half_n - k];
+            const e_re = 0.5 * (zk.re + zm.re);
+            const e_im = 0.5 * (zk.im - zm.im);
+            const o_re = 0.5 * (zk.im + zm.im);
+            const o_im = -0.5 * (zk.re - zm.re);
+            const p_re = self.tw_re[k] * o_re - self.tw_im[k] * o_im;
+            const p_im = self.tw_re[k] * o_im + self.tw_im[k] * o_re;
+            output[k] = .{ .re = e_re + p_re, .im = e_im + p_im };
+            output[half_n - k] = .{ .re = e_re - p_re, .im = p_im - e_im };
+        }
+    }
+
+    /// input: n/2 + 1 bins. output: n samples, scaled by 1/n like the
+    /// complex inverse.
+    pub fn inverse(self: *const RealFftPlan, input: []const Complex, output: []f32) void {
+        const half_n = self.n / 2;
+        std.debug.assert(input.len == half_n + 1 and output.len == self.n);
+
+        // Rebuild Z = E + iO in the output buffer; its inverse is the
+        // interleaved even/odd samples.
+        const z = @as([*]Complex, @ptrCast(@alignCast(output.ptr)))[0..half_n];
+        const x0 = input[0].re;
+        const xn = input[half_n].re;
+        z[0] = .{ .re = 0.5 * (x0 + xn), .im = 0.5 * (x0 - xn) };
+
+        var k: usize = 1;
+        while (k <= half_n / 2) : (k += 1) {
+            const xk = input[k];
+            const xm = input[half_n - k];
+            const e_re = 0.5 * (xk.re + xm.re);
+            const e_im = 0.5 * (xk.im - xm.im);
+            const d_re = 0.5 * (xk.re - xm.re);
+            const d_im = 0.5 * (xk.im + xm.im);
+            const o_re = d_re * self.tw_re[k] + d_im * self.tw_im[k];
+            const o_im = d_im * self.tw_re[k] - d_re * self.tw_im[k];
+            z[k] = .{ .re = e_re - o_im, .im = e_im + o_re };
+            z[half_n - k] = .{ .re = e_re + o_im, .im = o_re - e_im };
+        }
+        self.half.inverse(z);
+    }
+};
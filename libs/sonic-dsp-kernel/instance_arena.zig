@@ -0,0 +1,191 @@
+const std = @import("std");
+const Alignment = std.mem.Alignment;
+
+/// Every arena block and every allocation carved from it starts on its own
+/// cache line, so two instances (or two buffers of one instance) never share one.
+pub const cache_line = 64;
+
+/// Bump allocator over one cache-line-aligned block owned by a single plugin
+/// instance. The kernel sizes the block for the instance as prepared (see
+/// Sizer), so the plugin's state and scratch buffers end up contiguous and
+/// the whole instance is released with one free. The arena's own fields
+/// sit at the start of the block (see create), so an allocator a plugin
+/// keeps stays valid for as long as the block does.
+///
+/// Freeing the most recent allocation rolls the arena back; any other free
+/// is a no-op until the block itself goes away. A request that does not
+/// fit goes to the overflow allocator if there is one (-Dinstance-arena=false)
+/// and otherwise fails, so the plugin reports it as out of memory.
+pub const InstanceArena = struct {
+    buffer: []align(cache_line) u8,
+    /// Where the plugin's allocations begin: after the arena's fields and
+    /// whatever the caller reserved
+    base: usize,
+    end: usize,
+    overflow: ?std.mem.Allocator,
+    /// Requests the block could not hold (new blocks and growing resizes),
+    /// for the wrappers' profiling counters: served by the overflow
+    /// allocator when there is one, refused otherwise.
+    misses: u64,
+    /// Overflow blocks not yet freed. While there are any, part of the
+    /// instance lives outside its block and a copy of the block alone
+    /// (plugin_snapshot) would miss it.
+    overflow_live: usize,
+
+    /// Bytes at the start of a block taken by the arena's own fields
+    pub const header = std.mem.alignForward(usize, @sizeOf(InstanceArena), cache_line);
+
+    /// The first `reserved` bytes of buffer are already in use by the caller.
+    pub fn init(buffer: []align(cache_line) u8, reserved: usize, overflow: ?std.mem.Allocator) InstanceArena {
+        return .{ .buffer = buffer, .base = reserved, .end = reserved, .overflow = overflow, .misses = 0, .overflow_live = 0 };
+    }
+
+    /// A block from `backing` holding the arena itself, `reserve` bytes for
+    /// the caller (see reservation) and `capacity` bytes to allocate from.
+    pub fn create(backing: std.mem.Allocator, reserve: usize, capacity: usize, overflow: ?std.mem.Allocator) !*InstanceArena {
+        const reserved = header + std.mem.alignForward(usize, reserve, cache_line);
+        const block = try backing.alignedAlloc(u8, cache_line, reserved + capacity);
+        const self: *InstanceArena = @ptrCast(block.ptr);
+        self.* = init(block, reserved, overflow);
+        return self;
+    }
+
+    /// Frees a block made by create, the arena included.
+    pub fn destroy(self: *InstanceArena, backing: std.mem.Allocator) void {
+        backing.free(self.buffer);
+    }
+
+    /// The caller's reserved bytes of a block made by create
+    pub fn reservation(self: *const InstanceArena) []align(cache_line) u8 {
+        return @alignCast(self.buffer[header..self.base]);
+    }
+
+    /// Everything allocated so far, from the first allocation on
+    pub fn used(self: *const InstanceArena) []u8 {
+        return self.buffer[self.base..self.end];
+    }
+
+    pub fn allocator(self: *InstanceArena) std.mem.Allocator {
+        return .{ .ptr = self, .vtable = &vtable };
+    }
+
+    const vtable: std.mem.Allocator.VTable = .{
+        .alloc = alloc,
+        .resize = resize,
+        .remap = remap,
+        .free = free,
+    };
+
+    fn owns(self: *const InstanceArena, memory: []u8) bool {
+        const addr = @intFromPtr(memory.ptr);
+        const base = @intFromPtr(self.buffer.ptr);
+        return addr >= base and addr < base + self.buffer.len;
+    }
+
+    fn offsetOf(self: *const InstanceArena, memory: []u8) usize {
+        return @intFromPtr(memory.ptr) - @intFromPtr(self.buffer.ptr);
+    }
+
+    fn isLast(self: *const InstanceArena, memory: []u8) bool {
+        return self.offsetOf(memory) + memory.len == self.end;
+    }
+
+    fn alloc(ctx: *anyopaque, len: usize, alignment: Alignment, ret_addr: usize) ?[*]u8 {
+        const self: *InstanceArena = @ptrCast(@alignCast(ctx));
+        const base = @intFromPtr(self.buffer.ptr);
+        const start = std.mem.alignForward(usize, base + self.end, @max(alignment.toByteUnits(), cache_line)) - base;
+        if (start + len > self.buffer.len) {
+            self.misses +%= 1;
+            const overflow = self.overflow orelse return null;
+            const memory = overflow.rawAlloc(len, alignment, ret_addr) orelse return null;
+            self.overflow_live += 1;
+            return memory;
+        }
+        self.end = start + len;
+        return self.buffer.ptr + start;
+    }
+
+    fn resize(ctx: *anyopaque, memory: []u8, alignment: Alignment, new_len: usize, ret_addr: usize) bool {
+        const self: *InstanceArena = @ptrCast(@alignCast(ctx));
+        if (!self.owns(memory)) {
+            if (new_len > memory.len) self.misses +%= 1;
+            return self.overflow.?.rawResize(memory, alignment, new_len, ret_addr);
+        }
+        if (!self.isLast(memory)) return new_len <= memory.len;
+        const start = self.offsetOf(memory);
+        if (start + new_len > self.buffer.len) return false;
+        self.end = start + new_len;
+        return true;
+    }
+
+    fn remap(ctx: *anyopaque, memory: []u8, alignment: Alignment, new_len: usize, ret_addr: usize) ?[*]u8 {
+        const self: *InstanceArena = @ptrCast(@alignCast(ctx));
+        if (!self.owns(memory)) {
+            if (new_len > memory.len) self.misses +%= 1;
+            return self.overflow.?.rawRemap(memory, alignment, new_len, ret_addr);
+        }
+        return if (resize(ctx, memory, alignment, new_len, ret_addr)) memory.ptr else null;
+    }
+
+    fn free(ctx: *anyopaque, memory: []u8, alignment: Alignment, ret_addr: usize) void {
+        const self: *InstanceArena = @ptrCast(@alignCast(ctx));
+        if (!self.owns(memory)) {
+            self.overflow_live -= 1;
+            return self.overflow.?.rawFree(memory, alignment, ret_addr);
+        }
+        if (self.isLast(memory)) self.end = self.offsetOf(memory);
+    }
+};
+
+/// Passes allocations through to `backing` while laying them out the way an
+/// InstanceArena would, giving the block capacity a throwaway instance
+/// needed to be created and prepared. Frees
+/// never give space back and only shrinking resizes succeed, so the result
+/// is an upper bound.
+pub const Sizer = struct {
+    backing: std.mem.Allocator,
+    end: usize,
+
+    pub fn init(backing: std.mem.Allocator, reserved: usize) Sizer {
+        return .{ .backing = backing, .end = reserved };
+    }
+
+    pub fn allocator(self: *Sizer) std.mem.Allocator {
+        return .{ .ptr = self, .vtable = &vtable };
+    }
+
+    /// Capacity to give the arena, rounded to whole cache lines.
+    pub fn footprint(self: *const Sizer) usize {
+        return std.mem.alignForward(usize, self.end, cache_line);
+    }
+
+    const vtable: std.mem.Allocator.VTable = .{
+        .alloc = alloc,
+        .resize = resize,
+        .remap = remap,
+        .free = free,
+    };
+
+    fn alloc(ctx: *anyopaque, len: usize, alignment: Alignment, ret_addr: usize) ?[*]u8 {
+        const self: *Sizer = @ptrCast(@alignCast(ctx));
+        const align_bytes = @max(alignment.toByteUnits(), cache_line);
+        // The block itself is only cache-line aligned; larger alignments may need padding
+        const slack = if (align_bytes > cache_line) align_bytes - cache_line else 0;
+        self.end = std.mem.alignForward(usize, self.end, cache_line) + slack + len;
+        return self.backing.rawAlloc(len, alignment, ret_addr);
+    }
+
+    fn resize(ctx: *anyopaque, memory: []u8, alignment: Alignment, new_len: usize, ret_addr: usize) bool {
+        const self: *Sizer = @ptrCast(@alignCast(ctx));
+        return new_len <= memory.len and self.backing.rawResize(memory, alignment, new_len, ret_addr);
+    }
+
+    fn remap(_: *anyopaque, _: []u8, _: Alignment, _: usize, _: usize) ?[*]u8 {
+        return null;
+    }
+
+    fn free(ctx: *anyopaque, memory: []u8, alignment: Alignment, ret_addr: usize) void {
+        const self: *Sizer = @ptrCast(@alignCast(ctx));
+        self.backing.rawFree(memory, alignment, ret_addr);
+    }
+};
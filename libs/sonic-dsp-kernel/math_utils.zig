@@ -1,9 +1,11 @@
 const std = @import("std");
+const fft = @import("fft.zig");
 
 pub const PI: f32 = 3.14159265358979323846;
 pub const TWO_PI: f32 = 6.28318530717958647692;
 
-pub const Complex = struct {
+// extern: FFT plans reinterpret []Complex as interleaved re/im floats
+pub const Complex = extern struct {
     re: f32,
     im: f32,
 
@@ -39,26 +41,35 @@ pub const Complex = struct {
     }
 };
 
-// Simple recursive Cooley-Tukey FFT
-// Note: In production, an iterative version with precomputed twiddle factors is faster.
-// Using this for simplicity and readability as per blueprint context.
-pub fn fft(buffer: []Complex, stride: usize) void {
-    const len = buffer.len;
-    if (len <= 1) return;
-
-    // Separate even and odd
-    // This in-place recursive structure is a bit tricky in Zig without allocation.
-    // For a simple implementation without external allocator, we might need a scratch buffer.
-    // However, the standard recursive algorithm usually allocates.
-    // Let's implement an iterative one or assume the caller provides scratch.
-    // 
-    // Actually, for the "Adaptive Spectral Denoise" with 2048 window, a simple iterative implementation is better.
-    
-    _ = stride; // Unused in this placeholder if we go iterative
+pub const FftPlan = fft.FftPlan;
+pub const RealFftPlan = fft.RealFftPlan;
+
+/// In-place complex FFT (forward kernel e^{+i...}, inverse scaled by 1/n)
+/// on the caller's plan from fftPlan, or by fft_radix2_reference when
+/// there is none for this size.
+pub fn fft_iterative(plan: *const ?FftPlan, buffer: []Complex, inverse: bool) void {
+    if (plan.*) |p| {
+        if (p.n == buffer.len) return p.transform(buffer, inverse);
+    }
+    fft_radix2_reference(buffer, inverse);
+}
+
+/// Plan for fft_iterative at size n, built where the caller allocates its
+/// buffers so a transform never has to. null (the radix-2 fallback) if n
+/// is not a power of two or the tables don't fit; free with deinitFftPlan.
+pub fn fftPlan(allocator: std.mem.Allocator, n: usize) ?FftPlan {
+    return FftPlan.init(allocator, n) catch null;
+}
+
+pub fn deinitFftPlan(plan: *?FftPlan, allocator: std.mem.Allocator) void {
+    if (plan.*) |*p| p.deinit(allocator);
+    plan.* = null;
 }
 
-// Minimal iterative FFT implementation
-pub fn fft_iterative(buffer: []Complex, inverse: bool) void {
+/// The original scalar radix-2 transform: twiddles by repeated complex
+/// multiplication, no tables. Fallback for sizes without a plan and the
+/// baseline in tests/fft_accuracy_test.cpp and bench/fft_bench.cpp.
+pub fn fft_radix2_reference(buffer: []Complex, inverse: bool) void {
     const n = buffer.len;
     
     // Bit reversal permutation
@@ -0,0 +1,329 @@
+const std = @import("std");
+const cache_line = @import("instance_arena.zig").cache_line;
+
+/// Slots in a chain. An empty slot passes audio straight through.
+pub const slots = 8;
+/// Parameters per slot: the wrappers' generic count for a single plugin.
+pub const slot_params = 16;
+/// Frames a module processes per call. Two sub-blocks per channel are all
+/// the audio a chain keeps between modules (4 KB in stereo), so a sub-block
+/// stays in L1 from the first module to the last before the next one is read.
+pub const sub_block = 256;
+/// Slot selectors first, then every slot's parameters.
+pub const total_params = slots + slots * slot_params;
+
+/// An ordered list of kernel instances run as one plugin, so a whole
+/// channel strip sits behind one wrapper instead of one per module.
+///
+/// Parameters:
+///   s                          (s < slots) the module in slot s, stepped:
+///                              0 is empty, k / module_classes is class k - 1
+///   slots + s * slot_params + p  parameter p of slot s's module
+///
+/// A slot's parameter values belong to the slot, not the module: they are
+/// kept while a slot is empty, handed to whatever module it gets next and
+/// read back as set.
+///
+/// Moving a selector only records the choice; modules are created and
+/// destroyed in prepare, which never runs concurrently with process. The
+/// wrappers treat selectors as stepped settings and re-prepare when one
+/// moves, the way an oversampling change is handled. A slot's stepped
+/// parameters (its module's oversampling factor) are handled the same way:
+/// recorded, and handed to the module in prepare, so the chain's latency
+/// only changes there. Which slot parameters those are depends on the
+/// selected module, so the chain reports them per instance
+/// (plugin_param_steps) rather than per class.
+///
+/// Learned state of the modules (noise profiles, references) is not part
+/// of the chain's saved state: its size would depend on the selected
+/// modules, which plugin_load_state can't allocate for. A snapshot
+/// (plugin_snapshot) does carry theirs: the modules are its nested
+/// instances.
+///
+/// Kernel supplies the instance-level C ABI the chain drives its modules
+/// through (plugin_create_class, plugin_process, ...), plus module_classes,
+/// the number of classes a slot can hold, and class_param_steps
+/// (plugin_class_param_steps).
+pub fn ModuleChain(comptime Kernel: type) type {
+    return struct {
+        const Self = @This();
+
+        sample_rate: f32,
+        channels: u32,
+        modules: [slots]?*anyopaque,
+        /// Class index + 1 per slot, 0 for empty: what is loaded, and what
+        /// the selectors ask for at the next prepare. wanted is read
+        /// atomically by instanceSteps, which a UI thread may call.
+        loaded: [slots]u32,
+        wanted: [slots]u32,
+        values: [slots * slot_params]f32,
+        /// Loaded modules in slot order, for process
+        stages: [slots]*anyopaque,
+        stage_count: usize,
+        /// Ping-pong buffers between consecutive modules
+        scratch: [2][2][sub_block]f32 align(cache_line),
+
+        pub fn init(allocator: std.mem.Allocator, sample_rate: f32) !*Self {
+            const self = try allocator.create(Self);
+            self.* = .{
+                .sample_rate = sample_rate,
+                .channels = 2,
+                .modules = [_]?*anyopaque{null} ** slots,
+                .loaded = [_]u32{0} ** slots,
+                .wanted = [_]u32{0} ** slots,
+                // The wrappers' default for a generic parameter
+                .values = [_]f32{0.5} ** (slots * slot_params),
+                .stages = undefined,
+                .stage_count = 0,
+                .scratch = undefined,
+            };
+            return self;
+        }
+
+        pub fn deinit(self: *Self, allocator: std.mem.Allocator) void {
+            for (self.modules) |module| {
+                if (module) |m| Kernel.destroy(m);
+            }
+            allocator.destroy(self);
+        }
+
+        /// Loads the selected modules, then prepares every module for
+        /// sub-block calls at the new rate. A module that can't be created
+        /// leaves its slot as it was and makes prepare report failure.
+        pub fn prepare(self: *Self, sample_rate: f32) bool {
+            self.sample_rate = sample_rate;
+            var ok = true;
+            for (0..slots) |s| {
+                if (self.wanted[s] != self.loaded[s]) {
+                    if (self.load(s)) {
+                        self.loaded[s] = self.wanted[s];
+                    } else {
+                        ok = false;
+                    }
+                }
+                if (self.modules[s]) |m| {
+                    self.applySettings(s, m);
+                    if (Kernel.prepare(m, sample_rate, sub_block) != 0) ok = false;
+                }
+            }
+            self.stage_count = 0;
+            for (self.modules) |module| {
+                if (module) |m| {
+                    self.stages[self.stage_count] = m;
+                    self.stage_count += 1;
+                }
+            }
+            return ok;
+        }
+
+        fn load(self: *Self, slot: usize) bool {
+            var next: ?*anyopaque = null;
+            if (self.wanted[slot] != 0) {
+                const m = Kernel.create(self.wanted[slot] - 1, self.sample_rate) orelse return false;
+                if (Kernel.set_channels(m, self.channels) != 0) {
+                    Kernel.destroy(m);
+                    return false;
+                }
+                for (self.values[slot * slot_params ..][0..slot_params], 0..) |value, p| {
+                    Kernel.set_parameter(m, @intCast(p), value);
+                }
+                next = m;
+            }
+            if (self.modules[slot]) |old| Kernel.destroy(old);
+            self.modules[slot] = next;
+            return true;
+        }
+
+        /// Hands slot s's stepped parameters to its module. Unchanged
+        /// settings are no-ops (an oversampler keeps its factor and state).
+        fn applySettings(self: *Self, slot: usize, module: *anyopaque) void {
+            for (self.values[slot * slot_params ..][0..slot_params], 0..) |value, p| {
+                if (stepsOf(self.loaded[slot], p) > 0) Kernel.set_parameter(module, @intCast(p), value);
+            }
+        }
+
+        /// Runs each sub-block through every module before reading the
+        /// next one. The first module reads the host's input and the last
+        /// writes the host's output; in between, modules alternate between
+        /// the two scratch buffers, so no module sees aliased buffers.
+        pub fn process(self: *Self, inputs: [*]const [*]const f32, outputs: [*][*]f32, frames: usize) void {
+            const channels = self.channels;
+            if (self.stage_count == 0) {
+                for (0..channels) |c| @memcpy(outputs[c][0..frames], inputs[c][0..frames]);
+                return;
+            }
+            const last = self.stage_count - 1;
+            var pos: usize = 0;
+            while (pos < frames) {
+                const n = @min(sub_block, frames - pos);
+                var src: [2][*]const f32 = undefined;
+                for (0..channels) |c| src[c] = inputs[c] + pos;
+                for (self.stages[0..self.stage_count], 0..) |m, k| {
+                    var dst: [2][*]f32 = undefined;
+                    for (0..channels) |c| dst[c] = if (k == last) outputs[c] + pos else &self.scratch[k % 2][c];
+                    Kernel.process(m, &src, &dst, n);
+                    for (0..channels) |c| src[c] = dst[c];
+                }
+                pos += n;
+            }
+        }
+
+        /// Forwarded to every module; a stereo-only module gets the
+        /// kernel's mono adaptation.
+        pub fn setChannels(self: *Self, channels: u32) void {
+            self.channels = channels;
+            for (self.modules) |module| {
+                if (module) |m| _ = Kernel.set_channels(m, channels);
+            }
+        }
+
+        pub fn latency(self: *const Self) u32 {
+            var total: u32 = 0;
+            for (self.stages[0..self.stage_count]) |m| total += Kernel.latency(m);
+            return total;
+        }
+
+        pub fn tail(self: *const Self) u32 {
+            var total: u32 = 0;
+            for (self.stages[0..self.stage_count]) |m| total += Kernel.tail(m);
+            return total;
+        }
+
+        pub fn decayed(self: *const Self) bool {
+            for (self.stages[0..self.stage_count]) |m| {
+                if (Kernel.decayed(m) == 0) return false;
+            }
+            return true;
+        }
+
+        pub fn setParameter(self: *Self, index: i32, value: f32) void {
+            if (index < 0 or index >= total_params) return;
+            const i: usize = @intCast(index);
+            if (i < slots) {
+                @atomicStore(u32, &self.wanted[i], selection(value), .monotonic);
+                return;
+            }
+            self.values[i - slots] = value;
+            const slot = (i - slots) / slot_params;
+            const p = (i - slots) % slot_params;
+            // A stepped setting waits for prepare, like a selector
+            if (stepsOf(self.loaded[slot], p) > 0) return;
+            if (self.modules[slot]) |m| Kernel.set_parameter(m, @intCast(p), value);
+        }
+
+        pub fn getParameter(self: *Self, index: i32) f32 {
+            if (index < 0 or index >= total_params) return 0.0;
+            const i: usize = @intCast(index);
+            if (i < slots) return @as(f32, @floatFromInt(self.wanted[i])) / @as(f32, @floatFromInt(Kernel.module_classes));
+            return self.values[i - slots];
+        }
+
+        /// Same rounding as the wrappers' stepped parameters
+        fn selection(value: f32) u32 {
+            const steps: f32 = @floatFromInt(Kernel.module_classes);
+            return @intFromFloat(std.math.clamp(value, 0.0, 1.0) * steps + 0.5);
+        }
+
+        fn paramSteps(index: i32) u32 {
+            return if (index >= 0 and index < slots) Kernel.module_classes else 0;
+        }
+
+        /// Steps of a slot parameter for the module its selector asks for,
+        /// 0 for the selectors (paramSteps has them) and empty slots.
+        pub fn instanceSteps(self: *const Self, index: i32) u32 {
+            if (index < slots or index >= total_params) return 0;
+            const i: usize = @intCast(index - slots);
+            return stepsOf(@atomicLoad(u32, &self.wanted[i / slot_params], .monotonic), i % slot_params);
+        }
+
+        /// Steps of parameter p of a module class, as class index + 1
+        fn stepsOf(class: u32, p: usize) u32 {
+            if (class == 0) return 0;
+            return Kernel.class_param_steps(class - 1, @intCast(p));
+        }
+
+        fn impl_create(allocator: std.mem.Allocator, sample_rate: f32) ?*anyopaque {
+            if (Self.init(allocator, sample_rate)) |ptr| {
+                return ptr;
+            } else |_| {
+                return null;
+            }
+        }
+
+        fn impl_destroy(ptr: *anyopaque, allocator: std.mem.Allocator) void {
+            const self = @as(*Self, @ptrCast(@alignCast(ptr)));
+            self.deinit(allocator);
+        }
+
+        fn impl_prepare(ptr: *anyopaque, allocator: std.mem.Allocator, sample_rate: f32, max_block: usize) bool {
+            _ = allocator;
+            _ = max_block;
+            const self = @as(*Self, @ptrCast(@alignCast(ptr)));
+            return self.prepare(sample_rate);
+        }
+
+        fn impl_process(ptr: *anyopaque, inputs: [*]const [*]const f32, outputs: [*][*]f32, frames: usize) void {
+            const self = @as(*Self, @ptrCast(@alignCast(ptr)));
+            self.process(inputs, outputs, frames);
+        }
+
+        fn impl_set_channels(ptr: *anyopaque, channels: u32) void {
+            const self = @as(*Self, @ptrCast(@alignCast(ptr)));
+            self.setChannels(channels);
+        }
+
+        fn impl_latency(ptr: *anyopaque) u32 {
+            const self = @as(*Self, @ptrCast(@alignCast(ptr)));
+            return self.latency();
+        }
+
+        fn impl_tail(ptr: *anyopaque) u32 {
+            const self = @as(*Self, @ptrCast(@alignCast(ptr)));
+            return self.tail();
+        }
+
+        fn impl_decayed(ptr: *anyopaque) bool {
+            const self = @as(*Self, @ptrCast(@alignCast(ptr)));
+            return self.decayed();
+        }
+
+        fn impl_nested(ptr: *anyopaque) []const ?*anyopaque {
+            const self = @as(*Self, @ptrCast(@alignCast(ptr)));
+            return &self.modules;
+        }
+
+        fn impl_set_parameter(ptr: *anyopaque, index: i32, value: f32) void {
+            const self = @as(*Self, @ptrCast(@alignCast(ptr)));
+            self.setParameter(index, value);
+        }
+
+        fn impl_get_parameter(ptr: *anyopaque, index: i32) f32 {
+            const self = @as(*Self, @ptrCast(@alignCast(ptr)));
+            return self.getParameter(index);
+        }
+
+        fn impl_instance_param_steps(ptr: *anyopaque, index: i32) u32 {
+            const self = @as(*Self, @ptrCast(@alignCast(ptr)));
+            return self.instanceSteps(index);
+        }
+
+        pub const plugin_impl = struct {
+            pub const create = impl_create;
+            pub const destroy = impl_destroy;
+            pub const prepare = impl_prepare;
+            pub const process = impl_process;
+            pub const set_parameter = impl_set_parameter;
+            pub const get_parameter = impl_get_parameter;
+            pub const latency = impl_latency;
+            pub const tail = impl_tail;
+            pub const decayed = impl_decayed;
+            pub const nested = impl_nested;
+            pub const set_channels = impl_set_channels;
+            pub const max_channels = 2;
+            pub const param_count = total_params;
+            pub const param_steps = paramSteps;
+            pub const instance_param_steps = impl_instance_param_steps;
+        };
+
+    };
+}
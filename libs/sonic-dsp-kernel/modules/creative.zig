@@ -71,23 +71,49 @@ pub fn processDistortion(data: []f32, drive: f32, dist_type: i32, out_gain_db: f
     }
 }
 
-pub fn processBitcrusher(data: []f32, bits: f32, norm_freq: f32, mix: f32) void {
-    const step = std.math.pow(f32, 2.0, bits);
-    var phasor: f32 = 0;
-    var hold_l: f32 = 0;
-    var hold_r: f32 = 0;
-    
-    var i: usize = 0;
-    while (i < data.len - 1) : (i += 2) {
-        phasor += norm_freq;
-        if (phasor >= 1.0) {
-            phasor -= 1.0;
-            hold_l = std.math.floor(data[i] * step) / step;
-            hold_r = std.math.floor(data[i+1] * step) / step;
+/// Sample-rate reducer; the hold phasor carries over so the decimation grid
+/// doesn't reset at block boundaries.
+pub const Bitcrusher = struct {
+    phasor: f32 = 0,
+    hold_l: f32 = 0,
+    hold_r: f32 = 0,
+
+    pub fn process(self: *Bitcrusher, data: []f32, bits: f32, norm_freq: f32, mix: f32) void {
+        const step = std.math.pow(f32, 2.0, bits);
+
+        var i: usize = 0;
+        while (i < data.len - 1) : (i += 2) {
+            self.phasor += norm_freq;
+            if (self.phasor >= 1.0) {
+                self.phasor -= 1.0;
+                self.hold_l = std.math.floor(data[i] * step) / step;
+                self.hold_r = std.math.floor(data[i+1] * step) / step;
+            }
+            data[i] = self.hold_l * mix + data[i] * (1.0 - mix);
+            data[i+1] = self.hold_r * mix + data[i+1] * (1.0 - mix);
         }
-        data[i] = hold_l * mix + data[i] * (1.0 - mix);
-        data[i+1] = hold_r * mix + data[i+1] * (1.0 - mix);
     }
+
+    /// Same on planar left and right buffers of equal length.
+    pub fn processPlanar(self: *Bitcrusher, left: []f32, right: []f32, bits: f32, norm_freq: f32, mix: f32) void {
+        const step = std.math.pow(f32, 2.0, bits);
+
+        for (left, right) |*l, *r| {
+            self.phasor += norm_freq;
+            if (self.phasor >= 1.0) {
+                self.phasor -= 1.0;
+                self.hold_l = std.math.floor(l.* * step) / step;
+                self.hold_r = std.math.floor(r.* * step) / step;
+            }
+            l.* = self.hold_l * mix + l.* * (1.0 - mix);
+            r.* = self.hold_r * mix + r.* * (1.0 - mix);
+        }
+    }
+};
+
+pub fn processBitcrusher(data: []f32, bits: f32, norm_freq: f32, mix: f32) void {
+    var b = Bitcrusher{};
+    b.process(data, bits, norm_freq, mix);
 }
 
 pub fn processDithering(data: []f32, bits: f32) void {
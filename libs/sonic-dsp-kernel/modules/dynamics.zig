@@ -2,9 +2,10 @@ const std = @import("std");
 const dynamics = @import("../dsp/dynamics.zig");
 const shared = @import("../dsp/shared.zig");
 
+/// Bus compressor with detection linked across every channel (the loudest
+/// channel's envelope sets the gain for all of them).
 pub const Compressor = struct {
-    detector_l: dynamics.EnvelopeFollower = .{},
-    detector_r: dynamics.EnvelopeFollower = .{},
+    detector: dynamics.EnvelopeBank = .{},
     threshold: f32 = -24,
     ratio: f32 = 4,
     attack: f32 = 10, // ms
@@ -15,33 +16,49 @@ pub const Compressor = struct {
     mode: i32 = 0, // 0=VCA, 1=FET, 2=Opto, 3=VarMu
     sample_rate: f32 = 44100,
     
-    last_output_l: f32 = 0,
-    last_output_r: f32 = 0,
+    last_output: [shared.max_channels]f32 = [_]f32{0} ** shared.max_channels,
+    /// Deepest gain reduction of the last processChannels call in dB, for
+    /// the kernel's meters.
+    gain_reduction: f32 = 0,
 
+    /// Interleaved stereo, for the offline entry points.
     pub fn process(self: *Compressor, data: []f32) void {
-        self.detector_l.setParams(self.attack, self.release, self.sample_rate);
-        self.detector_r.setParams(self.attack, self.release, self.sample_rate);
-        const makeup_gain = shared.dbToLinear(self.makeup);
+        shared.processPlanarStereo(self, processChannels, data);
+    }
+
+    /// Planar bus of up to shared.max_channels channels.
+    pub fn processChannels(self: *Compressor, inputs: [*]const [*]const f32, outputs: [*][*]f32, channels: usize, frames: usize) void {
+        switch (shared.lanesFor(channels)) {
+            inline 1, 2, 4, 8, 16 => |lanes| self.processLanes(lanes, inputs, outputs, channels, frames),
+            else => unreachable,
+        }
+    }
+
+    pub fn reset(self: *Compressor) void {
+        self.detector.reset();
+        self.last_output = [_]f32{0} ** shared.max_channels;
+        self.gain_reduction = 0;
+    }
+
+    fn processLanes(self: *Compressor, comptime lanes: usize, inputs: [*]const [*]const f32, outputs: [*][*]f32, channels: usize, frames: usize) void {
+        const V = @Vector(lanes, f32);
+        self.detector.setParams(self.attack, self.release, self.sample_rate);
+        var detector = self.detector.load(lanes);
+        var last_output: V = self.last_output[0..lanes].*;
+        const makeup_gain: V = @splat(shared.dbToLinear(self.makeup));
+        const dry: V = @splat(1.0 - self.mix);
+        const wet: V = @splat(self.mix);
+        var deepest: f32 = 0;
+
+        for (0..frames) |i| {
+            const x = shared.loadFrame(lanes, inputs, channels, i);
 
-        var i: usize = 0;
-        while (i < data.len - 1) : (i += 2) {
-            const l = data[i];
-            const r = data[i+1];
-            
             // 1. Detection Source
-            var det_l = l;
-            var det_r = r;
-            if (self.mode == 1) { // FET: Feedback
-                det_l = self.last_output_l;
-                det_r = self.last_output_r;
-            }
+            // FET: Feedback
+            const det = if (self.mode == 1) last_output else x;
 
-            // 2. Level Detection
-            const env_l = self.detector_l.process(det_l);
-            const env_r = self.detector_r.process(det_r);
-            
-            // Link Channels
-            const env = @max(env_l, env_r);
+            // 2. Level Detection, linked across channels
+            const env = @reduce(.Max, detector.process(det));
             const env_db = shared.linearToDb(env);
             
             // 3. Mode Specific Adjustments
@@ -57,22 +74,21 @@ pub const Compressor = struct {
                 // Slower release for higher levels
                 const rel_mod = 1.0 - @min(1.0, env);
                 const dyn_rel = self.release * (0.5 + rel_mod * 0.5);
-                self.detector_l.release_coeff = std.math.exp(-1.0 / (@max(0.001, dyn_rel * 0.001) * self.sample_rate));
-                self.detector_r.release_coeff = self.detector_l.release_coeff;
+                detector.release_coeff = @splat(std.math.exp(-1.0 / (@max(0.001, dyn_rel * 0.001) * self.sample_rate)));
             }
             
             const gr_db = dynamics.GainComputer.compute(self.threshold, current_ratio, if (self.mode == 3) 0 else self.knee, env_db);
-            const gain = shared.dbToLinear(-gr_db);
+            const gain: V = @splat(shared.dbToLinear(-gr_db));
+            deepest = @max(deepest, gr_db);
             
-            const processed_l = l * gain * makeup_gain;
-            const processed_r = r * gain * makeup_gain;
-
-            data[i] = l * (1.0 - self.mix) + processed_l * self.mix;
-            data[i+1] = r * (1.0 - self.mix) + processed_r * self.mix;
-            
-            self.last_output_l = processed_l;
-            self.last_output_r = processed_r;
+            const processed = x * gain * makeup_gain;
+            shared.storeFrame(lanes, outputs, channels, i, x * dry + processed * wet);
+            last_output = processed;
         }
+
+        self.detector.store(lanes, detector);
+        self.last_output[0..lanes].* = last_output;
+        self.gain_reduction = deepest;
     }
 };
 
@@ -91,10 +107,16 @@ pub const Limiter = struct {
         self.compressor.sample_rate = self.sample_rate;
         self.compressor.process(data);
     }
+
+    pub fn processChannels(self: *Limiter, inputs: [*]const [*]const f32, outputs: [*][*]f32, channels: usize, frames: usize) void {
+        self.compressor.sample_rate = self.sample_rate;
+        self.compressor.processChannels(inputs, outputs, channels, frames);
+    }
 };
 
 pub const DeEsser = struct {
     hp_filter: @import("../dsp/filters.zig").Biquad = .{},
+    detector: dynamics.EnvelopeFollower = .{},
     compressor: Compressor = .{
         .threshold = -20,
         .ratio = 4,
@@ -121,7 +143,7 @@ pub const DeEsser = struct {
             const hp_r = self.hp_filter.process(s_r);
             const sidechain = @max(@abs(hp_l), @abs(hp_r));
             
-            const env = self.compressor.detector_l.process(sidechain);
+            const env = self.detector.process(sidechain);
             const env_db = shared.linearToDb(env);
             
             const gr_db = dynamics.GainComputer.compute(self.compressor.threshold, self.compressor.ratio, self.compressor.knee, env_db);
@@ -184,18 +206,38 @@ pub const TransientShaper = struct {
     mix: f32 = 1,
     sample_rate: f32 = 44100,
 
+    /// Interleaved stereo, for the offline entry point.
     pub fn process(self: *TransientShaper, data: []f32) void {
+        shared.processPlanarStereo(self, processChannels, data);
+    }
+
+    /// Planar bus of up to shared.max_channels channels. Detection runs on
+    /// the loudest channel; every channel gets the same gain.
+    pub fn processChannels(self: *TransientShaper, inputs: [*]const [*]const f32, outputs: [*][*]f32, channels: usize, frames: usize) void {
+        switch (shared.lanesFor(channels)) {
+            inline 1, 2, 4, 8, 16 => |lanes| self.processLanes(lanes, inputs, outputs, channels, frames),
+            else => unreachable,
+        }
+    }
+
+    pub fn reset(self: *TransientShaper) void {
+        self.attack_env.reset();
+        self.sustain_env.reset();
+    }
+
+    fn processLanes(self: *TransientShaper, comptime lanes: usize, inputs: [*]const [*]const f32, outputs: [*][*]f32, channels: usize, frames: usize) void {
+        const V = @Vector(lanes, f32);
         self.attack_env.setParams(1.0, 50.0, self.sample_rate);
         self.sustain_env.setParams(50.0, 200.0, self.sample_rate);
         
-        const att_g = shared.dbToLinear(self.attack_gain);
-        const sus_g = shared.dbToLinear(self.sustain_gain);
+        const att_g: V = @splat(shared.dbToLinear(self.attack_gain));
+        const sus_g: V = @splat(shared.dbToLinear(self.sustain_gain));
+        const dry: V = @splat(1.0 - self.mix);
+        const wet: V = @splat(self.mix);
 
-        var i: usize = 0;
-        while (i < data.len - 1) : (i += 2) {
-            const l = data[i];
-            const r = data[i+1];
-            const mono = @max(@abs(l), @abs(r));
+        for (0..frames) |i| {
+            const x = shared.loadFrame(lanes, inputs, channels, i);
+            const mono = @reduce(.Max, @abs(x));
             
             const att = self.attack_env.process(mono);
             const sus = self.sustain_env.process(mono);
@@ -204,8 +246,7 @@ pub const TransientShaper = struct {
             const is_attack = att > sus;
             const gain = if (is_attack) att_g else sus_g;
             
-            data[i] = l * (1.0 - self.mix) + (l * gain) * self.mix;
-            data[i+1] = r * (1.0 - self.mix) + (r * gain) * self.mix;
+            shared.storeFrame(lanes, outputs, channels, i, x * dry + (x * gain) * wet);
         }
     }
 };
@@ -1,5 +1,40 @@
 const std = @import("std");
 const filters = @import("../dsp/filters.zig");
+const shared = @import("../dsp/shared.zig");
+const cascade = @import("../dsp/cascade.zig");
+
+/// Low shelf, mid bell and high shelf on every channel of a bus of up to
+/// shared.max_channels, with filter memory kept between calls. Parameter
+/// changes glide in over a few blocks (see cascade.Cascade).
+pub const ParametricEQ = struct {
+    bands: cascade.Cascade(3) = .{},
+
+    pub fn setParams(
+        self: *ParametricEQ,
+        sample_rate: f32,
+        low_freq: f32, low_gain: f32,
+        mid_freq: f32, mid_gain: f32, mid_q: f32,
+        high_freq: f32, high_gain: f32
+    ) void {
+        self.bands.prepare(sample_rate);
+        self.bands.setSection(0, filters.Coefficients.design(.lowshelf, low_freq, low_gain, 0.707, sample_rate));
+        self.bands.setSection(1, filters.Coefficients.design(.peaking, mid_freq, mid_gain, mid_q, sample_rate));
+        self.bands.setSection(2, filters.Coefficients.design(.highshelf, high_freq, high_gain, 0.707, sample_rate));
+    }
+
+    /// Interleaved stereo, for the offline entry point.
+    pub fn process(self: *ParametricEQ, data: []f32) void {
+        shared.processPlanarStereo(self, processChannels, data);
+    }
+
+    pub fn processChannels(self: *ParametricEQ, inputs: [*]const [*]const f32, outputs: [*][*]f32, channels: usize, frames: usize) void {
+        self.bands.processChannels(inputs, outputs, channels, frames);
+    }
+
+    pub fn reset(self: *ParametricEQ) void {
+        self.bands.reset();
+    }
+};
 
 pub fn processParametricEQ(
     data: []f32,
@@ -8,31 +43,49 @@ pub fn processParametricEQ(
     mid_freq: f32, mid_gain: f32, mid_q: f32,
     high_freq: f32, high_gain: f32
 ) void {
-    var filters_l = [3]filters.Biquad{ .{}, .{}, .{} };
-    var filters_r = [3]filters.Biquad{ .{}, .{}, .{} };
-
-    filters_l[0].setParams(.lowshelf, low_freq, low_gain, 0.707, sample_rate);
-    filters_l[1].setParams(.peaking, mid_freq, mid_gain, mid_q, sample_rate);
-    filters_l[2].setParams(.highshelf, high_freq, high_gain, 0.707, sample_rate);
-
-    filters_r[0].setParams(.lowshelf, low_freq, low_gain, 0.707, sample_rate);
-    filters_r[1].setParams(.peaking, mid_freq, mid_gain, mid_q, sample_rate);
-    filters_r[2].setParams(.highshelf, high_freq, high_gain, 0.707, sample_rate);
-
-    var i: usize = 0;
-    while (i < data.len - 1) : (i += 2) {
-        var s_l = data[i];
-        var s_r = data[i+1];
+    var peq = ParametricEQ{};
+    peq.setParams(sample_rate, low_freq, low_gain, mid_freq, mid_gain, mid_q, high_freq, high_gain);
+    peq.process(data);
+}
 
-        inline for (0..3) |j| {
-            s_l = filters_l[j].process(s_l);
-            s_r = filters_r[j].process(s_r);
+/// Mid/side peaking EQ with filter memory kept between calls. Mid and side
+/// run as two channels of one cascade section, each on its own band.
+pub const MidSideEQ = struct {
+    bands: cascade.Cascade(1) = .{},
+
+    pub fn process(
+        self: *MidSideEQ,
+        data: []f32,
+        sample_rate: f32,
+        mid_gain: f32, mid_freq: f32,
+        side_gain: f32, side_freq: f32
+    ) void {
+        self.bands.prepare(sample_rate);
+        self.bands.setSectionChannel(0, 0, filters.Coefficients.design(.peaking, mid_freq, mid_gain, 1.0, sample_rate));
+        self.bands.setSectionChannel(0, 1, filters.Coefficients.design(.peaking, side_freq, side_gain, 1.0, sample_rate));
+
+        const chunk = 256;
+        var mid: [chunk]f32 = undefined;
+        var side: [chunk]f32 = undefined;
+        const inputs = [2][*]const f32{ &mid, &side };
+        var outputs = [2][*]f32{ &mid, &side };
+        const frames = data.len / 2;
+        var pos: usize = 0;
+        while (pos < frames) : (pos += chunk) {
+            const n: usize = @min(chunk, frames - pos);
+            const frame = data[pos * 2 ..][0 .. n * 2];
+            for (0..n) |i| {
+                mid[i] = (frame[i*2] + frame[i*2+1]) * 0.5;
+                side[i] = (frame[i*2] - frame[i*2+1]) * 0.5;
+            }
+            self.bands.processChannels(&inputs, &outputs, 2, n);
+            for (0..n) |i| {
+                frame[i*2] = mid[i] + side[i];
+                frame[i*2+1] = mid[i] - side[i];
+            }
         }
-
-        data[i] = s_l;
-        data[i+1] = s_r;
     }
-}
+};
 
 pub fn processMidSideEQ(
     data: []f32,
@@ -40,24 +93,49 @@ pub fn processMidSideEQ(
     mid_gain: f32, mid_freq: f32,
     side_gain: f32, side_freq: f32
 ) void {
-    var filter_mid = filters.Biquad{};
-    var filter_side = filters.Biquad{};
-
-    filter_mid.setParams(.peaking, mid_freq, mid_gain, 1.0, sample_rate);
-    filter_side.setParams(.peaking, side_freq, side_gain, 1.0, sample_rate);
-
-    var i: usize = 0;
-    while (i < data.len - 1) : (i += 2) {
-        const mid = (data[i] + data[i+1]) * 0.5;
-        const side = (data[i] - data[i+1]) * 0.5;
-
-        const p_mid = filter_mid.process(mid);
-        const p_side = filter_side.process(side);
+    var ms = MidSideEQ{};
+    ms.process(data, sample_rate, mid_gain, mid_freq, side_gain, side_freq);
+}
 
-        data[i] = p_mid + p_side;
-        data[i+1] = p_mid - p_side;
+/// Three-band stereo width with crossover memory kept between calls.
+pub const StereoImager = struct {
+    lp_l: filters.Biquad = .{}, lp_r: filters.Biquad = .{},
+    hp_l: filters.Biquad = .{}, hp_r: filters.Biquad = .{},
+
+    pub fn process(
+        self: *StereoImager,
+        data: []f32,
+        sample_rate: f32,
+        low_freq: f32, high_freq: f32,
+        width_low: f32, width_mid: f32, width_high: f32
+    ) void {
+        self.lp_l.setParams(.lowpass, low_freq, 0, 0.707, sample_rate);
+        self.lp_r.setParams(.lowpass, low_freq, 0, 0.707, sample_rate);
+        self.hp_l.setParams(.highpass, high_freq, 0, 0.707, sample_rate);
+        self.hp_r.setParams(.highpass, high_freq, 0, 0.707, sample_rate);
+
+        var i: usize = 0;
+        while (i < data.len - 1) : (i += 2) {
+            const s_l = data[i];
+            const s_r = data[i+1];
+
+            const mid = (s_l + s_r) * 0.5;
+            const side = (s_l - s_r) * 0.5;
+
+            const low_l = self.lp_l.process(s_l);
+            const low_r = self.lp_r.process(s_r);
+            const high_l = self.hp_l.process(s_l);
+            const high_r = self.hp_r.process(s_r);
+
+            const side_low = (low_l - low_r) * width_low;
+            const side_mid = side * width_mid;
+            const side_high = (high_l - high_r) * width_high;
+
+            data[i] = mid + side_low + side_mid + side_high;
+            data[i+1] = mid - side_low - side_mid - side_high;
+        }
     }
-}
+};
 
 pub fn processStereoImager(
     data: []f32,
@@ -65,37 +143,6 @@ pub fn processStereoImager(
     low_freq: f32, high_freq: f32,
     width_low: f32, width_mid: f32, width_high: f32
 ) void {
-    var lp_l = filters.Biquad{}; var lp_r = filters.Biquad{};
-    var hp_l = filters.Biquad{}; var hp_r = filters.Biquad{};
-    var bp_l = filters.Biquad{}; var bp_r = filters.Biquad{};
-
-    lp_l.setParams(.lowpass, low_freq, 0, 0.707, sample_rate);
-    lp_r.setParams(.lowpass, low_freq, 0, 0.707, sample_rate);
-    hp_l.setParams(.highpass, high_freq, 0, 0.707, sample_rate);
-    hp_r.setParams(.highpass, high_freq, 0, 0.707, sample_rate);
-    
-    const mid_f = (low_freq + high_freq) * 0.5;
-    bp_l.setParams(.bandpass, mid_f, 0, 0.707, sample_rate);
-    bp_r.setParams(.bandpass, mid_f, 0, 0.707, sample_rate);
-
-    var i: usize = 0;
-    while (i < data.len - 1) : (i += 2) {
-        const s_l = data[i];
-        const s_r = data[i+1];
-
-        const mid = (s_l + s_r) * 0.5;
-        const side = (s_l - s_r) * 0.5;
-
-        const low_l = lp_l.process(s_l);
-        const low_r = lp_r.process(s_r);
-        const high_l = hp_l.process(s_l);
-        const high_r = hp_r.process(s_r);
-
-        const side_low = (low_l - low_r) * width_low;
-        const side_mid = side * width_mid;
-        const side_high = (high_l - high_r) * width_high;
-
-        data[i] = mid + side_low + side_mid + side_high;
-        data[i+1] = mid - side_low - side_mid - side_high;
-    }
+    var si = StereoImager{};
+    si.process(data, sample_rate, low_freq, high_freq, width_low, width_mid, width_high);
 }
@@ -26,16 +26,24 @@ pub const FeedbackDelay = struct {
             const delayed_r = self.delay_r.readInterpolated(read_ptr);
             
             // Write to delay lines with feedback
-            self.delay_l.buffer[self.delay_l.write_ptr] = s_l + delayed_l * self.feedback;
-            self.delay_r.buffer[self.delay_r.write_ptr] = s_r + delayed_r * self.feedback;
-            
-            self.delay_l.write_ptr = (self.delay_l.write_ptr + 1) % 96000;
-            self.delay_r.write_ptr = (self.delay_r.write_ptr + 1) % 96000;
+            self.delay_l.write(s_l + delayed_l * self.feedback);
+            self.delay_r.write(s_r + delayed_r * self.feedback);
             
             data[i] = s_l * (1.0 - self.wet) + delayed_l * self.wet;
             data[i+1] = s_r * (1.0 - self.wet) + delayed_r * self.wet;
         }
     }
+
+    /// Samples the echoes take to fall 60 dB, capped at the 30 s hosts will
+    /// reasonably wait for.
+    pub fn tailSamples(self: *const FeedbackDelay) u32 {
+        return delay.feedbackTail(self.time * self.sample_rate, self.feedback, @intFromFloat(30 * self.sample_rate));
+    }
+
+    /// Nothing left in either line to echo.
+    pub fn decayed(self: *const FeedbackDelay) bool {
+        return self.delay_l.isSilent() and self.delay_r.isSilent();
+    }
 };
 
 pub const Chorus = struct {
@@ -48,16 +56,20 @@ pub const Chorus = struct {
     feedback: f32 = 0,
     wet: f32 = 0.5,
     sample_rate: f32 = 44100,
+    lfo_phase: f32 = 0, // cycles; carried across calls so block size doesn't restart the LFO
     
     pub fn process(self: *Chorus, data: []f32) void {
+        const phase_inc = self.rate / self.sample_rate;
+
         var i: usize = 0;
         while (i < data.len - 1) : (i += 2) {
             const s_l = data[i];
             const s_r = data[i+1];
             
-            const t = @as(f32, @floatFromInt(i / 2)) / self.sample_rate;
-            const lfo_l = std.math.sin(shared.TWO_PI * self.rate * t);
-            const lfo_r = std.math.sin(shared.TWO_PI * self.rate * t + shared.PI * 0.5);
+            const lfo_l = std.math.sin(shared.TWO_PI * self.lfo_phase);
+            const lfo_r = std.math.sin(shared.TWO_PI * self.lfo_phase + shared.PI * 0.5);
+            self.lfo_phase += phase_inc;
+            if (self.lfo_phase >= 1.0) self.lfo_phase -= 1.0;
             
             const delay_l_samples = (self.base_time + self.depth * lfo_l) * self.sample_rate;
             const delay_r_samples = (self.base_time + self.depth * lfo_r) * self.sample_rate;
@@ -68,16 +80,22 @@ pub const Chorus = struct {
             const delayed_l = self.delay_l.readInterpolated(read_l);
             const delayed_r = self.delay_r.readInterpolated(read_r);
             
-            self.delay_l.buffer[self.delay_l.write_ptr] = s_l + delayed_l * self.feedback;
-            self.delay_r.buffer[self.delay_r.write_ptr] = s_r + delayed_r * self.feedback;
-            
-            self.delay_l.write_ptr = (self.delay_l.write_ptr + 1) % 4800;
-            self.delay_r.write_ptr = (self.delay_r.write_ptr + 1) % 4800;
+            self.delay_l.write(s_l + delayed_l * self.feedback);
+            self.delay_r.write(s_r + delayed_r * self.feedback);
             
             data[i] = s_l * (1.0 - self.wet) + delayed_l * self.wet;
             data[i+1] = s_r * (1.0 - self.wet) + delayed_r * self.wet;
         }
     }
+
+    /// The longest modulated delay, repeated while the feedback rings.
+    pub fn tailSamples(self: *const Chorus) u32 {
+        return delay.feedbackTail((self.base_time + self.depth) * self.sample_rate, self.feedback, @intFromFloat(30 * self.sample_rate));
+    }
+
+    pub fn decayed(self: *const Chorus) bool {
+        return self.delay_l.isSilent() and self.delay_r.isSilent();
+    }
 };
 
 pub fn processFeedbackDelay(data: []f32, sample_rate: f32, time: f32, feedback: f32, wet: f32) void {
@@ -1,4 +1,8 @@
 #include "au_minimal.h"
+#include "meters.h"
+#include "param_channel.h"
+#include "profiler.h"
+#include "rt_guard.h"
 #include <vector>
 #include <cstring>
 #include <new>
@@ -6,20 +10,52 @@
 // Zig C-ABI
 extern "C" {
     void* plugin_create(float sample_rate);
+    const char* plugin_class_id(uint32_t index);
+    uint32_t plugin_class_max_channels(uint32_t index);
+    int32_t plugin_class_oversampling_param(uint32_t index);
     void plugin_destroy(void* instance);
+    int32_t plugin_set_channels(void* instance, uint32_t channels);
+    int32_t plugin_prepare(void* instance, float sample_rate, size_t max_block);
     void plugin_process(void* instance, const float** inputs, float** outputs, size_t frames);
     void plugin_set_parameter(void* instance, int32_t index, float value);
     float plugin_get_parameter(void* instance, int32_t index);
+    uint32_t plugin_get_latency(void* instance);
+    uint32_t plugin_get_tail(void* instance);
+    int32_t plugin_tail_decayed(void* instance);
+    uint64_t plugin_heap_allocs(void* instance);
 }
 
+class SonicAU;
+
+// The host calls the factory once per instance and hands the returned
+// pointer back as 'self' to Open/Close and to every looked-up selector.
+struct SonicAUInstance {
+    AudioComponentPlugInInterface interface; // must stay first
+    SonicAU* au;
+};
+
+static SonicAU* AUFromSelf(void* self) {
+    return ((SonicAUInstance*)self)->au;
+}
+
+static const UInt32 kMaxChannels = 16;
+static const UInt32 kDefaultMaxFrames = 1156; // CoreAudio's default MaximumFramesPerSlice
+// Read-only global property holding a SonicMeterReadings (meters.h) for a
+// view to poll; IDs from 64000 up are the unit's own
+static const AudioUnitPropertyID kSonicProperty_Meters = 64000;
+
 class SonicAU {
 public:
     SonicAU(AudioComponentPlugInInterface* component) 
-        : mComponent(component), mInstance(nullptr), mSampleRate(44100.0) 
+        : mComponent(component), mInstance(nullptr), mInitialized(false), mSampleRate(44100.0),
+          mMaxFrames(kDefaultMaxFrames), mChannels(2), mInputList(nullptr), mParams(0.5f)
     {
         mInputConnection.sourceAudioUnit = nullptr;
         mRenderCallback.inputProc = nullptr;
-        for (int i = 0; i < 16; i++) mParams[i] = 0.5f;
+        mMeterReadings = { { -100.0f, -100.0f }, { -100.0f, -100.0f }, -100.0f, 0.0f, 0 };
+        // Oversampling is opt-in: start at 1x rather than mid-range
+        int32_t oversampling = plugin_class_oversampling_param(0);
+        if (oversampling >= 0) mParams.store(oversampling, 0.0f);
     }
     
     ~SonicAU() {
@@ -30,18 +66,35 @@ public:
     }
 
     OSStatus Initialize() {
+        // Everything Render touches is sized here, so the render thread never allocates.
+        // Input is pulled into wrapper-owned buffers and the kernel always runs
+        // out-of-place: inputs and outputs handed to plugin_process never alias.
+        mInputStorage.assign((size_t)kMaxChannels * mMaxFrames, 0.0f);
+        mScratchStorage.assign((size_t)kMaxChannels * mMaxFrames, 0.0f);
+        mInputListStorage.assign(sizeof(AudioBufferList) + (kMaxChannels - 1) * sizeof(AudioBuffer), 0);
+        mInputList = (AudioBufferList*)mInputListStorage.data();
+
+        // The kernel instance outlives Uninitialize/Initialize cycles (format
+        // or slice-size changes), so learned state is kept; it is only
+        // retuned for the new configuration.
         if (!mInstance) {
             mInstance = plugin_create((float)mSampleRate);
-            for (int i = 0; i < 16; i++) plugin_set_parameter(mInstance, i, mParams[i]);
+            if (!mInstance) return kAudioUnitErr_FailedInitialization;
+            mParams.clearDirty();
+            for (int i = 0; i < 16; i++) plugin_set_parameter(mInstance, i, mParams.get(i));
+#ifndef SONIC_NO_METERS
+            if (sonicMetersRequested()) plugin_set_metering(mInstance, 1);
+#endif
         }
+        if (plugin_set_channels(mInstance, mChannels) != 0) return kAudioUnitErr_FormatNotSupported;
+        if (plugin_prepare(mInstance, (float)mSampleRate, mMaxFrames) != 0) return kAudioUnitErr_FailedInitialization;
+        mProfiler.attach(plugin_class_id(0), (float)mSampleRate, (int32_t)mMaxFrames);
+        mInitialized = true;
         return noErr;
     }
 
     OSStatus Uninitialize() {
-        if (mInstance) {
-            plugin_destroy(mInstance);
-            mInstance = nullptr;
-        }
+        mInitialized = false;
         return noErr;
     }
     
@@ -50,6 +103,21 @@ public:
              mSampleRate = *(const Float64*)inData;
              return noErr;
          }
+         if (inID == kAudioUnitProperty_StreamFormat) {
+             const AudioStreamBasicDescription* desc = (const AudioStreamBasicDescription*)inData;
+             // Input and output share one format, so this is the kernel's bus width
+             if (desc->mChannelsPerFrame == 0 || desc->mChannelsPerFrame > kMaxChannels ||
+                 desc->mChannelsPerFrame > plugin_class_max_channels(0)) return kAudioUnitErr_FormatNotSupported;
+             if (mInitialized && desc->mChannelsPerFrame != mChannels) return kAudioUnitErr_Initialized;
+             mSampleRate = desc->mSampleRate;
+             mChannels = desc->mChannelsPerFrame;
+             return noErr;
+         }
+         if (inID == kAudioUnitProperty_MaximumFramesPerSlice) {
+             if (mInitialized) return kAudioUnitErr_Initialized;
+             mMaxFrames = *(const UInt32*)inData;
+             return noErr;
+         }
          if (inID == kAudioUnitProperty_MakeConnection && inScope == kAudioUnitScope_Input) {
              mInputConnection = *(const AudioUnitConnection*)inData;
              return noErr;
@@ -63,20 +131,58 @@ public:
 
     OSStatus GetPropertyInfo(AudioUnitPropertyID inID, AudioUnitScope inScope, AudioUnitElement inElement, UInt32* outDataSize, Boolean* outWritable) {
         if (inID == kAudioUnitProperty_SupportedNumChannels) {
-            if (outDataSize) *outDataSize = sizeof(AudioComponentDescription); 
+            if (outDataSize) *outDataSize = channelInfo(nullptr) * sizeof(AUChannelInfo);
+            if (outWritable) *outWritable = false;
+            return noErr;
+        }
+        if (inID == kAudioUnitProperty_Latency || inID == kAudioUnitProperty_TailTime) {
+            if (outDataSize) *outDataSize = sizeof(Float64);
+            if (outWritable) *outWritable = false;
+            return noErr;
+        }
+        if (inID == kSonicProperty_Meters) {
+            if (outDataSize) *outDataSize = sizeof(SonicMeterReadings);
             if (outWritable) *outWritable = false;
             return noErr;
         }
         return kAudioUnitErr_InvalidProperty;
     }
 
-    OSStatus GetProperty(AudioUnitPropertyID inID, AudioUnitScope inScope, AudioUnitElement inElement, void* outData) {
+    OSStatus GetProperty(AudioUnitPropertyID inID, AudioUnitScope inScope, AudioUnitElement inElement, void* outData, UInt32* ioDataSize) {
+        if (inID == kAudioUnitProperty_SupportedNumChannels) {
+            UInt32 size = channelInfo(nullptr) * sizeof(AUChannelInfo);
+            if (ioDataSize && *ioDataSize < size) return kAudioUnitErr_InvalidPropertyValue;
+            channelInfo((AUChannelInfo*)outData);
+            if (ioDataSize) *ioDataSize = size;
+            return noErr;
+        }
+        // Both are in seconds; before Initialize there is no kernel instance yet
+        if (inID == kAudioUnitProperty_Latency || inID == kAudioUnitProperty_TailTime) {
+            if (ioDataSize && *ioDataSize < sizeof(Float64)) return kAudioUnitErr_InvalidPropertyValue;
+            uint32_t samples = 0;
+            if (mInstance) samples = inID == kAudioUnitProperty_Latency ? plugin_get_latency(mInstance) : plugin_get_tail(mInstance);
+            *(Float64*)outData = (Float64)samples / mSampleRate;
+            if (ioDataSize) *ioDataSize = sizeof(Float64);
+            return noErr;
+        }
+        // Read straight from the kernel's seqlock, which Render never
+        // waits on. One view polls at a time; should a read collide with
+        // Render on every try, it gets the previous readings again.
+        if (inID == kSonicProperty_Meters) {
+            if (ioDataSize && *ioDataSize < sizeof(SonicMeterReadings)) return kAudioUnitErr_InvalidPropertyValue;
+            if (!mInstance) return kAudioUnitErr_Uninitialized;
+            SonicMeterReadings readings;
+            if (plugin_read_meters(mInstance, &readings) == 0) mMeterReadings = readings;
+            memcpy(outData, &mMeterReadings, sizeof(SonicMeterReadings));
+            if (ioDataSize) *ioDataSize = sizeof(SonicMeterReadings);
+            return noErr;
+        }
         return kAudioUnitErr_InvalidProperty;
     }
 
     OSStatus GetParameter(AudioUnitParameterID inID, AudioUnitScope inScope, AudioUnitElement inElement, AudioUnitParameterValue* outValue) {
         if (inID < 16) {
-            *outValue = mParams[inID];
+            *outValue = mParams.get(inID);
             return noErr;
         }
         return kAudioUnitErr_InvalidParameter;
@@ -84,81 +190,165 @@ public:
 
     OSStatus SetParameter(AudioUnitParameterID inID, AudioUnitScope inScope, AudioUnitElement inElement, AudioUnitParameterValue inValue, UInt32 inBufferOffsetInFrames) {
         if (inID < 16) {
-            mParams[inID] = inValue;
-            if (mInstance) plugin_set_parameter(mInstance, inID, inValue);
+            // Never touch the Zig instance here: Render may be running on the
+            // audio thread. The value is forwarded at the start of the next Render.
+            mParams.push(inID, inValue);
             return noErr;
         }
         return kAudioUnitErr_InvalidParameter;
     }
 
     OSStatus Render(AudioUnitRenderActionFlags* ioActionFlags, const AudioTimeStamp* inTimeStamp, UInt32 inOutputBusNumber, UInt32 inNumberFrames, AudioBufferList* ioData) {
-        if (!mInstance) return kAudioUnitErr_Uninitialized;
+        if (!mInitialized) return kAudioUnitErr_Uninitialized;
+        if (inNumberFrames > mMaxFrames) return kAudioUnitErr_TooManyFramesToProcess;
+
+        RtGuardScope rtGuard;
+        UInt32 numChannels = ioData->mNumberBuffers < mChannels ? ioData->mNumberBuffers : mChannels;
+
+        // 1. Fetch Input into our own buffers
+        mInputList->mNumberBuffers = numChannels;
+        for (UInt32 ch = 0; ch < numChannels; ++ch) {
+            mInputList->mBuffers[ch].mNumberChannels = 1;
+            mInputList->mBuffers[ch].mDataByteSize = inNumberFrames * sizeof(float);
+            mInputList->mBuffers[ch].mData = &mInputStorage[(size_t)ch * mMaxFrames];
+        }
 
-        // 1. Fetch Input
         OSStatus result = noErr;
         if (mInputConnection.sourceAudioUnit) {
-            result = AudioUnitRender(mInputConnection.sourceAudioUnit, ioActionFlags, inTimeStamp, mInputConnection.sourceOutputNumber, inNumberFrames, ioData);
+            result = AudioUnitRender(mInputConnection.sourceAudioUnit, ioActionFlags, inTimeStamp, mInputConnection.sourceOutputNumber, inNumberFrames, mInputList);
         } else if (mRenderCallback.inputProc) {
-            result = mRenderCallback.inputProc(mRenderCallback.inputProcRefCon, ioActionFlags, inTimeStamp, 0, inNumberFrames, ioData);
+            result = mRenderCallback.inputProc(mRenderCallback.inputProcRefCon, ioActionFlags, inTimeStamp, 0, inNumberFrames, mInputList);
+        } else {
+            for (UInt32 ch = 0; ch < numChannels; ++ch) memset(mInputList->mBuffers[ch].mData, 0, inNumberFrames * sizeof(float));
         }
         
         if (result != noErr) return result;
 
-        // 2. Map to Zig
-        std::vector<const float*> inputs;
-        std::vector<float*> outputs;
-        
-        for (UInt32 i = 0; i < ioData->mNumberBuffers; ++i) {
-            inputs.push_back((const float*)ioData->mBuffers[i].mData);
-            outputs.push_back((float*)ioData->mBuffers[i].mData);
+        // 2. Forward parameter changes made since the last render
+        mParams.drain([this](int index, float value) {
+            plugin_set_parameter(mInstance, index, value);
+        });
+
+        // 3. Map to Zig. The kernel processes the negotiated channel count;
+        // should the host hand over fewer buffers, the slots past them point
+        // at scratch memory so nothing is read or written out of bounds.
+        for (UInt32 ch = 0; ch < kMaxChannels; ++ch) {
+            if (ch < numChannels) {
+                if (!ioData->mBuffers[ch].mData) ioData->mBuffers[ch].mData = &mScratchStorage[(size_t)ch * mMaxFrames];
+                mInputPtrs[ch] = (const float*)mInputList->mBuffers[ch].mData;
+                mOutputPtrs[ch] = (float*)ioData->mBuffers[ch].mData;
+            } else {
+                mInputPtrs[ch] = mInputPtrs[0];
+                mOutputPtrs[ch] = &mScratchStorage[(size_t)ch * mMaxFrames];
+            }
+        }
+
+#ifndef SONIC_NO_SILENCE_SKIP
+        // 4. Silent input and nothing left ringing: skip the kernel and pass
+        // the silence flag downstream. The upstream unit may have set it already.
+        bool inputSilent = (*ioActionFlags & kAudioUnitRenderAction_OutputIsSilence) != 0;
+        if (!inputSilent) inputSilent = isSilent(mInputPtrs, numChannels, inNumberFrames);
+        if (inputSilent && plugin_tail_decayed(mInstance)) {
+            for (UInt32 ch = 0; ch < numChannels; ++ch) memset(mOutputPtrs[ch], 0, inNumberFrames * sizeof(float));
+            *ioActionFlags |= kAudioUnitRenderAction_OutputIsSilence;
+            mProfiler.skipped();
+            plugin_meter_silence(mInstance, inNumberFrames);
+            return noErr;
         }
+#endif
+        *ioActionFlags &= ~kAudioUnitRenderAction_OutputIsSilence;
 
-        plugin_process(mInstance, inputs.data(), outputs.data(), inNumberFrames);
+        if (!mProfiler.active()) {
+            plugin_process(mInstance, mInputPtrs, mOutputPtrs, inNumberFrames);
+            return noErr;
+        }
+        mProfiler.begin(plugin_heap_allocs(mInstance));
+        plugin_process(mInstance, mInputPtrs, mOutputPtrs, inNumberFrames);
+        mProfiler.end((int32_t)inNumberFrames, plugin_heap_allocs(mInstance));
 
         return noErr;
     }
 
+    // Stereo-only classes take mono or stereo; wider ones any matching
+    // count, with the limit enforced when the stream format is set.
+    static UInt32 channelInfo(AUChannelInfo* out) {
+        if (plugin_class_max_channels(0) > 2) {
+            if (out) out[0] = { -1, -1 };
+            return 1;
+        }
+        if (out) {
+            out[0] = { 1, 1 };
+            out[1] = { 2, 2 };
+        }
+        return 2;
+    }
+
+    static bool isSilent(const float* const* channels, UInt32 numChannels, UInt32 numFrames) {
+        for (UInt32 ch = 0; ch < numChannels; ++ch) {
+            for (UInt32 i = 0; i < numFrames; ++i) {
+                if (channels[ch][i] != 0.0f) return false;
+            }
+        }
+        return true;
+    }
+
     // Static dispatchers
     static OSStatus SonicAU_GetPropertyInfo(void *self, AudioUnitPropertyID inID, AudioUnitScope inScope, AudioUnitElement inElement, UInt32 *outDataSize, Boolean *outWritable) {
-        return ((SonicAU*)self)->GetPropertyInfo(inID, inScope, inElement, outDataSize, outWritable);
+        return AUFromSelf(self)->GetPropertyInfo(inID, inScope, inElement, outDataSize, outWritable);
     }
     static OSStatus SonicAU_GetProperty(void *self, AudioUnitPropertyID inID, AudioUnitScope inScope, AudioUnitElement inElement, void *outData, UInt32 *ioDataSize) {
-        return ((SonicAU*)self)->GetProperty(inID, inScope, inElement, outData);
+        return AUFromSelf(self)->GetProperty(inID, inScope, inElement, outData, ioDataSize);
     }
     static OSStatus SonicAU_SetProperty(void *self, AudioUnitPropertyID inID, AudioUnitScope inScope, AudioUnitElement inElement, const void *inData, UInt32 inDataSize) {
-        return ((SonicAU*)self)->SetProperty(inID, inScope, inElement, inData, inDataSize);
+        return AUFromSelf(self)->SetProperty(inID, inScope, inElement, inData, inDataSize);
     }
     static OSStatus SonicAU_GetParameter(void *self, AudioUnitParameterID inID, AudioUnitScope inScope, AudioUnitElement inElement, AudioUnitParameterValue *outValue) {
-        return ((SonicAU*)self)->GetParameter(inID, inScope, inElement, outValue);
+        return AUFromSelf(self)->GetParameter(inID, inScope, inElement, outValue);
     }
     static OSStatus SonicAU_SetParameter(void *self, AudioUnitParameterID inID, AudioUnitScope inScope, AudioUnitElement inElement, AudioUnitParameterValue inValue, UInt32 inBufferOffsetInFrames) {
-        return ((SonicAU*)self)->SetParameter(inID, inScope, inElement, inValue, inBufferOffsetInFrames);
+        return AUFromSelf(self)->SetParameter(inID, inScope, inElement, inValue, inBufferOffsetInFrames);
     }
-    static OSStatus SonicAU_Initialize(void *self) { return ((SonicAU*)self)->Initialize(); }
-    static OSStatus SonicAU_Uninitialize(void *self) { return ((SonicAU*)self)->Uninitialize(); }
+    static OSStatus SonicAU_Initialize(void *self) { return AUFromSelf(self)->Initialize(); }
+    static OSStatus SonicAU_Uninitialize(void *self) { return AUFromSelf(self)->Uninitialize(); }
     static OSStatus SonicAU_Render(void *self, AudioUnitRenderActionFlags *ioActionFlags, const AudioTimeStamp *inTimeStamp, UInt32 inOutputBusNumber, UInt32 inNumberFrames, AudioBufferList *ioData) {
-        return ((SonicAU*)self)->Render(ioActionFlags, inTimeStamp, inOutputBusNumber, inNumberFrames, ioData);
+        return AUFromSelf(self)->Render(ioActionFlags, inTimeStamp, inOutputBusNumber, inNumberFrames, ioData);
     }
 
 private:
     AudioComponentPlugInInterface* mComponent;
     void* mInstance;
+    bool mInitialized;
     double mSampleRate;
     AudioUnitConnection mInputConnection;
     AURenderCallbackStruct mRenderCallback;
-    float mParams[16];
+    UInt32 mMaxFrames;
+    UInt32 mChannels;
+    std::vector<float> mInputStorage;
+    std::vector<float> mScratchStorage;
+    std::vector<unsigned char> mInputListStorage;
+    AudioBufferList* mInputList;
+    const float* mInputPtrs[kMaxChannels];
+    float* mOutputPtrs[kMaxChannels];
+    sonic_stats::InstanceProfiler mProfiler;
+    ParamChannel<16> mParams;
+    // Last readings handed out for kSonicProperty_Meters. Only the polling
+    // thread touches them, so a read that loses to Render every time
+    // repeats these instead of failing.
+    SonicMeterReadings mMeterReadings;
 };
 
 // Component Entry
 OSStatus SonicAU_Open(void *self, void *mInstance) {
-    SonicAU* au = new (std::nothrow) SonicAU((AudioComponentPlugInInterface*)self);
-    if (!au) return -1;
-    // Note: In a real implementation, we would store 'au' in the instance storage.
-    // For this minimal bridge, we'll assume the host passes it back correctly in self.
+    SonicAUInstance* inst = (SonicAUInstance*)self;
+    inst->au = new (std::nothrow) SonicAU(&inst->interface);
+    if (!inst->au) return -1;
     return noErr;
 }
 
 OSStatus SonicAU_Close(void *self) {
+    SonicAUInstance* inst = (SonicAUInstance*)self;
+    delete inst->au;
+    delete inst;
     return noErr;
 }
 
@@ -178,11 +368,13 @@ void* SonicAU_Lookup(SInt16 selector) {
 
 extern "C" {
     AU_EXPORT void* SonicPluginFactory(const AudioComponentDescription* inDesc) {
-        static AudioComponentPlugInInterface interface;
-        interface.Open = SonicAU_Open;
-        interface.Close = SonicAU_Close;
-        interface.Lookup = SonicAU_Lookup;
-        interface.GetScrap = NULL;
-        return &interface;
+        SonicAUInstance* inst = new (std::nothrow) SonicAUInstance;
+        if (!inst) return NULL;
+        inst->interface.Open = SonicAU_Open;
+        inst->interface.Close = SonicAU_Close;
+        inst->interface.Lookup = SonicAU_Lookup;
+        inst->interface.GetScrap = NULL;
+        inst->au = nullptr;
+        return inst;
     }
 }
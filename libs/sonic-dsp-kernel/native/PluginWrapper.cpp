@@ -1,15 +1,43 @@
 #include "vst3_minimal.h"
+#include "meters.h"
+#include "param_channel.h"
+#include "profiler.h"
+#include "rt_guard.h"
+#include "state_mailbox.h"
 #include <vector>
 #include <cstring>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
 #include <atomic>
+#include <algorithm>
 
 // Zig C-ABI
 extern "C" {
     void* plugin_create(float sample_rate);
+    void* plugin_create_class(uint32_t index, float sample_rate);
+    uint32_t plugin_class_count();
+    const char* plugin_class_id(uint32_t index);
+    const char* plugin_class_name(uint32_t index);
+    uint32_t plugin_class_max_channels(uint32_t index);
+    int32_t plugin_class_oversampling_param(uint32_t index);
+    uint32_t plugin_class_param_count(uint32_t index);
+    uint32_t plugin_class_param_steps(uint32_t index, int32_t param);
+    uint32_t plugin_param_steps(void* instance, int32_t param);
     void plugin_destroy(void* instance);
+    int32_t plugin_set_channels(void* instance, uint32_t channels);
+    void plugin_set_worker_threads(void* instance, uint32_t threads);
+    int32_t plugin_prepare(void* instance, float sample_rate, size_t max_block);
     void plugin_process(void* instance, const float** inputs, float** outputs, size_t frames);
     void plugin_set_parameter(void* instance, int32_t index, float value);
     float plugin_get_parameter(void* instance, int32_t index);
+    uint32_t plugin_get_latency(void* instance);
+    uint32_t plugin_get_tail(void* instance);
+    int32_t plugin_tail_decayed(void* instance);
+    uint64_t plugin_heap_allocs(void* instance);
+    size_t plugin_get_state_size(void* instance);
+    size_t plugin_save_state(void* instance, uint8_t* out, size_t capacity);
+    int32_t plugin_load_state(void* instance, const uint8_t* data, size_t len);
 }
 
 namespace Steinberg {
@@ -32,12 +60,77 @@ using namespace Steinberg::Vst;
 // Random GUID for our plugin: {A1B2C3D4-E5F6-7890-1234-56789ABCDEF0}
 static const TUID MyPluginCID = {0xA1,0xB2,0xC3,0xD4,0xE5,0xF6,0x78,0x90,0x12,0x34,0x56,0x78,0x9A,0xBC,0xDE,0xF0};
 
+// Each kernel class gets MyPluginCID's first half plus a 64-bit FNV-1a hash
+// of its id, so a plugin keeps the same CID whether it ships alone or inside
+// the SonicSuite bundle, and no two plugins share one.
+static void classCID(uint32 index, TUID cid) {
+    memcpy(cid, MyPluginCID, 8);
+    uint64 h = 0xcbf29ce484222325ull;
+    for (const char* p = plugin_class_id(index); *p; p++) {
+        h ^= (uint8)*p;
+        h *= 0x100000001b3ull;
+    }
+    for (int i = 0; i < 8; i++) cid[8 + i] = (unsigned char)(h >> (56 - 8 * i));
+}
+
+static const int32 kMaxChannels = 16;
+// Most parameters a kernel class declares (c_export.zig max_params); the
+// module chain has 136, everything else 16.
+static const int32 kMaxParams = 256;
+// Automation points consumed per block. Past this, a queue keeps only its
+// last point, so every parameter still ends the block where the host left
+// it; those take one more slot per parameter.
+static const int32 kMaxParamEvents = 512;
+static const int32 kParamEventSlots = kMaxParamEvents + kMaxParams;
+// Bytes read from a state stream per call
+static const int32 kStateChunk = 4096;
+// The kernel's meters (meters.h), reported as read-only output parameters
+// after the class's own when SONIC_METERS=1. Their ids start at
+// kMaxParams, whatever the class.
+static const int32 kMeters = 6;
+#ifdef SONIC_NO_METERS
+static const int32 kMeterParams = 0;
+#else
+static const int32 kMeterParams = kMeters;
+#endif
+static const ParamID kMeterParamBase = kMaxParams;
+static const char* const kMeterTitles[kMeters] = { "Peak L", "Peak R", "RMS L", "RMS R", "Momentary", "Gain Reduction" };
+static const char* const kMeterShortTitles[kMeters] = { "PkL", "PkR", "RmsL", "RmsR", "LUFS", "GR" };
+static const char* const kMeterUnits[kMeters] = { "dB", "dB", "dB", "dB", "LUFS", "dB" };
+// Gain reduction is the last meter
+static const int32 kGainReductionMeter = 5;
+// Levels are shown from kMeterRangeDb below full scale to 0 dB, gain
+// reduction from 0 to kMeterGainRangeDb
+static const float kMeterRangeDb = 60.0f;
+static const float kMeterGainRangeDb = 30.0f;
+
+struct ParamEvent {
+    int32 offset;
+    int32 order; // arrival index, keeps same-offset points in queue order
+    ParamID id;
+    float value;
+};
+
 class PluginWrapper : public IComponent, public IAudioProcessor, public IEditController {
 public:
-    PluginWrapper() : refCount(1), zigInstance(nullptr), sampleRate(44100.0f) {
-        for (int i = 0; i < 16; i++) paramCache[i] = 0.5f;
+    explicit PluginWrapper(uint32 classIndex)
+        : refCount(1), classIndex(classIndex), zigInstance(nullptr), sampleRate(44100.0f), maxBlock(0),
+          arrangement(SpeakerArr::kStereo), busChannels(2), workerThreads(1),
+          numParams(std::min((int32)plugin_class_param_count(classIndex), kMaxParams)), params(0.5f),
+          oversamplingParam(plugin_class_oversampling_param(classIndex)), steppedParams(false),
+          meterParams(kMeterParams && sonicMetersRequested() ? kMeterParams : 0), componentHandler(nullptr),
+          active(false), reprepare(false) {
+        // Stepped settings (oversampling, a chain slot's module) are
+        // opt-in: start at the first step rather than mid-range
+        for (int32 i = 0; i < numParams; i++) {
+            if (plugin_class_param_steps(classIndex, i) == 0) continue;
+            params.store(i, 0.0f);
+            steppedParams = true;
+        }
+        for (auto& value : meterValues) value.store(0.0f, std::memory_order_relaxed);
     }
     virtual ~PluginWrapper() {
+        if (componentHandler) componentHandler->release();
         if (zigInstance) {
             plugin_destroy(zigInstance);
             zigInstance = nullptr;
@@ -46,16 +139,21 @@ public:
 
     // --- FUnknown ---
     int32 SMTG_STDCALL queryInterface(const TUID _iid, void** obj) override {
+        // Each interface lives at its own offset inside the object, so hand out
+        // the matching base pointer rather than 'this'.
         if (FUnknownPrivate_iidEqual(_iid, FUnknown::iid) ||
-            FUnknownPrivate_iidEqual(_iid, IComponent::iid) ||
-            FUnknownPrivate_iidEqual(_iid, IAudioProcessor::iid) ||
-            FUnknownPrivate_iidEqual(_iid, IEditController::iid)) {
-            *obj = this;
-            addRef();
-            return kResultOk;
+            FUnknownPrivate_iidEqual(_iid, IComponent::iid)) {
+            *obj = static_cast<IComponent*>(this);
+        } else if (FUnknownPrivate_iidEqual(_iid, IAudioProcessor::iid)) {
+            *obj = static_cast<IAudioProcessor*>(this);
+        } else if (FUnknownPrivate_iidEqual(_iid, IEditController::iid)) {
+            *obj = static_cast<IEditController*>(this);
+        } else {
+            *obj = nullptr;
+            return kNoInterface;
         }
-        *obj = nullptr;
-        return kNoInterface;
+        addRef();
+        return kResultOk;
     }
 
     uint32 SMTG_STDCALL addRef() override {
@@ -71,9 +169,11 @@ public:
     }
 
     // --- IComponent ---
+    // Single-component: this object is its own IEditController, which
+    // hosts find through queryInterface. No class in the factory creates
+    // a separate controller, so there is no CID to name.
     tresult SMTG_STDCALL getControllerClassId(TUID classId) override { 
-        memcpy(classId, MyPluginCID, 16); 
-        return kResultOk; 
+        return kResultFalse; 
     }
     tresult SMTG_STDCALL setIoMode(TIoMediaType level) override { return kResultOk; }
     tresult SMTG_STDCALL getBusCount(TMediaType type, TBusDirection dir) override {
@@ -81,39 +181,139 @@ public:
         return 0;
     }
     tresult SMTG_STDCALL getBusInfo(TMediaType type, TBusDirection dir, int32 index, void* busInfo) override {
-        return kResultOk; 
+        if (type != kAudio || index != 0 || !busInfo) return kInvalidArgument;
+        BusInfo* info = (BusInfo*)busInfo;
+        memset(info, 0, sizeof(BusInfo));
+        info->mediaType = kAudio;
+        info->direction = dir;
+        info->channelCount = busChannels;
+        const char* name = dir == kInput ? "Input" : "Output";
+        for (int i = 0; name[i]; i++) info->name[i] = (char16)name[i];
+        info->busType = kMain;
+        info->flags = BusInfo::kDefaultActive;
+        return kResultOk;
     }
     tresult SMTG_STDCALL getRoutingInfo(void* inInfo, void* outInfo) override { return kNotImplemented; }
     tresult SMTG_STDCALL activateBus(TMediaType type, TBusDirection dir, int32 index, bool state) override { return kResultOk; }
     tresult SMTG_STDCALL setActive(bool state) override { 
         if (state) {
-            if (!zigInstance) {
-                zigInstance = plugin_create(sampleRate);
-                // Sync initial params
-                for (int i = 0; i < 16; i++) plugin_set_parameter(zigInstance, i, paramCache[i]);
-            }
+            if (!zigInstance && !createInstance()) return kResultFalse;
+            // Not processing, so settle pending edits here: an oversampling
+            // change must be in place before the host re-reads latency, and
+            // a chain loads the modules its slots now select
+            params.drain([this](int index, float value) {
+                plugin_set_parameter(zigInstance, index, value);
+            });
+            if (reprepare.exchange(false)) plugin_prepare(zigInstance, sampleRate, (size_t)maxBlock);
+        }
+        active.store(state, std::memory_order_release);
+        // A state handed over after the last block is applied now
+        if (!state) {
+            if (const std::vector<uint8>* blob = pendingState.take()) applyState(blob->data(), blob->size());
         }
         return kResultOk; 
     }
-    tresult SMTG_STDCALL setState(void* state) override { return kResultOk; }
-    tresult SMTG_STDCALL getState(void* state) override { return kResultOk; }
+    // State is the kernel's blob (plugin_save_state): parameters plus
+    // learned data such as noise profiles. IComponent and IEditController
+    // share these two methods, so the controller state is the same blob.
+    tresult SMTG_STDCALL setState(void* state) override {
+        IBStream* stream = (IBStream*)state;
+        if (!stream) return kInvalidArgument;
+        // Hosts often restore before setupProcessing; the instance made
+        // here is prepared when processing is set up
+        if (!zigInstance && !createInstance()) return kResultFalse;
+
+        size_t len = 0;
+        int32 got = 0;
+        do {
+            stateBytes.resize(len + kStateChunk);
+            got = 0;
+            if (stream->read(stateBytes.data() + len, kStateChunk, &got) != kResultOk) got = 0;
+            len += (size_t)std::max(got, 0);
+        } while (got == kStateChunk);
+        stateBytes.resize(len);
+
+        // Edits made before the load don't survive it
+        params.clearDirty();
+        if (!active.load(std::memory_order_acquire)) {
+            uint32 latency = plugin_get_latency(zigInstance);
+            if (!applyState(stateBytes.data(), stateBytes.size())) return kResultFalse;
+            // Stepped settings in the state (a chain's modules) take
+            // effect at prepare
+            if (steppedParams) plugin_prepare(zigInstance, sampleRate, (size_t)maxBlock);
+            if (plugin_get_latency(zigInstance) != latency && componentHandler)
+                componentHandler->restartComponent(kLatencyChanged);
+            return kResultOk;
+        }
+        // Active: process() may be running, so the audio thread applies it
+        // at its next block, replacing any state still waiting there. The
+        // copy is made here, so nothing is allocated there.
+        pendingState.back() = stateBytes;
+        pendingState.post();
+        // Its stepped settings wait for the re-activation this asks for
+        if (steppedParams) {
+            reprepare.store(true);
+            if (componentHandler) componentHandler->restartComponent(kLatencyChanged);
+        }
+        return kResultOk;
+    }
+    tresult SMTG_STDCALL getState(void* state) override {
+        IBStream* stream = (IBStream*)state;
+        if (!stream) return kInvalidArgument;
+        if (!zigInstance && !createInstance()) return kResultFalse;
+        stateBytes.resize(plugin_get_state_size(zigInstance));
+        size_t len = plugin_save_state(zigInstance, stateBytes.data(), stateBytes.size());
+        if (len == 0) return kResultFalse;
+        int32 written = 0;
+        if (stream->write(stateBytes.data(), (int32)len, &written) != kResultOk || written != (int32)len) return kResultFalse;
+        return kResultOk;
+    }
 
     // --- IAudioProcessor ---
-    tresult SMTG_STDCALL setBusArrangements(uint64* inputs, int32 numIns, uint64* outputs, int32 numOuts) override { return kResultOk; }
-    tresult SMTG_STDCALL getBusArrangement(int32 busIndex, TBusDirection dir, uint64& arrangement) override { return kResultOk; }
+    // One main bus each way with the same layout on both. Any arrangement
+    // up to the class's channel limit is taken as-is: the kernel only needs
+    // the channel count. Anything else is refused and the current
+    // arrangement stays, which the host reads back with getBusArrangement.
+    tresult SMTG_STDCALL setBusArrangements(uint64* inputs, int32 numIns, uint64* outputs, int32 numOuts) override {
+        if (numIns != 1 || numOuts != 1 || inputs[0] != outputs[0]) return kResultFalse;
+        int32 channels = SpeakerArr::getChannelCount(inputs[0]);
+        if (channels < 1 || channels > kMaxChannels || (uint32)channels > plugin_class_max_channels(classIndex)) return kResultFalse;
+        if (zigInstance && plugin_set_channels(zigInstance, (uint32)channels) != 0) return kResultFalse;
+        arrangement = inputs[0];
+        busChannels = channels;
+        return kResultOk;
+    }
+    tresult SMTG_STDCALL getBusArrangement(int32 busIndex, TBusDirection dir, uint64& arr) override {
+        if (busIndex != 0) return kInvalidArgument;
+        arr = arrangement;
+        return kResultOk;
+    }
     tresult SMTG_STDCALL canProcessSampleSize(int32 symbolicSampleSize) override {
         return (symbolicSampleSize == 0) ? kResultOk : kResultFalse; // kSample32 = 0
     }
-    tresult SMTG_STDCALL getLatencySamples(int32& latency) override { latency = 0; return kResultOk; }
+    // Hosts ask after setupProcessing, once the kernel instance exists
+    tresult SMTG_STDCALL getLatencySamples(int32& latency) override {
+        latency = zigInstance ? (int32)plugin_get_latency(zigInstance) : 0;
+        return kResultOk;
+    }
     
     tresult SMTG_STDCALL setupProcessing(ProcessSetup& setup) override {
         sampleRate = setup.sampleRate;
-        if (zigInstance) {
-            plugin_destroy(zigInstance);
-            zigInstance = nullptr;
-        }
-        zigInstance = plugin_create(sampleRate);
-        for (int i = 0; i < 16; i++) plugin_set_parameter(zigInstance, i, paramCache[i]);
+        // Sized here so process() never has to grow it
+        maxBlock = setup.maxSamplesPerBlock > 0 ? setup.maxSamplesPerBlock : 0;
+        if (inputScratch.size() != (size_t)kMaxChannels * maxBlock)
+            inputScratch.assign((size_t)kMaxChannels * maxBlock, 0.0f);
+        // A bounce has no deadline, so heavy spectral classes may spread
+        // its large blocks over worker threads; real time stays on the
+        // host's thread
+        workerThreads = setup.processMode == kOffline ? offlineThreads() : 1;
+        // Hosts call this on every transport/format change. Reconfigure the
+        // existing instance so learned state (noise profiles, references)
+        // survives; only the first call creates one.
+        if (!zigInstance) return createInstance() ? kResultOk : kResultFalse;
+        plugin_set_worker_threads(zigInstance, workerThreads);
+        if (plugin_prepare(zigInstance, sampleRate, (size_t)maxBlock) != 0) return kResultFalse;
+        profiler.attach(plugin_class_id(classIndex), sampleRate, maxBlock);
         return kResultOk;
     }
     
@@ -121,46 +321,79 @@ public:
     
     tresult SMTG_STDCALL process(ProcessData& data) override {
         if (!zigInstance) return kResultOk;
+        RtGuardScope rtGuard;
 
-        // Handle Parameter Changes
-        if (data.inputParameterChanges) {
-            int32 numParams = data.inputParameterChanges->getParameterCount();
-            for (int32 i = 0; i < numParams; i++) {
-                IParamValueQueue* queue = data.inputParameterChanges->getParameterData(i);
-                if (queue) {
-                    ParamID id = queue->getParameterId();
-                    int32 points = queue->getPointCount();
-                    ParamValue val;
-                    int32 offset;
-                    if (queue->getPoint(points - 1, offset, val) == kResultOk) {
-                        if (id < 16) {
-                            paramCache[id] = (float)val;
-                            plugin_set_parameter(zigInstance, id, (float)val);
-                        }
-                    }
-                }
-            }
-        }
+        if (const std::vector<uint8>* blob = pendingState.take()) applyState(blob->data(), blob->size());
 
-        if (data.numInputs == 0 || data.numOutputs == 0) return kResultOk;
+        // Controller-side edits first, then this block's host automation on top
+        params.drain([this](int index, float value) {
+            plugin_set_parameter(zigInstance, index, value);
+        });
+
+        int32 numEvents = collectParamEvents(data.inputParameterChanges, data.numSamples);
+
+        if (data.numInputs == 0 || data.numOutputs == 0 || data.numSamples <= 0) {
+            // Parameter flush without audio: apply everything right away
+            for (int32 e = 0; e < numEvents; e++) applyParamEvent(paramEvents[e]);
+            return kResultOk;
+        }
         if (data.symbolicSampleSize != 0) return kResultFalse; 
 
-        float** inputs = data.inputs[0].channelBuffers32;
-        float** outputs = data.outputs[0].channelBuffers32;
         int32 numFrames = data.numSamples;
+        if (numFrames > maxBlock) return kResultFalse;
 
-        plugin_process(zigInstance, (const float**)inputs, outputs, numFrames);
+        // The kernel reads exactly the negotiated number of channels each way
+        if (data.inputs[0].numChannels < busChannels || data.outputs[0].numChannels < busChannels) return kResultFalse;
+        int32 numIns = busChannels;
+        int32 numOuts = busChannels;
+        float** outputs = data.outputs[0].channelBuffers32;
 
+#ifndef SONIC_NO_SILENCE_SKIP
+        // Silent input into a kernel whose tail has died away: the output is
+        // silence too, so skip the kernel and say so. Automation still lands,
+        // just not sample-accurately, since nothing audible depends on it.
+        if (inputIsSilent(data.inputs[0], numIns, numFrames) && plugin_tail_decayed(zigInstance)) {
+            for (int32 e = 0; e < numEvents; e++) applyParamEvent(paramEvents[e]);
+            for (int32 ch = 0; ch < numOuts; ch++) memset(outputs[ch], 0, sizeof(float) * numFrames);
+            data.outputs[0].silenceFlags = (1ull << numOuts) - 1;
+            profiler.skipped();
+            plugin_meter_silence(zigInstance, (size_t)numFrames);
+            reportMeters(data);
+            return kResultOk;
+        }
+#endif
+        data.outputs[0].silenceFlags = 0;
+        const float** inputs = resolveInputs(data.inputs[0], numIns, data.outputs[0], numOuts, numFrames);
+
+        if (!profiler.active()) {
+            runKernel(inputs, outputs, numIns, numOuts, numFrames, numEvents);
+        } else {
+            profiler.begin(plugin_heap_allocs(zigInstance));
+            runKernel(inputs, outputs, numIns, numOuts, numFrames, numEvents);
+            profiler.end(numFrames, plugin_heap_allocs(zigInstance));
+        }
+        reportMeters(data);
         return kResultOk;
     }
     
-    tresult SMTG_STDCALL getTailSamples(int32& tail) override { tail = 0; return kResultOk; }
+    tresult SMTG_STDCALL getTailSamples(int32& tail) override {
+        tail = zigInstance ? (int32)plugin_get_tail(zigInstance) : 0;
+        return kResultOk;
+    }
 
     // --- IEditController ---
+    // The component is this object, and its setState has already loaded
+    // the same bytes
     tresult SMTG_STDCALL setComponentState(void* state) override { return kResultOk; }
-    int32 SMTG_STDCALL getParameterCount() override { return 16; } // Support up to 16 generic params
+    // 16 generic params, or the class's own count (the module chain's
+    // slots), then the meters
+    int32 SMTG_STDCALL getParameterCount() override { return numParams + meterParams; }
     tresult SMTG_STDCALL getParameterInfo(int32 paramIndex, ParameterInfo& info) override {
-        if (paramIndex >= 16) return kResultFalse;
+        if (paramIndex >= numParams && paramIndex < numParams + meterParams) {
+            meterInfo(paramIndex - numParams, info);
+            return kResultOk;
+        }
+        if (paramIndex < 0 || paramIndex >= numParams) return kResultFalse;
         info.id = paramIndex;
         sprintf(info.title, "Param %d", paramIndex + 1);
         strcpy(info.shortTitle, info.title);
@@ -170,29 +403,286 @@ public:
         info.min = 0.0;
         info.max = 1.0;
         info.unitId = 0;
-        info.flags = 1; // canAutomate
+        info.flags = ParameterInfo::kCanAutomate;
+        const uint32 steps = paramSteps(paramIndex);
+        if (steps > 0) {
+            // Oversampling 1x to 8x, a chain slot's module. Changes
+            // latency, so not automatable.
+            if (paramIndex == oversamplingParam) {
+                strcpy(info.title, "Oversampling");
+                strcpy(info.shortTitle, "OS");
+            }
+            info.stepCount = (int32)steps;
+            info.defaultValue = 0.0;
+            info.flags = ParameterInfo::kIsList;
+        }
         return kResultOk;
     }
     ParamValue SMTG_STDCALL getParamStringByValue(ParamID id, ParamValue valueNormalized, char16* string) override { return 0; }
     tresult SMTG_STDCALL getParamValueByString(ParamID id, char16* string, ParamValue& valueNormalized) override { return kNotImplemented; }
-    ParamValue SMTG_STDCALL normalizedParamToPlain(ParamID id, ParamValue valueNormalized) override { return valueNormalized; }
+    // Meters read back in dB (LUFS for momentary loudness)
+    ParamValue SMTG_STDCALL normalizedParamToPlain(ParamID id, ParamValue valueNormalized) override {
+        if (meterIndex(id) == kGainReductionMeter) return valueNormalized * kMeterGainRangeDb;
+        if (meterIndex(id) >= 0) return (valueNormalized - 1.0) * kMeterRangeDb;
+        return valueNormalized;
+    }
     ParamValue SMTG_STDCALL plainParamToNormalized(ParamID id, ParamValue plainValue) override { return plainValue; }
     ParamValue SMTG_STDCALL getParamNormalized(ParamID id) override { 
-        if (id < 16) return paramCache[id];
+        if (id >= 0 && id < (ParamID)numParams) return params.get(id);
+        // The audio thread's last report, so a UI polling meters never
+        // reaches the kernel
+        if (meterIndex(id) >= 0) return meterValues[meterIndex(id)].load(std::memory_order_relaxed);
         return 0; 
     }
     tresult SMTG_STDCALL setParamNormalized(ParamID id, ParamValue value) override { 
-        if (id < 16) paramCache[id] = (float)value;
+        // May run on the UI thread while process() is active; the audio
+        // thread picks the change up at its next block.
+        if (id >= (ParamID)numParams) return kResultOk;
+        const uint32 steps = paramSteps((int32)id);
+        const bool newStep = steps > 0 && stepOf(params.get(id), steps) != stepOf((float)value, steps);
+        params.push(id, (float)value);
+        // The host deactivates, which applies the change (setActive), and
+        // then asks for the new latency. A chain slot's new module can
+        // make other slot parameters stepped, so its info changes too.
+        if (newStep) {
+            reprepare.store(true);
+            const bool selector = id != (ParamID)oversamplingParam && plugin_class_param_steps(classIndex, (int32)id) > 0;
+            if (componentHandler) componentHandler->restartComponent(kLatencyChanged | (selector ? kParamTitlesChanged : 0));
+        }
         return kResultOk; 
     }
-    tresult SMTG_STDCALL setComponentHandler(void* handler) override { return kResultOk; }
+    tresult SMTG_STDCALL setComponentHandler(void* handler) override {
+        IComponentHandler* next = (IComponentHandler*)handler;
+        if (next) next->addRef();
+        if (componentHandler) componentHandler->release();
+        componentHandler = next;
+        return kResultOk;
+    }
     void* SMTG_STDCALL createView(const char* name) override { return nullptr; }
 
 private:
+    // Every kernel call for one block: a single plugin_process, or one per
+    // stretch between automation points.
+    void runKernel(const float** inputs, float** outputs, int32 numIns, int32 numOuts, int32 numFrames, int32 numEvents) {
+        if (numEvents == 0) {
+            plugin_process(zigInstance, inputs, outputs, numFrames);
+            return;
+        }
+
+        // Split the block at every automation point so each value takes
+        // effect on its own sample offset instead of at the block start.
+        const float* segInputs[kMaxChannels];
+        float* segOutputs[kMaxChannels];
+
+        int32 pos = 0;
+        int32 e = 0;
+        while (pos < numFrames) {
+            while (e < numEvents && paramEvents[e].offset <= pos) applyParamEvent(paramEvents[e++]);
+            int32 end = (e < numEvents) ? paramEvents[e].offset : numFrames;
+
+            for (int32 ch = 0; ch < numIns; ch++) segInputs[ch] = inputs[ch] + pos;
+            for (int32 ch = 0; ch < numOuts; ch++) segOutputs[ch] = outputs[ch] + pos;
+            plugin_process(zigInstance, segInputs, segOutputs, (size_t)(end - pos));
+
+            pos = end;
+        }
+        // Points sitting on the last sample (offset == numSamples) land here
+        while (e < numEvents) applyParamEvent(paramEvents[e++]);
+    }
+
+    // After every block with audio: the meter readings go to the host as
+    // output parameter changes on the block's last sample, and to
+    // getParamNormalized through meterValues. The reader is the audio
+    // thread, which has just published, so the read never has to retry and
+    // each report covers exactly one block.
+    void reportMeters(ProcessData& data) {
+        if (meterParams == 0) return;
+        SonicMeterReadings r;
+        if (plugin_read_meters(zigInstance, &r) != 0) return;
+        const float values[] = { meterLevel(r.peakDb[0]), meterLevel(r.peakDb[1]), meterLevel(r.rmsDb[0]),
+                                 meterLevel(r.rmsDb[1]), meterLevel(r.momentaryLufs),
+                                 std::min(std::max(r.gainReductionDb / kMeterGainRangeDb, 0.0f), 1.0f) };
+        for (int32 i = 0; i < meterParams; i++) {
+            meterValues[i].store(values[i], std::memory_order_relaxed);
+            if (!data.outputParameterChanges) continue;
+            int32 index = 0;
+            IParamValueQueue* queue = data.outputParameterChanges->addParameterData(kMeterParamBase + i, index);
+            if (queue) queue->addPoint(data.numSamples - 1, values[i], index);
+        }
+    }
+
+    static float meterLevel(float db) {
+        return std::min(std::max(1.0f + db / kMeterRangeDb, 0.0f), 1.0f);
+    }
+
+    // Which meter an id is, or -1
+    int32 meterIndex(ParamID id) const {
+        return id >= kMeterParamBase && id < kMeterParamBase + (ParamID)meterParams ? id - kMeterParamBase : -1;
+    }
+
+    static void meterInfo(int32 meter, ParameterInfo& info) {
+        info.id = kMeterParamBase + meter;
+        strcpy(info.title, kMeterTitles[meter]);
+        strcpy(info.shortTitle, kMeterShortTitles[meter]);
+        strcpy(info.units, kMeterUnits[meter]);
+        info.stepCount = 0;
+        info.defaultValue = 0.0;
+        info.min = 0.0;
+        info.max = 1.0;
+        info.unitId = 0;
+        info.flags = ParameterInfo::kIsReadOnly;
+    }
+
+    // Trusts the host's silence flags when they cover every channel, and
+    // otherwise looks for digital silence itself; many hosts never set them.
+    static bool inputIsSilent(const AudioBusBuffers& in, int32 numIns, int32 numFrames) {
+        uint64 all = (1ull << numIns) - 1;
+        if ((in.silenceFlags & all) == all) return true;
+        for (int32 ch = 0; ch < numIns; ch++) {
+            const float* src = in.channelBuffers32[ch];
+            for (int32 i = 0; i < numFrames; i++) {
+                if (src[i] != 0.0f) return false;
+            }
+        }
+        return true;
+    }
+
+    // The kernel never sees aliased buffers: hosts are allowed to process
+    // in place, so any input channel that shares memory with an output is
+    // copied into scratch first.
+    const float** resolveInputs(AudioBusBuffers& in, int32 numIns, AudioBusBuffers& out, int32 numOuts, int32 numFrames) {
+        for (int32 ch = 0; ch < numIns; ch++) {
+            const float* src = in.channelBuffers32[ch];
+            bool aliased = false;
+            for (int32 k = 0; k < numOuts; k++) {
+                if (out.channelBuffers32[k] == src) { aliased = true; break; }
+            }
+            if (aliased) {
+                float* copy = inputScratch.data() + (size_t)ch * maxBlock;
+                memcpy(copy, src, sizeof(float) * numFrames);
+                src = copy;
+            }
+            inputPtrs[ch] = src;
+        }
+        return inputPtrs;
+    }
+
+    // Flattens every queue into paramEvents, ordered by sample offset.
+    // std::sort works in place, so nothing is allocated on the audio thread.
+    int32 collectParamEvents(IParameterChanges* changes, int32 numSamples) {
+        if (!changes) return 0;
+        int32 count = 0;
+        int32 numQueues = changes->getParameterCount();
+        for (int32 i = 0; i < numQueues && count < kParamEventSlots; i++) {
+            IParamValueQueue* queue = changes->getParameterData(i);
+            if (!queue) continue;
+            ParamID id = queue->getParameterId();
+            if (id >= (ParamID)numParams) continue;
+            int32 points = queue->getPointCount();
+            // A queue that doesn't fit in what is left of kMaxParamEvents
+            // fills it up to one short, then adds its last point
+            const int32 budget = kMaxParamEvents - count;
+            for (int32 p = 0; p < points && count < kParamEventSlots; p++) {
+                if (p >= budget - 1 && p != points - 1) continue;
+                int32 offset;
+                ParamValue val;
+                if (queue->getPoint(p, offset, val) != kResultOk) continue;
+                if (offset < 0) offset = 0;
+                if (offset > numSamples) offset = numSamples;
+                paramEvents[count] = { offset, count, id, (float)val };
+                count++;
+            }
+        }
+        std::sort(paramEvents, paramEvents + count, [](const ParamEvent& a, const ParamEvent& b) {
+            return a.offset != b.offset ? a.offset < b.offset : a.order < b.order;
+        });
+        return count;
+    }
+
+    bool createInstance() {
+        zigInstance = plugin_create_class(classIndex, sampleRate);
+        if (!zigInstance) return false;
+        plugin_set_channels(zigInstance, (uint32)busChannels);
+        if (meterParams) plugin_set_metering(zigInstance, 1);
+        // Parameters before prepare, so a chain loads its modules here
+        syncParams();
+        plugin_set_worker_threads(zigInstance, workerThreads);
+        plugin_prepare(zigInstance, sampleRate, (size_t)maxBlock);
+        profiler.attach(plugin_class_id(classIndex), sampleRate, maxBlock);
+        return true;
+    }
+
+    // Full resync into a fresh instance; only valid while not processing.
+    void syncParams() {
+        params.clearDirty();
+        for (int32 i = 0; i < numParams; i++) plugin_set_parameter(zigInstance, i, params.get(i));
+    }
+
+    // Loads a state blob into the instance and shows its parameters to the
+    // host. Allocation-free, so it can run on the audio thread.
+    bool applyState(const uint8* data, size_t len) {
+        if (plugin_load_state(zigInstance, data, len) != 0) return false;
+        for (int32 i = 0; i < numParams; i++) params.store(i, plugin_get_parameter(zigInstance, i));
+        return true;
+    }
+
+    // Threads for offline processing: SONIC_OFFLINE_THREADS if set, else
+    // one per core
+    static uint32 offlineThreads() {
+        const char* env = getenv("SONIC_OFFLINE_THREADS");
+        if (env && atoi(env) > 0) return (uint32)atoi(env);
+        return std::max(std::thread::hardware_concurrency(), 1u);
+    }
+
+    // Stepped settings of this instance: besides the class's, a chain
+    // slot's oversampling factor, which depends on the module selected
+    uint32 paramSteps(int32 id) const {
+        return zigInstance ? plugin_param_steps(zigInstance, id) : plugin_class_param_steps(classIndex, id);
+    }
+
+    // Same rounding as the kernel's oversample.factorFromParameter and
+    // the chain's slot selectors
+    static int stepOf(float value, uint32 steps) {
+        return (int)(std::min(std::max(value, 0.0f), 1.0f) * (float)steps + 0.5f);
+    }
+
+    void applyParamEvent(const ParamEvent& ev) {
+        params.store(ev.id, ev.value);
+        plugin_set_parameter(zigInstance, ev.id, ev.value);
+    }
+
     std::atomic<uint32> refCount;
+    uint32 classIndex;
     void* zigInstance;
     float sampleRate;
-    float paramCache[16];
+    int32 maxBlock;
+    uint64 arrangement;
+    int32 busChannels;
+    // Set from the process mode in setupProcessing
+    uint32 workerThreads;
+    int32 numParams;
+    ParamChannel<kMaxParams> params;
+    int32 oversamplingParam;
+    // Whether any parameter is a stepped setting (plugin_class_param_steps)
+    bool steppedParams;
+    // Meter output parameters this instance reports: kMeterParams with
+    // SONIC_METERS=1, else none
+    const int32 meterParams;
+    IComponentHandler* componentHandler;
+    std::atomic<bool> active;
+    // State read by setState; handed to the audio thread through
+    // pendingState while active
+    std::vector<uint8> stateBytes;
+    StateMailbox pendingState;
+    // A stepped setting moved: prepare again at the next activation
+    std::atomic<bool> reprepare;
+    ParamEvent paramEvents[kParamEventSlots];
+    std::vector<float> inputScratch;
+    const float* inputPtrs[kMaxChannels];
+    sonic_stats::InstanceProfiler profiler;
+    // Normalised meter readings, written by the audio thread after each
+    // block (reportMeters)
+    std::atomic<float> meterValues[kMeters];
 };
 
 class PluginFactory : public IPluginFactory {
@@ -215,25 +705,33 @@ public:
 
     // IPluginFactory
     tresult SMTG_STDCALL getFactoryInfo(void* info) override { 
-        // PFactoryInfo* i = (PFactoryInfo*)info;
-        // strcpy(i->vendor, "SonicFoundry");
+        PFactoryInfo* i = (PFactoryInfo*)info;
+        memset(i, 0, sizeof(PFactoryInfo));
+        strcpy(i->vendor, "SonicFoundry");
         return kResultOk; 
     }
-    int32 SMTG_STDCALL countClasses() override { return 1; }
+    int32 SMTG_STDCALL countClasses() override { return (int32)plugin_class_count(); }
     tresult SMTG_STDCALL getClassInfo(int32 index, void* info) override {
-        if (index == 0) {
-            // PClassInfo* i = (PClassInfo*)info;
-            // memcpy(i->cid, MyPluginCID, 16);
-            // strcpy(i->name, "SonicPlugin");
-            // strcpy(i->category, "Fx");
-            return kResultOk;
-        }
-        return kInvalidArgument;
+        if (index < 0 || (uint32)index >= plugin_class_count()) return kInvalidArgument;
+        PClassInfo* i = (PClassInfo*)info;
+        memset(i, 0, sizeof(PClassInfo));
+        classCID((uint32)index, i->cid);
+        i->cardinality = PClassInfo::kManyInstances;
+        strcpy(i->category, "Audio Module Class");
+        strncpy(i->name, plugin_class_name((uint32)index), sizeof(i->name) - 1);
+        return kResultOk;
     }
     tresult SMTG_STDCALL createInstance(const TUID cid, const TUID _iid, void** obj) override {
-        if (FUnknownPrivate_iidEqual(cid, MyPluginCID)) {
-            PluginWrapper* p = new PluginWrapper();
-            return p->queryInterface(_iid, obj);
+        *obj = nullptr;
+        uint32 count = plugin_class_count();
+        for (uint32 index = 0; index < count; index++) {
+            TUID classId;
+            classCID(index, classId);
+            if (!FUnknownPrivate_iidEqual(cid, classId)) continue;
+            PluginWrapper* p = new PluginWrapper(index);
+            tresult result = p->queryInterface(_iid, obj);
+            p->release(); // the interface returned to the host holds the only reference
+            return result;
         }
         return kInvalidArgument;
     }
@@ -22,6 +22,12 @@ typedef uint8_t Byte;
 typedef UInt32 AudioUnitScope;
 typedef UInt32 AudioUnitElement;
 typedef UInt32 AudioUnitParameterID;
+typedef UInt32 AudioUnitPropertyID;
+typedef UInt32 AudioUnitRenderActionFlags;
+typedef unsigned char Boolean;
+
+struct AudioTimeStamp;
+struct AudioBufferList;
 typedef Float32 AudioUnitParameterValue;
 
 enum {
@@ -62,7 +68,9 @@ enum {
     kAudioUnitProperty_ParameterList = 3,
     kAudioUnitProperty_ParameterInfo = 4,
     kAudioUnitProperty_StreamFormat = 8,
+    kAudioUnitProperty_Latency = 12,
     kAudioUnitProperty_MaximumFramesPerSlice = 14,
+    kAudioUnitProperty_TailTime = 20,
     kAudioUnitProperty_SetRenderCallback = 23,
     kAudioUnitProperty_FactoryPresets = 24,
     kAudioUnitProperty_RenderQuality = 26,
@@ -84,6 +92,13 @@ struct AudioUnitConnection {
     UInt32 destInputNumber;
 };
 
+// kAudioUnitProperty_SupportedNumChannels entries; -1 on both sides means
+// any count as long as input and output match.
+struct AUChannelInfo {
+    SInt16 inChannels;
+    SInt16 outChannels;
+};
+
 extern "C" {
     OSStatus AudioUnitRender(void* inUnit, AudioUnitRenderActionFlags* ioActionFlags, const AudioTimeStamp* inTimeStamp, UInt32 inOutputBusNumber, UInt32 inNumberFrames, AudioBufferList* ioData);
 }
@@ -135,8 +150,6 @@ enum {
     kAudioTimeStampSampleTimeValid = (1 << 0)
 };
 
-typedef UInt32 AudioUnitRenderActionFlags;
-
 enum {
     kAudioUnitRenderAction_OutputIsSilence = (1 << 4)
 };
@@ -0,0 +1,14 @@
+#pragma once
+
+// C ABI of echovanish's whole-buffer dereverberation (echovanish.zig,
+// exported from c_export.zig). It streams over the buffer with the same
+// online WPE the sonicechovanish class runs block by block, so its memory
+// does not grow with the buffer's length.
+
+#include <cstddef>
+
+extern "C" {
+    // Mono, in place. reduction 0..1 scales the predicted late reverb taken
+    // out; tailMs sets the prediction order (one tap per 1024-sample hop).
+    void echovanish_process(float* data, size_t len, float sampleRate, float reduction, float tailMs);
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+// C ABI of the kernel's standalone EQ cascades (dsp/cascade.zig, exported
+// from c_export.zig), for benchmarks and tests.
+//
+// Engine 0 is the vectorised cascade the EQ plugins run on, engine 1 the
+// per-sample scalar biquad chain it replaced. Band k is a +3 dB peak at
+// 100 * 2^k Hz, Q 1, on every channel. Buffers are planar; inputs and
+// outputs may be the same buffers.
+
+#include <cstdint>
+
+extern "C" {
+    // bands 1-8, channels 1-16; null for anything else
+    void* eq_bench_create(uint32_t engine, uint32_t bands, uint32_t channels, float sampleRate);
+    void eq_bench_destroy(void* eq);
+    void eq_bench_process(void* eq, const float* const* inputs, float* const* outputs, uint32_t frames);
+}
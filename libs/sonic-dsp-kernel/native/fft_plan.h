@@ -0,0 +1,27 @@
+#pragma once
+
+// C ABI of the kernel's FFT plans (fft.zig, exported from c_export.zig).
+//
+// Sizes are powers of two. Complex data is interleaved re/im floats. The
+// forward kernel is e^{+i 2 pi k n / N} and inverse transforms scale by 1/N,
+// matching math_utils.fft_iterative. A plan is immutable once created and
+// may be used from several threads at once.
+
+#include <cstddef>
+#include <cstdint>
+
+extern "C" {
+    void* fft_plan_create(size_t n);
+    void fft_plan_destroy(void* plan);
+    // In place on n complex values
+    void fft_plan_transform(void* plan, float* data, int32_t inverse);
+
+    // Real signals: n samples <-> n/2 + 1 complex bins
+    void* fft_real_plan_create(size_t n);
+    void fft_real_plan_destroy(void* plan);
+    void fft_real_forward(void* plan, const float* input, float* output);
+    void fft_real_inverse(void* plan, const float* input, float* output);
+
+    // The original scalar radix-2 transform, for comparisons
+    void fft_reference_transform(float* data, size_t n, int32_t inverse);
+}
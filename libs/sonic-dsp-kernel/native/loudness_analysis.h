@@ -0,0 +1,50 @@
+#pragma once
+
+// C ABI of the kernel's loudness analysis (analysis.zig, exported from
+// c_export.zig): the engine behind analyze_audio_comprehensive, for files
+// of any length.
+//
+// Audio is interleaved; only the first two channels are analysed. Results
+// are 14 floats: integrated LUFS, LRA, peak dB, RMS dB, crest factor,
+// correlation, stereo width, balance, DC offset, low/mid/high energy share,
+// max momentary and max short-term LUFS.
+//
+// An accumulator takes a stream in blocks of any size. To split a file,
+// give each stretch its own accumulator, run it over up to
+// loudness_analysis_warmup_frames() of the audio before the stretch (more
+// at higher rates) with loudness_analysis_warmup(), push the stretch, then
+// merge the accumulators in order. Stretches must start on multiples of
+// loudness_analysis_hop_frames(). Separate accumulators may be used from
+// separate threads.
+//
+// The lufs_meter functions measure BS.1770 gated integrated loudness (the
+// normalizers' measurement) of up to 16 channels in constant memory.
+
+#include <cstddef>
+#include <cstdint>
+
+extern "C" {
+    // null for zero channels or a non-positive rate
+    void* loudness_analysis_create(uint32_t channels, float sampleRate);
+    void loudness_analysis_destroy(void* acc);
+    size_t loudness_analysis_hop_frames(float sampleRate);
+    size_t loudness_analysis_warmup_frames(float sampleRate);
+
+    void loudness_analysis_warmup(void* acc, const float* interleaved, size_t frames);
+    void loudness_analysis_push(void* acc, const float* interleaved, size_t frames);
+    // Appends `next`, which must follow `into` directly; -1 if it can't
+    int32_t loudness_analysis_merge(void* into, const void* next);
+    void loudness_analysis_result(const void* acc, float* out);
+
+    // Whole buffer on a worker pool; threads 0 means one per core. 0 or -1.
+    int32_t loudness_analyze(const float* interleaved, size_t frames, uint32_t channels, float sampleRate,
+                             uint32_t threads, float* out);
+
+    // null for zero or more than 16 channels or a non-positive rate
+    void* lufs_meter_create(uint32_t channels, float sampleRate);
+    void lufs_meter_destroy(void* meter);
+    void lufs_meter_push(void* meter, const float* interleaved, size_t frames);
+    void lufs_meter_push_planar(void* meter, const float* const* channels, size_t frames);
+    // 0 with the loudness in *lufs, or -1 while nothing has passed the gates
+    int32_t lufs_meter_integrated(const void* meter, float* lufs);
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+// C ABI of the kernel's real-time meters (exported from c_export.zig).
+//
+// With metering on, every plugin_process call measures its output on the
+// audio thread and publishes the figures through a seqlock; nothing is
+// allocated or locked there. plugin_read_meters copies the latest readings
+// from one other thread (a UI timer) or from the audio thread between
+// blocks, and never makes the audio thread wait.
+//
+// Peak, RMS and gain reduction cover everything processed since the
+// previous read; momentary loudness is BS.1770 over the last 400 ms and
+// moves every 100 ms. Peak and RMS are of the first two channels, a mono
+// bus's one channel on both sides. Levels below -100 dB read as -100.
+//
+// Metering is off for a new instance. The wrappers turn it on only with
+// SONIC_METERS=1 in the environment (sonicMetersRequested), since most
+// hosts never read the figures.
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+struct SonicMeterReadings {
+    float peakDb[2];
+    float rmsDb[2];
+    float momentaryLufs;
+    // Deepest over the period, 0 for classes that don't compress
+    float gainReductionDb;
+    // plugin_process calls measured since metering was turned on
+    uint64_t blocks;
+};
+
+extern "C" {
+    // Never while plugin_process or a read may run. Turning metering on
+    // takes effect at the next plugin_prepare unless the instance already
+    // has room for the meter. Returns 0.
+    int32_t plugin_set_metering(void* instance, int32_t enabled);
+    // A block skipped as silent (plugin_tail_decayed) counts as silence
+    void plugin_meter_silence(void* instance, size_t frames);
+    // 0, or -1 if metering is off or the audio thread was publishing on
+    // every attempt; *out is then untouched
+    int32_t plugin_read_meters(void* instance, SonicMeterReadings* out);
+}
+
+// SONIC_METERS=1: the wrappers meter their instances and report the figures
+inline bool sonicMetersRequested() {
+    const char* env = getenv("SONIC_METERS");
+    return env && strcmp(env, "1") == 0;
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+// Lock-free hand-off of parameter values from the controller/UI threads to
+// the audio thread.
+//
+// Every parameter owns an atomic slot holding its latest value and a bit in a
+// shared dirty mask (one 32-bit word per 32 parameters). Writers store the
+// value and then set the bit; the audio thread swaps each mask word out at
+// block start and forwards only the slots that changed. Writers never block and the reader never allocates or waits.
+// Several writer threads are fine: the last store to a slot wins, which is the
+// same semantics the host expects from setParamNormalized / SetParameter.
+template <int NumParams>
+class ParamChannel {
+    static_assert(NumParams > 0, "at least one parameter");
+    static const int kWords = (NumParams + 31) / 32;
+
+public:
+    explicit ParamChannel(float initial = 0.5f) {
+        for (int i = 0; i < NumParams; i++) values[i].store(initial, std::memory_order_relaxed);
+        for (int w = 0; w < kWords; w++) dirty[w].store(0, std::memory_order_relaxed);
+    }
+
+    // Writer side (any thread): publish a value and flag it for the audio thread.
+    void push(int index, float value) {
+        if (index < 0 || index >= NumParams) return;
+        values[index].store(value, std::memory_order_relaxed);
+        dirty[index / 32].fetch_or(1u << (index % 32), std::memory_order_release);
+    }
+
+    // Record a value the audio thread already applied itself (e.g. sample
+    // accurate automation) so readers see it, without re-queuing it.
+    void store(int index, float value) {
+        if (index < 0 || index >= NumParams) return;
+        values[index].store(value, std::memory_order_relaxed);
+    }
+
+    float get(int index) const {
+        if (index < 0 || index >= NumParams) return 0.0f;
+        return values[index].load(std::memory_order_relaxed);
+    }
+
+    // Reader side (audio thread): call apply(index, value) for every slot
+    // written since the previous drain.
+    template <typename Fn>
+    void drain(Fn&& apply) {
+        for (int w = 0; w < kWords; w++) {
+            uint32_t bits = dirty[w].exchange(0, std::memory_order_acquire);
+            while (bits) {
+                int index = w * 32 + __builtin_ctz(bits);
+                bits &= bits - 1;
+                apply(index, values[index].load(std::memory_order_relaxed));
+            }
+        }
+    }
+
+    // Discard pending changes, e.g. after a full resync into a new instance.
+    void clearDirty() {
+        for (int w = 0; w < kWords; w++) dirty[w].store(0, std::memory_order_relaxed);
+    }
+
+private:
+    std::atomic<float> values[NumParams];
+    std::atomic<uint32_t> dirty[kWords];
+};
@@ -0,0 +1,26 @@
+#pragma once
+
+// C ABI of the kernel's YIN pitch tracker (pitch_detect.zig, exported from
+// c_export.zig): the FFT-based tracker behind the tape stabilizer and the
+// brute-force Yin.detect it replaced.
+//
+// A tracker analyses frames of `size` samples (a power of two) for a
+// period between sampleRate / maxFreq and sampleRate / minFreq, which must
+// be under size / 2. Frequencies are in Hz, 0 where no period was found.
+
+#include <cstddef>
+#include <cstdint>
+
+extern "C" {
+    // null for an unusable size, hop or range
+    void* pitch_tracker_create(size_t size, size_t hop, float sampleRate, float minFreq, float maxFreq);
+    void pitch_tracker_destroy(void* tracker);
+    // A stream in blocks of any size: one estimate per completed frame, the
+    // frames `hop` apart. freqs needs room for len / hop + 1; returns the count.
+    size_t pitch_tracker_push(void* tracker, const float* samples, size_t len, float* freqs);
+    // One frame of `size` samples; aperiodicity may be null
+    float pitch_tracker_analyse(void* tracker, const float* frame, float* aperiodicity);
+
+    // Yin.detect on one frame of any length
+    float pitch_reference_detect(const float* frame, size_t len, float sampleRate, float minFreq, float maxFreq);
+}
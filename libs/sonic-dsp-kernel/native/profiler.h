@@ -0,0 +1,275 @@
+#pragma once
+
+// Always-on per-instance profiling for the wrappers.
+//
+// Each instance claims a slot in its process's stats segment (see
+// stats_segment.h) and brackets the kernel calls of every block with
+// begin()/end(). Blocks, frames and heap allocations are counted for every
+// block, in the profiler itself. One block in kDefaultTimeEvery is timed:
+// it alone pays for the two cycle-counter reads and, on x86, the two MXCSR
+// reads that catch denormal operands, and it publishes the counters to
+// the slot. Load, the histogram, the slowest block and overruns are
+// therefore over the timed blocks, a steady sample of the stream.
+// Nothing on the audio thread allocates, locks or makes a system call.
+// Attach `sonic-stats` to read the counters while the host runs.
+//
+// SONIC_PROFILE=0 in the environment leaves new instances unprofiled,
+// SONIC_PROFILE_EVERY=<n> times one block in n (1 times them all) and
+// SONIC_PROFILE_BUDGET=<percent> sets the overrun budget for a new segment.
+// The segment needs POSIX shared memory, so on Windows every instance stays
+// detached and the calls are no-ops.
+
+#include "stats_segment.h"
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define SONIC_PROFILE_MXCSR 1
+#endif
+
+#if !defined(_WIN32)
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace sonic_stats {
+
+// Cycle counter where there is a cheap one, steady_clock nanoseconds elsewhere
+inline uint64_t readTicks() {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#elif defined(__aarch64__)
+    uint64_t ticks;
+    asm volatile("mrs %0, cntvct_el0" : "=r"(ticks));
+    return ticks;
+#else
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+// Once per segment. The TSC rate is not architecturally visible, so it is
+// timed against steady_clock for a few milliseconds.
+inline double measureTicksPerSecond() {
+#if defined(__x86_64__) || defined(__i386__)
+    auto t0 = std::chrono::steady_clock::now();
+    uint64_t c0 = readTicks();
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    uint64_t c1 = readTicks();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    return seconds > 0.0 ? (double)(c1 - c0) / seconds : 1e9;
+#elif defined(__aarch64__)
+    uint64_t freq;
+    asm volatile("mrs %0, cntfrq_el0" : "=r"(freq));
+    return (double)freq;
+#else
+    return 1e9;
+#endif
+}
+
+inline uint32_t log2Bucket(uint64_t v) {
+    uint32_t b = 0;
+#if defined(__GNUC__) || defined(__clang__)
+    if (v) b = 63 - (uint32_t)__builtin_clzll(v);
+#else
+    while (v >>= 1) b++;
+#endif
+    return b < kHistogramBuckets ? b : kHistogramBuckets - 1;
+}
+
+// The process's segment, created on first use and unlinked when the plugin
+// binary is unloaded.
+class SegmentOwner {
+public:
+    SegmentOwner() { create(); }
+    ~SegmentOwner() {
+#if !defined(_WIN32)
+        if (!segment) return;
+        munmap(segment, sizeof(Segment));
+        shm_unlink(name);
+#endif
+    }
+
+    Segment* segment = nullptr;
+
+private:
+    void create() {
+#if !defined(_WIN32)
+        int pid = (int)getpid();
+        // Another plugin binary in the same host may already own index 0
+        for (int index = 0; index < 16; index++) {
+            segmentName(name, sizeof(name), pid, index);
+            int fd = shm_open(name, O_CREAT | O_EXCL | O_RDWR, 0600);
+            if (fd < 0) {
+                if (errno == EEXIST) continue;
+                return;
+            }
+            void* mem = MAP_FAILED;
+            if (ftruncate(fd, sizeof(Segment)) == 0)
+                mem = mmap(nullptr, sizeof(Segment), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+            close(fd);
+            if (mem == MAP_FAILED) {
+                shm_unlink(name);
+                return;
+            }
+            // ftruncate zero-fills, so every slot starts out free
+            Segment* seg = (Segment*)mem;
+            seg->version = kVersion;
+            seg->slotCount = kMaxSlots;
+#if defined(SONIC_PROFILE_MXCSR)
+            seg->capabilities = kCapDenormals;
+#endif
+            seg->pid = pid;
+            seg->ticksPerSecond = measureTicksPerSecond();
+            const char* budget = getenv("SONIC_PROFILE_BUDGET");
+            int percent = budget ? atoi(budget) : 0;
+            seg->budgetPercent.store(percent > 0 ? (uint32_t)percent : kDefaultBudgetPercent, std::memory_order_relaxed);
+            // Readers check the magic before anything else
+            std::atomic_thread_fence(std::memory_order_release);
+            seg->magic = kMagic;
+            segment = seg;
+            return;
+        }
+#endif
+    }
+
+    char name[64] = {};
+};
+
+inline Segment* processSegment() {
+    static SegmentOwner owner;
+    return owner.segment;
+}
+
+class InstanceProfiler {
+public:
+    InstanceProfiler() = default;
+    InstanceProfiler(const InstanceProfiler&) = delete;
+    InstanceProfiler& operator=(const InstanceProfiler&) = delete;
+    ~InstanceProfiler() { detach(); }
+
+    // Claims a slot, or updates the one already held after a rate or block
+    // size change. Never on the audio thread: the first call in a process
+    // creates the segment and calibrates the clock.
+    void attach(const char* classId, float sampleRate, int32_t maxBlock) {
+        if (!slot) claim(classId);
+        if (!slot) return;
+        slot->sampleRate = sampleRate;
+        slot->maxBlock = maxBlock;
+        ticksPerFrame = sampleRate > 0.0f ? (uint64_t)(segment->ticksPerSecond / sampleRate) : 0;
+    }
+
+    void detach() {
+        if (!slot) return;
+        slot->state.store(kSlotFree, std::memory_order_release);
+        slot = nullptr;
+    }
+
+    bool active() const { return slot != nullptr; }
+
+    // Audio thread: wraps the kernel calls for one block. heapAllocs is the
+    // kernel's running count (plugin_heap_allocs) before and after.
+    void begin(uint64_t heapAllocs) {
+        startAllocs = heapAllocs;
+        timing = --untilTimed == 0;
+        if (!timing) return;
+        untilTimed = timeEvery;
+#if defined(SONIC_PROFILE_MXCSR)
+        // The denormal flag is sticky; clear it so end() sees only this
+        // block. Writing MXCSR is slow, so only when it is set.
+        const uint32_t csr = _mm_getcsr();
+        if (csr & kMxcsrDenormal) _mm_setcsr(csr & ~kMxcsrDenormal);
+#endif
+        startTicks = readTicks();
+    }
+
+    void end(int32_t frames, uint64_t heapAllocs) {
+        blocks++;
+        totalFrames += (uint64_t)frames;
+        if (heapAllocs != startAllocs) add(slot->heapAllocs, heapAllocs - startAllocs);
+        if (!timing) return;
+
+        const uint64_t elapsed = readTicks() - startTicks;
+        Slot& s = *slot;
+        s.blocks.store(blocks, std::memory_order_relaxed);
+        s.frames.store(totalFrames, std::memory_order_relaxed);
+        add(s.timedFrames, (uint64_t)frames);
+        add(s.ticks, elapsed);
+        s.lastBlockTicks.store(elapsed, std::memory_order_relaxed);
+        if (elapsed > s.maxBlockTicks.load(std::memory_order_relaxed))
+            s.maxBlockTicks.store(elapsed, std::memory_order_relaxed);
+        add(s.histogram[log2Bucket(frames > 0 ? elapsed / (uint64_t)frames : elapsed)], 1);
+
+        const uint64_t budget = (uint64_t)frames * ticksPerFrame * segment->budgetPercent.load(std::memory_order_relaxed);
+        if (elapsed * 100 > budget) add(s.overruns, 1);
+#if defined(SONIC_PROFILE_MXCSR)
+        if (_mm_getcsr() & kMxcsrDenormal) add(s.denormalBlocks, 1);
+#endif
+    }
+
+    // Audio thread: a block answered with silence without calling the kernel
+    void skipped() {
+        if (slot) add(slot->skippedBlocks, 1);
+    }
+
+private:
+    static const uint32_t kMxcsrDenormal = 1u << 1;
+
+    // Single writer per slot, so no read-modify-write instruction is needed
+    static void add(std::atomic<uint64_t>& counter, uint64_t n) {
+        counter.store(counter.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+
+    void claim(const char* classId) {
+        const char* env = getenv("SONIC_PROFILE");
+        if (env && strcmp(env, "0") == 0) return;
+        const char* every = getenv("SONIC_PROFILE_EVERY");
+        timeEvery = every && atoi(every) > 0 ? (uint32_t)atoi(every) : kDefaultTimeEvery;
+        untilTimed = 1;
+        blocks = 0;
+        totalFrames = 0;
+        Segment* seg = processSegment();
+        if (!seg) return;
+        for (uint32_t i = 0; i < seg->slotCount; i++) {
+            Slot& s = seg->slots[i];
+            uint32_t expected = kSlotFree;
+            if (!s.state.compare_exchange_strong(expected, kSlotClaimed, std::memory_order_acquire)) continue;
+
+            memset(s.classId, 0, sizeof(s.classId));
+            strncpy(s.classId, classId ? classId : "", sizeof(s.classId) - 1);
+            s.timeEvery = timeEvery;
+            std::atomic<uint64_t>* counters[] = {
+                &s.blocks, &s.frames, &s.timedFrames, &s.ticks, &s.maxBlockTicks, &s.lastBlockTicks,
+                &s.overruns, &s.heapAllocs, &s.denormalBlocks, &s.skippedBlocks,
+            };
+            for (auto* c : counters) c->store(0, std::memory_order_relaxed);
+            for (auto& h : s.histogram) h.store(0, std::memory_order_relaxed);
+            s.generation.fetch_add(1, std::memory_order_relaxed);
+            s.state.store(kSlotLive, std::memory_order_release);
+
+            segment = seg;
+            slot = &s;
+            return;
+        }
+    }
+
+    Segment* segment = nullptr;
+    Slot* slot = nullptr;
+    uint64_t ticksPerFrame = 0;
+    uint64_t startTicks = 0;
+    uint64_t startAllocs = 0;
+    // Audio thread only: the running totals the timed blocks publish, and
+    // the countdown to the next timed block (the first block is timed)
+    uint64_t blocks = 0;
+    uint64_t totalFrames = 0;
+    uint32_t timeEvery = kDefaultTimeEvery;
+    uint32_t untilTimed = 1;
+    bool timing = false;
+};
+
+} // namespace sonic_stats
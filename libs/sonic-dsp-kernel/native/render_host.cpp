@@ -0,0 +1,530 @@
+// Offline render host for the kernel C ABI.
+//
+//   sonic-render [--block N] [--threads N] [--normalize LUFS] <in.wav | noise:SECONDS> <out.wav | null> [<plugin>[:<param>=<value>,...] ...]
+//   sonic-render --list
+//
+// Streams a WAV file through a chain of kernel plugins as fast as they run
+// and reports the realtime factor (seconds of audio per second of CPU) of
+// every stage and of the whole chain. Plugins are the suite's class ids
+// (--list shows them); parameters are the normalised 0..1 values the
+// wrappers pass through, by index, e.g. "sonicdenoise:0=0.8".
+//
+// Both files are memory-mapped. Input samples are converted straight from
+// the mapping into the first stage's buffers, stages hand their output
+// buffers to the next stage, and the last stage's output is written
+// straight into the output mapping: nothing is staged in between. Output
+// is 32-bit float, delay-compensated by the chain's reported latency, and
+// the same length as the input.
+//
+// "noise:SECONDS" renders deterministic stereo noise at 48 kHz instead of
+// a file, and "null" discards the output, for reproducible throughput runs.
+// With no plugins the input is just converted.
+//
+// --threads lets each plugin spread its blocks over N threads, as in a
+// host's offline bounce (plugin_set_worker_threads); the output is the same
+// for any N.
+//
+// --normalize renders twice. The first pass measures the gated integrated
+// loudness (BS.1770) of the chain's output in constant memory without
+// writing anything; the second renders again from a fresh chain and
+// applies the gain that brings it to LUFS as it writes. Mapped pages are
+// dropped from the process behind the read and write positions, so
+// resident memory stays flat however long the file; the summary reports
+// the peak.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <strings.h>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "loudness_analysis.h"
+
+extern "C" {
+    uint32_t plugin_class_count();
+    const char* plugin_class_id(uint32_t index);
+    const char* plugin_class_name(uint32_t index);
+    void* plugin_create_class(uint32_t index, float sample_rate);
+    void plugin_destroy(void* instance);
+    void plugin_set_worker_threads(void* instance, uint32_t threads);
+    int32_t plugin_prepare(void* instance, float sample_rate, size_t max_block);
+    void plugin_process(void* instance, const float* const* inputs, float** outputs, size_t frames);
+    void plugin_set_parameter(void* instance, int32_t index, float value);
+    uint32_t plugin_get_latency(void* instance);
+}
+
+static const size_t kDefaultBlock = 65536;
+static const size_t kWavHeaderBytes = 44;
+static const uint16_t kFormatPcm = 1;
+static const uint16_t kFormatFloat = 3;
+static const uint16_t kFormatExtensible = 0xFFFE;
+// Mapped bytes dropped from the process at a time once read or written
+static const size_t kReleaseWindow = (size_t)64 << 20;
+
+using Clock = std::chrono::steady_clock;
+
+static double secondsSince(Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+// --- Files ---
+
+class MappedFile {
+public:
+    ~MappedFile() {
+        if (data && data != MAP_FAILED) munmap(data, size);
+        if (fd >= 0) close(fd);
+    }
+
+    bool openRead(const char* path) {
+        fd = open(path, O_RDONLY);
+        if (fd < 0) return false;
+        struct stat st;
+        if (fstat(fd, &st) != 0 || st.st_size == 0) return false;
+        size = (size_t)st.st_size;
+        data = (uint8_t*)mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data == MAP_FAILED) return false;
+        madvise(data, size, MADV_SEQUENTIAL);
+        return true;
+    }
+
+    bool create(const char* path, size_t bytes) {
+        fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0 || ftruncate(fd, (off_t)bytes) != 0) return false;
+        size = bytes;
+        data = (uint8_t*)mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        return data != MAP_FAILED;
+    }
+
+    // Unmaps the pages before `offset` from this process, a window at a
+    // time. Written pages stay in the page cache until the kernel flushes
+    // them, and touching any page again faults it back in, so this only
+    // bounds resident memory. rewind() starts over for another pass.
+    void releaseBefore(size_t offset) {
+        size_t end = offset / kReleaseWindow * kReleaseWindow;
+        if (!data || end <= released) return;
+        madvise(data + released, end - released, MADV_DONTNEED);
+        released = end;
+    }
+
+    void rewind() { released = 0; }
+
+    uint8_t* data = nullptr;
+    size_t size = 0;
+
+private:
+    int fd = -1;
+    size_t released = 0;
+};
+
+static uint16_t read16(const uint8_t* p) { return (uint16_t)(p[0] | (p[1] << 8)); }
+static uint32_t read32(const uint8_t* p) { return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24); }
+static void write16(uint8_t* p, uint16_t v) { p[0] = (uint8_t)v; p[1] = (uint8_t)(v >> 8); }
+static void write32(uint8_t* p, uint32_t v) { for (int i = 0; i < 4; i++) p[i] = (uint8_t)(v >> (8 * i)); }
+
+// Interleaved source samples: a mapped WAV data chunk or generated noise
+struct Source {
+    uint16_t format = kFormatFloat;
+    uint16_t channels = 2;
+    uint16_t bits = 32;
+    uint32_t sampleRate = 48000;
+    const uint8_t* samples = nullptr; // null: noise
+    size_t frames = 0;
+};
+
+static bool parseWav(const uint8_t* p, size_t size, Source& src, std::string& err) {
+    if (size < 12 || memcmp(p, "RIFF", 4) != 0 || memcmp(p + 8, "WAVE", 4) != 0) {
+        err = "not a RIFF/WAVE file";
+        return false;
+    }
+    bool haveFormat = false;
+    size_t pos = 12;
+    while (pos + 8 <= size) {
+        const uint8_t* chunk = p + pos;
+        size_t len = read32(chunk + 4);
+        size_t body = pos + 8;
+        if (memcmp(chunk, "fmt ", 4) == 0 && len >= 16 && body + len <= size) {
+            src.format = read16(p + body);
+            src.channels = read16(p + body + 2);
+            src.sampleRate = read32(p + body + 4);
+            src.bits = read16(p + body + 14);
+            // The subformat GUID starts with the actual format code
+            if (src.format == kFormatExtensible && len >= 26) src.format = read16(p + body + 24);
+            haveFormat = true;
+        } else if (memcmp(chunk, "data", 4) == 0) {
+            if (!haveFormat) {
+                err = "data chunk before fmt chunk";
+                return false;
+            }
+            // Streamed WAVs may carry a placeholder length; trust the file size
+            size_t available = size - body;
+            if (len > available) len = available;
+            size_t frameBytes = (size_t)src.channels * (src.bits / 8);
+            src.samples = p + body;
+            src.frames = frameBytes ? len / frameBytes : 0;
+            break;
+        }
+        pos = body + len + (len & 1);
+    }
+    if (!src.samples) {
+        err = "no data chunk";
+        return false;
+    }
+    bool pcm = src.format == kFormatPcm && (src.bits == 16 || src.bits == 24 || src.bits == 32);
+    bool flt = src.format == kFormatFloat && src.bits == 32;
+    if (!pcm && !flt) {
+        err = "unsupported sample format (16/24/32-bit PCM and 32-bit float only)";
+        return false;
+    }
+    if (src.channels != 1 && src.channels != 2) {
+        err = "only mono and stereo files are supported (the kernel processes stereo)";
+        return false;
+    }
+    return true;
+}
+
+static float sampleAt(const Source& src, size_t index) {
+    const uint8_t* p = src.samples + index * (src.bits / 8);
+    if (src.format == kFormatFloat) {
+        float v;
+        memcpy(&v, p, sizeof(v));
+        return v;
+    }
+    switch (src.bits) {
+        case 16: return (float)(int16_t)read16(p) * (1.0f / 32768.0f);
+        case 24: {
+            int32_t v = (int32_t)((uint32_t)p[0] << 8 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 24) >> 8;
+            return (float)v * (1.0f / 8388608.0f);
+        }
+        default: return (float)(int32_t)read32(p) * (1.0f / 2147483648.0f);
+    }
+}
+
+// Converts frames [start, start + n) into planar stereo; past the end of the
+// source (the latency flush) it writes silence. Mono feeds both channels.
+static void readFrames(const Source& src, size_t start, size_t n, float* const out[2]) {
+    size_t avail = start < src.frames ? std::min(n, src.frames - start) : 0;
+    if (!src.samples) {
+        for (size_t i = 0; i < avail; i++) {
+            for (int ch = 0; ch < 2; ch++) {
+                uint32_t seed = (uint32_t)((start + i) * 2 + ch) * 2654435761u;
+                seed ^= seed >> 15;
+                seed *= 2246822519u;
+                seed ^= seed >> 13;
+                out[ch][i] = ((float)(seed >> 8) / 16777216.0f) * 0.5f - 0.25f;
+            }
+        }
+    } else if (src.channels == 2 && src.format == kFormatFloat) {
+        const float* in = (const float*)src.samples + start * 2;
+        for (size_t i = 0; i < avail; i++) {
+            out[0][i] = in[i * 2];
+            out[1][i] = in[i * 2 + 1];
+        }
+    } else {
+        for (size_t i = 0; i < avail; i++) {
+            size_t base = (start + i) * src.channels;
+            out[0][i] = sampleAt(src, base);
+            out[1][i] = src.channels == 2 ? sampleAt(src, base + 1) : out[0][i];
+        }
+    }
+    for (int ch = 0; ch < 2; ch++) std::fill(out[ch] + avail, out[ch] + n, 0.0f);
+}
+
+static void writeFloatWavHeader(uint8_t* p, uint16_t channels, uint32_t sampleRate, size_t frames) {
+    uint32_t dataBytes = (uint32_t)(frames * channels * sizeof(float));
+    memcpy(p, "RIFF", 4);
+    write32(p + 4, 36 + dataBytes);
+    memcpy(p + 8, "WAVEfmt ", 8);
+    write32(p + 16, 16);
+    write16(p + 20, kFormatFloat);
+    write16(p + 22, channels);
+    write32(p + 24, sampleRate);
+    write32(p + 28, sampleRate * channels * (uint32_t)sizeof(float));
+    write16(p + 32, (uint16_t)(channels * sizeof(float)));
+    write16(p + 34, 32);
+    memcpy(p + 36, "data", 4);
+    write32(p + 40, dataBytes);
+}
+
+// --- Chain ---
+
+struct Stage {
+    std::string spec;
+    void* instance = nullptr;
+    uint32_t latency = 0;
+    double seconds = 0.0;
+};
+
+static int findClass(const std::string& id) {
+    for (uint32_t i = 0; i < plugin_class_count(); i++) {
+        if (strcasecmp(plugin_class_id(i), id.c_str()) == 0) return (int)i;
+    }
+    return -1;
+}
+
+// "<id>[:<index>=<value>,...]"
+static bool createStage(Stage& stage, float sampleRate, size_t block, uint32_t threads) {
+    std::string id = stage.spec.substr(0, stage.spec.find(':'));
+    int index = findClass(id);
+    if (index < 0) {
+        fprintf(stderr, "sonic-render: unknown plugin '%s' (see --list)\n", id.c_str());
+        return false;
+    }
+    stage.instance = plugin_create_class((uint32_t)index, sampleRate);
+    if (!stage.instance) {
+        fprintf(stderr, "sonic-render: failed to create '%s'\n", id.c_str());
+        return false;
+    }
+
+    size_t colon = stage.spec.find(':');
+    if (colon != std::string::npos) {
+        std::string params = stage.spec.substr(colon + 1);
+        size_t pos = 0;
+        while (pos < params.size()) {
+            size_t end = params.find(',', pos);
+            if (end == std::string::npos) end = params.size();
+            std::string assignment = params.substr(pos, end - pos);
+            size_t eq = assignment.find('=');
+            if (eq == std::string::npos) {
+                fprintf(stderr, "sonic-render: bad parameter '%s' (want index=value)\n", assignment.c_str());
+                return false;
+            }
+            plugin_set_parameter(stage.instance, atoi(assignment.c_str()), (float)atof(assignment.c_str() + eq + 1));
+            pos = end + 1;
+        }
+    }
+    plugin_set_worker_threads(stage.instance, threads);
+    // After the parameters, so stepped settings such as a sonicchain
+    // stage's modules are in place
+    if (plugin_prepare(stage.instance, sampleRate, block) != 0) {
+        fprintf(stderr, "sonic-render: failed to prepare '%s'\n", id.c_str());
+        return false;
+    }
+    stage.latency = plugin_get_latency(stage.instance);
+    return true;
+}
+
+// Creates every stage; the chain's total latency, or -1 on failure
+static int64_t createChain(std::vector<Stage>& stages, float sampleRate, size_t block, uint32_t threads) {
+    int64_t latency = 0;
+    for (Stage& stage : stages) {
+        if (!createStage(stage, sampleRate, block, threads)) return -1;
+        latency += stage.latency;
+    }
+    return latency;
+}
+
+static void destroyChain(std::vector<Stage>& stages) {
+    for (Stage& stage : stages) {
+        if (stage.instance) plugin_destroy(stage.instance);
+        stage.instance = nullptr;
+        stage.seconds = 0.0;
+    }
+}
+
+// Where one run of the chain sends its output
+struct Sink {
+    MappedFile* file = nullptr; // null: discarded
+    uint16_t channels = 2;
+    float gain = 1.0f;
+    void* meter = nullptr; // measures the output when set
+};
+
+// Runs the whole source through the chain once; wall-clock seconds
+static double renderPass(const Source& src, MappedFile& inFile, std::vector<Stage>& stages, uint32_t chainLatency,
+                         size_t block, const Sink& sink) {
+    // Two planar stereo buffers; each stage reads one and writes the other
+    std::vector<float> storage(4 * block);
+    float* bufs[2][2] = { { &storage[0], &storage[block] }, { &storage[2 * block], &storage[3 * block] } };
+    float* outSamples = sink.file ? (float*)(sink.file->data + kWavHeaderBytes) : nullptr;
+    const size_t inOffset = inFile.data ? (size_t)(src.samples - inFile.data) : 0;
+    const size_t inFrameBytes = (size_t)src.channels * (src.bits / 8);
+
+    // Run latency extra frames of silence through the chain and drop the
+    // first latency frames of output, so the file lines up with the input
+    size_t totalFrames = src.frames + chainLatency;
+    auto passStart = Clock::now();
+    for (size_t pos = 0; pos < totalFrames; pos += block) {
+        size_t n = std::min(block, totalFrames - pos);
+        readFrames(src, pos, n, bufs[0]);
+        inFile.releaseBefore(inOffset + std::min(pos + n, src.frames) * inFrameBytes);
+
+        int cur = 0;
+        for (Stage& stage : stages) {
+            auto start = Clock::now();
+            plugin_process(stage.instance, bufs[cur], bufs[cur ^ 1], n);
+            stage.seconds += secondsSince(start);
+            cur ^= 1;
+        }
+
+        size_t skip = pos < chainLatency ? std::min(n, chainLatency - pos) : 0;
+        if (skip == n) continue;
+        size_t outPos = pos + skip - chainLatency;
+        const float* l = bufs[cur][0] + skip;
+        const float* r = bufs[cur][1] + skip;
+        size_t count = n - skip;
+        if (sink.meter) {
+            const float* planes[2] = { l, r };
+            lufs_meter_push_planar(sink.meter, planes, count);
+        }
+        if (!outSamples) continue;
+        const float gain = sink.gain;
+        if (sink.channels == 2) {
+            float* dst = outSamples + outPos * 2;
+            for (size_t i = 0; i < count; i++, dst += 2) {
+                dst[0] = l[i] * gain;
+                dst[1] = r[i] * gain;
+            }
+        } else {
+            float* dst = outSamples + outPos;
+            for (size_t i = 0; i < count; i++) dst[i] = l[i] * gain;
+        }
+        sink.file->releaseBefore(kWavHeaderBytes + (outPos + count) * sink.channels * sizeof(float));
+    }
+    return secondsSince(passStart);
+}
+
+static void usage() {
+    fprintf(stderr,
+            "usage: sonic-render [--block N] [--threads N] [--normalize LUFS] <in.wav | noise:SECONDS> <out.wav | null> "
+            "[<plugin>[:<param>=<value>,...] ...]\n"
+            "       sonic-render --list\n");
+}
+
+int main(int argc, char** argv) {
+    size_t block = kDefaultBlock;
+    uint32_t threads = 1;
+    bool normalize = false;
+    float targetLufs = 0.0f;
+    int arg = 1;
+    if (arg < argc && strcmp(argv[arg], "--list") == 0) {
+        for (uint32_t i = 0; i < plugin_class_count(); i++) printf("%-24s %s\n", plugin_class_id(i), plugin_class_name(i));
+        return 0;
+    }
+    while (arg + 1 < argc && strncmp(argv[arg], "--", 2) == 0) {
+        if (strcmp(argv[arg], "--block") == 0) {
+            block = (size_t)strtoul(argv[arg + 1], nullptr, 10);
+        } else if (strcmp(argv[arg], "--threads") == 0) {
+            threads = (uint32_t)strtoul(argv[arg + 1], nullptr, 10);
+        } else if (strcmp(argv[arg], "--normalize") == 0) {
+            normalize = true;
+            targetLufs = (float)atof(argv[arg + 1]);
+        } else {
+            break;
+        }
+        arg += 2;
+    }
+    if (argc - arg < 2 || block == 0 || threads == 0) {
+        usage();
+        return 1;
+    }
+    const char* inPath = argv[arg];
+    const char* outPath = argv[arg + 1];
+
+    MappedFile inFile;
+    Source src;
+    if (strncmp(inPath, "noise:", 6) == 0) {
+        src.frames = (size_t)(atof(inPath + 6) * src.sampleRate);
+    } else {
+        std::string err;
+        if (!inFile.openRead(inPath)) {
+            fprintf(stderr, "sonic-render: cannot map %s\n", inPath);
+            return 1;
+        }
+        if (!parseWav(inFile.data, inFile.size, src, err)) {
+            fprintf(stderr, "sonic-render: %s: %s\n", inPath, err.c_str());
+            return 1;
+        }
+    }
+
+    std::vector<Stage> stages(argc - arg - 2);
+    for (size_t s = 0; s < stages.size(); s++) stages[s].spec = argv[arg + 2 + s];
+    int64_t latency = createChain(stages, (float)src.sampleRate, block, threads);
+    if (latency < 0) return 1;
+    const uint32_t chainLatency = (uint32_t)latency;
+    double audioSeconds = (double)src.frames / src.sampleRate;
+
+    MappedFile outFile;
+    Sink sink;
+    sink.channels = src.channels;
+    if (strcmp(outPath, "null") != 0) {
+        size_t bytes = kWavHeaderBytes + src.frames * sink.channels * sizeof(float);
+        if (!outFile.create(outPath, bytes)) {
+            fprintf(stderr, "sonic-render: cannot create %s\n", outPath);
+            return 1;
+        }
+        writeFloatWavHeader(outFile.data, sink.channels, src.sampleRate, src.frames);
+        sink.file = &outFile;
+    }
+
+    double measureSeconds = 0.0;
+    float measuredLufs = 0.0f;
+    bool measured = false;
+    if (normalize) {
+        Sink probe;
+        probe.channels = sink.channels;
+        probe.meter = lufs_meter_create(sink.channels, (float)src.sampleRate);
+        measureSeconds = renderPass(src, inFile, stages, chainLatency, block, probe);
+        measured = lufs_meter_integrated(probe.meter, &measuredLufs) == 0;
+        lufs_meter_destroy(probe.meter);
+        if (measured) sink.gain = powf(10.0f, (targetLufs - measuredLufs) / 20.0f);
+
+        // The second pass starts from fresh plugin state, as the first did.
+        // Measuring into null stops here.
+        if (sink.file) {
+            destroyChain(stages);
+            if (createChain(stages, (float)src.sampleRate, block, threads) < 0) return 1;
+            inFile.rewind();
+        }
+    }
+
+    double chainSeconds = 0.0;
+    if (!normalize || sink.file) chainSeconds = renderPass(src, inFile, stages, chainLatency, block, sink);
+
+    printf("input: %u Hz, %u ch, %.2f s; block %zu frames, %u threads\n", src.sampleRate, src.channels, audioSeconds, block,
+           threads);
+    if (normalize) {
+        if (measured) {
+            printf("measured %.2f LUFS, gain %+.2f dB to %.2f LUFS\n", measuredLufs, targetLufs - measuredLufs,
+                   targetLufs);
+        } else {
+            printf("nothing above the loudness gates; level left unchanged\n");
+        }
+    }
+    printf("%-32s %8s %10s %10s\n", "stage", "latency", "cpu s", "x-RT");
+    double pluginSeconds = 0.0;
+    for (const Stage& stage : stages) {
+        printf("%-32s %8u %10.3f %10.1f\n", stage.spec.c_str(), stage.latency, stage.seconds,
+               stage.seconds > 0 ? audioSeconds / stage.seconds : 0.0);
+        pluginSeconds += stage.seconds;
+    }
+    if (!stages.empty()) {
+        printf("%-32s %8u %10.3f %10.1f\n", "chain (plugins)", chainLatency, pluginSeconds,
+               pluginSeconds > 0 ? audioSeconds / pluginSeconds : 0.0);
+    }
+    if (normalize) {
+        printf("%-32s %8s %10.3f %10.1f\n", "measure pass (with file I/O)", "", measureSeconds,
+               measureSeconds > 0 ? audioSeconds / measureSeconds : 0.0);
+    }
+    if (chainSeconds > 0) {
+        printf("%-32s %8s %10.3f %10.1f\n", normalize ? "gain pass (with file I/O)" : "chain (with file I/O)", "",
+               chainSeconds, audioSeconds / chainSeconds);
+    }
+
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) == 0) printf("peak RSS: %.1f MB\n", (double)usage.ru_maxrss / 1024.0);
+
+    destroyChain(stages);
+    return 0;
+}
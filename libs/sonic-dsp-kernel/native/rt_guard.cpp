@@ -0,0 +1,102 @@
+// Allocation interposer backing rt_guard.h (Linux/glibc only).
+//
+// Linked into a test executable it replaces the process-wide allocator
+// directly; built as librt_guard.so it can be LD_PRELOADed into any host.
+
+#include "rt_guard.h"
+
+#include <atomic>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+extern "C" {
+    void* __libc_malloc(size_t size);
+    void* __libc_calloc(size_t count, size_t size);
+    void* __libc_realloc(void* ptr, size_t size);
+    void* __libc_memalign(size_t alignment, size_t size);
+    void __libc_free(void* ptr);
+}
+
+// initial-exec TLS never allocates on first access, which matters inside malloc
+static __thread int tDepth __attribute__((tls_model("initial-exec"))) = 0;
+static __thread int tReporting __attribute__((tls_model("initial-exec"))) = 0;
+static std::atomic<uint64_t> gViolations(0);
+static std::atomic<int> gAbort(1);
+
+static void writeErr(const char* s) {
+    ssize_t r = write(2, s, strlen(s));
+    (void)r;
+}
+
+extern "C" void sonic_rt_guard_enter() { tDepth++; }
+extern "C" void sonic_rt_guard_leave() { if (tDepth > 0) tDepth--; }
+extern "C" void sonic_rt_guard_set_abort(int enabled) { gAbort.store(enabled); }
+extern "C" uint64_t sonic_rt_guard_violations() { return gViolations.load(); }
+
+extern "C" void sonic_rt_guard_check(const char* what) {
+    if (tDepth <= 0 || tReporting) return;
+    tReporting = 1;
+    gViolations.fetch_add(1);
+    writeErr("sonic rt-guard: ");
+    writeErr(what);
+    writeErr(" called inside a real-time section\n");
+    tReporting = 0;
+    if (gAbort.load()) abort();
+}
+
+extern "C" {
+
+void* malloc(size_t size) {
+    sonic_rt_guard_check("malloc");
+    return __libc_malloc(size);
+}
+
+void* calloc(size_t count, size_t size) {
+    sonic_rt_guard_check("calloc");
+    return __libc_calloc(count, size);
+}
+
+void* realloc(void* ptr, size_t size) {
+    sonic_rt_guard_check("realloc");
+    return __libc_realloc(ptr, size);
+}
+
+void free(void* ptr) {
+    if (ptr) sonic_rt_guard_check("free");
+    __libc_free(ptr);
+}
+
+void* memalign(size_t alignment, size_t size) {
+    sonic_rt_guard_check("memalign");
+    return __libc_memalign(alignment, size);
+}
+
+void* aligned_alloc(size_t alignment, size_t size) {
+    sonic_rt_guard_check("aligned_alloc");
+    return __libc_memalign(alignment, size);
+}
+
+int posix_memalign(void** out, size_t alignment, size_t size) {
+    sonic_rt_guard_check("posix_memalign");
+    void* p = __libc_memalign(alignment, size);
+    if (!p) return ENOMEM;
+    *out = p;
+    return 0;
+}
+
+// Zig's page allocator maps memory directly when linked against libc
+void* mmap(void* addr, size_t length, int prot, int flags, int fd, off_t offset) {
+    sonic_rt_guard_check("mmap");
+    return (void*)syscall(SYS_mmap, addr, length, prot, flags, fd, offset);
+}
+
+int munmap(void* addr, size_t length) {
+    sonic_rt_guard_check("munmap");
+    return (int)syscall(SYS_munmap, addr, length);
+}
+
+}
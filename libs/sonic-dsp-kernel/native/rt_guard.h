@@ -0,0 +1,32 @@
+#pragma once
+
+// Debug "RT-safety" mode.
+//
+// Builds with -DSONIC_RT_GUARD (zig build -Drt-guard=true) mark every
+// Render/process call as a real-time section. When rt_guard.cpp is linked in
+// (tests) or preloaded (LD_PRELOAD=librt_guard.so <host>), any malloc/free,
+// mmap/munmap or Zig allocator call made inside such a section is reported
+// and, by default, aborts the process. Without the guard library the hooks
+// are weak and resolve to nothing, so an instrumented plugin still loads in a
+// normal host.
+
+#include <cstdint>
+
+extern "C" {
+    void sonic_rt_guard_enter() __attribute__((weak));
+    void sonic_rt_guard_leave() __attribute__((weak));
+    // Report an allocation-like call; no-op outside a real-time section.
+    void sonic_rt_guard_check(const char* what) __attribute__((weak));
+    // 0 = count and log only, 1 = abort on the first violation (default).
+    void sonic_rt_guard_set_abort(int enabled) __attribute__((weak));
+    uint64_t sonic_rt_guard_violations() __attribute__((weak));
+}
+
+struct RtGuardScope {
+#ifdef SONIC_RT_GUARD
+    RtGuardScope() { if (sonic_rt_guard_enter) sonic_rt_guard_enter(); }
+    ~RtGuardScope() { if (sonic_rt_guard_leave) sonic_rt_guard_leave(); }
+#else
+    RtGuardScope() {}
+#endif
+};
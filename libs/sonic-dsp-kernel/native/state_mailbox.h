@@ -0,0 +1,46 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+// Lock-free hand-off of state blobs from the thread calling setState to the
+// audio thread, newest first.
+//
+// Three buffers: the writer fills the one it holds, then swaps it for the
+// one in the middle slot with a "fresh" flag set; the reader swaps its own
+// buffer for the middle one whenever the flag is up. A blob posted before
+// the reader got to the previous one replaces it, so the audio thread
+// always applies the latest state and a writer never waits or fails. Only
+// the writer resizes buffers, so the reader never allocates. One writer
+// thread and one reader thread at a time.
+class StateMailbox {
+public:
+    // Writer side: the buffer to fill with the next blob
+    std::vector<uint8_t>& back() { return buffers[backIndex]; }
+
+    // Writer side: hands back() to the reader, replacing any blob it has
+    // not taken yet
+    void post() {
+        const uint32_t previous = middle.exchange(backIndex | kFresh, std::memory_order_acq_rel);
+        backIndex = previous & kIndexMask;
+    }
+
+    // Reader side: the latest posted blob, or nullptr if nothing was posted
+    // since the last take. Valid until the next take.
+    const std::vector<uint8_t>* take() {
+        if (!(middle.load(std::memory_order_relaxed) & kFresh)) return nullptr;
+        const uint32_t previous = middle.exchange(frontIndex, std::memory_order_acq_rel);
+        frontIndex = previous & kIndexMask;
+        return &buffers[frontIndex];
+    }
+
+private:
+    static const uint32_t kFresh = 4;
+    static const uint32_t kIndexMask = 3;
+
+    std::vector<uint8_t> buffers[3];
+    uint32_t backIndex = 0;
+    uint32_t frontIndex = 1;
+    std::atomic<uint32_t> middle{2};
+};
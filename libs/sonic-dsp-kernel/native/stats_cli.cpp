@@ -0,0 +1,242 @@
+// Reader for the wrappers' shared-memory profiling counters (profiler.h).
+//
+//   sonic-stats [--watch SECONDS] [--hist] [--budget PERCENT] [--clean] [PID ...]
+//
+// Attaches to the stats segments of running hosts and prints one row per
+// live plugin instance: DSP load as a share of real time, mean and 99th
+// percentile ticks per sample, the slowest block, blocks over budget, heap
+// allocations and denormal-hit blocks inside the kernel, and silent blocks
+// that skipped it. Ticks are TSC cycles on x86, the generic timer on ARM.
+// The timing figures (load, ticks, the slowest block, overruns, denormals)
+// come from the blocks the wrappers time, one in SONIC_PROFILE_EVERY (8 by
+// default); block and allocation counts are of every block.
+//
+// With no PID every segment under /dev/shm is read (Linux); elsewhere name
+// the host's PID. --watch reprints every few seconds with load and averages
+// over the interval instead of since the instance started. --hist adds each
+// instance's ticks-per-sample histogram. --budget changes the overrun
+// budget (percent of each block's duration) of every segment found, and
+// --clean removes segments left behind by processes that no longer exist.
+
+#include "stats_segment.h"
+
+#include <cerrno>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace sonic_stats;
+
+static const int kMaxSegmentsPerPid = 16;
+
+struct Attached {
+    std::string name;
+    Segment* segment;
+};
+
+// Plain copy of one slot's counters
+struct Sample {
+    uint32_t generation = 0;
+    uint64_t blocks = 0, frames = 0, timedFrames = 0, ticks = 0, maxBlockTicks = 0, overruns = 0;
+    uint64_t heapAllocs = 0, denormalBlocks = 0, skippedBlocks = 0;
+    uint64_t histogram[kHistogramBuckets] = {};
+};
+
+static bool processAlive(int pid) {
+    return kill(pid, 0) == 0 || errno == EPERM;
+}
+
+static Segment* mapSegment(const char* name, bool writable) {
+    int fd = shm_open(name, writable ? O_RDWR : O_RDONLY, 0);
+    if (fd < 0) return nullptr;
+    struct stat st;
+    void* mem = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && (size_t)st.st_size >= sizeof(Segment))
+        mem = mmap(nullptr, sizeof(Segment), writable ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mem == MAP_FAILED) return nullptr;
+    Segment* seg = (Segment*)mem;
+    if (seg->magic != kMagic || seg->version != kVersion) {
+        munmap(mem, sizeof(Segment));
+        return nullptr;
+    }
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return seg;
+}
+
+static void findNames(const std::vector<int>& pids, std::vector<std::string>& names) {
+    char name[64];
+    if (!pids.empty()) {
+        for (int pid : pids) {
+            for (int i = 0; i < kMaxSegmentsPerPid; i++) {
+                segmentName(name, sizeof(name), pid, i);
+                names.push_back(name);
+            }
+        }
+        return;
+    }
+    DIR* dir = opendir("/dev/shm");
+    if (!dir) return;
+    while (dirent* entry = readdir(dir)) {
+        if (strncmp(entry->d_name, "sonic-stats-", 12) == 0) names.push_back(std::string("/") + entry->d_name);
+    }
+    closedir(dir);
+}
+
+static Sample readSlot(const Slot& s) {
+    Sample out;
+    out.generation = s.generation.load(std::memory_order_relaxed);
+    out.blocks = s.blocks.load(std::memory_order_relaxed);
+    out.frames = s.frames.load(std::memory_order_relaxed);
+    out.timedFrames = s.timedFrames.load(std::memory_order_relaxed);
+    out.ticks = s.ticks.load(std::memory_order_relaxed);
+    out.maxBlockTicks = s.maxBlockTicks.load(std::memory_order_relaxed);
+    out.overruns = s.overruns.load(std::memory_order_relaxed);
+    out.heapAllocs = s.heapAllocs.load(std::memory_order_relaxed);
+    out.denormalBlocks = s.denormalBlocks.load(std::memory_order_relaxed);
+    out.skippedBlocks = s.skippedBlocks.load(std::memory_order_relaxed);
+    for (uint32_t b = 0; b < kHistogramBuckets; b++) out.histogram[b] = s.histogram[b].load(std::memory_order_relaxed);
+    return out;
+}
+
+// Counters accumulated between two samples of the same slot
+static Sample since(const Sample& now, const Sample& before) {
+    if (now.generation != before.generation) return now;
+    Sample d = now;
+    d.blocks -= before.blocks;
+    d.frames -= before.frames;
+    d.timedFrames -= before.timedFrames;
+    d.ticks -= before.ticks;
+    d.overruns -= before.overruns;
+    d.heapAllocs -= before.heapAllocs;
+    d.denormalBlocks -= before.denormalBlocks;
+    d.skippedBlocks -= before.skippedBlocks;
+    for (uint32_t b = 0; b < kHistogramBuckets; b++) d.histogram[b] -= before.histogram[b];
+    return d;
+}
+
+// Upper edge of the histogram bucket holding the given fraction of blocks
+static double percentile(const Sample& s, double fraction) {
+    uint64_t total = 0;
+    for (uint64_t h : s.histogram) total += h;
+    if (total == 0) return 0.0;
+    uint64_t target = (uint64_t)std::ceil(fraction * (double)total);
+    uint64_t seen = 0;
+    for (uint32_t b = 0; b < kHistogramBuckets; b++) {
+        seen += s.histogram[b];
+        if (seen >= target) return std::ldexp(1.0, (int)b + 1);
+    }
+    return std::ldexp(1.0, (int)kHistogramBuckets);
+}
+
+static void printHeader() {
+    printf("%-7s %-4s %-20s %10s %7s %9s %9s %9s %8s %7s %7s %8s\n", "PID", "SLOT", "CLASS", "BLOCKS", "LOAD%",
+           "AVG t/smp", "P99 t/smp", "MAX us", "OVERRUN", "ALLOCS", "DENORM", "SKIPPED");
+}
+
+static void printRow(const Segment& seg, uint32_t index, const Slot& slot, const Sample& s, bool hist) {
+    const double tps = seg.ticksPerSecond > 0.0 ? seg.ticksPerSecond : 1e9;
+    // Ticks only cover the timed blocks, so they are set against those
+    // blocks' frames
+    const double audioSeconds = slot.sampleRate > 0.0f ? (double)s.timedFrames / slot.sampleRate : 0.0;
+    const double load = audioSeconds > 0.0 ? 100.0 * ((double)s.ticks / tps) / audioSeconds : 0.0;
+    const double avg = s.timedFrames ? (double)s.ticks / (double)s.timedFrames : 0.0;
+    char denorm[24];
+    if (seg.capabilities & kCapDenormals) snprintf(denorm, sizeof(denorm), "%llu", (unsigned long long)s.denormalBlocks);
+    else snprintf(denorm, sizeof(denorm), "n/a");
+
+    printf("%-7d %-4u %-20.20s %10llu %7.2f %9.1f %9.0f %9.1f %8llu %7llu %7s %8llu\n", seg.pid, index, slot.classId,
+           (unsigned long long)s.blocks, load, avg, percentile(s, 0.99), 1e6 * (double)s.maxBlockTicks / tps,
+           (unsigned long long)s.overruns, (unsigned long long)s.heapAllocs, denorm,
+           (unsigned long long)s.skippedBlocks);
+
+    if (!hist) return;
+    uint64_t peak = 0;
+    for (uint64_t h : s.histogram) peak = h > peak ? h : peak;
+    for (uint32_t b = 0; b < kHistogramBuckets; b++) {
+        if (!s.histogram[b]) continue;
+        int bar = (int)(40.0 * (double)s.histogram[b] / (double)peak + 0.5);
+        printf("        %10.0f-%-10.0f %10llu %.*s\n", std::ldexp(1.0, (int)b), std::ldexp(1.0, (int)b + 1),
+               (unsigned long long)s.histogram[b], bar, "########################################");
+    }
+}
+
+static void usage() {
+    fprintf(stderr, "usage: sonic-stats [--watch SECONDS] [--hist] [--budget PERCENT] [--clean] [PID ...]\n");
+}
+
+int main(int argc, char** argv) {
+    double watch = 0.0;
+    bool hist = false;
+    bool clean = false;
+    int budget = 0;
+    std::vector<int> pids;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--watch") == 0 && i + 1 < argc) watch = atof(argv[++i]);
+        else if (strcmp(argv[i], "--budget") == 0 && i + 1 < argc) budget = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--hist") == 0) hist = true;
+        else if (strcmp(argv[i], "--clean") == 0) clean = true;
+        else if (argv[i][0] != '-' && atoi(argv[i]) > 0) pids.push_back(atoi(argv[i]));
+        else {
+            usage();
+            return 1;
+        }
+    }
+
+    std::vector<std::string> names;
+    findNames(pids, names);
+    std::vector<Attached> segments;
+    for (const std::string& name : names) {
+        Segment* seg = mapSegment(name.c_str(), budget > 0);
+        if (!seg) continue;
+        if (!processAlive(seg->pid)) {
+            munmap(seg, sizeof(Segment));
+            if (clean && shm_unlink(name.c_str()) == 0) printf("removed stale %s\n", name.c_str());
+            continue;
+        }
+        segments.push_back({ name, seg });
+    }
+    if (segments.empty()) {
+        if (clean) return 0;
+        fprintf(stderr, "sonic-stats: no live stats segments found\n");
+        return 1;
+    }
+    if (budget > 0) {
+        for (Attached& a : segments) a.segment->budgetPercent.store((uint32_t)budget, std::memory_order_relaxed);
+        printf("overrun budget set to %d%% of block duration\n", budget);
+    }
+
+    std::vector<std::vector<Sample>> previous(segments.size(), std::vector<Sample>(kMaxSlots));
+    for (size_t i = 0; i < segments.size(); i++) {
+        for (uint32_t k = 0; k < kMaxSlots; k++) previous[i][k] = readSlot(segments[i].segment->slots[k]);
+    }
+
+    do {
+        if (watch > 0.0) usleep((useconds_t)(watch * 1e6));
+        printHeader();
+        for (size_t i = 0; i < segments.size(); i++) {
+            const Segment& seg = *segments[i].segment;
+            for (uint32_t k = 0; k < seg.slotCount && k < kMaxSlots; k++) {
+                const Slot& slot = seg.slots[k];
+                if (slot.state.load(std::memory_order_acquire) != kSlotLive) continue;
+                Sample now = readSlot(slot);
+                printRow(seg, k, slot, watch > 0.0 ? since(now, previous[i][k]) : now, hist);
+                previous[i][k] = now;
+            }
+        }
+        if (watch > 0.0) printf("\n");
+        fflush(stdout);
+    } while (watch > 0.0);
+
+    for (Attached& a : segments) munmap(a.segment, sizeof(Segment));
+    return 0;
+}
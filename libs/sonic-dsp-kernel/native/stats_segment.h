@@ -0,0 +1,81 @@
+#pragma once
+
+// Layout of the shared-memory statistics segment written by profiler.h and
+// read by the sonic-stats tool (native/stats_cli.cpp).
+//
+// Each loaded plugin binary creates one segment per process, named
+// /sonic-stats-<pid>-<n>, holding a fixed table of instance slots. A slot
+// has exactly one writer, the audio thread of the instance that claimed it,
+// which updates every counter with plain relaxed stores; readers take relaxed
+// loads and may see one block's update half applied, never a torn value.
+// Nothing is locked on either side.
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+
+namespace sonic_stats {
+
+static const uint32_t kMagic = 0x534e5354; // "SNST"
+static const uint32_t kVersion = 2;
+static const uint32_t kMaxSlots = 256;
+// Bucket b counts blocks that took [2^b, 2^(b+1)) ticks per sample
+static const uint32_t kHistogramBuckets = 32;
+static const uint32_t kClassIdSize = 32;
+// Blocks slower than this share of their own duration count as overruns
+static const uint32_t kDefaultBudgetPercent = 50;
+// One block in this many is timed (see profiler.h)
+static const uint32_t kDefaultTimeEvery = 8;
+
+// Segment capability bits
+static const uint32_t kCapDenormals = 1u << 0;
+
+enum SlotState : uint32_t {
+    kSlotFree = 0,
+    kSlotClaimed = 1, // being filled in, not yet readable
+    kSlotLive = 2,
+};
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "stats counters must be lock-free in shared memory");
+
+struct alignas(64) Slot {
+    std::atomic<uint32_t> state;
+    // Bumped every time the slot is claimed, so a reader can tell a reused slot apart
+    std::atomic<uint32_t> generation;
+    char classId[kClassIdSize];
+    float sampleRate;
+    int32_t maxBlock;
+    // One block in timeEvery is timed; the timing counters cover those only
+    uint32_t timeEvery;
+
+    std::atomic<uint64_t> blocks;
+    std::atomic<uint64_t> frames;
+    std::atomic<uint64_t> timedFrames;    // frames of the timed blocks
+    std::atomic<uint64_t> ticks;          // ticks inside the kernel over the timed blocks
+    std::atomic<uint64_t> maxBlockTicks;
+    std::atomic<uint64_t> lastBlockTicks;
+    std::atomic<uint64_t> overruns;       // timed blocks over budget
+    std::atomic<uint64_t> heapAllocs;     // kernel allocations the instance arena couldn't hold
+    std::atomic<uint64_t> denormalBlocks; // timed blocks that touched a denormal operand
+    std::atomic<uint64_t> skippedBlocks;  // silent blocks the kernel never saw
+    std::atomic<uint64_t> histogram[kHistogramBuckets]; // timed blocks
+};
+
+struct Segment {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t slotCount;
+    uint32_t capabilities;
+    int32_t pid;
+    uint32_t reserved;
+    double ticksPerSecond;
+    // Writable by readers: sonic-stats --budget changes it under a running host
+    std::atomic<uint32_t> budgetPercent;
+    Slot slots[kMaxSlots];
+};
+
+inline void segmentName(char* out, size_t size, int pid, int index) {
+    snprintf(out, size, "/sonic-stats-%d-%d", pid, index);
+}
+
+} // namespace sonic_stats
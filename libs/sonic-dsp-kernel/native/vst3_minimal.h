@@ -46,6 +46,17 @@ namespace Steinberg {
 
     typedef int32 tresult;
 
+    // Byte stream the host hands to getState/setState
+    class IBStream : public FUnknown {
+    public:
+        enum IStreamSeekMode { kIBSeekSet = 0, kIBSeekCur, kIBSeekEnd };
+        virtual tresult SMTG_STDCALL read(void* buffer, int32 numBytes, int32* numBytesRead = nullptr) = 0;
+        virtual tresult SMTG_STDCALL write(void* buffer, int32 numBytes, int32* numBytesWritten = nullptr) = 0;
+        virtual tresult SMTG_STDCALL seek(int64 pos, int32 mode, int64* result = nullptr) = 0;
+        virtual tresult SMTG_STDCALL tell(int64* pos) = 0;
+        static const TUID iid;
+    };
+
     namespace Vst {
         typedef int32 ParamID;
         typedef double ParamValue;
@@ -75,6 +86,59 @@ namespace Steinberg {
             uint64 arrangement;
         };
 
+        // Speaker bits and the arrangements built from them, as in the SDK's
+        // vstspeaker.h. An arrangement's channel count is its number of bits.
+        enum Speakers : uint64 {
+            kSpeakerL = 1ull << 0,
+            kSpeakerR = 1ull << 1,
+            kSpeakerC = 1ull << 2,
+            kSpeakerLfe = 1ull << 3,
+            kSpeakerLs = 1ull << 4,
+            kSpeakerRs = 1ull << 5,
+            kSpeakerSl = 1ull << 9,
+            kSpeakerSr = 1ull << 10,
+            kSpeakerTfl = 1ull << 12,
+            kSpeakerTfr = 1ull << 14,
+            kSpeakerTrl = 1ull << 15,
+            kSpeakerTrr = 1ull << 17,
+            kSpeakerM = 1ull << 19,
+        };
+
+        namespace SpeakerArr {
+            const uint64 kEmpty = 0;
+            const uint64 kMono = kSpeakerM;
+            const uint64 kStereo = kSpeakerL | kSpeakerR;
+            const uint64 k51 = kSpeakerL | kSpeakerR | kSpeakerC | kSpeakerLfe | kSpeakerLs | kSpeakerRs;
+            const uint64 k71Music = k51 | kSpeakerSl | kSpeakerSr;
+            const uint64 k71_4 = k71Music | kSpeakerTfl | kSpeakerTfr | kSpeakerTrl | kSpeakerTrr;
+
+            inline int32 getChannelCount(uint64 arr) {
+                int32 count = 0;
+                for (; arr; arr &= arr - 1) count++;
+                return count;
+            }
+        }
+
+        typedef char16 String128[128];
+
+        struct BusInfo {
+            TMediaType mediaType;
+            TBusDirection direction;
+            int32 channelCount;
+            String128 name;
+            TBusType busType;
+            uint32 flags;
+            enum BusFlags {
+                kDefaultActive = 1 << 0,
+            };
+        };
+
+        enum ProcessModes {
+            kRealtime = 0,
+            kPrefetch,
+            kOffline
+        };
+
         struct ProcessSetup {
             int32 processMode;
             int32 symbolicSampleSize;
@@ -117,6 +181,13 @@ namespace Steinberg {
             ParamValue max;
             int32 unitId;
             int32 flags;
+
+            enum ParameterFlags {
+                kNoFlags = 0,
+                kCanAutomate = 1 << 0,
+                kIsReadOnly = 1 << 1,
+                kIsList = 1 << 3,
+            };
         };
 
         class IParamValueQueue : public FUnknown {
@@ -136,6 +207,24 @@ namespace Steinberg {
             static const TUID iid;
         };
 
+        enum RestartFlags {
+            kReloadComponent = 1 << 0,
+            kIoChanged = 1 << 1,
+            kParamValuesChanged = 1 << 2,
+            kLatencyChanged = 1 << 3,
+            kParamTitlesChanged = 1 << 4,
+        };
+
+        // Host side of the edit controller, passed to setComponentHandler
+        class IComponentHandler : public FUnknown {
+        public:
+            virtual tresult SMTG_STDCALL beginEdit(ParamID id) = 0;
+            virtual tresult SMTG_STDCALL performEdit(ParamID id, ParamValue valueNormalized) = 0;
+            virtual tresult SMTG_STDCALL endEdit(ParamID id) = 0;
+            virtual tresult SMTG_STDCALL restartComponent(int32 flags) = 0;
+            static const TUID iid;
+        };
+
         class IEditController : public FUnknown {
         public:
             virtual tresult SMTG_STDCALL setComponentState(void* state) = 0;
@@ -160,7 +249,7 @@ namespace Steinberg {
             virtual tresult SMTG_STDCALL getControllerClassId(TUID classId) = 0;
             virtual tresult SMTG_STDCALL setIoMode(TIoMediaType level) = 0;
             virtual tresult SMTG_STDCALL getBusCount(TMediaType type, TBusDirection dir) = 0;
-            virtual tresult SMTG_STDCALL getBusInfo(TMediaType type, TBusDirection dir, int32 index, void* busInfo) = 0; // BusInfo struct omitted
+            virtual tresult SMTG_STDCALL getBusInfo(TMediaType type, TBusDirection dir, int32 index, void* busInfo) = 0; // BusInfo*
             virtual tresult SMTG_STDCALL getRoutingInfo(void* inInfo, void* outInfo) = 0;
             virtual tresult SMTG_STDCALL activateBus(TMediaType type, TBusDirection dir, int32 index, bool state) = 0;
             virtual tresult SMTG_STDCALL setActive(bool state) = 0;
@@ -184,6 +273,21 @@ namespace Steinberg {
         };
     }
 
+    struct PFactoryInfo {
+        char8 vendor[64];
+        char8 url[256];
+        char8 email[128];
+        int32 flags;
+    };
+
+    struct PClassInfo {
+        enum { kManyInstances = 0x7FFFFFFF };
+        TUID cid;
+        int32 cardinality;
+        char8 category[32];
+        char8 name[64];
+    };
+
     class IPluginFactory : public FUnknown {
     public:
         virtual tresult SMTG_STDCALL getFactoryInfo(void* info) = 0;
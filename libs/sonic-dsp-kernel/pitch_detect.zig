@@ -1,6 +1,17 @@
 const std = @import("std");
+const math = @import("math_utils.zig");
+
+pub const Estimate = struct {
+    /// Hz, or 0 when no period was found
+    freq: f32,
+    /// Cumulative mean normalized difference at the chosen period
+    aperiodicity: f32,
+};
 
 pub const Yin = struct {
+    /// Normalized difference below which a lag counts as a period
+    pub const threshold: f32 = 0.15;
+
     pub fn detect(allocator: std.mem.Allocator, input: []const f32, sample_rate: f32, min_freq: f32, max_freq: f32) !f32 {
         const n = input.len;
         const min_period = @as(usize, @intFromFloat(sample_rate / max_freq));
@@ -31,27 +42,34 @@ pub const Yin = struct {
             full_diff_buf[tau] = sum;
         }
 
+        return pick(full_diff_buf, min_period, max_period, sample_rate).freq;
+    }
+
+    /// Steps 2-4 on a difference function d[0..max_period+2], overwritten
+    /// with its cumulative mean normalized form. freq is 0 when nothing
+    /// fits; aperiodicity is the normalized difference at the chosen lag,
+    /// below `threshold` when the frame has a clear period.
+    pub fn pick(diff: []f32, min_period: usize, max_period: usize, sample_rate: f32) Estimate {
         // 2. Cumulative Mean Normalized Difference
-        full_diff_buf[0] = 1;
+        diff[0] = 1;
         var running_sum: f32 = 0;
-        tau = 1;
+        var tau: usize = 1;
         while (tau <= max_period) : (tau += 1) {
-            running_sum += full_diff_buf[tau];
+            running_sum += diff[tau];
             if (running_sum == 0) {
-                 full_diff_buf[tau] = 1;
+                 diff[tau] = 1;
             } else {
-                 full_diff_buf[tau] *= @as(f32, @floatFromInt(tau)) / running_sum;
+                 diff[tau] *= @as(f32, @floatFromInt(tau)) / running_sum;
             }
         }
 
         // 3. Absolute Threshold
         var best_tau: usize = 0;
-        const threshold: f32 = 0.15;
 
         tau = min_period;
         while (tau < max_period) : (tau += 1) {
-            if (full_diff_buf[tau] < threshold) {
-                while (tau + 1 < max_period and full_diff_buf[tau + 1] < full_diff_buf[tau]) {
+            if (diff[tau] < threshold) {
+                while (tau + 1 < max_period and diff[tau + 1] < diff[tau]) {
                     tau += 1;
                 }
                 best_tau = tau;
@@ -63,22 +81,22 @@ pub const Yin = struct {
              var min_val: f32 = 1000.0;
              tau = min_period;
              while (tau <= max_period) : (tau += 1) {
-                 if (full_diff_buf[tau] < min_val) {
-                     min_val = full_diff_buf[tau];
+                 if (diff[tau] < min_val) {
+                     min_val = diff[tau];
                      best_tau = tau;
                  }
              }
         }
 
-        if (best_tau == 0) return 0.0;
+        if (best_tau == 0) return .{ .freq = 0, .aperiodicity = 1 };
 
         // 4. Parabolic Interpolation
         var refined_tau = @as(f32, @floatFromInt(best_tau));
 
         if (best_tau > 0 and best_tau < max_period) {
-            const s0 = full_diff_buf[best_tau - 1];
-            const s1 = full_diff_buf[best_tau];
-            const s2 = full_diff_buf[best_tau + 1];
+            const s0 = diff[best_tau - 1];
+            const s1 = diff[best_tau];
+            const s2 = diff[best_tau + 1];
 
             if (2.0 * s1 - s2 - s0 != 0) {
                 const adjustment = (s2 - s0) / (2.0 * (2.0 * s1 - s2 - s0));
@@ -86,6 +104,168 @@ pub const Yin = struct {
             }
         }
 
-        return sample_rate / refined_tau;
+        return .{ .freq = sample_rate / refined_tau, .aperiodicity = diff[best_tau] };
+    }
+};
+
+/// YIN over a stream, with the difference function computed from an FFT
+/// autocorrelation instead of Yin.detect's lag-by-lag sums.
+///
+/// For a frame of `size` samples and w = size / 2,
+///   d(tau) = sum_{j<w} (x[j] - x[j+tau])^2 = e(0) + e(tau) - 2 r(tau)
+/// where e(tau) is the energy of x[tau..tau+w], slid along one sample per
+/// lag, and r(tau) = sum_{j<w} x[j] x[j+tau] comes from the spectra of the
+/// frame and of its zero-padded first half. j + tau stays below size for
+/// every lag searched, so the circular correlation of a size-point
+/// transform is exact and needs no further padding. That is three real
+/// FFTs per frame instead of w * max_period multiply-adds; steps 2-4 are
+/// Yin.pick, shared with the reference.
+///
+/// push() collects samples in a FIFO and analyses the last `size` of them
+/// every `hop`, keeping the overlap, so a host can hand over blocks of any
+/// size. analyse() runs one frame on its own. All buffers are allocated in
+/// init; neither allocates.
+pub const YinTracker = struct {
+    pub const Config = struct {
+        /// Frame length, a power of two
+        size: usize = 2048,
+        hop: usize = 1024,
+        sample_rate: f32,
+        /// Search range; the longest period must be under size / 2
+        min_freq: f32,
+        max_freq: f32,
+    };
+
+    size: usize,
+    hop: usize,
+    sample_rate: f32,
+    min_period: usize,
+    max_period: usize,
+    plan: math.RealFftPlan,
+    /// The last `fill` samples pushed, oldest first
+    fifo: []f32,
+    fill: usize,
+    /// size: the frame's first half, zero-padded, then the correlation
+    scratch: []f32,
+    frame_bins: []math.Complex,
+    half_bins: []math.Complex,
+    /// max_period + 2
+    diff: []f32,
+    /// Result of the last frame analysed
+    latest: Estimate,
+
+    pub fn init(allocator: std.mem.Allocator, config: Config) !YinTracker {
+        const size = config.size;
+        if (config.hop == 0 or config.hop > size) return error.InvalidHop;
+        var self = YinTracker{
+            .size = size,
+            .hop = config.hop,
+            .sample_rate = config.sample_rate,
+            .min_period = 0,
+            .max_period = 0,
+            .plan = undefined,
+            .fifo = &.{},
+            .fill = 0,
+            .scratch = &.{},
+            .frame_bins = &.{},
+            .half_bins = &.{},
+            .diff = &.{},
+            .latest = .{ .freq = 0, .aperiodicity = 1 },
+        };
+        try self.setRange(config.min_freq, config.max_freq);
+
+        self.plan = try math.RealFftPlan.init(allocator, size);
+        errdefer self.plan.deinit(allocator);
+        self.fifo = try allocator.alloc(f32, size);
+        errdefer allocator.free(self.fifo);
+        self.scratch = try allocator.alloc(f32, size);
+        errdefer allocator.free(self.scratch);
+        self.frame_bins = try allocator.alloc(math.Complex, size / 2 + 1);
+        errdefer allocator.free(self.frame_bins);
+        self.half_bins = try allocator.alloc(math.Complex, size / 2 + 1);
+        errdefer allocator.free(self.half_bins);
+        // Any range setRange accepts later fits
+        self.diff = try allocator.alloc(f32, size / 2 + 1);
+        return self;
+    }
+
+    pub fn deinit(self: *YinTracker, allocator: std.mem.Allocator) void {
+        self.plan.deinit(allocator);
+        allocator.free(self.fifo);
+        allocator.free(self.scratch);
+        allocator.free(self.frame_bins);
+        allocator.free(self.half_bins);
+        allocator.free(self.diff);
+    }
+
+    /// Changes the search range without reallocating.
+    pub fn setRange(self: *YinTracker, min_freq: f32, max_freq: f32) !void {
+        if (!(min_freq > 0) or !(max_freq >= min_freq)) return error.InvalidRange;
+        const longest = self.sample_rate / min_freq;
+        if (!(longest < @as(f32, @floatFromInt(self.size / 2)))) return error.InvalidRange;
+        self.min_period = @max(@as(usize, @intFromFloat(self.sample_rate / max_freq)), 1);
+        self.max_period = @intFromFloat(longest);
+    }
+
+    /// Forgets the samples pushed so far.
+    pub fn reset(self: *YinTracker) void {
+        self.fill = 0;
+        self.latest = .{ .freq = 0, .aperiodicity = 1 };
+    }
+
+    /// Samples push() takes before the next frame is complete.
+    pub fn pending(self: *const YinTracker) usize {
+        return self.size - self.fill;
+    }
+
+    /// Appends up to pending() samples and returns how many were taken.
+    /// When that completes a frame it is analysed into `latest` and the
+    /// FIFO moves on by one hop.
+    pub fn push(self: *YinTracker, samples: []const f32) usize {
+        const n = @min(samples.len, self.pending());
+        @memcpy(self.fifo[self.fill..][0..n], samples[0..n]);
+        self.fill += n;
+        if (self.fill == self.size) {
+            self.latest = self.analyse(self.fifo);
+            std.mem.copyForwards(f32, self.fifo[0 .. self.size - self.hop], self.fifo[self.hop..]);
+            self.fill = self.size - self.hop;
+        }
+        return n;
+    }
+
+    /// Pitch of one frame of exactly `size` samples.
+    pub fn analyse(self: *YinTracker, frame: []const f32) Estimate {
+        const w = self.size / 2;
+        std.debug.assert(frame.len == self.size);
+
+        // r(tau): inverse transform of conj(H) * X, H the first half alone
+        @memcpy(self.scratch[0..w], frame[0..w]);
+        @memset(self.scratch[w..], 0);
+        self.plan.forward(self.scratch, self.half_bins);
+        self.plan.forward(frame, self.frame_bins);
+        for (self.half_bins, self.frame_bins) |*h, x| {
+            const re = h.re * x.re + h.im * x.im;
+            const im = h.re * x.im - h.im * x.re;
+            h.* = .{ .re = re, .im = im };
+        }
+        self.plan.inverse(self.half_bins, self.scratch);
+
+        // e(tau) slid along in f64, so the running sum doesn't drift
+        var e0: f64 = 0;
+        for (frame[0..w]) |s| e0 += square(s);
+        var e = e0;
+        const diff = self.diff[0 .. self.max_period + 2];
+        diff[0] = 0;
+        for (1..self.max_period + 1) |tau| {
+            e += square(frame[tau + w - 1]) - square(frame[tau - 1]);
+            const d = e0 + e - 2.0 * @as(f64, self.scratch[tau]);
+            diff[tau] = @floatCast(@max(d, 0));
+        }
+        return Yin.pick(diff, self.min_period, self.max_period, self.sample_rate);
+    }
+
+    fn square(x: f32) f64 {
+        const wide: f64 = x;
+        return wide * wide;
     }
 };
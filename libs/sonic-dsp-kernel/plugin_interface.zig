@@ -2,12 +2,25 @@ const std = @import("std");
 
 pub const PluginInterface = struct {
     /// Create a new instance of the plugin
+    /// The allocator is the instance's own arena (instance_arena.zig): it is
+    /// sized by a trial create at the same sample rate, so create must
+    /// allocate the same way every time it is called with a given rate.
     create: *const fn (allocator: std.mem.Allocator, sample_rate: f32) ?*anyopaque,
     
+    /// Reconfigure an existing instance for a new sample rate and maximum
+    /// block size. Recomputes rate-dependent coefficients in place and keeps
+    /// learned state (noise profiles, references, envelopes). Never called
+    /// concurrently with process. Returns false if the instance could not be
+    /// resized; it is left usable at its previous configuration.
+    /// Optional: plugins with no rate-dependent state may omit it.
+    prepare: *const fn (instance: *anyopaque, allocator: std.mem.Allocator, sample_rate: f32, max_block: usize) bool,
+
     /// Process a block of audio
     /// inputs: array of input channel pointers
     /// outputs: array of output channel pointers
     /// frames: number of samples per channel
+    /// Called on the audio thread: must not allocate or block. Inputs and
+    /// outputs never alias; the native wrappers copy in-place host buffers.
     process: *const fn (instance: *anyopaque, inputs: [*]const [*]const f32, outputs: [*][*]f32, frames: usize) void,
     
     /// Update a parameter
@@ -15,7 +28,96 @@ pub const PluginInterface = struct {
     
     /// Get a parameter value
     get_parameter: *const fn (instance: *anyopaque, index: i32) f32,
+
+    /// Samples by which output lags input, reported to the host for delay
+    /// compensation. Must stay the same from prepare to prepare unless the
+    /// host is told (wrappers read it when processing starts).
+    /// Optional: defaults to 0.
+    latency: *const fn (instance: *anyopaque) u32,
+
+    /// Samples of output that can follow silent input, after latency
+    /// (reverb decay, spectral smearing). Optional: defaults to 0.
+    tail: *const fn (instance: *anyopaque) u32,
+
+    /// Whether internal state has died away, for plugins whose output can
+    /// come back after a quiet gap (a feedback delay between echoes). The
+    /// kernel only asks once input and output have both been silent for
+    /// latency + tail samples. Optional: defaults to true, which is right
+    /// for anything whose output cannot outlast that.
+    decayed: *const fn (instance: *anyopaque) bool,
     
+    /// Number of channels process() will be given from now on, between 1
+    /// and max_channels. Never called concurrently with process. Plugins
+    /// that keep per-channel state should clear it.
+    /// Optional: plugins without it are stereo-only, and the kernel feeds a
+    /// mono bus to them as two copies of the one channel.
+    set_channels: *const fn (instance: *anyopaque, channels: u32) void,
+
+    /// Threads process() may use from now on, the caller's included, for
+    /// offline rendering where blocks are large and nobody waits on them;
+    /// 1 for the calling thread only. Never called concurrently with
+    /// process, and followed by prepare before the next block, so the
+    /// plugin can start workers here and size buffers there. Output must
+    /// not depend on the thread count.
+    /// Optional: plugins without it always run single-threaded.
+    set_threads: *const fn (instance: *anyopaque, threads: u32) void,
+
+    /// Widest bus process() handles (plugin_impl.max_channels, default 2).
+    max_channels: u32,
+
+    /// Index of the parameter that picks the oversampling factor
+    /// (plugin_impl.oversampling_param), or -1. Moving it changes latency,
+    /// so wrappers present it as a stepped, non-automatable setting and
+    /// tell the host to re-read latency when it changes.
+    oversampling_param: i32,
+
+    /// Parameters the wrappers expose (plugin_impl.param_count, default the
+    /// generic 16, at most 256). Also the count plugin_save_state stores.
+    param_count: u32,
+
+    /// For a parameter choosing between discrete settings that may change
+    /// latency or need allocating (a chain slot's module), how many steps
+    /// above 0 it has; 0 for a continuous one. Wrappers present such a
+    /// parameter as a non-automatable list and re-prepare after it moves,
+    /// so the plugin may defer the change to prepare. The oversampling
+    /// parameter doesn't need listing here. Optional: defaults to 0.
+    param_steps: *const fn (index: i32) u32,
+
+    /// param_steps for parameters whose steps depend on the instance's
+    /// settings (a chain slot's parameter follows the module selected into
+    /// the slot), 0 for the rest. May be called from a UI thread while
+    /// process runs. Optional: defaults to 0.
+    instance_param_steps: *const fn (instance: *anyopaque, index: i32) u32,
+
+    /// Bytes of learned state that parameters can't recreate (noise
+    /// profiles, reference spectra), saved after the parameters by
+    /// plugin_save_state. Must only depend on how the instance was
+    /// created, so a saved blob either fits a new instance exactly or is
+    /// refused. Optional, together with save_state and load_state:
+    /// defaults to 0, for plugins whose parameters are their whole state.
+    state_size: *const fn (instance: *anyopaque) usize,
+
+    /// Write exactly state_size bytes of learned state, little-endian
+    /// (dsp/state.zig).
+    save_state: *const fn (instance: *anyopaque, out: []u8) void,
+
+    /// Restore what save_state wrote; data is exactly state_size bytes.
+    /// Runs after the saved parameters have been set, and may run on the
+    /// audio thread between blocks, so it must not allocate.
+    load_state: *const fn (instance: *anyopaque, data: []const u8) void,
+
+    /// Kernel instances this one drives through the C ABI (a chain's
+    /// slots, null where empty), so plugin_snapshot can take their state
+    /// along with its own. Only changes in prepare.
+    /// Optional: defaults to none.
+    nested: *const fn (instance: *anyopaque) []const ?*anyopaque,
+
+    /// Deepest gain reduction in dB that the last process call applied,
+    /// for the wrappers' meters. Read on the audio thread right after
+    /// process. Optional: defaults to 0, for anything that isn't a
+    /// dynamics processor.
+    gain_reduction: *const fn (instance: *anyopaque) f32,
+
     /// Destroy the instance
     destroy: *const fn (instance: *anyopaque, allocator: std.mem.Allocator) void,
 };
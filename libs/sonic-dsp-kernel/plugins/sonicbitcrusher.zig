@@ -1,10 +1,13 @@
 const std = @import("std");
 const creative = @import("../modules/creative.zig");
+const oversample = @import("../dsp/oversample.zig");
 
 pub const BitcrusherPlugin = struct {
     bits: f32 = 16,
     norm_freq: f32 = 1.0,
     mix: f32 = 1.0,
+    crusher: creative.Bitcrusher = .{},
+    oversampler: oversample.Oversampler(2) = .{},
 
     pub fn init(allocator: std.mem.Allocator, sample_rate: f32) !*BitcrusherPlugin {
         _ = sample_rate;
@@ -18,30 +21,14 @@ pub const BitcrusherPlugin = struct {
     }
 
     pub fn process(self: *BitcrusherPlugin, inputs: [*]const [*]const f32, outputs: [*][*]f32, frames: usize) void {
-        const in_l = inputs[0][0..frames];
-        const in_r = inputs[1][0..frames];
-        const out_l = outputs[0][0..frames];
-        const out_r = outputs[1][0..frames];
+        self.oversampler.process(inputs, outputs, frames, self, shape);
+    }
 
-        var interleaved: [1024]f32 = undefined;
-        const total_samples = frames * 2;
-        
-        if (total_samples <= interleaved.len) {
-            for (0..frames) |i| {
-                interleaved[i * 2] = in_l[i];
-                interleaved[i * 2 + 1] = in_r[i];
-            }
-            
-            creative.processBitcrusher(interleaved[0..total_samples], self.bits, self.norm_freq, self.mix);
-            
-            for (0..frames) |i| {
-                out_l[i] = interleaved[i * 2];
-                out_r[i] = interleaved[i * 2 + 1];
-            }
-        } else {
-            @memcpy(out_l, in_l);
-            @memcpy(out_r, in_r);
-        }
+    fn shape(self: *BitcrusherPlugin, channels: [2][]f32) void {
+        // Same hold rate in Hz whatever the factor; only the quantiser's
+        // edges gain the headroom
+        const norm_freq = self.norm_freq / @as(f32, @floatFromInt(self.oversampler.factor()));
+        self.crusher.processPlanar(channels[0], channels[1], self.bits, norm_freq, self.mix);
     }
 
     pub fn setParameter(self: *BitcrusherPlugin, index: i32, value: f32) void {
@@ -49,6 +36,7 @@ pub const BitcrusherPlugin = struct {
             0 => self.bits = 1.0 + (value * 15.0),
             1 => self.norm_freq = 0.01 + (value * 0.99),
             2 => self.mix = value,
+            3 => self.oversampler.setFactor(oversample.factorFromParameter(value)),
             else => {},
         }
     }
@@ -58,6 +46,7 @@ pub const BitcrusherPlugin = struct {
             0 => (self.bits - 1.0) / 15.0,
             1 => (self.norm_freq - 0.01) / 0.99,
             2 => self.mix,
+            3 => oversample.parameterFromFactor(self.oversampler.factor()),
             else => 0.0,
         };
     }
@@ -91,10 +80,24 @@ fn impl_get_parameter(ptr: *anyopaque, index: i32) f32 {
     return self.getParameter(index);
 }
 
+fn impl_latency(ptr: *anyopaque) u32 {
+    const self = @as(*BitcrusherPlugin, @ptrCast(@alignCast(ptr)));
+    return self.oversampler.latency();
+}
+
+// The decimation filters ring for about as long as they delay
+fn impl_tail(ptr: *anyopaque) u32 {
+    const self = @as(*BitcrusherPlugin, @ptrCast(@alignCast(ptr)));
+    return self.oversampler.latency();
+}
+
 pub const plugin_impl = struct {
     pub const create = impl_create;
     pub const destroy = impl_destroy;
     pub const process = impl_process;
     pub const set_parameter = impl_set_parameter;
     pub const get_parameter = impl_get_parameter;
+    pub const latency = impl_latency;
+    pub const tail = impl_tail;
+    pub const oversampling_param = 3;
 };
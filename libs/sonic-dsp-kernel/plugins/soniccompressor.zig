@@ -1,62 +1,34 @@
 const std = @import("std");
 const dynamics = @import("../modules/dynamics.zig");
+const shared = @import("../dsp/shared.zig");
 
 pub const CompressorPlugin = struct {
     comp: dynamics.Compressor,
+    channels: usize,
 
     pub fn init(allocator: std.mem.Allocator, sample_rate: f32) !*CompressorPlugin {
         const self = try allocator.create(CompressorPlugin);
         self.comp = dynamics.Compressor{ .sample_rate = sample_rate };
+        self.channels = 2;
         return self;
     }
 
+    pub fn prepare(self: *CompressorPlugin, sample_rate: f32) void {
+        self.comp.sample_rate = sample_rate;
+    }
+
     pub fn deinit(self: *CompressorPlugin, allocator: std.mem.Allocator) void {
         allocator.destroy(self);
     }
 
     pub fn process(self: *CompressorPlugin, inputs: [*]const [*]const f32, outputs: [*][*]f32, frames: usize) void {
-        const in_l = inputs[0][0..frames];
-        const in_r = inputs[1][0..frames];
-        const out_l = outputs[0][0..frames];
-        const out_r = outputs[1][0..frames];
-
-        // We need an interleaved or flat buffer for dynamics.zig's current process(data: []f32)
-        // because it assumes [L, R, L, R]. 
-        // We have separate pointers. 
-        // Let's create a temporary interleaved buffer or update the Zig module to handle split buffers.
-        // Updating the module is better for performance, but for now let's use an interleaved temp if we must.
-        // Wait, dynamics.zig's process is:
-        /*
-        while (i < data.len - 1) : (i += 2) {
-            const l = data[i];
-            const r = data[i+1];
-            ...
-        }
-        */
-        // Let's create a stack-allocated buffer for the block if frames is small (usually 64-256), 
-        // otherwise heap.
-        
-        var interleaved: [1024]f32 = undefined;
-        const total_samples = frames * 2;
-        
-        if (total_samples <= interleaved.len) {
-            for (0..frames) |i| {
-                interleaved[i * 2] = in_l[i];
-                interleaved[i * 2 + 1] = in_r[i];
-            }
-            
-            self.comp.process(interleaved[0..total_samples]);
-            
-            for (0..frames) |i| {
-                out_l[i] = interleaved[i * 2];
-                out_r[i] = interleaved[i * 2 + 1];
-            }
-        } else {
-            // Fallback for large blocks (unlikely in DAW but possible)
-            // Just process mono on L for now to avoid heap churn every block
-            @memcpy(out_l, in_l);
-            @memcpy(out_r, in_r);
-        }
+        self.comp.processChannels(inputs, outputs, self.channels, frames);
+    }
+
+    /// Bus width from the host; restarts the detector.
+    pub fn setChannels(self: *CompressorPlugin, channels: usize) void {
+        self.channels = channels;
+        self.comp.reset();
     }
 
     pub fn setParameter(self: *CompressorPlugin, index: i32, value: f32) void {
@@ -101,11 +73,29 @@ fn impl_destroy(ptr: *anyopaque, allocator: std.mem.Allocator) void {
     self.deinit(allocator);
 }
 
+fn impl_prepare(ptr: *anyopaque, allocator: std.mem.Allocator, sample_rate: f32, max_block: usize) bool {
+    _ = allocator;
+    _ = max_block;
+    const self = @as(*CompressorPlugin, @ptrCast(@alignCast(ptr)));
+    self.prepare(sample_rate);
+    return true;
+}
+
 fn impl_process(ptr: *anyopaque, inputs: [*]const [*]const f32, outputs: [*][*]f32, frames: usize) void {
     const self = @as(*CompressorPlugin, @ptrCast(@alignCast(ptr)));
     self.process(inputs, outputs, frames);
 }
 
+fn impl_set_channels(ptr: *anyopaque, channels: u32) void {
+    const self = @as(*CompressorPlugin, @ptrCast(@alignCast(ptr)));
+    self.setChannels(channels);
+}
+
+fn impl_gain_reduction(ptr: *anyopaque) f32 {
+    const self = @as(*CompressorPlugin, @ptrCast(@alignCast(ptr)));
+    return self.comp.gain_reduction;
+}
+
 fn impl_set_parameter(ptr: *anyopaque, index: i32, value: f32) void {
     const self = @as(*CompressorPlugin, @ptrCast(@alignCast(ptr)));
     self.setParameter(index, value);
@@ -119,7 +109,11 @@ fn impl_get_parameter(ptr: *anyopaque, index: i32) f32 {
 pub const plugin_impl = struct {
     pub const create = impl_create;
     pub const destroy = impl_destroy;
+    pub const prepare = impl_prepare;
     pub const process = impl_process;
     pub const set_parameter = impl_set_parameter;
     pub const get_parameter = impl_get_parameter;
+    pub const set_channels = impl_set_channels;
+    pub const gain_reduction = impl_gain_reduction;
+    pub const max_channels = shared.max_channels;
 };
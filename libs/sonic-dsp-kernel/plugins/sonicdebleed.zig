@@ -1,22 +1,37 @@
 const std = @import("std");
 const dsp = @import("../debleed.zig");
+const math = @import("../math_utils.zig");
+const StreamingStft = @import("../dsp/stft.zig").StreamingStft;
 
 pub const DeBleedPlugin = struct {
     sensitivity: f32,
     threshold: f32,
     sample_rate: f32,
     allocator: std.mem.Allocator,
+    stft: StreamingStft,
+
+    const WINDOW_SIZE = 2048;
+    const HOP_SIZE = 1024;
 
     pub fn init(allocator: std.mem.Allocator, sample_rate: f32) !*DeBleedPlugin {
         const self = try allocator.create(DeBleedPlugin);
+        errdefer allocator.destroy(self);
         self.sensitivity = 0.5;
         self.threshold = -20.0; // dB
         self.sample_rate = sample_rate;
         self.allocator = allocator;
+        // Channel 0 is the target, channel 1 the bleed source (analysis only)
+        self.stft = try StreamingStft.init(allocator, .{ .size = WINDOW_SIZE, .hop = HOP_SIZE, .channels = 2, .outputs = 1 });
         return self;
     }
 
+    pub fn prepare(self: *DeBleedPlugin, allocator: std.mem.Allocator, sample_rate: f32, max_block: usize) !void {
+        try self.stft.prepare(allocator, max_block);
+        self.sample_rate = sample_rate;
+    }
+
     pub fn deinit(self: *DeBleedPlugin, allocator: std.mem.Allocator) void {
+        self.stft.deinit(allocator);
         allocator.destroy(self);
     }
 
@@ -30,59 +45,36 @@ pub const DeBleedPlugin = struct {
         // Output R -> Processed (Dual Mono)
         
         const in_target = inputs[0][0..frames];
-        // Check if we have a second channel
-        // Since we are inside unsafe pointer land, we assume stereo if the host promised it.
-        // But if mono, this might crash. 
-        // For safety, strictly we should check bus count from C++ side, but we don't have it here.
         // We'll assume the host provides at least 2 channels if we advertise stereo.
-        
-        // However, checking inputs[1] might be valid if pointer array is large enough.
         const in_source = inputs[1][0..frames];
         
         const out_l = outputs[0][0..frames];
         const out_r = outputs[1][0..frames];
 
-        // Copy Inputs to Outputs first (so we can process in-place on Output buffer if needed, 
-        // but debleed.zig takes separate target/source slices)
-        
-        // Actually dsp.process takes (allocator, target, source, sens, thresh)
-        // It modifies 'target' in place.
-        // It reads 'source'.
-        
-        // So we copy Input L to Output L
-        @memcpy(out_l, in_target);
-        
-        // We need a mutable copy of source? No, source is const in standard DSP?
-        // dsp.process signature: (..., source: []f32, ...)
-        // It expects a slice. `in_source` is a slice of const f32?
-        // `inputs` is `[*]const [*]const f32`. So `in_source` is `[]const f32`.
-        // `dsp.process` expects `[]f32` (mutable) for source?
-        // Let's check debleed.zig again.
-        // `pub fn process(..., source: []f32, ...)`
-        // It might modify source locally (FFT buffer)?
-        // Yes, `math.fft_iterative` modifies buffer in place.
-        // So we MUST copy source to a mutable buffer.
-        
-        // We can use Output R as the temp buffer for Source!
-        @memcpy(out_r, in_source);
-        
-        // Now call process
-        // target = out_l
-        // source = out_r
-        // This will modify out_l (result) and out_r (destroyed by FFT).
-        
-        // We need to handle the error from dsp.process (it returns !void)
-        dsp.process(self.allocator, out_l, out_r, self.sensitivity, self.threshold) catch |err| {
-            // Handle allocation failure or other errors
-            // Just silence output?
-            @memset(out_l, 0);
-        };
-        
-        // Output R is now garbage (FFT of source).
-        // We should copy the result (Out L) to Out R to make it Dual Mono output.
+        self.stft.processIndependent(&.{ in_target, in_source }, &.{out_l}, frames, self, processFrame);
         @memcpy(out_r, out_l);
     }
 
+    /// Reads nothing but the frame and the parameters, so frames can run
+    /// on worker threads in any order.
+    fn processFrame(self: *DeBleedPlugin, stft: *StreamingStft) void {
+        const rms_target = dsp.frameRms(stft.frameInput(0));
+        const rms_source = dsp.frameRms(stft.frameInput(1));
+        dsp.subtractBleed(stft.spectrum(0), stft.spectrum(1), rms_target, rms_source, self.sensitivity, math.dbToLinear(self.threshold));
+    }
+
+    pub fn setThreads(self: *DeBleedPlugin, threads: u32) void {
+        self.stft.setThreads(threads);
+    }
+
+    pub fn latency(self: *const DeBleedPlugin) u32 {
+        return @intCast(self.stft.latency());
+    }
+
+    pub fn tail(self: *const DeBleedPlugin) u32 {
+        return @intCast(self.stft.tail());
+    }
+
     pub fn setParameter(self: *DeBleedPlugin, index: i32, value: f32) void {
         if (index == 0) {
             self.sensitivity = value;
@@ -112,11 +104,32 @@ fn impl_destroy(ptr: *anyopaque, allocator: std.mem.Allocator) void {
     self.deinit(allocator);
 }
 
+fn impl_prepare(ptr: *anyopaque, allocator: std.mem.Allocator, sample_rate: f32, max_block: usize) bool {
+    const self = @as(*DeBleedPlugin, @ptrCast(@alignCast(ptr)));
+    self.prepare(allocator, sample_rate, max_block) catch return false;
+    return true;
+}
+
 fn impl_process(ptr: *anyopaque, inputs: [*]const [*]const f32, outputs: [*][*]f32, frames: usize) void {
     const self = @as(*DeBleedPlugin, @ptrCast(@alignCast(ptr)));
     self.process(inputs, outputs, frames);
 }
 
+fn impl_set_threads(ptr: *anyopaque, threads: u32) void {
+    const self = @as(*DeBleedPlugin, @ptrCast(@alignCast(ptr)));
+    self.setThreads(threads);
+}
+
+fn impl_latency(ptr: *anyopaque) u32 {
+    const self = @as(*DeBleedPlugin, @ptrCast(@alignCast(ptr)));
+    return self.latency();
+}
+
+fn impl_tail(ptr: *anyopaque) u32 {
+    const self = @as(*DeBleedPlugin, @ptrCast(@alignCast(ptr)));
+    return self.tail();
+}
+
 fn impl_set_parameter(ptr: *anyopaque, index: i32, value: f32) void {
     const self = @as(*DeBleedPlugin, @ptrCast(@alignCast(ptr)));
     self.setParameter(index, value);
@@ -130,7 +143,11 @@ fn impl_get_parameter(ptr: *anyopaque, index: i32) f32 {
 pub const plugin_impl = struct {
     pub const create = impl_create;
     pub const destroy = impl_destroy;
+    pub const prepare = impl_prepare;
     pub const process = impl_process;
     pub const set_parameter = impl_set_parameter;
     pub const get_parameter = impl_get_parameter;
+    pub const latency = impl_latency;
+    pub const tail = impl_tail;
+    pub const set_threads = impl_set_threads;
 };
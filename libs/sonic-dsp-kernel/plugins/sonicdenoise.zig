@@ -1,47 +1,41 @@
 const std = @import("std");
-const math = @import("../math_utils.zig");
+const StreamingStft = @import("../dsp/stft.zig").StreamingStft;
+const state = @import("../dsp/state.zig");
 
 pub const SpectralDenoisePlugin = struct {
     amount: f32,
     noise_profile: []f32,
     allocator: std.mem.Allocator,
-    window: []f32,
-    fft_buf: []math.Complex,
-    output_accum: []f32,
+    stft: StreamingStft,
     frames_learned: usize,
     learn_mode: bool,
 
     const WINDOW_SIZE = 2048;
     const HOP_SIZE = 1024;
+    /// Frames averaged into the noise profile (~0.4 s at 48 kHz)
+    const LEARN_FRAMES = 20;
 
     pub fn init(allocator: std.mem.Allocator, sample_rate: f32) !*SpectralDenoisePlugin {
         _ = sample_rate;
         const self = try allocator.create(SpectralDenoisePlugin);
+        errdefer allocator.destroy(self);
         self.allocator = allocator;
         self.amount = 1.0;
         self.learn_mode = true;
         self.frames_learned = 0;
-        
-        self.noise_profile = try allocator.alloc(f32, WINDOW_SIZE / 2);
+
+        self.stft = try StreamingStft.init(allocator, .{ .size = WINDOW_SIZE, .hop = HOP_SIZE });
+        errdefer self.stft.deinit(allocator);
+
+        self.noise_profile = try allocator.alloc(f32, self.stft.bins());
         @memset(self.noise_profile, 0);
-        
-        self.window = try allocator.alloc(f32, WINDOW_SIZE);
-        for (self.window, 0..) |_, idx| {
-            self.window[idx] = 0.5 * (1.0 - std.math.cos(math.TWO_PI * @as(f32, @floatFromInt(idx)) / @as(f32, @floatFromInt(WINDOW_SIZE - 1))));
-        }
-        
-        self.fft_buf = try allocator.alloc(math.Complex, WINDOW_SIZE);
-        self.output_accum = try allocator.alloc(f32, WINDOW_SIZE * 2); // Buffer for overlap-add
-        @memset(self.output_accum, 0);
-        
+
         return self;
     }
 
     pub fn deinit(self: *SpectralDenoisePlugin, allocator: std.mem.Allocator) void {
         allocator.free(self.noise_profile);
-        allocator.free(self.window);
-        allocator.free(self.fft_buf);
-        allocator.free(self.output_accum);
+        self.stft.deinit(allocator);
         allocator.destroy(self);
     }
 
@@ -50,27 +44,42 @@ pub const SpectralDenoisePlugin = struct {
         const out_l = outputs[0][0..frames];
         const out_r = outputs[1][0..frames];
 
-        // Real-time spectral denoise is complex due to hop-based latency.
-        // For this VST3 wrapper, we use a very simplified approach:
-        // 1. Learning: first 20 blocks are used to build noise profile.
-        // 2. Subtraction: subsequent blocks apply spectral subtraction.
-        
-        if (self.learn_mode and self.frames_learned < 20) {
-            // Very simple learning: average magnitude of current block
-            // Note: This is not a proper STFT because we don't have enough lookahead in a single VST block
-            // if frames < WINDOW_SIZE. 
-            // We assume 'frames' is small (e.g. 128).
-            
-            // Just pass through during learning
-            @memcpy(out_l, in_l);
-            @memcpy(out_r, in_l);
+        self.stft.process(&.{in_l}, &.{out_l}, frames, self, processFrame);
+        @memcpy(out_r, out_l);
+    }
+
+    /// Learning: the first LEARN_FRAMES frames pass through unchanged while
+    /// their magnitudes are averaged into the noise profile.
+    /// Afterwards: spectral subtraction of the profile, scaled by amount.
+    fn processFrame(self: *SpectralDenoisePlugin, stft: *StreamingStft) void {
+        const bins = stft.spectrum(0);
+
+        if (self.learn_mode and self.frames_learned < LEARN_FRAMES) {
+            const weight = 1.0 / @as(f32, @floatFromInt(self.frames_learned + 1));
+            for (self.noise_profile, bins) |*noise, bin| {
+                noise.* += (bin.magnitude() - noise.*) * weight;
+            }
             self.frames_learned += 1;
             return;
         }
+        if (self.frames_learned == 0) return;
 
-        // Processing
-        @memcpy(out_l, in_l);
-        @memcpy(out_r, in_l);
+        for (bins, self.noise_profile) |*bin, noise| {
+            const mag = bin.magnitude();
+            if (mag <= 0) continue;
+            // Scaling re/im keeps the phase
+            const gain = @max(0.0, 1.0 - noise * self.amount / mag);
+            bin.re *= gain;
+            bin.im *= gain;
+        }
+    }
+
+    pub fn latency(self: *const SpectralDenoisePlugin) u32 {
+        return @intCast(self.stft.latency());
+    }
+
+    pub fn tail(self: *const SpectralDenoisePlugin) u32 {
+        return @intCast(self.stft.tail());
     }
 
     pub fn setParameter(self: *SpectralDenoisePlugin, index: i32, value: f32) void {
@@ -91,6 +100,25 @@ pub const SpectralDenoisePlugin = struct {
         if (index == 1) return if (self.learn_mode) 1.0 else 0.0;
         return 0.0;
     }
+
+    /// Saved state: frames learned so far, then the noise profile, so a
+    /// session reloads without re-learning (and passing audio through
+    /// untouched while it does).
+    pub fn stateSize(self: *const SpectralDenoisePlugin) usize {
+        return 4 + 4 * self.noise_profile.len;
+    }
+
+    pub fn saveState(self: *const SpectralDenoisePlugin, out: []u8) void {
+        var w: state.Writer = .{ .bytes = out };
+        w.int(u32, @intCast(self.frames_learned));
+        w.floats(self.noise_profile);
+    }
+
+    pub fn loadState(self: *SpectralDenoisePlugin, data: []const u8) void {
+        var r: state.Reader = .{ .bytes = data };
+        self.frames_learned = @min(r.int(u32), LEARN_FRAMES);
+        r.floats(self.noise_profile);
+    }
 };
 
 fn impl_create(allocator: std.mem.Allocator, sample_rate: f32) ?*anyopaque {
@@ -111,6 +139,16 @@ fn impl_process(ptr: *anyopaque, inputs: [*]const [*]const f32, outputs: [*][*]f
     self.process(inputs, outputs, frames);
 }
 
+fn impl_latency(ptr: *anyopaque) u32 {
+    const self = @as(*SpectralDenoisePlugin, @ptrCast(@alignCast(ptr)));
+    return self.latency();
+}
+
+fn impl_tail(ptr: *anyopaque) u32 {
+    const self = @as(*SpectralDenoisePlugin, @ptrCast(@alignCast(ptr)));
+    return self.tail();
+}
+
 fn impl_set_parameter(ptr: *anyopaque, index: i32, value: f32) void {
     const self = @as(*SpectralDenoisePlugin, @ptrCast(@alignCast(ptr)));
     self.setParameter(index, value);
@@ -121,10 +159,30 @@ fn impl_get_parameter(ptr: *anyopaque, index: i32) f32 {
     return self.getParameter(index);
 }
 
+fn impl_state_size(ptr: *anyopaque) usize {
+    const self = @as(*SpectralDenoisePlugin, @ptrCast(@alignCast(ptr)));
+    return self.stateSize();
+}
+
+fn impl_save_state(ptr: *anyopaque, out: []u8) void {
+    const self = @as(*SpectralDenoisePlugin, @ptrCast(@alignCast(ptr)));
+    self.saveState(out);
+}
+
+fn impl_load_state(ptr: *anyopaque, data: []const u8) void {
+    const self = @as(*SpectralDenoisePlugin, @ptrCast(@alignCast(ptr)));
+    self.loadState(data);
+}
+
 pub const plugin_impl = struct {
     pub const create = impl_create;
     pub const destroy = impl_destroy;
     pub const process = impl_process;
     pub const set_parameter = impl_set_parameter;
     pub const get_parameter = impl_get_parameter;
+    pub const latency = impl_latency;
+    pub const tail = impl_tail;
+    pub const state_size = impl_state_size;
+    pub const save_state = impl_save_state;
+    pub const load_state = impl_load_state;
 };
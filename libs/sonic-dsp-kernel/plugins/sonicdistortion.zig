@@ -1,11 +1,13 @@
 const std = @import("std");
 const creative = @import("../modules/creative.zig");
+const oversample = @import("../dsp/oversample.zig");
 
 pub const DistortionPlugin = struct {
     drive: f32 = 0.5,
     dist_type: i32 = 0,
     out_gain: f32 = 0,
     mix: f32 = 1.0,
+    oversampler: oversample.Oversampler(2) = .{},
 
     pub fn init(allocator: std.mem.Allocator, sample_rate: f32) !*DistortionPlugin {
         _ = sample_rate;
@@ -19,16 +21,13 @@ pub const DistortionPlugin = struct {
     }
 
     pub fn process(self: *DistortionPlugin, inputs: [*]const [*]const f32, outputs: [*][*]f32, frames: usize) void {
-        const in_l = inputs[0][0..frames];
-        const in_r = inputs[1][0..frames];
-        const out_l = outputs[0][0..frames];
-        const out_r = outputs[1][0..frames];
-
-        @memcpy(out_l, in_l);
-        @memcpy(out_r, in_r);
+        self.oversampler.process(inputs, outputs, frames, self, shape);
+    }
 
-        creative.processDistortion(out_l, self.drive, self.dist_type, self.out_gain, self.mix);
-        creative.processDistortion(out_r, self.drive, self.dist_type, self.out_gain, self.mix);
+    fn shape(self: *DistortionPlugin, channels: [2][]f32) void {
+        for (channels) |data| {
+            creative.processDistortion(data, self.drive, self.dist_type, self.out_gain, self.mix);
+        }
     }
 
     pub fn setParameter(self: *DistortionPlugin, index: i32, value: f32) void {
@@ -37,6 +36,7 @@ pub const DistortionPlugin = struct {
             1 => self.dist_type = @intFromFloat(value * 2.0), // 0, 1, 2
             2 => self.out_gain = (value * 40.0) - 20.0, // +/- 20dB
             3 => self.mix = value,
+            4 => self.oversampler.setFactor(oversample.factorFromParameter(value)),
             else => {},
         }
     }
@@ -47,6 +47,7 @@ pub const DistortionPlugin = struct {
             1 => @as(f32, @floatFromInt(self.dist_type)) / 2.0,
             2 => (self.out_gain + 20.0) / 40.0,
             3 => self.mix,
+            4 => oversample.parameterFromFactor(self.oversampler.factor()),
             else => 0.0,
         };
     }
@@ -80,10 +81,24 @@ fn impl_get_parameter(ptr: *anyopaque, index: i32) f32 {
     return self.getParameter(index);
 }
 
+fn impl_latency(ptr: *anyopaque) u32 {
+    const self = @as(*DistortionPlugin, @ptrCast(@alignCast(ptr)));
+    return self.oversampler.latency();
+}
+
+// The decimation filters ring for about as long as they delay
+fn impl_tail(ptr: *anyopaque) u32 {
+    const self = @as(*DistortionPlugin, @ptrCast(@alignCast(ptr)));
+    return self.oversampler.latency();
+}
+
 pub const plugin_impl = struct {
     pub const create = impl_create;
     pub const destroy = impl_destroy;
     pub const process = impl_process;
     pub const set_parameter = impl_set_parameter;
     pub const get_parameter = impl_get_parameter;
+    pub const latency = impl_latency;
+    pub const tail = impl_tail;
+    pub const oversampling_param = 4;
 };
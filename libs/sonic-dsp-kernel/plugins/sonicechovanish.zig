@@ -1,36 +1,91 @@
 const std = @import("std");
 const dsp = @import("../echovanish.zig");
+const StreamingStft = @import("../dsp/stft.zig").StreamingStft;
 
 pub const EchoVanishPlugin = struct {
     reduction: f32,
     tail_ms: f32,
     sample_rate: f32,
+    stft: StreamingStft,
+    wpe: dsp.OnlineWpe,
+
+    const WINDOW_SIZE = 2048;
+    const HOP_SIZE = 1024;
 
     pub fn init(allocator: std.mem.Allocator, sample_rate: f32) !*EchoVanishPlugin {
         const self = try allocator.create(EchoVanishPlugin);
+        errdefer allocator.destroy(self);
         self.reduction = 0.5;
         self.tail_ms = 150.0;
         self.sample_rate = sample_rate;
+        self.stft = try StreamingStft.init(allocator, .{ .size = WINDOW_SIZE, .hop = HOP_SIZE });
+        errdefer self.stft.deinit(allocator);
+        self.wpe = try dsp.OnlineWpe.init(allocator, self.stft.bins());
         return self;
     }
 
+    pub fn prepare(self: *EchoVanishPlugin, allocator: std.mem.Allocator, sample_rate: f32, max_block: usize) !void {
+        try self.stft.prepare(allocator, max_block);
+        self.sample_rate = sample_rate;
+    }
+
     pub fn deinit(self: *EchoVanishPlugin, allocator: std.mem.Allocator) void {
+        self.wpe.deinit(allocator);
+        self.stft.deinit(allocator);
         allocator.destroy(self);
     }
 
     pub fn process(self: *EchoVanishPlugin, inputs: [*]const [*]const f32, outputs: [*][*]f32, frames: usize) void {
-        const in_l = inputs[0];
-        const out_l = outputs[0];
-        const out_r = outputs[1];
-
-        // Copy input to output (in-place processing)
-        @memcpy(out_l[0..frames], in_l[0..frames]);
+        const in_l = inputs[0][0..frames];
+        const out_l = outputs[0][0..frames];
+        const out_r = outputs[1][0..frames];
 
         // Process (Mono for now)
-        dsp.process_echovanish(out_l, frames, self.sample_rate, self.reduction, self.tail_ms);
+        self.stft.processBatches(&.{in_l}, &.{out_l}, frames, self, processFrames);
 
         // Copy to Right channel
-        @memcpy(out_r[0..frames], out_l[0..frames]);
+        @memcpy(out_r, out_l);
+    }
+
+    /// Bins per dereverb job: about 130 KB of filter state at the highest
+    /// order, which stays in one core's L2
+    const range_bins = 64;
+
+    const RangeJob = struct {
+        plugin: *EchoVanishPlugin,
+        frames: []StreamingStft,
+    };
+
+    /// Each bin's prediction depends only on that bin, so a batch is split
+    /// by bin range rather than by frame: every job runs all of the batch's
+    /// frames, in order, over its own bins.
+    fn processFrames(self: *EchoVanishPlugin, stft: *StreamingStft, frames: []StreamingStft) void {
+        const hop_seconds = @as(f32, @floatFromInt(stft.hop)) / self.sample_rate;
+        self.wpe.setOrder(dsp.OnlineWpe.orderFor(hop_seconds, self.tail_ms));
+        const job = RangeJob{ .plugin = self, .frames = frames };
+        stft.parallelFor(std.math.divCeil(usize, stft.bins(), range_bins) catch unreachable, job, processRange);
+        self.wpe.advance(frames.len);
+    }
+
+    fn processRange(job: RangeJob, range: usize) void {
+        const self = job.plugin;
+        const lo = range * range_bins;
+        const hi = @min(lo + range_bins, self.wpe.power.len);
+        for (job.frames, 0..) |*frame, ahead| {
+            self.wpe.processBins(frame.spectrum(0), lo, hi, ahead, self.reduction);
+        }
+    }
+
+    pub fn setThreads(self: *EchoVanishPlugin, threads: u32) void {
+        self.stft.setThreads(threads);
+    }
+
+    pub fn latency(self: *const EchoVanishPlugin) u32 {
+        return @intCast(self.stft.latency());
+    }
+
+    pub fn tail(self: *const EchoVanishPlugin) u32 {
+        return @intCast(self.stft.tail());
     }
 
     pub fn setParameter(self: *EchoVanishPlugin, index: i32, value: f32) void {
@@ -65,11 +120,32 @@ fn impl_destroy(ptr: *anyopaque, allocator: std.mem.Allocator) void {
     self.deinit(allocator);
 }
 
+fn impl_prepare(ptr: *anyopaque, allocator: std.mem.Allocator, sample_rate: f32, max_block: usize) bool {
+    const self = @as(*EchoVanishPlugin, @ptrCast(@alignCast(ptr)));
+    self.prepare(allocator, sample_rate, max_block) catch return false;
+    return true;
+}
+
 fn impl_process(ptr: *anyopaque, inputs: [*]const [*]const f32, outputs: [*][*]f32, frames: usize) void {
     const self = @as(*EchoVanishPlugin, @ptrCast(@alignCast(ptr)));
     self.process(inputs, outputs, frames);
 }
 
+fn impl_set_threads(ptr: *anyopaque, threads: u32) void {
+    const self = @as(*EchoVanishPlugin, @ptrCast(@alignCast(ptr)));
+    self.setThreads(threads);
+}
+
+fn impl_latency(ptr: *anyopaque) u32 {
+    const self = @as(*EchoVanishPlugin, @ptrCast(@alignCast(ptr)));
+    return self.latency();
+}
+
+fn impl_tail(ptr: *anyopaque) u32 {
+    const self = @as(*EchoVanishPlugin, @ptrCast(@alignCast(ptr)));
+    return self.tail();
+}
+
 fn impl_set_parameter(ptr: *anyopaque, index: i32, value: f32) void {
     const self = @as(*EchoVanishPlugin, @ptrCast(@alignCast(ptr)));
     self.setParameter(index, value);
@@ -83,7 +159,11 @@ fn impl_get_parameter(ptr: *anyopaque, index: i32) f32 {
 pub const plugin_impl = struct {
     pub const create = impl_create;
     pub const destroy = impl_destroy;
+    pub const prepare = impl_prepare;
     pub const process = impl_process;
     pub const set_parameter = impl_set_parameter;
     pub const get_parameter = impl_get_parameter;
+    pub const latency = impl_latency;
+    pub const tail = impl_tail;
+    pub const set_threads = impl_set_threads;
 };
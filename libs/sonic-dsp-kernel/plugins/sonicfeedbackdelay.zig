@@ -1,5 +1,6 @@
 const std = @import("std");
 const time = @import("../modules/time.zig");
+const shared = @import("../dsp/shared.zig");
 
 pub const FeedbackDelayPlugin = struct {
     delay: time.FeedbackDelay,
@@ -10,35 +11,28 @@ pub const FeedbackDelayPlugin = struct {
         return self;
     }
 
+    pub fn prepare(self: *FeedbackDelayPlugin, sample_rate: f32) void {
+        self.delay.sample_rate = sample_rate;
+    }
+
     pub fn deinit(self: *FeedbackDelayPlugin, allocator: std.mem.Allocator) void {
         allocator.destroy(self);
     }
 
     pub fn process(self: *FeedbackDelayPlugin, inputs: [*]const [*]const f32, outputs: [*][*]f32, frames: usize) void {
-        const in_l = inputs[0][0..frames];
-        const in_r = inputs[1][0..frames];
-        const out_l = outputs[0][0..frames];
-        const out_r = outputs[1][0..frames];
-
-        var interleaved: [1024]f32 = undefined;
-        const total_samples = frames * 2;
-        
-        if (total_samples <= interleaved.len) {
-            for (0..frames) |i| {
-                interleaved[i * 2] = in_l[i];
-                interleaved[i * 2 + 1] = in_r[i];
-            }
-            
-            self.delay.process(interleaved[0..total_samples]);
-            
-            for (0..frames) |i| {
-                out_l[i] = interleaved[i * 2];
-                out_r[i] = interleaved[i * 2 + 1];
-            }
-        } else {
-            @memcpy(out_l, in_l);
-            @memcpy(out_r, in_r);
-        }
+        shared.processInterleavedStereo(self, processChunk, inputs, outputs, frames);
+    }
+
+    fn processChunk(self: *FeedbackDelayPlugin, data: []f32) void {
+        self.delay.process(data);
+    }
+
+    pub fn tail(self: *const FeedbackDelayPlugin) u32 {
+        return self.delay.tailSamples();
+    }
+
+    pub fn decayed(self: *const FeedbackDelayPlugin) bool {
+        return self.delay.decayed();
     }
 
     pub fn setParameter(self: *FeedbackDelayPlugin, index: i32, value: f32) void {
@@ -73,11 +67,29 @@ fn impl_destroy(ptr: *anyopaque, allocator: std.mem.Allocator) void {
     self.deinit(allocator);
 }
 
+fn impl_prepare(ptr: *anyopaque, allocator: std.mem.Allocator, sample_rate: f32, max_block: usize) bool {
+    _ = allocator;
+    _ = max_block;
+    const self = @as(*FeedbackDelayPlugin, @ptrCast(@alignCast(ptr)));
+    self.prepare(sample_rate);
+    return true;
+}
+
 fn impl_process(ptr: *anyopaque, inputs: [*]const [*]const f32, outputs: [*][*]f32, frames: usize) void {
     const self = @as(*FeedbackDelayPlugin, @ptrCast(@alignCast(ptr)));
     self.process(inputs, outputs, frames);
 }
 
+fn impl_tail(ptr: *anyopaque) u32 {
+    const self = @as(*FeedbackDelayPlugin, @ptrCast(@alignCast(ptr)));
+    return self.tail();
+}
+
+fn impl_decayed(ptr: *anyopaque) bool {
+    const self = @as(*FeedbackDelayPlugin, @ptrCast(@alignCast(ptr)));
+    return self.decayed();
+}
+
 fn impl_set_parameter(ptr: *anyopaque, index: i32, value: f32) void {
     const self = @as(*FeedbackDelayPlugin, @ptrCast(@alignCast(ptr)));
     self.setParameter(index, value);
@@ -91,7 +103,10 @@ fn impl_get_parameter(ptr: *anyopaque, index: i32) f32 {
 pub const plugin_impl = struct {
     pub const create = impl_create;
     pub const destroy = impl_destroy;
+    pub const prepare = impl_prepare;
     pub const process = impl_process;
     pub const set_parameter = impl_set_parameter;
     pub const get_parameter = impl_get_parameter;
+    pub const tail = impl_tail;
+    pub const decayed = impl_decayed;
 };
@@ -1,45 +1,39 @@
 const std = @import("std");
+const shared = @import("../dsp/shared.zig");
 
 pub const GainPlugin = struct {
     gain: f32,
     sample_rate: f32,
+    channels: usize,
 
     pub fn init(allocator: std.mem.Allocator, sample_rate: f32) !*GainPlugin {
         const self = try allocator.create(GainPlugin);
         self.gain = 1.0;
         self.sample_rate = sample_rate;
+        self.channels = 2;
         return self;
     }
 
+    pub fn prepare(self: *GainPlugin, sample_rate: f32) void {
+        self.sample_rate = sample_rate;
+    }
+
     pub fn deinit(self: *GainPlugin, allocator: std.mem.Allocator) void {
         allocator.destroy(self);
     }
 
     pub fn process(self: *GainPlugin, inputs: [*]const [*]const f32, outputs: [*][*]f32, frames: usize) void {
-        // Assume stereo or check buffers? 
-        // For simplicity, handle whatever is passed (assumes valid pointers).
-        // In VST3 wrapper we will ensure valid pointers.
-        
-        // Simple passthrough + gain
-        // We'll process channel 0 and 1 if available.
-        // Actually, inputs is [*]const [*]const f32, which is essentially float**.
-        
-        const in_l = inputs[0];
-        const out_l = outputs[0];
-        
-        // Check if stereo
-        // We really need num_channels passed in process or fixed at creation.
-        // Let's assume Stereo for this VST3 proof-of-concept.
-        
-        var i: usize = 0;
-        while (i < frames) : (i += 1) {
-            out_l[i] = in_l[i] * self.gain;
+        for (0..self.channels) |ch| {
+            const in = inputs[ch];
+            const out = outputs[ch];
+            for (0..frames) |i| {
+                out[i] = in[i] * self.gain;
+            }
         }
+    }
 
-        // Handle second channel if likely exists (wrapper should ensure)
-        // We'll just mirror L to R if input R is missing or pass R if present.
-        // Ideally we check a channel_count.
-        // For now, let's just do Channel 0.
+    pub fn setChannels(self: *GainPlugin, channels: usize) void {
+        self.channels = channels;
     }
 
     pub fn setParameter(self: *GainPlugin, index: i32, value: f32) void {
@@ -70,11 +64,24 @@ fn impl_destroy(ptr: *anyopaque, allocator: std.mem.Allocator) void {
     self.deinit(allocator);
 }
 
+fn impl_prepare(ptr: *anyopaque, allocator: std.mem.Allocator, sample_rate: f32, max_block: usize) bool {
+    _ = allocator;
+    _ = max_block;
+    const self = @as(*GainPlugin, @ptrCast(@alignCast(ptr)));
+    self.prepare(sample_rate);
+    return true;
+}
+
 fn impl_process(ptr: *anyopaque, inputs: [*]const [*]const f32, outputs: [*][*]f32, frames: usize) void {
     const self = @as(*GainPlugin, @ptrCast(@alignCast(ptr)));
     self.process(inputs, outputs, frames);
 }
 
+fn impl_set_channels(ptr: *anyopaque, channels: u32) void {
+    const self = @as(*GainPlugin, @ptrCast(@alignCast(ptr)));
+    self.setChannels(channels);
+}
+
 fn impl_set_parameter(ptr: *anyopaque, index: i32, value: f32) void {
     const self = @as(*GainPlugin, @ptrCast(@alignCast(ptr)));
     self.setParameter(index, value);
@@ -88,7 +95,10 @@ fn impl_get_parameter(ptr: *anyopaque, index: i32) f32 {
 pub const plugin_impl = struct {
     pub const create = impl_create;
     pub const destroy = impl_destroy;
+    pub const prepare = impl_prepare;
     pub const process = impl_process;
     pub const set_parameter = impl_set_parameter;
     pub const get_parameter = impl_get_parameter;
+    pub const set_channels = impl_set_channels;
+    pub const max_channels = shared.max_channels;
 };
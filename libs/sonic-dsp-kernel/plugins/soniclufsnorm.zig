@@ -1,69 +1,75 @@
 const std = @import("std");
 const math = @import("../math_utils.zig");
-
-// Copy of filter from main.zig
-fn apply_filter(input: []const f32, output: []f32, state: *struct { x1: f32 = 0, y1: f32 = 0 }) void {
-    const a1 = -0.995;
-    const b0 = 0.9975;
-    const b1 = -0.9975;
-
-    for (input, 0..) |sample, i| {
-        output[i] = b0 * sample + b1 * state.x1 - a1 * state.y1;
-        state.x1 = sample;
-        state.y1 = output[i];
-    }
-}
-
+const analysis = @import("../analysis.zig");
+
+/// Most the normalizer will boost or cut, so a quiet intro isn't pulled up
+/// to the target before anything louder has been heard.
+const max_gain_db: f32 = 24.0;
+/// Time constant of the gain following the running measurement.
+const smoothing_ms: f32 = 500.0;
+
+/// Real-time loudness normalization. Measures the gated integrated
+/// loudness of everything played since the last prepare, the same way the
+/// offline normalizer measures a whole file, and steers the gain towards
+/// target minus measured. The measurement, and so the gain target, only
+/// moves at 100 ms hop boundaries and the gain glides per sample, so the
+/// output doesn't depend on the host block size.
 pub const LufsNormPlugin = struct {
     target_lufs: f32,
     sample_rate: f32,
-    filter_state: struct { x1: f32 = 0, y1: f32 = 0 },
+    meter: analysis.GatedLoudness,
+    gain: f32,
+    target_gain: f32,
+    glide: f32,
 
     pub fn init(allocator: std.mem.Allocator, sample_rate: f32) !*LufsNormPlugin {
         const self = try allocator.create(LufsNormPlugin);
         self.target_lufs = -16.0;
-        self.sample_rate = sample_rate;
-        self.filter_state = .{};
+        self.prepare(sample_rate);
         return self;
     }
 
+    pub fn prepare(self: *LufsNormPlugin, sample_rate: f32) void {
+        self.sample_rate = sample_rate;
+        self.meter = analysis.GatedLoudness.init(2, sample_rate);
+        self.gain = 1.0;
+        self.target_gain = 1.0;
+        self.glide = 1.0 - std.math.exp(-1000.0 / (smoothing_ms * sample_rate));
+    }
+
     pub fn deinit(self: *LufsNormPlugin, allocator: std.mem.Allocator) void {
         allocator.destroy(self);
     }
 
-    pub fn process(self: *LufsNormPlugin, inputs: [*]const [*]const f32, outputs: [*][*]f32, frames: usize) void {
-        const in_l = inputs[0][0..frames];
-        const out_l = outputs[0][0..frames];
-        const out_r = outputs[1][0..frames];
-
-        // This is a block-based normalization. It calculates the gain for the CURRENT block
-        // and applies it. In a real DAW this might be "jumpy".
-        // But following main.zig implementation:
-        
-        var sum_sq: f32 = 0;
-        for (in_l) |s| {
-            // Apply K-weighting filter approximation
-            const filtered = 0.9975 * s + (-0.9975) * self.filter_state.x1 - (-0.995) * self.filter_state.y1;
-            self.filter_state.x1 = s;
-            self.filter_state.y1 = filtered;
-            sum_sq += filtered * filtered;
-        }
-
-        const mean_sq = sum_sq / @as(f32, @floatFromInt(frames));
-        const rms_db = if (mean_sq > 1e-12) 10.0 * std.math.log10(mean_sq) else -100.0;
-        const current_lufs = rms_db - 0.691;
-        const delta_db = self.target_lufs - current_lufs;
-        const linear_gain = std.math.pow(f32, 10.0, delta_db / 20.0);
+    fn updateTarget(self: *LufsNormPlugin) void {
+        const measured = self.meter.integrated() orelse return;
+        self.target_gain = math.dbToLinear(std.math.clamp(self.target_lufs - measured, -max_gain_db, max_gain_db));
+    }
 
-        for (in_l, 0..) |s, i| {
-            out_l[i] = s * linear_gain;
-            out_r[i] = out_l[i];
+    pub fn process(self: *LufsNormPlugin, inputs: [*]const [*]const f32, outputs: [*][*]f32, frames: usize) void {
+        var pos: usize = 0;
+        while (pos < frames) {
+            const n = @min(frames - pos, self.meter.untilHop());
+            const ins = [2][*]const f32{ inputs[0] + pos, inputs[1] + pos };
+            self.meter.pushPlanar(&ins, n);
+
+            var gain = self.gain;
+            for (0..n) |i| {
+                gain += (self.target_gain - gain) * self.glide;
+                outputs[0][pos + i] = ins[0][i] * gain;
+                outputs[1][pos + i] = ins[1][i] * gain;
+            }
+            self.gain = gain;
+
+            if (self.meter.untilHop() == self.meter.hop_frames) self.updateTarget();
+            pos += n;
         }
     }
 
     pub fn setParameter(self: *LufsNormPlugin, index: i32, value: f32) void {
         if (index == 0) {
             self.target_lufs = -24.0 + (value * 16.0);
+            self.updateTarget();
         }
     }
 
@@ -86,6 +92,14 @@ fn impl_destroy(ptr: *anyopaque, allocator: std.mem.Allocator) void {
     self.deinit(allocator);
 }
 
+fn impl_prepare(ptr: *anyopaque, allocator: std.mem.Allocator, sample_rate: f32, max_block: usize) bool {
+    _ = allocator;
+    _ = max_block;
+    const self = @as(*LufsNormPlugin, @ptrCast(@alignCast(ptr)));
+    self.prepare(sample_rate);
+    return true;
+}
+
 fn impl_process(ptr: *anyopaque, inputs: [*]const [*]const f32, outputs: [*][*]f32, frames: usize) void {
     const self = @as(*LufsNormPlugin, @ptrCast(@alignCast(ptr)));
     self.process(inputs, outputs, frames);
@@ -104,6 +118,7 @@ fn impl_get_parameter(ptr: *anyopaque, index: i32) f32 {
 pub const plugin_impl = struct {
     pub const create = impl_create;
     pub const destroy = impl_destroy;
+    pub const prepare = impl_prepare;
     pub const process = impl_process;
     pub const set_parameter = impl_set_parameter;
     pub const get_parameter = impl_get_parameter;
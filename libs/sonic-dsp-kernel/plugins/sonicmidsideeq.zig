@@ -1,5 +1,6 @@
 const std = @import("std");
 const eq = @import("../modules/eq.zig");
+const shared = @import("../dsp/shared.zig");
 
 pub const MidSideEQPlugin = struct {
     mid_gain: f32 = 0,
@@ -7,6 +8,7 @@ pub const MidSideEQPlugin = struct {
     side_gain: f32 = 0,
     side_freq: f32 = 1000,
     sample_rate: f32,
+    ms: eq.MidSideEQ = .{},
 
     pub fn init(allocator: std.mem.Allocator, sample_rate: f32) !*MidSideEQPlugin {
         const self = try allocator.create(MidSideEQPlugin);
@@ -15,38 +17,24 @@ pub const MidSideEQPlugin = struct {
         self.mid_freq = 1000;
         self.side_gain = 0;
         self.side_freq = 1000;
+        self.ms = .{};
         return self;
     }
 
+    pub fn prepare(self: *MidSideEQPlugin, sample_rate: f32) void {
+        self.sample_rate = sample_rate;
+    }
+
     pub fn deinit(self: *MidSideEQPlugin, allocator: std.mem.Allocator) void {
         allocator.destroy(self);
     }
 
     pub fn process(self: *MidSideEQPlugin, inputs: [*]const [*]const f32, outputs: [*][*]f32, frames: usize) void {
-        const in_l = inputs[0][0..frames];
-        const in_r = inputs[1][0..frames];
-        const out_l = outputs[0][0..frames];
-        const out_r = outputs[1][0..frames];
+        shared.processInterleavedStereo(self, processChunk, inputs, outputs, frames);
+    }
 
-        var interleaved: [1024]f32 = undefined;
-        const total_samples = frames * 2;
-        
-        if (total_samples <= interleaved.len) {
-            for (0..frames) |i| {
-                interleaved[i * 2] = in_l[i];
-                interleaved[i * 2 + 1] = in_r[i];
-            }
-            
-            eq.processMidSideEQ(interleaved[0..total_samples], self.sample_rate, self.mid_gain, self.mid_freq, self.side_gain, self.side_freq);
-            
-            for (0..frames) |i| {
-                out_l[i] = interleaved[i * 2];
-                out_r[i] = interleaved[i * 2 + 1];
-            }
-        } else {
-            @memcpy(out_l, in_l);
-            @memcpy(out_r, in_r);
-        }
+    fn processChunk(self: *MidSideEQPlugin, data: []f32) void {
+        self.ms.process(data, self.sample_rate, self.mid_gain, self.mid_freq, self.side_gain, self.side_freq);
     }
 
     pub fn setParameter(self: *MidSideEQPlugin, index: i32, value: f32) void {
@@ -83,6 +71,14 @@ fn impl_destroy(ptr: *anyopaque, allocator: std.mem.Allocator) void {
     self.deinit(allocator);
 }
 
+fn impl_prepare(ptr: *anyopaque, allocator: std.mem.Allocator, sample_rate: f32, max_block: usize) bool {
+    _ = allocator;
+    _ = max_block;
+    const self = @as(*MidSideEQPlugin, @ptrCast(@alignCast(ptr)));
+    self.prepare(sample_rate);
+    return true;
+}
+
 fn impl_process(ptr: *anyopaque, inputs: [*]const [*]const f32, outputs: [*][*]f32, frames: usize) void {
     const self = @as(*MidSideEQPlugin, @ptrCast(@alignCast(ptr)));
     self.process(inputs, outputs, frames);
@@ -101,6 +97,7 @@ fn impl_get_parameter(ptr: *anyopaque, index: i32) f32 {
 pub const plugin_impl = struct {
     pub const create = impl_create;
     pub const destroy = impl_destroy;
+    pub const prepare = impl_prepare;
     pub const process = impl_process;
     pub const set_parameter = impl_set_parameter;
     pub const get_parameter = impl_get_parameter;
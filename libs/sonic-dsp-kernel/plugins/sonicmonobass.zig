@@ -1,35 +1,41 @@
 const std = @import("std");
-const math = @import("../math_utils.zig");
+const cascade = @import("../dsp/cascade.zig");
+
+/// Chunk for the low band before it is folded to mono
+const low_chunk = 512;
 
 pub const MonoBassPlugin = struct {
     freq: f32,
     sample_rate: f32,
-    lpf_l1: math.Biquad,
-    lpf_l2: math.Biquad,
-    lpf_r1: math.Biquad,
-    lpf_r2: math.Biquad,
-    hpf_l1: math.Biquad,
-    hpf_l2: math.Biquad,
-    hpf_r1: math.Biquad,
-    hpf_r2: math.Biquad,
+    /// 4th-order Linkwitz-Riley crossover as two Butterworth sections on
+    /// four channels: low left, low right, high left, high right.
+    crossover: cascade.Cascade(2),
 
     pub fn init(allocator: std.mem.Allocator, sample_rate: f32) !*MonoBassPlugin {
         const self = try allocator.create(MonoBassPlugin);
-        self.sample_rate = sample_rate;
-        self.freq = 150.0;
+        self.* = .{ .freq = 150.0, .sample_rate = sample_rate, .crossover = .{} };
+        self.crossover.prepare(sample_rate);
         self.updateFilters();
         return self;
     }
 
     fn updateFilters(self: *MonoBassPlugin) void {
-        self.lpf_l1 = math.calc_lpf_coeffs(self.freq, self.sample_rate);
-        self.lpf_l2 = self.lpf_l1;
-        self.lpf_r1 = math.calc_lpf_coeffs(self.freq, self.sample_rate);
-        self.lpf_r2 = self.lpf_r1;
-        self.hpf_l1 = math.calc_hpf_coeffs(self.freq, self.sample_rate);
-        self.hpf_l2 = self.hpf_l1;
-        self.hpf_r1 = math.calc_hpf_coeffs(self.freq, self.sample_rate);
-        self.hpf_r2 = self.hpf_r1;
+        const lpf = cascade.Coefficients.design(.lowpass, self.freq, 0, std.math.sqrt1_2, self.sample_rate);
+        const hpf = cascade.Coefficients.design(.highpass, self.freq, 0, std.math.sqrt1_2, self.sample_rate);
+        for (0..2) |k| {
+            self.crossover.setSectionChannel(k, 0, lpf);
+            self.crossover.setSectionChannel(k, 1, lpf);
+            self.crossover.setSectionChannel(k, 2, hpf);
+            self.crossover.setSectionChannel(k, 3, hpf);
+        }
+    }
+
+    pub fn prepare(self: *MonoBassPlugin, sample_rate: f32) void {
+        self.sample_rate = sample_rate;
+        self.crossover.prepare(sample_rate);
+        self.updateFilters();
+        self.crossover.snap();
+        self.crossover.reset();
     }
 
     pub fn deinit(self: *MonoBassPlugin, allocator: std.mem.Allocator) void {
@@ -37,28 +43,23 @@ pub const MonoBassPlugin = struct {
     }
 
     pub fn process(self: *MonoBassPlugin, inputs: [*]const [*]const f32, outputs: [*][*]f32, frames: usize) void {
-        const in_l = inputs[0][0..frames];
-        const in_r = inputs[1][0..frames];
-        const out_l = outputs[0][0..frames];
-        const out_r = outputs[1][0..frames];
-
-        for (in_l, 0..) |l, i| {
-            const r = in_r[i];
-            
-            var low_l = self.lpf_l1.process(l);
-            low_l = self.lpf_l2.process(low_l);
-            var low_r = self.lpf_r1.process(r);
-            low_r = self.lpf_r2.process(low_r);
-            
-            const low_mono = (low_l + low_r) * 0.5;
-            
-            var high_l = self.hpf_l1.process(l);
-            high_l = self.hpf_l2.process(high_l);
-            var high_r = self.hpf_r1.process(r);
-            high_r = self.hpf_r2.process(high_r);
-            
-            out_l[i] = low_mono + high_l;
-            out_r[i] = low_mono + high_r;
+        var low_l: [low_chunk]f32 = undefined;
+        var low_r: [low_chunk]f32 = undefined;
+
+        var pos: usize = 0;
+        while (pos < frames) : (pos += low_chunk) {
+            const n = @min(low_chunk, frames - pos);
+            const bands = [4][*]const f32{ inputs[0] + pos, inputs[1] + pos, inputs[0] + pos, inputs[1] + pos };
+            var split = [4][*]f32{ &low_l, &low_r, outputs[0] + pos, outputs[1] + pos };
+            self.crossover.processChannels(&bands, &split, 4, n);
+
+            const out_l = outputs[0][pos..][0..n];
+            const out_r = outputs[1][pos..][0..n];
+            for (0..n) |i| {
+                const low_mono = (low_l[i] + low_r[i]) * 0.5;
+                out_l[i] += low_mono;
+                out_r[i] += low_mono;
+            }
         }
     }
 
@@ -88,6 +89,14 @@ fn impl_destroy(ptr: *anyopaque, allocator: std.mem.Allocator) void {
     self.deinit(allocator);
 }
 
+fn impl_prepare(ptr: *anyopaque, allocator: std.mem.Allocator, sample_rate: f32, max_block: usize) bool {
+    _ = allocator;
+    _ = max_block;
+    const self = @as(*MonoBassPlugin, @ptrCast(@alignCast(ptr)));
+    self.prepare(sample_rate);
+    return true;
+}
+
 fn impl_process(ptr: *anyopaque, inputs: [*]const [*]const f32, outputs: [*][*]f32, frames: usize) void {
     const self = @as(*MonoBassPlugin, @ptrCast(@alignCast(ptr)));
     self.process(inputs, outputs, frames);
@@ -106,6 +115,7 @@ fn impl_get_parameter(ptr: *anyopaque, index: i32) f32 {
 pub const plugin_impl = struct {
     pub const create = impl_create;
     pub const destroy = impl_destroy;
+    pub const prepare = impl_prepare;
     pub const process = impl_process;
     pub const set_parameter = impl_set_parameter;
     pub const get_parameter = impl_get_parameter;
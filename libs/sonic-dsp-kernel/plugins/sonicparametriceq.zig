@@ -1,9 +1,10 @@
 const std = @import("std");
-const filters = @import("../dsp/filters.zig");
+const eq = @import("../modules/eq.zig");
+const shared = @import("../dsp/shared.zig");
 
 pub const ParametricEQPlugin = struct {
-    filters_l: [3]filters.Biquad,
-    filters_r: [3]filters.Biquad,
+    peq: eq.ParametricEQ,
+    channels: usize,
     
     params: struct {
         low_freq: f32 = 100,
@@ -19,21 +20,21 @@ pub const ParametricEQPlugin = struct {
     pub fn init(allocator: std.mem.Allocator, sample_rate: f32) !*ParametricEQPlugin {
         const self = try allocator.create(ParametricEQPlugin);
         self.sample_rate = sample_rate;
-        self.filters_l = [_]filters.Biquad{.{}} ** 3;
-        self.filters_r = [_]filters.Biquad{.{}} ** 3;
+        self.peq = .{};
+        self.channels = 2;
         self.params = .{};
         self.updateFilters();
         return self;
     }
 
     fn updateFilters(self: *ParametricEQPlugin) void {
-        self.filters_l[0].setParams(.lowshelf, self.params.low_freq, self.params.low_gain, 0.707, self.sample_rate);
-        self.filters_l[1].setParams(.peaking, self.params.mid_freq, self.params.mid_gain, self.params.mid_q, self.sample_rate);
-        self.filters_l[2].setParams(.highshelf, self.params.high_freq, self.params.high_gain, 0.707, self.sample_rate);
-        
-        self.filters_r[0].setParams(.lowshelf, self.params.low_freq, self.params.low_gain, 0.707, self.sample_rate);
-        self.filters_r[1].setParams(.peaking, self.params.mid_freq, self.params.mid_gain, self.params.mid_q, self.sample_rate);
-        self.filters_r[2].setParams(.highshelf, self.params.high_freq, self.params.high_gain, 0.707, self.sample_rate);
+        const p = self.params;
+        self.peq.setParams(self.sample_rate, p.low_freq, p.low_gain, p.mid_freq, p.mid_gain, p.mid_q, p.high_freq, p.high_gain);
+    }
+
+    pub fn prepare(self: *ParametricEQPlugin, sample_rate: f32) void {
+        self.sample_rate = sample_rate;
+        self.updateFilters();
     }
 
     pub fn deinit(self: *ParametricEQPlugin, allocator: std.mem.Allocator) void {
@@ -41,23 +42,13 @@ pub const ParametricEQPlugin = struct {
     }
 
     pub fn process(self: *ParametricEQPlugin, inputs: [*]const [*]const f32, outputs: [*][*]f32, frames: usize) void {
-        const in_l = inputs[0];
-        const in_r = inputs[1];
-        const out_l = outputs[0];
-        const out_r = outputs[1];
-
-        for (0..frames) |i| {
-            var s_l = in_l[i];
-            var s_r = in_r[i];
-
-            inline for (0..3) |j| {
-                s_l = self.filters_l[j].process(s_l);
-                s_r = self.filters_r[j].process(s_r);
-            }
-
-            out_l[i] = s_l;
-            out_r[i] = s_r;
-        }
+        self.peq.processChannels(inputs, outputs, self.channels, frames);
+    }
+
+    /// Bus width from the host; restarts the filter memory.
+    pub fn setChannels(self: *ParametricEQPlugin, channels: usize) void {
+        self.channels = channels;
+        self.peq.reset();
     }
 
     pub fn setParameter(self: *ParametricEQPlugin, index: i32, value: f32) void {
@@ -101,11 +92,24 @@ fn impl_destroy(ptr: *anyopaque, allocator: std.mem.Allocator) void {
     self.deinit(allocator);
 }
 
+fn impl_prepare(ptr: *anyopaque, allocator: std.mem.Allocator, sample_rate: f32, max_block: usize) bool {
+    _ = allocator;
+    _ = max_block;
+    const self = @as(*ParametricEQPlugin, @ptrCast(@alignCast(ptr)));
+    self.prepare(sample_rate);
+    return true;
+}
+
 fn impl_process(ptr: *anyopaque, inputs: [*]const [*]const f32, outputs: [*][*]f32, frames: usize) void {
     const self = @as(*ParametricEQPlugin, @ptrCast(@alignCast(ptr)));
     self.process(inputs, outputs, frames);
 }
 
+fn impl_set_channels(ptr: *anyopaque, channels: u32) void {
+    const self = @as(*ParametricEQPlugin, @ptrCast(@alignCast(ptr)));
+    self.setChannels(channels);
+}
+
 fn impl_set_parameter(ptr: *anyopaque, index: i32, value: f32) void {
     const self = @as(*ParametricEQPlugin, @ptrCast(@alignCast(ptr)));
     self.setParameter(index, value);
@@ -119,7 +123,10 @@ fn impl_get_parameter(ptr: *anyopaque, index: i32) f32 {
 pub const plugin_impl = struct {
     pub const create = impl_create;
     pub const destroy = impl_destroy;
+    pub const prepare = impl_prepare;
     pub const process = impl_process;
     pub const set_parameter = impl_set_parameter;
     pub const get_parameter = impl_get_parameter;
+    pub const set_channels = impl_set_channels;
+    pub const max_channels = shared.max_channels;
 };
@@ -1,5 +1,6 @@
 const std = @import("std");
 const modulation = @import("../modules/modulation.zig");
+const shared = @import("../dsp/shared.zig");
 
 pub const PhaserPlugin = struct {
     stages: i32 = 4,
@@ -8,42 +9,28 @@ pub const PhaserPlugin = struct {
     octaves: f32 = 2,
     wet: f32 = 0.5,
     sample_rate: f32,
+    phaser: modulation.Phaser = .{},
 
     pub fn init(allocator: std.mem.Allocator, sample_rate: f32) !*PhaserPlugin {
         const self = try allocator.create(PhaserPlugin);
-        self.sample_rate = sample_rate;
+        self.* = .{ .sample_rate = sample_rate };
         return self;
     }
 
+    pub fn prepare(self: *PhaserPlugin, sample_rate: f32) void {
+        self.sample_rate = sample_rate;
+    }
+
     pub fn deinit(self: *PhaserPlugin, allocator: std.mem.Allocator) void {
         allocator.destroy(self);
     }
 
     pub fn process(self: *PhaserPlugin, inputs: [*]const [*]const f32, outputs: [*][*]f32, frames: usize) void {
-        const in_l = inputs[0][0..frames];
-        const in_r = inputs[1][0..frames];
-        const out_l = outputs[0][0..frames];
-        const out_r = outputs[1][0..frames];
+        shared.processInterleavedStereo(self, processChunk, inputs, outputs, frames);
+    }
 
-        var interleaved: [1024]f32 = undefined;
-        const total_samples = frames * 2;
-        
-        if (total_samples <= interleaved.len) {
-            for (0..frames) |i| {
-                interleaved[i * 2] = in_l[i];
-                interleaved[i * 2 + 1] = in_r[i];
-            }
-            
-            modulation.processPhaser(interleaved[0..total_samples], self.sample_rate, self.stages, self.frequency, self.base_freq, self.octaves, self.wet);
-            
-            for (0..frames) |i| {
-                out_l[i] = interleaved[i * 2];
-                out_r[i] = interleaved[i * 2 + 1];
-            }
-        } else {
-            @memcpy(out_l, in_l);
-            @memcpy(out_r, in_r);
-        }
+    fn processChunk(self: *PhaserPlugin, data: []f32) void {
+        self.phaser.process(data, self.sample_rate, self.stages, self.frequency, self.base_freq, self.octaves, self.wet);
     }
 
     pub fn setParameter(self: *PhaserPlugin, index: i32, value: f32) void {
@@ -82,6 +69,14 @@ fn impl_destroy(ptr: *anyopaque, allocator: std.mem.Allocator) void {
     self.deinit(allocator);
 }
 
+fn impl_prepare(ptr: *anyopaque, allocator: std.mem.Allocator, sample_rate: f32, max_block: usize) bool {
+    _ = allocator;
+    _ = max_block;
+    const self = @as(*PhaserPlugin, @ptrCast(@alignCast(ptr)));
+    self.prepare(sample_rate);
+    return true;
+}
+
 fn impl_process(ptr: *anyopaque, inputs: [*]const [*]const f32, outputs: [*][*]f32, frames: usize) void {
     const self = @as(*PhaserPlugin, @ptrCast(@alignCast(ptr)));
     self.process(inputs, outputs, frames);
@@ -100,6 +95,7 @@ fn impl_get_parameter(ptr: *anyopaque, index: i32) f32 {
 pub const plugin_impl = struct {
     pub const create = impl_create;
     pub const destroy = impl_destroy;
+    pub const prepare = impl_prepare;
     pub const process = impl_process;
     pub const set_parameter = impl_set_parameter;
     pub const get_parameter = impl_get_parameter;
@@ -14,6 +14,10 @@ pub const PlosiveGuardPlugin = struct {
         return self;
     }
 
+    pub fn prepare(self: *PlosiveGuardPlugin, sample_rate: f32) void {
+        self.sample_rate = sample_rate;
+    }
+
     pub fn deinit(self: *PlosiveGuardPlugin, allocator: std.mem.Allocator) void {
         allocator.destroy(self);
     }
@@ -61,6 +65,14 @@ fn impl_destroy(ptr: *anyopaque, allocator: std.mem.Allocator) void {
     self.deinit(allocator);
 }
 
+fn impl_prepare(ptr: *anyopaque, allocator: std.mem.Allocator, sample_rate: f32, max_block: usize) bool {
+    _ = allocator;
+    _ = max_block;
+    const self = @as(*PlosiveGuardPlugin, @ptrCast(@alignCast(ptr)));
+    self.prepare(sample_rate);
+    return true;
+}
+
 fn impl_process(ptr: *anyopaque, inputs: [*]const [*]const f32, outputs: [*][*]f32, frames: usize) void {
     const self = @as(*PlosiveGuardPlugin, @ptrCast(@alignCast(ptr)));
     self.process(inputs, outputs, frames);
@@ -79,6 +91,7 @@ fn impl_get_parameter(ptr: *anyopaque, index: i32) f32 {
 pub const plugin_impl = struct {
     pub const create = impl_create;
     pub const destroy = impl_destroy;
+    pub const prepare = impl_prepare;
     pub const process = impl_process;
     pub const set_parameter = impl_set_parameter;
     pub const get_parameter = impl_get_parameter;
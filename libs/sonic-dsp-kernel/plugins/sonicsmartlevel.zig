@@ -50,6 +50,21 @@ pub const SmartLevelPlugin = struct {
         return self;
     }
 
+    /// Only reallocates when the 300ms window actually changes length; the
+    /// current gain carries over.
+    pub fn prepare(self: *SmartLevelPlugin, allocator: std.mem.Allocator, sample_rate: f32) !void {
+        const window_size = @as(usize, @intFromFloat(0.3 * sample_rate));
+        if (window_size != self.history.len) {
+            const history = try allocator.alloc(f32, window_size);
+            allocator.free(self.history);
+            self.history = history;
+            @memset(self.history, 0);
+            self.history_idx = 0;
+            self.sum_sq = 0;
+        }
+        self.sample_rate = sample_rate;
+    }
+
     pub fn deinit(self: *SmartLevelPlugin, allocator: std.mem.Allocator) void {
         allocator.free(self.history);
         allocator.destroy(self);
@@ -149,6 +164,13 @@ fn impl_destroy(ptr: *anyopaque, allocator: std.mem.Allocator) void {
     self.deinit(allocator);
 }
 
+fn impl_prepare(ptr: *anyopaque, allocator: std.mem.Allocator, sample_rate: f32, max_block: usize) bool {
+    _ = max_block;
+    const self = @as(*SmartLevelPlugin, @ptrCast(@alignCast(ptr)));
+    self.prepare(allocator, sample_rate) catch return false;
+    return true;
+}
+
 fn impl_process(ptr: *anyopaque, inputs: [*]const [*]const f32, outputs: [*][*]f32, frames: usize) void {
     const self = @as(*SmartLevelPlugin, @ptrCast(@alignCast(ptr)));
     self.process(inputs, outputs, frames);
@@ -167,6 +189,7 @@ fn impl_get_parameter(ptr: *anyopaque, index: i32) f32 {
 pub const plugin_impl = struct {
     pub const create = impl_create;
     pub const destroy = impl_destroy;
+    pub const prepare = impl_prepare;
     pub const process = impl_process;
     pub const set_parameter = impl_set_parameter;
     pub const get_parameter = impl_get_parameter;
@@ -1,56 +1,129 @@
 const std = @import("std");
 const dsp = @import("../spectralmatch.zig");
+const StreamingStft = @import("../dsp/stft.zig").StreamingStft;
+const state = @import("../dsp/state.zig");
 
+/// Matches the input's long-term spectrum to a reference. The reference is
+/// learned from the plugin's own input: while "learn" (parameter 1) is on,
+/// audio passes through and every frame's power is averaged into it, and
+/// switching learn off smooths it the way spectralmatch_analyze_ref does.
+/// It is part of the saved state.
 pub const SpectralMatchPlugin = struct {
     amount: f32,
     sample_rate: f32,
-    ref_analysis: ?*dsp.AnalysisResult,
+    /// Power spectrum to match, on analyze_signal's scale and length;
+    /// while learning, the running mean of the frames so far
+    reference: []f32,
+    reference_frames: usize,
+    learning: bool,
+    stft: StreamingStft,
+    match: dsp.StreamingMatch,
 
     pub fn init(allocator: std.mem.Allocator, sample_rate: f32) !*SpectralMatchPlugin {
         const self = try allocator.create(SpectralMatchPlugin);
+        errdefer allocator.destroy(self);
         self.amount = 0.5;
         self.sample_rate = sample_rate;
-        self.ref_analysis = null;
+        self.reference = try allocator.alloc(f32, dsp.WINDOW_SIZE / 2);
+        errdefer allocator.free(self.reference);
+        @memset(self.reference, 0);
+        self.reference_frames = 0;
+        self.learning = false;
+        // Frames the size of the reference analysis, so the bins line up
+        self.stft = try StreamingStft.init(allocator, .{ .size = dsp.WINDOW_SIZE, .hop = dsp.HOP_SIZE });
+        errdefer self.stft.deinit(allocator);
+        self.match = try dsp.StreamingMatch.init(allocator, self.stft.window);
         return self;
     }
 
+    pub fn prepare(self: *SpectralMatchPlugin, sample_rate: f32) void {
+        self.sample_rate = sample_rate;
+    }
+
     pub fn deinit(self: *SpectralMatchPlugin, allocator: std.mem.Allocator) void {
-        if (self.ref_analysis) |ref| {
-            dsp.spectralmatch_free_analysis(ref);
-        }
+        self.match.deinit(allocator);
+        self.stft.deinit(allocator);
+        allocator.free(self.reference);
         allocator.destroy(self);
     }
 
     pub fn process(self: *SpectralMatchPlugin, inputs: [*]const [*]const f32, outputs: [*][*]f32, frames: usize) void {
-        const in_l = inputs[0];
-        const out_l = outputs[0];
-        const out_r = outputs[1];
+        const in_l = inputs[0][0..frames];
+        const out_l = outputs[0][0..frames];
+        const out_r = outputs[1][0..frames];
 
-        // Copy Input -> Output
-        @memcpy(out_l[0..frames], in_l[0..frames]);
+        // Without a reference (or while learning one) it's a (delayed)
+        // passthrough.
+        self.stft.process(&.{in_l}, &.{out_l}, frames, self, processFrame);
 
-        // Spectral Match requires a reference analysis.
-        // If we don't have one, it's a passthrough.
-        if (self.ref_analysis) |ref| {
-            dsp.process_spectralmatch(out_l, frames, ref, self.amount, 0.5);
+        // Dual Mono
+        @memcpy(out_r, out_l);
+    }
+
+    fn processFrame(self: *SpectralMatchPlugin, stft: *StreamingStft) void {
+        const bins = stft.spectrum(0);
+        const hop_seconds = @as(f32, @floatFromInt(stft.hop)) / self.sample_rate;
+        if (self.learning) {
+            const weight = 1.0 / @as(f32, @floatFromInt(self.reference_frames + 1));
+            for (self.reference, bins[0..self.reference.len]) |*ref, bin| {
+                const power = (bin.re * bin.re + bin.im * bin.im) * self.match.power_scale;
+                ref.* += (power - ref.*) * weight;
+            }
+            self.reference_frames += 1;
         }
+        const reference: dsp.AnalysisResult = .{ .power_spectrum = self.reference, .size = self.reference.len };
+        const matching = !self.learning and self.reference_frames > 0;
+        self.match.processFrame(bins, if (matching) &reference else null, self.amount, hop_seconds);
+    }
 
-        // Dual Mono
-        @memcpy(out_r[0..frames], out_l[0..frames]);
+    pub fn latency(self: *const SpectralMatchPlugin) u32 {
+        return @intCast(self.stft.latency());
+    }
+
+    pub fn tail(self: *const SpectralMatchPlugin) u32 {
+        return @intCast(self.stft.tail());
     }
 
     pub fn setParameter(self: *SpectralMatchPlugin, index: i32, value: f32) void {
         if (index == 0) {
             self.amount = value;
         }
-        // index 1 could be used to trigger "Capture Reference" from sidechain?
-        // But for now we just handle amount.
+        if (index == 1) {
+            const learn = value > 0.5;
+            if (learn and !self.learning) {
+                @memset(self.reference, 0);
+                self.reference_frames = 0;
+            }
+            if (!learn and self.learning and self.reference_frames > 0) {
+                dsp.smooth_spectrum_with(self.reference, self.match.prefix[0 .. self.reference.len + 1]);
+            }
+            self.learning = learn;
+        }
     }
 
     pub fn getParameter(self: *SpectralMatchPlugin, index: i32) f32 {
         if (index == 0) return self.amount;
+        if (index == 1) return if (self.learning) 1.0 else 0.0;
         return 0.0;
     }
+
+    /// Saved state: frames averaged into the reference, then the reference
+    /// itself (already smoothed unless it was saved mid-learn).
+    pub fn stateSize(self: *const SpectralMatchPlugin) usize {
+        return 4 + 4 * self.reference.len;
+    }
+
+    pub fn saveState(self: *const SpectralMatchPlugin, out: []u8) void {
+        var w: state.Writer = .{ .bytes = out };
+        w.int(u32, @intCast(self.reference_frames));
+        w.floats(self.reference);
+    }
+
+    pub fn loadState(self: *SpectralMatchPlugin, data: []const u8) void {
+        var r: state.Reader = .{ .bytes = data };
+        self.reference_frames = r.int(u32);
+        r.floats(self.reference);
+    }
 };
 
 fn impl_create(allocator: std.mem.Allocator, sample_rate: f32) ?*anyopaque {
@@ -66,11 +139,29 @@ fn impl_destroy(ptr: *anyopaque, allocator: std.mem.Allocator) void {
     self.deinit(allocator);
 }
 
+fn impl_prepare(ptr: *anyopaque, allocator: std.mem.Allocator, sample_rate: f32, max_block: usize) bool {
+    _ = allocator;
+    _ = max_block;
+    const self = @as(*SpectralMatchPlugin, @ptrCast(@alignCast(ptr)));
+    self.prepare(sample_rate);
+    return true;
+}
+
 fn impl_process(ptr: *anyopaque, inputs: [*]const [*]const f32, outputs: [*][*]f32, frames: usize) void {
     const self = @as(*SpectralMatchPlugin, @ptrCast(@alignCast(ptr)));
     self.process(inputs, outputs, frames);
 }
 
+fn impl_latency(ptr: *anyopaque) u32 {
+    const self = @as(*SpectralMatchPlugin, @ptrCast(@alignCast(ptr)));
+    return self.latency();
+}
+
+fn impl_tail(ptr: *anyopaque) u32 {
+    const self = @as(*SpectralMatchPlugin, @ptrCast(@alignCast(ptr)));
+    return self.tail();
+}
+
 fn impl_set_parameter(ptr: *anyopaque, index: i32, value: f32) void {
     const self = @as(*SpectralMatchPlugin, @ptrCast(@alignCast(ptr)));
     self.setParameter(index, value);
@@ -81,10 +172,31 @@ fn impl_get_parameter(ptr: *anyopaque, index: i32) f32 {
     return self.getParameter(index);
 }
 
+fn impl_state_size(ptr: *anyopaque) usize {
+    const self = @as(*SpectralMatchPlugin, @ptrCast(@alignCast(ptr)));
+    return self.stateSize();
+}
+
+fn impl_save_state(ptr: *anyopaque, out: []u8) void {
+    const self = @as(*SpectralMatchPlugin, @ptrCast(@alignCast(ptr)));
+    self.saveState(out);
+}
+
+fn impl_load_state(ptr: *anyopaque, data: []const u8) void {
+    const self = @as(*SpectralMatchPlugin, @ptrCast(@alignCast(ptr)));
+    self.loadState(data);
+}
+
 pub const plugin_impl = struct {
     pub const create = impl_create;
     pub const destroy = impl_destroy;
+    pub const prepare = impl_prepare;
     pub const process = impl_process;
     pub const set_parameter = impl_set_parameter;
     pub const get_parameter = impl_get_parameter;
+    pub const latency = impl_latency;
+    pub const tail = impl_tail;
+    pub const state_size = impl_state_size;
+    pub const save_state = impl_save_state;
+    pub const load_state = impl_load_state;
 };
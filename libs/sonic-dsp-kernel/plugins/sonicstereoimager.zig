@@ -1,5 +1,6 @@
 const std = @import("std");
 const eq = @import("../modules/eq.zig");
+const shared = @import("../dsp/shared.zig");
 
 pub const StereoImagerPlugin = struct {
     params: struct {
@@ -10,43 +11,30 @@ pub const StereoImagerPlugin = struct {
         width_high: f32 = 1.0,
     },
     sample_rate: f32,
+    imager: eq.StereoImager = .{},
 
     pub fn init(allocator: std.mem.Allocator, sample_rate: f32) !*StereoImagerPlugin {
         const self = try allocator.create(StereoImagerPlugin);
         self.sample_rate = sample_rate;
         self.params = .{};
+        self.imager = .{};
         return self;
     }
 
+    pub fn prepare(self: *StereoImagerPlugin, sample_rate: f32) void {
+        self.sample_rate = sample_rate;
+    }
+
     pub fn deinit(self: *StereoImagerPlugin, allocator: std.mem.Allocator) void {
         allocator.destroy(self);
     }
 
     pub fn process(self: *StereoImagerPlugin, inputs: [*]const [*]const f32, outputs: [*][*]f32, frames: usize) void {
-        const in_l = inputs[0][0..frames];
-        const in_r = inputs[1][0..frames];
-        const out_l = outputs[0][0..frames];
-        const out_r = outputs[1][0..frames];
+        shared.processInterleavedStereo(self, processChunk, inputs, outputs, frames);
+    }
 
-        var interleaved: [1024]f32 = undefined;
-        const total_samples = frames * 2;
-        
-        if (total_samples <= interleaved.len) {
-            for (0..frames) |i| {
-                interleaved[i * 2] = in_l[i];
-                interleaved[i * 2 + 1] = in_r[i];
-            }
-            
-            eq.processStereoImager(interleaved[0..total_samples], self.sample_rate, self.params.low_freq, self.params.high_freq, self.params.width_low, self.params.width_mid, self.params.width_high);
-            
-            for (0..frames) |i| {
-                out_l[i] = interleaved[i * 2];
-                out_r[i] = interleaved[i * 2 + 1];
-            }
-        } else {
-            @memcpy(out_l, in_l);
-            @memcpy(out_r, in_r);
-        }
+    fn processChunk(self: *StereoImagerPlugin, data: []f32) void {
+        self.imager.process(data, self.sample_rate, self.params.low_freq, self.params.high_freq, self.params.width_low, self.params.width_mid, self.params.width_high);
     }
 
     pub fn setParameter(self: *StereoImagerPlugin, index: i32, value: f32) void {
@@ -85,6 +73,14 @@ fn impl_destroy(ptr: *anyopaque, allocator: std.mem.Allocator) void {
     self.deinit(allocator);
 }
 
+fn impl_prepare(ptr: *anyopaque, allocator: std.mem.Allocator, sample_rate: f32, max_block: usize) bool {
+    _ = allocator;
+    _ = max_block;
+    const self = @as(*StereoImagerPlugin, @ptrCast(@alignCast(ptr)));
+    self.prepare(sample_rate);
+    return true;
+}
+
 fn impl_process(ptr: *anyopaque, inputs: [*]const [*]const f32, outputs: [*][*]f32, frames: usize) void {
     const self = @as(*StereoImagerPlugin, @ptrCast(@alignCast(ptr)));
     self.process(inputs, outputs, frames);
@@ -103,6 +99,7 @@ fn impl_get_parameter(ptr: *anyopaque, index: i32) f32 {
 pub const plugin_impl = struct {
     pub const create = impl_create;
     pub const destroy = impl_destroy;
+    pub const prepare = impl_prepare;
     pub const process = impl_process;
     pub const set_parameter = impl_set_parameter;
     pub const get_parameter = impl_get_parameter;
@@ -3,49 +3,58 @@ const dsp = @import("../tape_stabilizer.zig");
 
 pub const TapeStabilizerPlugin = struct {
     nominal_freq: f32,
-    scan_min: f32,
-    scan_max: f32,
     correction: f32,
     sample_rate: f32,
+    stabilizer: dsp.StreamingStabilizer,
 
     pub fn init(allocator: std.mem.Allocator, sample_rate: f32) !*TapeStabilizerPlugin {
         const self = try allocator.create(TapeStabilizerPlugin);
+        errdefer allocator.destroy(self);
         self.nominal_freq = 60.0;
-        self.scan_min = 55.0;
-        self.scan_max = 65.0;
         self.correction = 1.0;
         self.sample_rate = sample_rate;
+        self.stabilizer = try dsp.StreamingStabilizer.init(allocator, sample_rate, self.nominal_freq);
         return self;
     }
 
+    /// Frame and delay lengths follow the sample rate, so only a new rate
+    /// rebuilds the stabilizer.
+    pub fn prepare(self: *TapeStabilizerPlugin, allocator: std.mem.Allocator, sample_rate: f32) !void {
+        if (sample_rate != self.sample_rate) {
+            var stabilizer = try dsp.StreamingStabilizer.init(allocator, sample_rate, self.nominal_freq);
+            stabilizer.correction = self.correction;
+            self.stabilizer.deinit(allocator);
+            self.stabilizer = stabilizer;
+        }
+        self.sample_rate = sample_rate;
+    }
+
     pub fn deinit(self: *TapeStabilizerPlugin, allocator: std.mem.Allocator) void {
+        self.stabilizer.deinit(allocator);
         allocator.destroy(self);
     }
 
     pub fn process(self: *TapeStabilizerPlugin, inputs: [*]const [*]const f32, outputs: [*][*]f32, frames: usize) void {
-        const in_l = inputs[0];
-        const out_l = outputs[0];
-        const out_r = outputs[1];
-
-        // Copy Input -> Output
-        @memcpy(out_l[0..frames], in_l[0..frames]);
-
-        // Tape Stabilizer is an offline/lookahead process that modifies a buffer.
-        // In a real-time context (VST3 process block), this is extremely difficult 
-        // because it changes the length of the audio (pitch correction via resampling).
-        
-        // For the VST3 wrapper, we treat it as a passthrough or a very limited 
-        // block-based corrector (which will glitch).
-        
-        // dsp.process_tapestabilizer(out_l, frames, self.sample_rate, self.nominal_freq, self.scan_min, self.scan_max, self.correction);
-
-        // Dual Mono
-        @memcpy(out_r[0..frames], out_l[0..frames]);
+        self.stabilizer.process(inputs[0][0..frames], inputs[1][0..frames], outputs[0][0..frames], outputs[1][0..frames]);
+    }
+
+    pub fn latency(self: *const TapeStabilizerPlugin) u32 {
+        return @intCast(self.stabilizer.latency);
+    }
+
+    pub fn tail(self: *const TapeStabilizerPlugin) u32 {
+        return @intCast(self.stabilizer.tail());
     }
 
     pub fn setParameter(self: *TapeStabilizerPlugin, index: i32, value: f32) void {
-        if (index == 0) self.nominal_freq = 40.0 + (value * 60.0); // 40-100Hz
-        if (index == 1) self.correction = value;
+        if (index == 0) {
+            self.nominal_freq = 40.0 + (value * 60.0); // 40-100Hz
+            self.stabilizer.setNominal(self.nominal_freq);
+        }
+        if (index == 1) {
+            self.correction = value;
+            self.stabilizer.correction = value;
+        }
     }
 
     pub fn getParameter(self: *TapeStabilizerPlugin, index: i32) f32 {
@@ -68,11 +77,28 @@ fn impl_destroy(ptr: *anyopaque, allocator: std.mem.Allocator) void {
     self.deinit(allocator);
 }
 
+fn impl_prepare(ptr: *anyopaque, allocator: std.mem.Allocator, sample_rate: f32, max_block: usize) bool {
+    _ = max_block;
+    const self = @as(*TapeStabilizerPlugin, @ptrCast(@alignCast(ptr)));
+    self.prepare(allocator, sample_rate) catch return false;
+    return true;
+}
+
 fn impl_process(ptr: *anyopaque, inputs: [*]const [*]const f32, outputs: [*][*]f32, frames: usize) void {
     const self = @as(*TapeStabilizerPlugin, @ptrCast(@alignCast(ptr)));
     self.process(inputs, outputs, frames);
 }
 
+fn impl_latency(ptr: *anyopaque) u32 {
+    const self = @as(*TapeStabilizerPlugin, @ptrCast(@alignCast(ptr)));
+    return self.latency();
+}
+
+fn impl_tail(ptr: *anyopaque) u32 {
+    const self = @as(*TapeStabilizerPlugin, @ptrCast(@alignCast(ptr)));
+    return self.tail();
+}
+
 fn impl_set_parameter(ptr: *anyopaque, index: i32, value: f32) void {
     const self = @as(*TapeStabilizerPlugin, @ptrCast(@alignCast(ptr)));
     self.setParameter(index, value);
@@ -86,7 +112,10 @@ fn impl_get_parameter(ptr: *anyopaque, index: i32) f32 {
 pub const plugin_impl = struct {
     pub const create = impl_create;
     pub const destroy = impl_destroy;
+    pub const prepare = impl_prepare;
     pub const process = impl_process;
     pub const set_parameter = impl_set_parameter;
     pub const get_parameter = impl_get_parameter;
+    pub const latency = impl_latency;
+    pub const tail = impl_tail;
 };
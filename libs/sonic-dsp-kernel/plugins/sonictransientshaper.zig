@@ -1,44 +1,34 @@
 const std = @import("std");
 const dynamics = @import("../modules/dynamics.zig");
+const shared = @import("../dsp/shared.zig");
 
 pub const TransientShaperPlugin = struct {
     ts: dynamics.TransientShaper,
+    channels: usize,
 
     pub fn init(allocator: std.mem.Allocator, sample_rate: f32) !*TransientShaperPlugin {
         const self = try allocator.create(TransientShaperPlugin);
         self.ts = dynamics.TransientShaper{ .sample_rate = sample_rate };
+        self.channels = 2;
         return self;
     }
 
+    pub fn prepare(self: *TransientShaperPlugin, sample_rate: f32) void {
+        self.ts.sample_rate = sample_rate;
+    }
+
     pub fn deinit(self: *TransientShaperPlugin, allocator: std.mem.Allocator) void {
         allocator.destroy(self);
     }
 
     pub fn process(self: *TransientShaperPlugin, inputs: [*]const [*]const f32, outputs: [*][*]f32, frames: usize) void {
-        const in_l = inputs[0][0..frames];
-        const in_r = inputs[1][0..frames];
-        const out_l = outputs[0][0..frames];
-        const out_r = outputs[1][0..frames];
-
-        var interleaved: [1024]f32 = undefined;
-        const total_samples = frames * 2;
-        
-        if (total_samples <= interleaved.len) {
-            for (0..frames) |i| {
-                interleaved[i * 2] = in_l[i];
-                interleaved[i * 2 + 1] = in_r[i];
-            }
-            
-            self.ts.process(interleaved[0..total_samples]);
-            
-            for (0..frames) |i| {
-                out_l[i] = interleaved[i * 2];
-                out_r[i] = interleaved[i * 2 + 1];
-            }
-        } else {
-            @memcpy(out_l, in_l);
-            @memcpy(out_r, in_r);
-        }
+        self.ts.processChannels(inputs, outputs, self.channels, frames);
+    }
+
+    /// Bus width from the host; restarts the envelopes.
+    pub fn setChannels(self: *TransientShaperPlugin, channels: usize) void {
+        self.channels = channels;
+        self.ts.reset();
     }
 
     pub fn setParameter(self: *TransientShaperPlugin, index: i32, value: f32) void {
@@ -73,11 +63,24 @@ fn impl_destroy(ptr: *anyopaque, allocator: std.mem.Allocator) void {
     self.deinit(allocator);
 }
 
+fn impl_prepare(ptr: *anyopaque, allocator: std.mem.Allocator, sample_rate: f32, max_block: usize) bool {
+    _ = allocator;
+    _ = max_block;
+    const self = @as(*TransientShaperPlugin, @ptrCast(@alignCast(ptr)));
+    self.prepare(sample_rate);
+    return true;
+}
+
 fn impl_process(ptr: *anyopaque, inputs: [*]const [*]const f32, outputs: [*][*]f32, frames: usize) void {
     const self = @as(*TransientShaperPlugin, @ptrCast(@alignCast(ptr)));
     self.process(inputs, outputs, frames);
 }
 
+fn impl_set_channels(ptr: *anyopaque, channels: u32) void {
+    const self = @as(*TransientShaperPlugin, @ptrCast(@alignCast(ptr)));
+    self.setChannels(channels);
+}
+
 fn impl_set_parameter(ptr: *anyopaque, index: i32, value: f32) void {
     const self = @as(*TransientShaperPlugin, @ptrCast(@alignCast(ptr)));
     self.setParameter(index, value);
@@ -91,7 +94,10 @@ fn impl_get_parameter(ptr: *anyopaque, index: i32) f32 {
 pub const plugin_impl = struct {
     pub const create = impl_create;
     pub const destroy = impl_destroy;
+    pub const prepare = impl_prepare;
     pub const process = impl_process;
     pub const set_parameter = impl_set_parameter;
     pub const get_parameter = impl_get_parameter;
+    pub const set_channels = impl_set_channels;
+    pub const max_channels = shared.max_channels;
 };
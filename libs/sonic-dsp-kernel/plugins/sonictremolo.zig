@@ -1,5 +1,6 @@
 const std = @import("std");
 const modulation = @import("../modules/modulation.zig");
+const shared = @import("../dsp/shared.zig");
 
 pub const TremoloPlugin = struct {
     frequency: f32 = 2.0,
@@ -7,42 +8,28 @@ pub const TremoloPlugin = struct {
     waveform: i32 = 0,
     mix: f32 = 1.0,
     sample_rate: f32,
+    lfo: modulation.Tremolo = .{},
 
     pub fn init(allocator: std.mem.Allocator, sample_rate: f32) !*TremoloPlugin {
         const self = try allocator.create(TremoloPlugin);
-        self.sample_rate = sample_rate;
+        self.* = .{ .sample_rate = sample_rate };
         return self;
     }
 
+    pub fn prepare(self: *TremoloPlugin, sample_rate: f32) void {
+        self.sample_rate = sample_rate;
+    }
+
     pub fn deinit(self: *TremoloPlugin, allocator: std.mem.Allocator) void {
         allocator.destroy(self);
     }
 
     pub fn process(self: *TremoloPlugin, inputs: [*]const [*]const f32, outputs: [*][*]f32, frames: usize) void {
-        const in_l = inputs[0][0..frames];
-        const in_r = inputs[1][0..frames];
-        const out_l = outputs[0][0..frames];
-        const out_r = outputs[1][0..frames];
+        shared.processInterleavedStereo(self, processChunk, inputs, outputs, frames);
+    }
 
-        var interleaved: [1024]f32 = undefined;
-        const total_samples = frames * 2;
-        
-        if (total_samples <= interleaved.len) {
-            for (0..frames) |i| {
-                interleaved[i * 2] = in_l[i];
-                interleaved[i * 2 + 1] = in_r[i];
-            }
-            
-            modulation.processTremolo(interleaved[0..total_samples], self.sample_rate, self.frequency, self.depth, self.waveform, self.mix);
-            
-            for (0..frames) |i| {
-                out_l[i] = interleaved[i * 2];
-                out_r[i] = interleaved[i * 2 + 1];
-            }
-        } else {
-            @memcpy(out_l, in_l);
-            @memcpy(out_r, in_r);
-        }
+    fn processChunk(self: *TremoloPlugin, data: []f32) void {
+        self.lfo.process(data, self.sample_rate, self.frequency, self.depth, self.waveform, self.mix);
     }
 
     pub fn setParameter(self: *TremoloPlugin, index: i32, value: f32) void {
@@ -79,6 +66,14 @@ fn impl_destroy(ptr: *anyopaque, allocator: std.mem.Allocator) void {
     self.deinit(allocator);
 }
 
+fn impl_prepare(ptr: *anyopaque, allocator: std.mem.Allocator, sample_rate: f32, max_block: usize) bool {
+    _ = allocator;
+    _ = max_block;
+    const self = @as(*TremoloPlugin, @ptrCast(@alignCast(ptr)));
+    self.prepare(sample_rate);
+    return true;
+}
+
 fn impl_process(ptr: *anyopaque, inputs: [*]const [*]const f32, outputs: [*][*]f32, frames: usize) void {
     const self = @as(*TremoloPlugin, @ptrCast(@alignCast(ptr)));
     self.process(inputs, outputs, frames);
@@ -97,6 +92,7 @@ fn impl_get_parameter(ptr: *anyopaque, index: i32) f32 {
 pub const plugin_impl = struct {
     pub const create = impl_create;
     pub const destroy = impl_destroy;
+    pub const prepare = impl_prepare;
     pub const process = impl_process;
     pub const set_parameter = impl_set_parameter;
     pub const get_parameter = impl_get_parameter;
@@ -1,43 +1,61 @@
 const std = @import("std");
 const dsp = @import("../voice_isolate.zig");
+const StreamingStft = @import("../dsp/stft.zig").StreamingStft;
 
 pub const VoiceIsolatePlugin = struct {
     amount: f32,
     sample_rate: f32,
+    stft: StreamingStft,
+    model: dsp.VoiceIsolateModel,
 
     pub fn init(allocator: std.mem.Allocator, sample_rate: f32) !*VoiceIsolatePlugin {
         const self = try allocator.create(VoiceIsolatePlugin);
+        errdefer allocator.destroy(self);
         self.amount = 0.5;
         self.sample_rate = sample_rate;
+        self.model = dsp.VoiceIsolateModel.init();
+        self.stft = try StreamingStft.init(allocator, .{ .size = dsp.WINDOW_SIZE, .hop = dsp.HOP_SIZE });
         return self;
     }
 
+    pub fn prepare(self: *VoiceIsolatePlugin, allocator: std.mem.Allocator, sample_rate: f32, max_block: usize) !void {
+        try self.stft.prepare(allocator, max_block);
+        self.sample_rate = sample_rate;
+    }
+
     pub fn deinit(self: *VoiceIsolatePlugin, allocator: std.mem.Allocator) void {
+        self.stft.deinit(allocator);
         allocator.destroy(self);
     }
 
     pub fn process(self: *VoiceIsolatePlugin, inputs: [*]const [*]const f32, outputs: [*][*]f32, frames: usize) void {
-        // Assume stereo input/output
-        // Voice Isolate works on mono buffer in-place in current impl?
-        // Let's check dsp.process_voiceisolate signature: (ptr: [*]f32, len: usize, amount: f32)
-        // It modifies in-place.
-        
-        const in_l = inputs[0];
-        const out_l = outputs[0];
-        
-        // Copy Input -> Output
-        @memcpy(out_l[0..frames], in_l[0..frames]);
-        
-        // Process In-Place
-        dsp.process_voiceisolate(out_l, frames, self.amount);
-        
+        const in_l = inputs[0][0..frames];
+        const out_l = outputs[0][0..frames];
+
+        self.stft.processIndependent(&.{in_l}, &.{out_l}, frames, self, processFrame);
+
         // Copy L -> R (Dual Mono for now, or process R if needed)
-        // If inputs[1] exists, we might want to process it too.
-        // For now, let's just copy L to R to ensure output.
-        // A safer way is checking if outputs[1] is not null (which we can't easily do with [*] pointer without num_channels context)
         // We assume stereo context from VST3 wrapper.
         const out_r = outputs[1];
-        @memcpy(out_r[0..frames], out_l[0..frames]);
+        @memcpy(out_r[0..frames], out_l);
+    }
+
+    /// The model keeps no state from one frame to the next, so frames can
+    /// run on worker threads in any order.
+    fn processFrame(self: *VoiceIsolatePlugin, stft: *StreamingStft) void {
+        dsp.mask_frame(&self.model, stft.spectrum(0), self.amount);
+    }
+
+    pub fn setThreads(self: *VoiceIsolatePlugin, threads: u32) void {
+        self.stft.setThreads(threads);
+    }
+
+    pub fn latency(self: *const VoiceIsolatePlugin) u32 {
+        return @intCast(self.stft.latency());
+    }
+
+    pub fn tail(self: *const VoiceIsolatePlugin) u32 {
+        return @intCast(self.stft.tail());
     }
 
     pub fn setParameter(self: *VoiceIsolatePlugin, index: i32, value: f32) void {
@@ -68,11 +86,32 @@ fn impl_destroy(ptr: *anyopaque, allocator: std.mem.Allocator) void {
     self.deinit(allocator);
 }
 
+fn impl_prepare(ptr: *anyopaque, allocator: std.mem.Allocator, sample_rate: f32, max_block: usize) bool {
+    const self = @as(*VoiceIsolatePlugin, @ptrCast(@alignCast(ptr)));
+    self.prepare(allocator, sample_rate, max_block) catch return false;
+    return true;
+}
+
 fn impl_process(ptr: *anyopaque, inputs: [*]const [*]const f32, outputs: [*][*]f32, frames: usize) void {
     const self = @as(*VoiceIsolatePlugin, @ptrCast(@alignCast(ptr)));
     self.process(inputs, outputs, frames);
 }
 
+fn impl_set_threads(ptr: *anyopaque, threads: u32) void {
+    const self = @as(*VoiceIsolatePlugin, @ptrCast(@alignCast(ptr)));
+    self.setThreads(threads);
+}
+
+fn impl_latency(ptr: *anyopaque) u32 {
+    const self = @as(*VoiceIsolatePlugin, @ptrCast(@alignCast(ptr)));
+    return self.latency();
+}
+
+fn impl_tail(ptr: *anyopaque) u32 {
+    const self = @as(*VoiceIsolatePlugin, @ptrCast(@alignCast(ptr)));
+    return self.tail();
+}
+
 fn impl_set_parameter(ptr: *anyopaque, index: i32, value: f32) void {
     const self = @as(*VoiceIsolatePlugin, @ptrCast(@alignCast(ptr)));
     self.setParameter(index, value);
@@ -86,7 +125,11 @@ fn impl_get_parameter(ptr: *anyopaque, index: i32) f32 {
 pub const plugin_impl = struct {
     pub const create = impl_create;
     pub const destroy = impl_destroy;
+    pub const prepare = impl_prepare;
     pub const process = impl_process;
     pub const set_parameter = impl_set_parameter;
     pub const get_parameter = impl_get_parameter;
+    pub const latency = impl_latency;
+    pub const tail = impl_tail;
+    pub const set_threads = impl_set_threads;
 };
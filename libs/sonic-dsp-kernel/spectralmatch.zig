@@ -9,8 +9,8 @@ pub const AnalysisResult = struct {
     size: usize,
 };
 
-const WINDOW_SIZE: usize = 4096;
-const HOP_SIZE: usize = 2048;
+pub const WINDOW_SIZE: usize = 4096;
+pub const HOP_SIZE: usize = 2048;
 
 fn create_hanning_window(size: usize) ![]f32 {
     const window = try allocator.alloc(f32, size);
@@ -24,11 +24,21 @@ fn create_hanning_window(size: usize) ![]f32 {
 // 1/3 Octave Smoothing
 // Simple implementation: Moving average with width proportional to frequency
 fn smooth_spectrum(spectrum: []f32) void {
-    const len = spectrum.len;
     // We need a temp buffer
-    const temp = allocator.alloc(f32, len) catch return;
-    defer allocator.free(temp);
-    @memcpy(temp, spectrum);
+    const prefix = allocator.alloc(f64, spectrum.len + 1) catch return;
+    defer allocator.free(prefix);
+    smooth_spectrum_with(spectrum, prefix);
+}
+
+/// smooth_spectrum with caller-provided scratch of spectrum.len + 1, for
+/// the audio thread. Running sums make each bin's average O(1); they are
+/// kept in f64 so quiet high bins survive the subtraction.
+pub fn smooth_spectrum_with(spectrum: []f32, prefix: []f64) void {
+    const len = spectrum.len;
+    std.debug.assert(prefix.len == len + 1);
+
+    prefix[0] = 0;
+    for (spectrum, 0..) |x, i| prefix[i + 1] = prefix[i] + x;
 
     const octave_width: f32 = 0.333; // 1/3 octave
     const factor = std.math.pow(f32, 2.0, octave_width) - 1.0; // Approximation of bandwidth
@@ -44,18 +54,31 @@ fn smooth_spectrum(spectrum: []f32) void {
         const start = if (i > w_int) i - w_int else 0;
         const end = if (i + w_int >= len) len - 1 else i + w_int;
 
-        var sum: f32 = 0;
-        const count = @as(f32, @floatFromInt(end - start + 1));
-
-        var j = start;
-        while (j <= end) : (j += 1) {
-            sum += temp[j];
-        }
+        const sum = prefix[end + 1] - prefix[start];
+        const count = @as(f64, @floatFromInt(end - start + 1));
 
-        spectrum[i] = sum / count;
+        spectrum[i] = @floatCast(sum / count);
     }
 }
 
+fn match_gain(ref_power: f32, target_power: f32, amount: f32) f32 {
+    const tgt = target_power + 1e-9; // Avoid div by zero
+
+    const ratio = ref_power / tgt;
+
+    // Convert to dB to clamp
+    var db = math.linearToDb(std.math.sqrt(ratio));
+
+    // Clamp +/- 12dB
+    if (db > 12.0) db = 12.0;
+    if (db < -12.0) db = -12.0;
+
+    // Apply amount
+    db *= amount;
+
+    return math.dbToLinear(db);
+}
+
 // Analyze spectrum of a buffer
 // Returns a heap-allocated array of power spectrum
 fn analyze_signal(data: []f32) ![]f32 {
@@ -71,6 +94,8 @@ fn analyze_signal(data: []f32) ![]f32 {
 
     const fft_buf = try allocator.alloc(math.Complex, WINDOW_SIZE);
     defer allocator.free(fft_buf);
+    var plan = math.fftPlan(allocator, WINDOW_SIZE);
+    defer math.deinitFftPlan(&plan, allocator);
 
     var pos: usize = 0;
     var frames: usize = 0;
@@ -82,7 +107,7 @@ fn analyze_signal(data: []f32) ![]f32 {
             fft_buf[i] = .{ .re = data[pos + i] * window[i], .im = 0 };
         }
 
-        math.fft_iterative(fft_buf, false);
+        math.fft_iterative(&plan, fft_buf, false);
 
         // Accumulate Power
         i = 0;
@@ -146,22 +171,7 @@ export fn process_spectralmatch(
 
     var i: usize = 0;
     while (i < filter_len) : (i += 1) {
-        const ref = ref_analysis.power_spectrum[i];
-        const tgt = target_spec[i] + 1e-9; // Avoid div by zero
-
-        const ratio = ref / tgt;
-
-        // Convert to dB to clamp
-        var db = math.linearToDb(std.math.sqrt(ratio));
-
-        // Clamp +/- 12dB
-        if (db > 12.0) db = 12.0;
-        if (db < -12.0) db = -12.0;
-
-        // Apply amount
-        db *= amount;
-
-        filter_mag[i] = math.dbToLinear(db);
+        filter_mag[i] = match_gain(ref_analysis.power_spectrum[i], target_spec[i], amount);
     }
 
     // 3. Generate Linear Phase IR
@@ -169,6 +179,8 @@ export fn process_spectralmatch(
     const fft_size = WINDOW_SIZE;
     const ir_spec = allocator.alloc(math.Complex, fft_size) catch return;
     defer allocator.free(ir_spec);
+    var ir_plan = math.fftPlan(allocator, fft_size);
+    defer math.deinitFftPlan(&ir_plan, allocator);
 
     // Linear Phase: Constant Group Delay of N/2
     // Phase = -2*pi*k * (N/2) / N = -pi*k
@@ -208,7 +220,7 @@ export fn process_spectralmatch(
     }
 
     // Inverse FFT -> Zero Phase IR
-    math.fft_iterative(ir_spec, true);
+    math.fft_iterative(&ir_plan, ir_spec, true);
 
     // Extract Real part and Shift to make it Linear Phase (Casual)
     const ir = allocator.alloc(f32, fft_size) catch return;
@@ -266,6 +278,8 @@ export fn process_spectralmatch(
 
     const fft_conv_buf = allocator.alloc(math.Complex, N) catch return;
     defer allocator.free(fft_conv_buf);
+    var conv_plan = math.fftPlan(allocator, N);
+    defer math.deinitFftPlan(&conv_plan, allocator);
 
     // Prepare IR spectrum for N=8192
     const ir_padded = allocator.alloc(math.Complex, N) catch return;
@@ -276,7 +290,7 @@ export fn process_spectralmatch(
     while (i < fft_size) : (i += 1) {
         ir_padded[i] = .{ .re = ir[i], .im = 0 };
     }
-    math.fft_iterative(ir_padded, false);
+    math.fft_iterative(&conv_plan, ir_padded, false);
 
     var pos: usize = 0;
     while (pos < target_len) : (pos += L) {
@@ -291,7 +305,7 @@ export fn process_spectralmatch(
             fft_conv_buf[j].re = target_data[pos + j];
         }
 
-        math.fft_iterative(fft_conv_buf, false);
+        math.fft_iterative(&conv_plan, fft_conv_buf, false);
 
         // Multiply
         j = 0;
@@ -299,7 +313,7 @@ export fn process_spectralmatch(
             fft_conv_buf[j] = fft_conv_buf[j].mul(ir_padded[j]);
         }
 
-        math.fft_iterative(fft_conv_buf, true);
+        math.fft_iterative(&conv_plan, fft_conv_buf, true);
 
         // Add to output
         j = 0;
@@ -311,3 +325,75 @@ export fn process_spectralmatch(
     // Copy back to target (truncating tail)
     @memcpy(target_data, output_buf[0..target_len]);
 }
+
+/// Streaming match EQ for the plugin, one STFT frame of WINDOW_SIZE
+/// samples at a time. The target's spectrum is a running average over the
+/// last few seconds instead of the whole file, smoothed like the reference,
+/// and the match curve is applied as a per-bin gain on the frame rather
+/// than as a linear-phase FIR.
+pub const StreamingMatch = struct {
+    /// Running average of the frame power, per bin
+    average: []f32,
+    /// Smoothed copy of average the gains are computed from
+    smoothed: []f32,
+    prefix: []f64,
+    /// Converts the frame power to the Hann-windowed scale analyze_signal
+    /// uses, so reference and target are comparable
+    power_scale: f32,
+    /// False until the first frame, which seeds the average
+    primed: bool,
+
+    /// Time constant of the running average
+    const average_seconds: f32 = 3.0;
+
+    /// window: the analysis window of the frames passed to processFrame.
+    pub fn init(alloc: std.mem.Allocator, window: []const f32) !StreamingMatch {
+        std.debug.assert(window.len == WINDOW_SIZE);
+        const bins = WINDOW_SIZE / 2 + 1;
+        const average = try alloc.alloc(f32, bins);
+        errdefer alloc.free(average);
+        const smoothed = try alloc.alloc(f32, bins);
+        errdefer alloc.free(smoothed);
+        const prefix = try alloc.alloc(f64, bins + 1);
+        @memset(average, 0);
+
+        var hann_energy: f32 = 0;
+        var window_energy: f32 = 0;
+        for (window, 0..) |w, i| {
+            const h = 0.5 * (1.0 - std.math.cos(math.TWO_PI * @as(f32, @floatFromInt(i)) / @as(f32, @floatFromInt(WINDOW_SIZE - 1))));
+            hann_energy += h * h;
+            window_energy += w * w;
+        }
+        return .{ .average = average, .smoothed = smoothed, .prefix = prefix, .power_scale = hann_energy / window_energy, .primed = false };
+    }
+
+    pub fn deinit(self: *StreamingMatch, alloc: std.mem.Allocator) void {
+        alloc.free(self.prefix);
+        alloc.free(self.smoothed);
+        alloc.free(self.average);
+    }
+
+    /// bins: the frame's WINDOW_SIZE/2 + 1 bins, edited in place when a
+    /// reference is given. hop_seconds: time between frames.
+    pub fn processFrame(self: *StreamingMatch, bins: []math.Complex, ref_analysis: ?*const AnalysisResult, amount: f32, hop_seconds: f32) void {
+        std.debug.assert(bins.len == self.average.len);
+        const keep = @exp(-hop_seconds / average_seconds);
+        for (self.average, bins) |*avg, bin| {
+            const power = (bin.re * bin.re + bin.im * bin.im) * self.power_scale;
+            avg.* = if (self.primed) keep * avg.* + (1.0 - keep) * power else power;
+        }
+        self.primed = true;
+
+        const ref = ref_analysis orelse return;
+        @memcpy(self.smoothed, self.average);
+        smooth_spectrum_with(self.smoothed, self.prefix);
+
+        for (bins, self.smoothed, 0..) |*bin, target, k| {
+            // The reference stops short of Nyquist
+            const ref_power = ref.power_spectrum[@min(k, ref.size - 1)];
+            const gain = match_gain(ref_power, target, amount);
+            bin.re *= gain;
+            bin.im *= gain;
+        }
+    }
+};
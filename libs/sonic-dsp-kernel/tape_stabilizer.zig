@@ -1,6 +1,8 @@
 const std = @import("std");
 const math = @import("math_utils.zig");
-const Yin = @import("pitch_detect.zig").Yin;
+const pitch = @import("pitch_detect.zig");
+const Yin = pitch.Yin;
+const YinTracker = pitch.YinTracker;
 
 // Use a local allocator for this module's internal allocations
 var gpa = std.heap.GeneralPurposeAllocator(.{}){};
@@ -33,6 +35,17 @@ export fn process_tapestabilizer(
     const freqs = allocator.alloc(f32, num_frames) catch return;
     defer allocator.free(freqs);
 
+    // One tracker for the whole file; a range it can't search in a window
+    // this short finds nothing, and every frame falls back to nominal
+    var tracker: ?YinTracker = YinTracker.init(allocator, .{
+        .size = window_size,
+        .hop = hop_size,
+        .sample_rate = sample_rate,
+        .min_freq = scan_freq_min,
+        .max_freq = scan_freq_max,
+    }) catch null;
+    defer if (tracker) |*t| t.deinit(allocator);
+
     // 2. Pitch Detection Loop
     var frame_idx: usize = 0;
     var pos: usize = 0;
@@ -41,7 +54,7 @@ export fn process_tapestabilizer(
         if (pos + window_size > len) break;
 
         const window = input[pos..][0..window_size];
-        const detected = Yin.detect(allocator, window, sample_rate, scan_freq_min, scan_freq_max) catch 0.0;
+        const detected = if (tracker) |*t| t.analyse(window).freq else 0.0;
 
         // Validation: If 0 or wild, use nominal
         if (detected > 0) {
@@ -148,3 +161,207 @@ export fn process_tapestabilizer(
     }
     @memcpy(input[0..write_pos], output[0..write_pos]);
 }
+
+/// Real-time wow and flutter correction against a recorded reference tone
+/// (mains hum, a pilot), for the plugin.
+///
+/// process_tapestabilizer measures the whole file and may drift the read
+/// position without bound; a real-time stage can't run ahead of its input,
+/// so this one reads through a delay line whose length moves instead. A
+/// YinTracker measures the tone every hop on the mid signal, and each
+/// output sample advances the read head at nominal / measured, interpolated
+/// between the frames around the sample being read, as the offline process
+/// does. The speed is taken relative to its own average over
+/// follow_seconds, so a tape that runs 1% slow throughout stays 1% slow and
+/// only wow and flutter move the head; it may drift max_drift_seconds either
+/// side of its resting delay. Frames with no clear period hold the last
+/// measurement; until the first one, and for input with no tone at all,
+/// the output is the input delayed by exactly `latency` samples.
+///
+/// A frame's estimate belongs to the samples YIN compares, the first half
+/// plus one period, and is placed at their centre. The delay covers that
+/// point in the newest frame plus one hop, so the frames either side of the
+/// read head are always already measured. Everything is allocated in init;
+/// process never allocates.
+pub const StreamingStabilizer = struct {
+    /// Nominal frequencies the plugin offers; they size the frames and the delay
+    pub const min_nominal: f32 = 40.0;
+    pub const max_nominal: f32 = 100.0;
+    /// Search range as a fraction of nominal: 55-65 Hz at 60, the offline
+    /// process's defaults
+    const scan_low: f32 = 11.0 / 12.0;
+    const scan_high: f32 = 13.0 / 12.0;
+    const follow_seconds: f32 = 4.0;
+    const max_drift_seconds: f32 = 0.05;
+    /// Pulls the head back against measurement error piling up; long
+    /// enough not to touch the correction
+    const recentre_seconds: f32 = 30.0;
+    /// Speed ratios kept; the read head is never more than a few frames
+    /// behind the newest (max_drift_seconds is under 4 hops at any rate)
+    const history = 8;
+
+    tracker: YinTracker,
+    /// Two channels of `capacity` samples, oldest overwritten first
+    delay: []f32,
+    capacity: usize,
+    /// The mid signal of the block being pushed to the tracker
+    mid: []f32,
+    /// Samples written since init
+    written: u64,
+    /// Frames analysed since init
+    frames: u64,
+    /// Speed relative to the average for the last `history` frames, by
+    /// frame number
+    ratios: [history]f32,
+    /// nominal / measured of the last frame with a clear period, and its
+    /// running average; 0 until there has been one
+    last: f32,
+    mean: f32,
+    /// Per-frame weight of the running average
+    follow: f32,
+    /// Read head position relative to its resting delay, in samples
+    drift: f32,
+    max_drift: f32,
+    recentre: f32,
+    latency: usize,
+    nominal: f32,
+    correction: f32,
+
+    pub fn init(alloc: std.mem.Allocator, sample_rate: f32, nominal: f32) !StreamingStabilizer {
+        // Frames of at least two of the longest periods ever searched
+        const longest: usize = @intFromFloat(@ceil(sample_rate / (min_nominal * scan_low)));
+        const size = 2 * try std.math.ceilPowerOfTwo(usize, longest + 1);
+        const hop = size / 4;
+        var tracker = try YinTracker.init(alloc, .{
+            .size = size,
+            .hop = hop,
+            .sample_rate = sample_rate,
+            .min_freq = nominal * scan_low,
+            .max_freq = nominal * scan_high,
+        });
+        errdefer tracker.deinit(alloc);
+
+        // The earliest any estimate can sit in its frame, for the shortest
+        // nominal period
+        const earliest = size / 4 + @as(usize, @intFromFloat(sample_rate / max_nominal)) / 2;
+        const max_drift = @floor(max_drift_seconds * sample_rate);
+        const latency = size - earliest + hop + @as(usize, @intFromFloat(max_drift));
+        // The furthest read goes one sample past the longest delay
+        const capacity = try std.math.ceilPowerOfTwo(usize, latency + @as(usize, @intFromFloat(max_drift)) + 2);
+        const delay = try alloc.alloc(f32, 2 * capacity);
+        errdefer alloc.free(delay);
+        @memset(delay, 0);
+        const mid = try alloc.alloc(f32, size);
+
+        return .{
+            .tracker = tracker,
+            .delay = delay,
+            .capacity = capacity,
+            .mid = mid,
+            .written = 0,
+            .frames = 0,
+            .ratios = [_]f32{1} ** history,
+            .last = 0,
+            .mean = 0,
+            .follow = @as(f32, @floatFromInt(hop)) / (follow_seconds * sample_rate),
+            .drift = 0,
+            .max_drift = max_drift,
+            .recentre = 1.0 / (recentre_seconds * sample_rate),
+            .latency = latency,
+            .nominal = nominal,
+            .correction = 1.0,
+        };
+    }
+
+    pub fn deinit(self: *StreamingStabilizer, alloc: std.mem.Allocator) void {
+        self.tracker.deinit(alloc);
+        alloc.free(self.delay);
+        alloc.free(self.mid);
+    }
+
+    /// Samples the read head can lag beyond latency, so output can follow
+    /// the input's end by this much.
+    pub fn tail(self: *const StreamingStabilizer) usize {
+        return @intFromFloat(self.max_drift);
+    }
+
+    /// nominal is clamped to min_nominal..max_nominal.
+    pub fn setNominal(self: *StreamingStabilizer, nominal: f32) void {
+        self.nominal = std.math.clamp(nominal, min_nominal, max_nominal);
+        // init sized the frames for the lowest nominal, so any range fits
+        self.tracker.setRange(self.nominal * scan_low, self.nominal * scan_high) catch {};
+    }
+
+    pub fn process(self: *StreamingStabilizer, in_l: []const f32, in_r: []const f32, out_l: []f32, out_r: []f32) void {
+        var done: usize = 0;
+        while (done < in_l.len) {
+            // Frames complete only at the end of a run, and no sample in a
+            // run reads a frame ending inside it
+            const n = @min(in_l.len - done, self.tracker.pending());
+            for (0..n) |i| {
+                const j = done + i;
+                self.mid[i] = 0.5 * (in_l[j] + in_r[j]);
+                const out = self.write(in_l[j], in_r[j], self.speedAt(self.written));
+                out_l[j] = out[0];
+                out_r[j] = out[1];
+            }
+            const completes = n == self.tracker.pending();
+            _ = self.tracker.push(self.mid[0..n]);
+            if (completes) self.addFrame();
+            done += n;
+        }
+    }
+
+    fn addFrame(self: *StreamingStabilizer) void {
+        const estimate = self.tracker.latest;
+        if (estimate.freq > 0 and estimate.aperiodicity < Yin.threshold) {
+            self.last = self.nominal / estimate.freq;
+            if (self.mean == 0) self.mean = self.last;
+        }
+        if (self.mean > 0) self.mean += (self.last - self.mean) * self.follow;
+        self.ratios[@intCast(self.frames % history)] = if (self.mean > 0) self.last / self.mean else 1.0;
+        self.frames += 1;
+    }
+
+    /// Speed ratio at the source sample the head reads at output sample t,
+    /// from the frames whose estimates sit either side of it.
+    fn speedAt(self: *const StreamingStabilizer, t: u64) f32 {
+        const size: f64 = @floatFromInt(self.tracker.size);
+        const hop: f64 = @floatFromInt(self.tracker.hop);
+        const centre = size / 4 + @floor(self.tracker.sample_rate / self.nominal) / 2;
+        const pos = (@as(f64, @floatFromInt(t)) - @as(f64, @floatFromInt(self.latency)) - centre) / hop;
+        if (pos < 0 or self.frames == 0) return 1.0;
+        const k: u64 = @intFromFloat(pos);
+        if (k + 1 >= self.frames) return self.ratioOf(self.frames - 1);
+        const frac: f32 = @floatCast(pos - @as(f64, @floatFromInt(k)));
+        return self.ratioOf(k) * (1.0 - frac) + self.ratioOf(k + 1) * frac;
+    }
+
+    fn ratioOf(self: *const StreamingStabilizer, frame: u64) f32 {
+        return self.ratios[@intCast(frame % history)];
+    }
+
+    fn write(self: *StreamingStabilizer, l: f32, r: f32, ratio: f32) [2]f32 {
+        const mask = self.capacity - 1;
+        const at: usize = @intCast(self.written & mask);
+        self.delay[at] = l;
+        self.delay[self.capacity + at] = r;
+        self.written += 1;
+
+        const increment = 1.0 + (ratio - 1.0) * self.correction;
+        self.drift = std.math.clamp(self.drift + (increment - 1.0) - self.drift * self.recentre, -self.max_drift, self.max_drift);
+
+        // Read at (newest - delay): y1 is the sample `whole` back, mu moves
+        // towards the newer y2
+        const delay = @as(f32, @floatFromInt(self.latency)) - self.drift;
+        const whole = @ceil(delay);
+        const mu = whole - delay;
+        const base = at + self.capacity - @as(usize, @intFromFloat(whole));
+        var out: [2]f32 = undefined;
+        inline for (0..2) |ch| {
+            const line = self.delay[ch * self.capacity ..][0..self.capacity];
+            out[ch] = math.cubicHermite(line[(base - 1) & mask], line[base & mask], line[(base + 1) & mask], line[(base + 2) & mask], mu);
+        }
+        return out;
+    }
+};
@@ -0,0 +1,201 @@
+// Loudness analysis test.
+//
+// The same program material is analysed three ways and all 14 results must
+// agree:
+//   streamed       one accumulator fed in odd-sized blocks
+//   chunked        hop-aligned stretches on separate accumulators, each
+//                  warmed up on the audio before it, merged in order
+//   parallel       loudness_analyze on 1 to 16 threads
+// A 12-minute file whose last minute is 20 dB louder checks that nothing
+// past the old 6000-hop (10 minute) history is dropped, and a merge onto a
+// stretch that ends mid-hop must be refused. A full-scale 997 Hz tone in
+// one channel must read BS.1770's -3.01 LUFS at 44.1 and 48 kHz, from the
+// analysis and from the lufs_meter alike.
+
+#include "loudness_analysis.h"
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+static const int kResults = 14;
+static const char* const kNames[kResults] = {
+    "integrated", "lra", "peak", "rms", "crest", "correlation", "width",
+    "balance", "dc", "low", "mid", "high", "momentary max", "short-term max",
+};
+// Percentile bins are 0.01 LU wide; everything else only differs in
+// summation order and filter warm-up
+static const float kLraTolerance = 0.02f;
+static const float kTolerance = 1e-3f;
+static const size_t kStreamBlocks[] = { 1000, 1, 4096, 333, 64 };
+
+// Stereo noise, partly correlated, with a slow loudness swing so LRA and
+// the window maxima have something to find
+static std::vector<float> makeProgram(size_t frames, float sampleRate, uint32_t seed) {
+    std::vector<float> data(frames * 2);
+    auto noise = [&seed] {
+        seed = seed * 1664525u + 1013904223u;
+        return ((float)(seed >> 8) / 16777216.0f) * 2.0f - 1.0f;
+    };
+    for (size_t i = 0; i < frames; i++) {
+        const float t = (float)i / sampleRate;
+        const float gain = 0.02f + 0.2f * (0.5f + 0.5f * sinf(2.0f * (float)M_PI * t / 37.0f));
+        const float common = noise();
+        data[2 * i] = gain * (0.7f * common + 0.3f * noise()) + 0.001f;
+        data[2 * i + 1] = gain * (0.6f * common + 0.4f * noise());
+    }
+    return data;
+}
+
+static void streamed(const std::vector<float>& data, float sampleRate, float* out) {
+    void* acc = loudness_analysis_create(2, sampleRate);
+    const size_t frames = data.size() / 2;
+    size_t pos = 0;
+    for (int b = 0; pos < frames; b++) {
+        size_t n = kStreamBlocks[b % (sizeof(kStreamBlocks) / sizeof(kStreamBlocks[0]))];
+        if (n > frames - pos) n = frames - pos;
+        loudness_analysis_push(acc, data.data() + 2 * pos, n);
+        pos += n;
+    }
+    loudness_analysis_result(acc, out);
+    loudness_analysis_destroy(acc);
+}
+
+// Stretches of `hops` hops, merged left to right
+static bool chunked(const std::vector<float>& data, float sampleRate, size_t hops, float* out) {
+    const size_t frames = data.size() / 2;
+    const size_t chunk = hops * loudness_analysis_hop_frames(sampleRate);
+    const size_t warmup = loudness_analysis_warmup_frames(sampleRate);
+    void* total = nullptr;
+    for (size_t start = 0; start < frames; start += chunk) {
+        const size_t end = start + chunk < frames ? start + chunk : frames;
+        const size_t lead = start < warmup ? start : warmup;
+        void* acc = loudness_analysis_create(2, sampleRate);
+        loudness_analysis_warmup(acc, data.data() + 2 * (start - lead), lead);
+        loudness_analysis_push(acc, data.data() + 2 * start, end - start);
+        if (!total) {
+            total = acc;
+            continue;
+        }
+        const int32_t merged = loudness_analysis_merge(total, acc);
+        loudness_analysis_destroy(acc);
+        if (merged != 0) {
+            loudness_analysis_destroy(total);
+            return false;
+        }
+    }
+    loudness_analysis_result(total, out);
+    loudness_analysis_destroy(total);
+    return true;
+}
+
+// BS.1770: a 0 dBFS sine at 997 Hz in one channel reads -3.01 LUFS
+static const float kToneLufs = -3.01f;
+static const float kToneTolerance = 0.05f;
+
+static int checkTone(float sampleRate) {
+    const size_t frames = (size_t)(20 * sampleRate);
+    std::vector<float> data(frames * 2, 0.0f);
+    for (size_t i = 0; i < frames; i++) data[2 * i] = sinf(2.0f * (float)M_PI * 997.0f * (float)i / sampleRate);
+
+    float results[kResults];
+    loudness_analyze(data.data(), frames, 2, sampleRate, 1, results);
+    float meter = 0.0f;
+    void* lufs = lufs_meter_create(2, sampleRate);
+    lufs_meter_push(lufs, data.data(), frames);
+    const bool measured = lufs_meter_integrated(lufs, &meter) == 0;
+    lufs_meter_destroy(lufs);
+
+    printf("997 Hz tone at %.0f Hz: analysis %.3f LUFS, meter %.3f LUFS\n", sampleRate, results[0], meter);
+    int failures = 0;
+    if (!(fabsf(results[0] - kToneLufs) <= kToneTolerance)) {
+        fprintf(stderr, "analysis_test: tone at %.0f Hz: analysis reads %.3f LUFS\n", sampleRate, results[0]);
+        failures++;
+    }
+    if (!measured || !(fabsf(meter - kToneLufs) <= kToneTolerance)) {
+        fprintf(stderr, "analysis_test: tone at %.0f Hz: meter reads %.3f LUFS\n", sampleRate, meter);
+        failures++;
+    }
+    return failures;
+}
+
+static int compare(const char* what, const float* want, const float* got) {
+    int failures = 0;
+    for (int i = 0; i < kResults; i++) {
+        const float tolerance = i == 1 ? kLraTolerance : kTolerance;
+        if (!(fabsf(want[i] - got[i]) <= tolerance)) {
+            fprintf(stderr, "analysis_test: %s: %s %.5f, streamed %.5f\n", what, kNames[i], got[i], want[i]);
+            failures++;
+        }
+    }
+    return failures;
+}
+
+int main() {
+    int failures = 0;
+    const float sampleRate = 48000.0f;
+    const std::vector<float> program = makeProgram((size_t)(150 * sampleRate) + 1234, sampleRate, 7);
+
+    float reference[kResults];
+    streamed(program, sampleRate, reference);
+    for (int i = 0; i < kResults; i++) printf("%-15s %10.4f\n", kNames[i], reference[i]);
+
+    const size_t chunkHops[] = { 1, 7, 29, 30, 31, 250 };
+    for (size_t hops : chunkHops) {
+        float got[kResults];
+        char label[64];
+        snprintf(label, sizeof(label), "chunked by %zu hops", hops);
+        if (!chunked(program, sampleRate, hops, got)) {
+            fprintf(stderr, "analysis_test: %s: merge refused\n", label);
+            failures++;
+            continue;
+        }
+        failures += compare(label, reference, got);
+    }
+
+    const uint32_t threadCounts[] = { 1, 2, 3, 4, 8, 16 };
+    for (uint32_t threads : threadCounts) {
+        float got[kResults];
+        char label[64];
+        snprintf(label, sizeof(label), "%u threads", threads);
+        if (loudness_analyze(program.data(), program.size() / 2, 2, sampleRate, threads, got) != 0) {
+            fprintf(stderr, "analysis_test: %s: failed\n", label);
+            failures++;
+            continue;
+        }
+        failures += compare(label, reference, got);
+    }
+
+    // 12 minutes at a low rate to keep the buffer small; the loud last
+    // minute has to show up in the short-term maximum
+    const float lowRate = 8000.0f;
+    const size_t minute = (size_t)(60 * lowRate);
+    std::vector<float> longFile(12 * minute * 2, 0.0f);
+    const std::vector<float> lastMinute = makeProgram(minute, lowRate, 11);
+    for (size_t i = 0; i < 11 * minute * 2; i++) longFile[i] = 0.1f * lastMinute[i % lastMinute.size()];
+    for (size_t i = 0; i < minute * 2; i++) longFile[11 * minute * 2 + i] = lastMinute[i];
+    float whole[kResults];
+    float tail[kResults];
+    loudness_analyze(longFile.data(), longFile.size() / 2, 2, lowRate, 0, whole);
+    loudness_analyze(lastMinute.data(), minute, 2, lowRate, 1, tail);
+    printf("12 min file: short-term max %.3f, last minute alone %.3f\n", whole[13], tail[13]);
+    if (!(fabsf(whole[13] - tail[13]) <= 0.05f)) {
+        fprintf(stderr, "analysis_test: the end of a long file was not analysed\n");
+        failures++;
+    }
+
+    void* a = loudness_analysis_create(2, sampleRate);
+    void* b = loudness_analysis_create(2, sampleRate);
+    loudness_analysis_push(a, program.data(), 100);
+    if (loudness_analysis_merge(a, b) != -1) {
+        fprintf(stderr, "analysis_test: merge onto a partial hop was accepted\n");
+        failures++;
+    }
+    loudness_analysis_destroy(a);
+    loudness_analysis_destroy(b);
+
+    failures += checkTone(44100.0f);
+    failures += checkTone(48000.0f);
+
+    printf("analysis_test: %s\n", failures ? "FAILED" : "ok");
+    return failures ? 1 : 0;
+}
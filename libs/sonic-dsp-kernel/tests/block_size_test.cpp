@@ -0,0 +1,86 @@
+// Block-size regression test.
+// Renders the same noise through two instances of the plugin, one in
+// 64-frame blocks and one in 8192-frame blocks, and requires the outputs to
+// match. Catches kernels that bypass or reset state at large host blocks.
+//
+// Plugins whose algorithm analyses each host block as a unit (per-block
+// level or transient analysis) legitimately depend on the block size;
+// they are listed in kBlockBased and skipped. The spectral plugins run on
+// the streaming STFT (dsp/stft.zig) and must match like everything else.
+
+#include "bench_host.h"
+#include <cmath>
+#include <cstring>
+#include <strings.h>
+
+using namespace bench;
+
+static const double kSampleRate = 48000.0;
+static const int32 kSmallBlock = 64;
+static const int32 kLargeBlock = 8192;
+static const int32 kTotalFrames = kLargeBlock * 4;
+static const float kTolerance = 1e-5f;
+
+static const char* const kBlockBased[] = {
+    "sonicdeclip", "sonicdithering", "sonicplosiveguard",
+};
+
+static bool render(int32 blockSize, const std::vector<float> (&in)[2], std::vector<float> (&out)[2]) {
+    Plugin plugin;
+    if (!plugin.open(kSampleRate, kLargeBlock)) return false;
+
+    StereoBlock block(blockSize);
+    for (int32 pos = 0; pos < kTotalFrames; pos += blockSize) {
+        for (int ch = 0; ch < 2; ch++) memcpy(block.in[ch].data(), in[ch].data() + pos, sizeof(float) * blockSize);
+        plugin.processor->process(block.data);
+        for (int ch = 0; ch < 2; ch++) memcpy(out[ch].data() + pos, block.out[ch].data(), sizeof(float) * blockSize);
+    }
+    plugin.close();
+    return true;
+}
+
+int main(int argc, char** argv) {
+    const char* name = argc > 1 ? argv[1] : "";
+    for (const char* skip : kBlockBased) {
+        if (strcasecmp(name, skip) == 0) {
+            printf("block_size_test: %s uses block-based analysis, skipped\n", name);
+            return 0;
+        }
+    }
+
+    std::vector<float> in[2] = { std::vector<float>(kTotalFrames), std::vector<float>(kTotalFrames) };
+    fillNoise(in[0], 1);
+    fillNoise(in[1], 2);
+    // Decaying bursts so dynamics and envelopes move through their full range
+    for (int32 i = 0; i < kTotalFrames; i++) {
+        float env = std::exp(-(float)(i % 6000) / 1500.0f);
+        in[0][i] *= env;
+        in[1][i] *= env;
+    }
+
+    std::vector<float> small[2] = { std::vector<float>(kTotalFrames), std::vector<float>(kTotalFrames) };
+    std::vector<float> large[2] = { std::vector<float>(kTotalFrames), std::vector<float>(kTotalFrames) };
+    if (!render(kSmallBlock, in, small) || !render(kLargeBlock, in, large)) {
+        fprintf(stderr, "block_size_test: failed to create plugin\n");
+        return 1;
+    }
+
+    int failures = 0;
+    for (int ch = 0; ch < 2; ch++) {
+        float maxDiff = 0.0f;
+        int32 worst = 0;
+        for (int32 i = 0; i < kTotalFrames; i++) {
+            float d = std::fabs(small[ch][i] - large[ch][i]);
+            if (d > maxDiff) { maxDiff = d; worst = i; }
+        }
+        printf("channel %d: max |%d-frame - %d-frame| = %g at frame %d\n", ch, kSmallBlock, kLargeBlock, maxDiff, worst);
+        if (!(maxDiff <= kTolerance)) failures++;
+    }
+
+    if (failures) {
+        fprintf(stderr, "block_size_test: FAILED\n");
+        return 1;
+    }
+    printf("block_size_test: ok\n");
+    return 0;
+}
@@ -0,0 +1,265 @@
+// Module chain test, through the suite's VST3 wrapper.
+//
+// Loads a chain of five modules into sonicchain the way a host would (slot
+// selectors, then the re-activation they ask for) and runs noise bursts
+// through it and through five separate instances of the same classes, fed
+// one into the next at the host's block size. The chain runs its modules in
+// 256-frame sub-blocks, so its output must match within the block-size
+// tolerance, and its latency must be the modules' sum. An empty chain must
+// pass audio through untouched, and a chain restored from its state must
+// load the same modules. A slot's oversampling factor is a stepped setting
+// like a selector: listed, left alone by automation until the chain is
+// prepared again, and applied at the re-activation an edit asks for.
+
+#include "bench_host.h"
+#include <cmath>
+#include <cstring>
+#include <memory>
+
+using namespace bench;
+
+extern "C" {
+    int32_t plugin_class_oversampling_param(uint32_t index);
+    uint32_t plugin_class_param_steps(uint32_t index, int32_t param);
+}
+
+static const double kSampleRate = 48000.0;
+static const int32 kBlockSize = 512;
+static const int kBlocks = 64;
+static const float kTolerance = 1e-5f;
+// Parameter layout (module_chain.zig): one selector per slot, then 16
+// parameters per slot
+static const int32 kSlots = 8;
+static const int32 kSlotParams = 16;
+static const char* const kModules[] = {
+    "sonicparametriceq", "soniccompressor", "sonicdenoise", "sonicstereoimager", "soniclimiter",
+};
+static const int kModuleCount = sizeof(kModules) / sizeof(kModules[0]);
+
+static int32 findClass(const char* name) {
+    IPluginFactory* factory = GetPluginFactory();
+    for (int32 c = 0; c < factory->countClasses(); c++) {
+        PClassInfo info;
+        if (factory->getClassInfo(c, &info) == kResultOk && strcmp(info.name, name) == 0) return c;
+    }
+    return -1;
+}
+
+static IEditController* controllerOf(IComponent* component) {
+    void* obj = nullptr;
+    if (component->queryInterface(IEditController::iid, &obj) != kResultOk) return nullptr;
+    return (IEditController*)obj;
+}
+
+static double slotValue(int32 classIndex, int32 p) {
+    return p == plugin_class_oversampling_param((uint32_t)classIndex) ? 0.0 : 0.3 + 0.02 * p;
+}
+
+// Picks the modules and sets their parameters, then re-activates so the
+// chain loads them
+static void loadChain(Plugin& chain, int32 chainIndex, const int32* modules, int count) {
+    const double steps = plugin_class_param_steps((uint32_t)chainIndex, 0);
+    IEditController* controller = controllerOf(chain.component);
+    for (int s = 0; s < count; s++) {
+        controller->setParamNormalized(s, (modules[s] + 1) / steps);
+        for (int32 p = 0; p < kSlotParams; p++)
+            controller->setParamNormalized(kSlots + s * kSlotParams + p, slotValue(modules[s], p));
+    }
+    controller->release();
+    chain.component->setActive(false);
+    chain.component->setActive(true);
+}
+
+static void fillBurst(StereoBlock& block, int b) {
+    fillNoise(block.in[0], 1 + 2 * b);
+    fillNoise(block.in[1], 2 + 2 * b);
+    for (int32 i = 0; i < kBlockSize; i++) {
+        float env = 0.5f * std::exp(-(float)((b * kBlockSize + i) % 6000) / 1500.0f);
+        block.in[0][i] *= env;
+        block.in[1][i] *= env;
+    }
+}
+
+static float maxDiff(const StereoBlock& a, const StereoBlock& b) {
+    float diff = 0.0f;
+    for (int ch = 0; ch < 2; ch++) {
+        for (int32 i = 0; i < kBlockSize; i++) diff = std::max(diff, std::fabs(a.out[ch][i] - b.out[ch][i]));
+    }
+    return diff;
+}
+
+// Latency of a fresh instance of classIndex with parameter os at value
+static int32 moduleLatency(int32 classIndex, int32 os, double value) {
+    Plugin module;
+    module.open(kSampleRate, kBlockSize, classIndex);
+    IEditController* controller = controllerOf(module.component);
+    controller->setParamNormalized(os, value);
+    controller->release();
+    module.component->setActive(false);
+    module.component->setActive(true);
+    int32 latency = 0;
+    module.processor->getLatencySamples(latency);
+    module.close();
+    return latency;
+}
+
+static int testSlotOversampling(int32 chainIndex, int32 module, int32 os) {
+    int failures = 0;
+    Plugin chain;
+    chain.open(kSampleRate, kBlockSize, chainIndex);
+    // slotValue leaves the factor at 1x
+    loadChain(chain, chainIndex, &module, 1);
+    IEditController* controller = controllerOf(chain.component);
+    const ParamID id = kSlots + os;
+    ParameterInfo info;
+    controller->getParameterInfo((int32)id, info);
+    if (info.stepCount != 3 || (info.flags & ParameterInfo::kCanAutomate)) {
+        fprintf(stderr, "chain_test: slot oversampling is not listed as a stepped setting\n");
+        failures++;
+    }
+    int32 before = 0;
+    chain.processor->getLatencySamples(before);
+
+    StereoBlock block(kBlockSize);
+    fillBurst(block, 0);
+    HostParamChanges changes;
+    int32 index;
+    changes.addParameterData(id, index)->addPoint(kBlockSize / 2, 1.0, index);
+    block.data.inputParameterChanges = &changes;
+    chain.processor->process(block.data);
+    int32 during = 0;
+    chain.processor->getLatencySamples(during);
+    if (during != before) {
+        fprintf(stderr, "chain_test: automated slot oversampling moved latency mid-stream, %d to %d\n", before, during);
+        failures++;
+    }
+
+    controller->setParamNormalized(id, 1.0 / 3.0);
+    controller->release();
+    chain.component->setActive(false);
+    chain.component->setActive(true);
+    int32 after = 0;
+    chain.processor->getLatencySamples(after);
+    const int32 expected = moduleLatency(module, os, 1.0 / 3.0);
+    printf("slot oversampling: latency %d at 1x, %d at 2x (module alone %d)\n", before, after, expected);
+    if (after != expected) {
+        fprintf(stderr, "chain_test: slot oversampling edit was not applied at re-activation\n");
+        failures++;
+    }
+    chain.close();
+    return failures;
+}
+
+int main() {
+    const int32 chainIndex = findClass("sonicchain");
+    int32 modules[kModuleCount];
+    for (int m = 0; m < kModuleCount; m++) modules[m] = findClass(kModules[m]);
+    if (chainIndex < 0 || std::find(modules, modules + kModuleCount, -1) != modules + kModuleCount) {
+        fprintf(stderr, "chain_test: sonicchain or a module is missing from this build\n");
+        return 1;
+    }
+    int failures = 0;
+
+    // Empty: a passthrough
+    Plugin empty;
+    empty.open(kSampleRate, kBlockSize, chainIndex);
+    StereoBlock block(kBlockSize);
+    fillBurst(block, 0);
+    empty.processor->process(block.data);
+    if (block.out[0] != block.in[0] || block.out[1] != block.in[1]) {
+        fprintf(stderr, "chain_test: empty chain changed the audio\n");
+        failures++;
+    }
+    empty.close();
+
+    Plugin chain;
+    chain.open(kSampleRate, kBlockSize, chainIndex);
+    loadChain(chain, chainIndex, modules, kModuleCount);
+
+    Plugin separate[kModuleCount];
+    int32 separateLatency = 0;
+    for (int m = 0; m < kModuleCount; m++) {
+        separate[m].open(kSampleRate, kBlockSize, modules[m]);
+        IEditController* controller = controllerOf(separate[m].component);
+        for (int32 p = 0; p < kSlotParams; p++) controller->setParamNormalized(p, slotValue(modules[m], p));
+        controller->release();
+        int32 latency = 0;
+        separate[m].processor->getLatencySamples(latency);
+        separateLatency += latency;
+    }
+    int32 chainLatency = 0;
+    chain.processor->getLatencySamples(chainLatency);
+    printf("latency: chain %d, separate %d\n", chainLatency, separateLatency);
+    if (chainLatency != separateLatency) {
+        fprintf(stderr, "chain_test: chain latency is not the sum of its modules'\n");
+        failures++;
+    }
+
+    StereoBlock chained(kBlockSize);
+    // StereoBlock points into itself, so each one stays where it was made
+    std::vector<std::unique_ptr<StereoBlock>> stages;
+    for (int m = 0; m < kModuleCount; m++) stages.emplace_back(new StereoBlock(kBlockSize));
+    float worst = 0.0f;
+    for (int b = 0; b < kBlocks; b++) {
+        fillBurst(chained, b);
+        chain.processor->process(chained.data);
+        stages[0]->in[0] = chained.in[0];
+        stages[0]->in[1] = chained.in[1];
+        for (int m = 0; m < kModuleCount; m++) {
+            if (m > 0) {
+                stages[m]->in[0] = stages[m - 1]->out[0];
+                stages[m]->in[1] = stages[m - 1]->out[1];
+            }
+            separate[m].processor->process(stages[m]->data);
+        }
+        worst = std::max(worst, maxDiff(chained, *stages[kModuleCount - 1]));
+    }
+    printf("chain vs separate instances: max difference %g\n", worst);
+    if (!(worst <= kTolerance)) {
+        fprintf(stderr, "chain_test: chain output differs from the separate instances\n");
+        failures++;
+    }
+    for (Plugin& p : separate) p.close();
+
+    // Restored into a fresh chain before setup, as a session load does
+    MemoryStream saved;
+    chain.component->getState(&saved);
+    chain.close();
+    IPluginFactory* factory = GetPluginFactory();
+    PClassInfo info;
+    factory->getClassInfo(chainIndex, &info);
+    void* obj = nullptr;
+    factory->createInstance(info.cid, IComponent::iid, &obj);
+    IComponent* restored = (IComponent*)obj;
+    saved.rewind();
+    if (restored->setState(&saved) != kResultOk) {
+        fprintf(stderr, "chain_test: chain state was refused\n");
+        failures++;
+    }
+    restored->queryInterface(IAudioProcessor::iid, &obj);
+    IAudioProcessor* processor = (IAudioProcessor*)obj;
+    ProcessSetup setup = { 0, 0, kBlockSize, kSampleRate };
+    processor->setupProcessing(setup);
+    restored->setActive(true);
+    int32 restoredLatency = 0;
+    processor->getLatencySamples(restoredLatency);
+    if (restoredLatency != chainLatency) {
+        fprintf(stderr, "chain_test: restored chain reports latency %d, not %d\n", restoredLatency, chainLatency);
+        failures++;
+    }
+    restored->setActive(false);
+    processor->release();
+    restored->release();
+
+    const int32 saturation = findClass("sonicsaturation");
+    const int32 os = saturation < 0 ? -1 : plugin_class_oversampling_param((uint32_t)saturation);
+    if (os < 0) {
+        fprintf(stderr, "chain_test: no oversampled sonicsaturation in this build\n");
+        failures++;
+    } else {
+        failures += testSlotOversampling(chainIndex, saturation, os);
+    }
+
+    printf("chain_test: %s\n", failures ? "FAILED" : "ok");
+    return failures ? 1 : 0;
+}
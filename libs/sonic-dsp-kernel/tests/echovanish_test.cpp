@@ -0,0 +1,180 @@
+// Online WPE dereverberation test.
+//
+// Bursts of noise are put through a Schroeder reverb with a 0.8 s tail, so
+// the gaps between them hold nothing but late reverb. echovanish_process
+// must give the input back untouched at zero reduction, and at full
+// reduction take most of the energy out of the gaps while leaving the
+// bursts close to their level. sonicechovanish, through the suite's VST3
+// wrapper and in blocks of irregular sizes, must report its STFT latency
+// and do the same to the delay-compensated output.
+
+#include "bench_host.h"
+#include "echovanish.h"
+#include <cmath>
+#include <cstring>
+
+using namespace bench;
+
+static const double kSampleRate = 48000.0;
+static const size_t kFrames = (size_t)(12 * kSampleRate);
+static const size_t kPeriod = (size_t)(0.6 * kSampleRate);
+static const size_t kBurst = (size_t)(0.15 * kSampleRate);
+// Gaps are measured from here on in each period, past the direct sound,
+// the frames it smears into and the three-frame prediction delay
+static const size_t kGapStart = kBurst + (size_t)(0.12 * kSampleRate);
+// The filters adapt over the first seconds; measure after that
+static const size_t kSettled = (size_t)(4 * kSampleRate);
+static const float kTailMs = 300.0f;
+static const int32 kBlockSizes[] = { 333, 1, 64, 1000, 4096, 17 };
+static const int32 kMaxBlock = 4096;
+
+// Late reverb must lose at least this much, the bursts at most this much
+static const double kMinGapReductionDb = 3.0;
+static const double kMaxBurstLossDb = 1.0;
+
+struct Comb {
+    std::vector<float> line;
+    size_t pos = 0;
+    float feedback;
+    Comb(size_t delay, float t60) : line(delay, 0.0f), feedback((float)std::pow(10.0, -3.0 * delay / (t60 * kSampleRate))) {}
+    float process(float x) {
+        const float y = line[pos];
+        line[pos] = x + feedback * y;
+        pos = (pos + 1) % line.size();
+        return y;
+    }
+};
+
+struct Allpass {
+    std::vector<float> line;
+    size_t pos = 0;
+    explicit Allpass(size_t delay) : line(delay, 0.0f) {}
+    float process(float x) {
+        const float delayed = line[pos];
+        const float v = x + 0.5f * delayed;
+        line[pos] = v;
+        pos = (pos + 1) % line.size();
+        return delayed - 0.5f * v;
+    }
+};
+
+static void fillReverberant(std::vector<float>& x) {
+    std::vector<float> noise(x.size());
+    fillNoise(noise, 11);
+    Comb combs[] = { Comb(1687, 0.8f), Comb(1601, 0.8f), Comb(2053, 0.8f), Comb(2251, 0.8f) };
+    Allpass allpasses[] = { Allpass(347), Allpass(113) };
+    for (size_t i = 0; i < x.size(); i++) {
+        const float dry = i % kPeriod < kBurst ? 0.5f * noise[i] : 0.0f;
+        float wet = 0.0f;
+        for (Comb& c : combs) wet += c.process(dry);
+        for (Allpass& a : allpasses) wet = a.process(wet);
+        x[i] = dry + 0.25f * wet;
+    }
+}
+
+struct Energy {
+    double burst = 0.0;
+    double gap = 0.0;
+};
+
+// Energy of the bursts and of the gaps' late reverb from kSettled on, the
+// same stretch whatever the offset
+static Energy measure(const std::vector<float>& x, size_t offset) {
+    Energy e;
+    for (size_t i = kSettled; i + kMaxBlock < x.size(); i++) {
+        const double s = x[i + offset];
+        const size_t phase = i % kPeriod;
+        if (phase < kBurst) e.burst += s * s;
+        else if (phase >= kGapStart) e.gap += s * s;
+    }
+    return e;
+}
+
+static double db(double ratio) {
+    return 10.0 * std::log10(std::max(ratio, 1e-30));
+}
+
+static int judge(const char* what, const Energy& in, const Energy& out) {
+    const double gapDb = db(in.gap / out.gap);
+    const double burstDb = db(in.burst / out.burst);
+    printf("%s: late reverb down %.1f dB, bursts down %.1f dB\n", what, gapDb, burstDb);
+    return gapDb >= kMinGapReductionDb && burstDb <= kMaxBurstLossDb ? 0 : 1;
+}
+
+static int checkBuffer(const std::vector<float>& input) {
+    int failures = 0;
+
+    std::vector<float> x = input;
+    echovanish_process(x.data(), x.size(), kSampleRate, 0.0f, kTailMs);
+    float worst = 0.0f;
+    for (size_t i = 0; i < x.size(); i++) worst = std::max(worst, std::fabs(x[i] - input[i]));
+    printf("buffer: zero reduction differs from the input by %.2e at most\n", worst);
+    if (worst > 1e-5f) failures++;
+
+    x = input;
+    echovanish_process(x.data(), x.size(), kSampleRate, 1.0f, kTailMs);
+    failures += judge("buffer", measure(input, 0), measure(x, 0));
+    return failures;
+}
+
+static int32 findClass(const char* name) {
+    IPluginFactory* factory = GetPluginFactory();
+    for (int32 c = 0; c < factory->countClasses(); c++) {
+        PClassInfo info;
+        if (factory->getClassInfo(c, &info) == kResultOk && strcmp(info.name, name) == 0) return c;
+    }
+    return -1;
+}
+
+// Full reduction and a 300 ms tail (the wrapper starts both mid-range)
+static void setParams(Plugin& p) {
+    void* obj = nullptr;
+    p.component->queryInterface(IEditController::iid, &obj);
+    IEditController* controller = (IEditController*)obj;
+    controller->setParamNormalized(0, 1.0);
+    controller->setParamNormalized(1, (kTailMs - 50.0) / 450.0);
+    controller->release();
+}
+
+static int checkPlugin(const std::vector<float>& input) {
+    const int32 classIndex = findClass("sonicechovanish");
+    if (classIndex < 0) {
+        fprintf(stderr, "echovanish_test: no sonicechovanish in this build\n");
+        return 1;
+    }
+    Plugin plugin;
+    if (!plugin.open(kSampleRate, kMaxBlock, classIndex)) {
+        fprintf(stderr, "echovanish_test: failed to open sonicechovanish\n");
+        return 1;
+    }
+    setParams(plugin);
+    int32 latency = 0;
+    plugin.processor->getLatencySamples(latency);
+    printf("plugin: latency %d samples\n", latency);
+    int failures = latency == 2048 ? 0 : 1;
+
+    std::vector<float> out(input.size());
+    StereoBlock block(kMaxBlock);
+    size_t pos = 0;
+    for (int b = 0; pos < input.size(); b++) {
+        int32 n = kBlockSizes[b % (sizeof(kBlockSizes) / sizeof(kBlockSizes[0]))];
+        n = (int32)std::min((size_t)n, input.size() - pos);
+        block.data.numSamples = n;
+        for (int ch = 0; ch < 2; ch++) memcpy(block.in[ch].data(), input.data() + pos, sizeof(float) * n);
+        plugin.processor->process(block.data);
+        memcpy(out.data() + pos, block.out[0].data(), sizeof(float) * n);
+        pos += n;
+    }
+    plugin.close();
+    failures += judge("plugin", measure(input, 0), measure(out, (size_t)latency));
+    return failures;
+}
+
+int main() {
+    std::vector<float> input(kFrames);
+    fillReverberant(input);
+    int failures = checkBuffer(input);
+    failures += checkPlugin(input);
+    printf("echovanish_test: %s\n", failures ? "FAILED" : "ok");
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,106 @@
+// Latency reporting test.
+// Feeds noise through the plugin in odd-sized blocks and finds the lag at
+// which the output best matches the input. It must equal what the plugin
+// reports through getLatencySamples, or host delay compensation will put
+// the track out of time. Plugins that report no latency are only checked
+// for a sane tail. Plugins with an oversampling setting are checked at
+// every factor, switched the way a host reacts to kLatencyChanged.
+
+#include "bench_host.h"
+#include <cmath>
+#include <cstring>
+
+using namespace bench;
+
+extern "C" int32_t plugin_class_oversampling_param(uint32_t index);
+
+static const double kSampleRate = 48000.0;
+static const int32 kMaxBlock = 4096;
+static const int32 kBlockSizes[] = { 333, 1, 64, 1000, 4096, 17 };
+static const int32 kAnalysisFrames = 16384;
+// Tails longer than this are almost certainly garbage
+static const int32 kMaxTail = 60 * 48000;
+
+// 0 if the reported latency checks out
+static int checkLatency(Plugin& plugin, const char* name) {
+    int32 latency = -1;
+    int32 tail = -1;
+    plugin.processor->getLatencySamples(latency);
+    plugin.processor->getTailSamples(tail);
+    printf("%s: latency %d, tail %d samples\n", name, latency, tail);
+
+    if (latency < 0 || tail < 0 || tail > kMaxTail) {
+        fprintf(stderr, "latency_test: FAILED (implausible latency/tail)\n");
+        return 1;
+    }
+    if (latency == 0) {
+        printf("latency_test: ok (no latency reported)\n");
+        return 0;
+    }
+
+    const int32 total = latency * 2 + kAnalysisFrames;
+    std::vector<float> in[2] = { std::vector<float>(total), std::vector<float>(total) };
+    std::vector<float> out(total);
+    fillNoise(in[0], 1);
+    fillNoise(in[1], 2);
+    for (int ch = 0; ch < 2; ch++) {
+        for (float& s : in[ch]) s *= 0.25f;
+    }
+
+    StereoBlock block(kMaxBlock);
+    int32 pos = 0;
+    for (int b = 0; pos < total; b++) {
+        int32 n = kBlockSizes[b % (sizeof(kBlockSizes) / sizeof(kBlockSizes[0]))];
+        if (n > total - pos) n = total - pos;
+        block.data.numSamples = n;
+        for (int ch = 0; ch < 2; ch++) memcpy(block.in[ch].data(), in[ch].data() + pos, sizeof(float) * n);
+        plugin.processor->process(block.data);
+        memcpy(out.data() + pos, block.out[0].data(), sizeof(float) * n);
+        pos += n;
+    }
+
+    // Correlate the left input against the output over the settled part
+    int32 bestLag = -1;
+    double best = 0.0;
+    for (int32 lag = 0; lag <= latency * 2; lag++) {
+        double sum = 0.0;
+        for (int32 i = 0; i < kAnalysisFrames; i++) sum += (double)in[0][i] * out[i + lag];
+        if (std::fabs(sum) > best) { best = std::fabs(sum); bestLag = lag; }
+    }
+    printf("measured delay: %d samples\n", bestLag);
+
+    if (bestLag != latency) {
+        fprintf(stderr, "latency_test: FAILED (reported %d, measured %d)\n", latency, bestLag);
+        return 1;
+    }
+    printf("latency_test: ok\n");
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    const char* name = argc > 1 ? argv[1] : "";
+
+    Plugin plugin;
+    if (!plugin.open(kSampleRate, kMaxBlock)) {
+        fprintf(stderr, "latency_test: failed to create plugin\n");
+        return 1;
+    }
+    int failed = checkLatency(plugin, name);
+
+    const int32 osParam = plugin_class_oversampling_param(0);
+    void* obj = nullptr;
+    if (!failed && osParam >= 0 && plugin.component->queryInterface(IEditController::iid, &obj) == kResultOk) {
+        IEditController* controller = (IEditController*)obj;
+        for (int step = 1; step <= 3 && !failed; step++) {
+            controller->setParamNormalized(osParam, step / 3.0);
+            plugin.component->setActive(false);
+            plugin.component->setActive(true);
+            char label[64];
+            snprintf(label, sizeof(label), "%s @ %dx", name, 1 << step);
+            failed = checkLatency(plugin, label);
+        }
+        controller->release();
+    }
+    plugin.close();
+    return failed;
+}
@@ -0,0 +1,301 @@
+// Real-time meters: what the kernel publishes from plugin_process and how
+// the VST3 wrapper reports it.
+//
+// 1. Levels: an empty module chain passes a 997 Hz sine at -6 dBFS through;
+//    peak, RMS and momentary loudness must read what BS.1770 says it is.
+// 2. Gain reduction: the compressor, with no makeup and fully wet, must
+//    report about the drop in peak it applies, and a chain running it
+//    must report its module's.
+// 3. Periods: a single loud block among silent ones must show in the read
+//    after it however many blocks later that read comes, and not in the
+//    one after that. Blocks skipped as silent count as silence.
+// 4. Concurrency: a reader thread polls while the audio thread renders.
+//    Every successful read must be finite with a block count that never
+//    goes backwards, and the final read must have seen every block.
+// 5. The wrapper: the meters come after the class's parameters as
+//    read-only ones, get a point on each block's last sample through
+//    outputParameterChanges, and read back through getParamNormalized.
+//
+// Worth running under -fsanitize=thread as well as in the normal build.
+
+#include "bench_host.h"
+#include "meters.h"
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <thread>
+
+using namespace bench;
+
+extern "C" {
+    uint32_t plugin_class_count();
+    const char* plugin_class_id(uint32_t index);
+    uint32_t plugin_class_param_count(uint32_t index);
+    uint32_t plugin_class_param_steps(uint32_t index, int32_t param);
+    void* plugin_create_class(uint32_t index, float sample_rate);
+    int32_t plugin_prepare(void* instance, float sample_rate, size_t max_block);
+    void plugin_process(void* instance, const float* const* inputs, float** outputs, size_t frames);
+    void plugin_set_parameter(void* instance, int32_t index, float value);
+    void plugin_destroy(void* instance);
+}
+
+static const float kSampleRate = 48000.0f;
+static const size_t kBlock = 480;
+static const double kPi = 3.14159265358979323846;
+static const float kAmplitude = 0.5f;
+// The wrapper's parameter limit, where the meters' ids start
+static const ParamID kMeterBase = 256;
+static const int32 kMeters = 6;
+
+static int failures = 0;
+
+static void expect(bool ok, const char* what, double got) {
+    if (ok) return;
+    fprintf(stderr, "FAIL: %s (got %.3f)\n", what, got);
+    failures++;
+}
+
+static int32_t findClass(const char* id) {
+    for (uint32_t c = 0; c < plugin_class_count(); c++) {
+        if (strcmp(plugin_class_id(c), id) == 0) return (int32_t)c;
+    }
+    return -1;
+}
+
+// An instance with metering on; a chain gets `module` in its first slot
+// and nothing in the rest
+static void* openMetered(const char* id, const char* module = nullptr) {
+    const int32_t index = findClass(id);
+    if (index < 0) return nullptr;
+    void* instance = plugin_create_class((uint32_t)index, kSampleRate);
+    if (!instance) return nullptr;
+    for (uint32_t p = 0; p < plugin_class_param_count((uint32_t)index); p++) {
+        const uint32_t steps = plugin_class_param_steps((uint32_t)index, (int32_t)p);
+        if (steps == 0) continue;
+        const int32_t selected = p == 0 && module ? findClass(module) : -1;
+        plugin_set_parameter(instance, (int32_t)p, selected < 0 ? 0.0f : (float)(selected + 1) / (float)steps);
+    }
+    if (plugin_set_metering(instance, 1) != 0 || plugin_prepare(instance, kSampleRate, kBlock) != 0) {
+        plugin_destroy(instance);
+        return nullptr;
+    }
+    return instance;
+}
+
+struct Stereo {
+    std::vector<float> in[2] = { std::vector<float>(kBlock), std::vector<float>(kBlock) };
+    std::vector<float> out[2] = { std::vector<float>(kBlock), std::vector<float>(kBlock) };
+    const float* inPtrs[2] = { in[0].data(), in[1].data() };
+    float* outPtrs[2] = { out[0].data(), out[1].data() };
+    size_t phase = 0;
+
+    void sine(float amplitude) {
+        for (size_t i = 0; i < kBlock; i++, phase++) {
+            const float s = amplitude * (float)std::sin(2.0 * kPi * 997.0 * (double)phase / kSampleRate);
+            in[0][i] = s;
+            in[1][i] = s;
+        }
+    }
+    void silence() {
+        for (auto& ch : in) std::fill(ch.begin(), ch.end(), 0.0f);
+    }
+    double peakOut() const {
+        float peak = 0.0f;
+        for (const auto& ch : out) {
+            for (float s : ch) peak = std::max(peak, std::fabs(s));
+        }
+        return 20.0 * std::log10(std::max(peak, 1e-10f));
+    }
+};
+
+static SonicMeterReadings read(void* instance) {
+    SonicMeterReadings r;
+    memset(&r, 0, sizeof(r));
+    if (plugin_read_meters(instance, &r) != 0) {
+        fprintf(stderr, "FAIL: meters unreadable\n");
+        failures++;
+    }
+    return r;
+}
+
+static void testLevels() {
+    void* chain = openMetered("sonicchain");
+    if (!chain) {
+        fprintf(stderr, "FAIL: can't open an empty chain\n");
+        failures++;
+        return;
+    }
+    Stereo io;
+    // A second of sine, then one block to read on its own
+    for (int b = 0; b < 100; b++) {
+        io.sine(kAmplitude);
+        plugin_process(chain, io.inPtrs, io.outPtrs, kBlock);
+    }
+    read(chain);
+    io.sine(kAmplitude);
+    plugin_process(chain, io.inPtrs, io.outPtrs, kBlock);
+    const SonicMeterReadings r = read(chain);
+
+    const double peak = 20.0 * std::log10(kAmplitude);
+    printf("levels     peak %.2f/%.2f dB  rms %.2f/%.2f dB  momentary %.2f LUFS  gr %.2f dB  blocks %llu\n", r.peakDb[0],
+           r.peakDb[1], r.rmsDb[0], r.rmsDb[1], r.momentaryLufs, r.gainReductionDb, (unsigned long long)r.blocks);
+    for (int side = 0; side < 2; side++) {
+        expect(std::fabs(r.peakDb[side] - peak) < 0.1, "sine peak", r.peakDb[side]);
+        expect(std::fabs(r.rmsDb[side] - (peak - 3.01)) < 0.1, "sine RMS", r.rmsDb[side]);
+    }
+    // Both channels at -6.02 dBFS: 0 LUFS for full scale, less 6.02
+    expect(std::fabs(r.momentaryLufs - peak) < 0.2, "sine momentary loudness", r.momentaryLufs);
+    expect(r.gainReductionDb == 0.0f, "passthrough gain reduction", r.gainReductionDb);
+    expect(r.blocks == 101, "block count", (double)r.blocks);
+    plugin_destroy(chain);
+}
+
+static void testGainReduction(const char* id, const char* module) {
+    void* instance = openMetered(id, module);
+    if (!instance) {
+        fprintf(stderr, "FAIL: can't open %s\n", id);
+        failures++;
+        return;
+    }
+    // The compressor's own parameters: threshold -30 dB, 4:1, 1 ms
+    // attack, 100 ms release, hard knee, no makeup, fully wet, VCA
+    const int32 base = module ? 8 : 0;
+    const float settings[] = { 0.5f, 3.0f / 19.0f, 0.9f / 99.9f, 99.0f / 999.0f, 0.0f, 0.0f, 1.0f, 0.0f };
+    for (int32 p = 0; p < 8; p++) plugin_set_parameter(instance, base + p, settings[p]);
+
+    Stereo io;
+    for (int b = 0; b < 100; b++) {
+        io.sine(kAmplitude);
+        plugin_process(instance, io.inPtrs, io.outPtrs, kBlock);
+    }
+    read(instance);
+    io.sine(kAmplitude);
+    plugin_process(instance, io.inPtrs, io.outPtrs, kBlock);
+    const SonicMeterReadings r = read(instance);
+    const double drop = 20.0 * std::log10(kAmplitude) - io.peakOut();
+    printf("%-10s gain reduction %.2f dB, peak down %.2f dB\n", module ? "chain" : id, r.gainReductionDb, drop);
+    expect(r.gainReductionDb > 10.0f, "gain reduction reported", r.gainReductionDb);
+    expect(std::fabs(r.gainReductionDb - drop) < 2.0, "gain reduction against the peak drop", r.gainReductionDb - drop);
+    plugin_destroy(instance);
+}
+
+static void testPeriods() {
+    void* chain = openMetered("sonicchain");
+    if (!chain) return;
+    Stereo io;
+    read(chain);
+    for (int b = 0; b < 10; b++) {
+        if (b == 3) io.sine(0.9f); else io.silence();
+        plugin_process(chain, io.inPtrs, io.outPtrs, kBlock);
+    }
+    SonicMeterReadings r = read(chain);
+    expect(std::fabs(r.peakDb[0] - 20.0 * std::log10(0.9)) < 0.1, "peak held until read", r.peakDb[0]);
+
+    io.silence();
+    plugin_process(chain, io.inPtrs, io.outPtrs, kBlock);
+    plugin_meter_silence(chain, kBlock);
+    r = read(chain);
+    expect(r.peakDb[0] == -100.0f && r.rmsDb[1] == -100.0f, "silence after the read", r.peakDb[0]);
+    expect(r.blocks == 12, "skipped block counted", (double)r.blocks);
+    plugin_destroy(chain);
+}
+
+static void testConcurrentReader() {
+    void* instance = openMetered("soniccompressor");
+    if (!instance) return;
+    const int blocks = 20000;
+    std::atomic<bool> running(true);
+    uint64_t reads = 0, refused = 0, backwards = 0, notFinite = 0;
+    std::thread reader([&] {
+        uint64_t last = 0;
+        while (running.load(std::memory_order_acquire)) {
+            SonicMeterReadings r;
+            if (plugin_read_meters(instance, &r) != 0) {
+                refused++;
+                continue;
+            }
+            reads++;
+            if (r.blocks < last) backwards++;
+            last = r.blocks;
+            const float values[] = { r.peakDb[0], r.peakDb[1], r.rmsDb[0], r.rmsDb[1], r.momentaryLufs, r.gainReductionDb };
+            for (float v : values) {
+                if (!std::isfinite(v)) notFinite++;
+            }
+        }
+    });
+    Stereo io;
+    for (int b = 0; b < blocks; b++) {
+        io.sine(b % 7 == 0 ? 0.9f : 0.1f);
+        plugin_process(instance, io.inPtrs, io.outPtrs, kBlock);
+    }
+    running.store(false, std::memory_order_release);
+    reader.join();
+    const SonicMeterReadings last = read(instance);
+    printf("concurrent %llu reads, %llu refused, over %d blocks\n", (unsigned long long)reads, (unsigned long long)refused, blocks);
+    expect(backwards == 0, "block count went backwards", (double)backwards);
+    expect(notFinite == 0, "reading not finite", (double)notFinite);
+    expect(last.blocks == (uint64_t)blocks, "final read covers every block", (double)last.blocks);
+    plugin_destroy(instance);
+}
+
+static void testWrapper() {
+    const int32 classIndex = findClass("soniccompressor");
+    Plugin plugin;
+    if (classIndex < 0 || !plugin.open(kSampleRate, (int32)kBlock, classIndex)) {
+        fprintf(stderr, "FAIL: can't open the compressor through the wrapper\n");
+        failures++;
+        return;
+    }
+    void* obj = nullptr;
+    plugin.component->queryInterface(IEditController::iid, &obj);
+    IEditController* controller = (IEditController*)obj;
+    const int32 params = controller->getParameterCount();
+    expect(params == 16 + kMeters, "parameter count", params);
+    for (int32 i = 16; i < params; i++) {
+        ParameterInfo info;
+        controller->getParameterInfo(i, info);
+        expect(info.id == kMeterBase + (i - 16) && (info.flags & ParameterInfo::kIsReadOnly), "meter parameter info", info.id);
+    }
+
+    StereoBlock block((int32)kBlock);
+    HostParamChanges outputs;
+    block.data.outputParameterChanges = &outputs;
+    for (int b = 0; b < 50; b++) {
+        outputs.clearPoints();
+        for (size_t i = 0; i < kBlock; i++) {
+            block.in[0][i] = block.in[1][i] = kAmplitude * (float)std::sin(2.0 * kPi * 997.0 * (double)(b * kBlock + i) / kSampleRate);
+        }
+        plugin.processor->process(block.data);
+    }
+    expect(outputs.getParameterCount() == kMeters, "meter queues", outputs.getParameterCount());
+    for (int32 q = 0; q < outputs.getParameterCount(); q++) {
+        IParamValueQueue* queue = outputs.getParameterData(q);
+        int32 offset = -1;
+        ParamValue value = -1.0;
+        const bool one = queue->getPointCount() == 1 && queue->getPoint(0, offset, value) == kResultOk;
+        expect(one && offset == (int32)kBlock - 1, "one point on the last sample", offset);
+        expect(value >= 0.0 && value <= 1.0, "normalised meter value", value);
+        expect(controller->getParamNormalized(queue->getParameterId()) == (float)value, "getParamNormalized matches the report",
+               controller->getParamNormalized(queue->getParameterId()));
+    }
+    // Peak L, on a 60 dB scale, of the block just processed
+    float peak = 0.0f;
+    for (float s : block.out[0]) peak = std::max(peak, std::fabs(s));
+    expect(std::fabs(controller->getParamNormalized(kMeterBase) - (1.0 + 20.0 * std::log10(peak) / 60.0)) < 0.001, "peak meter value",
+           controller->getParamNormalized(kMeterBase));
+    printf("wrapper    %d parameters, peak %.3f, gain reduction %.3f (normalised)\n", params,
+           controller->getParamNormalized(kMeterBase), controller->getParamNormalized(kMeterBase + 5));
+    controller->release();
+    plugin.close();
+}
+
+int main() {
+    testLevels();
+    testGainReduction("soniccompressor", nullptr);
+    testGainReduction("sonicchain", "soniccompressor");
+    testPeriods();
+    testConcurrentReader();
+    testWrapper();
+    printf("meter_test: %s\n", failures ? "FAILED" : "ok");
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,259 @@
+// Stress harness for the controller -> audio thread parameter hand-off.
+//
+// 1. ParamChannel on its own: several writer threads publish strictly
+//    increasing values into the slots they own while a reader drains in a
+//    tight loop. The reader must never see a slot go backwards and must end
+//    on each writer's final value.
+// 2. The real VST3 wrapper: writer threads hammer setParamNormalized while a
+//    render thread calls process() continuously.
+// 3. Host automation of a single parameter, the highest writable id: one
+//    queue with one point must reach the kernel, whatever the queue count.
+// 4. More automation points in one block than the wrapper takes (512):
+//    every continuous parameter must still end on its queue's last point.
+//
+// Worth running under -fsanitize=thread as well as in the normal build.
+
+#include "bench_host.h"
+#include "param_channel.h"
+#include <atomic>
+#include <thread>
+#include <random>
+
+using namespace bench;
+
+static const int kWriters = 4;
+static const int kParams = 16;
+static const auto kDuration = std::chrono::milliseconds(1500);
+
+static int testChannel() {
+    ParamChannel<kParams> channel(0.0f);
+    std::atomic<bool> running(true);
+    float finalValue[kParams] = {};
+
+    std::vector<std::thread> writers;
+    for (int w = 0; w < kWriters; w++) {
+        writers.emplace_back([&, w] {
+            // Values stay below 2^24 so every step is exactly representable
+            float seq[kParams] = {};
+            while (running.load(std::memory_order_relaxed)) {
+                for (int p = w; p < kParams; p += kWriters) {
+                    if (seq[p] < 16000000.0f) seq[p] += 1.0f;
+                    channel.push(p, seq[p]);
+                }
+            }
+            for (int p = w; p < kParams; p += kWriters) finalValue[p] = seq[p];
+        });
+    }
+
+    float seen[kParams] = {};
+    int failures = 0;
+    long drains = 0;
+    auto check = [&](int index, float value) {
+        if (value < seen[index]) failures++;
+        seen[index] = value;
+    };
+
+    auto start = Clock::now();
+    while (Clock::now() - start < kDuration) {
+        channel.drain(check);
+        drains++;
+    }
+    running = false;
+    for (auto& t : writers) t.join();
+    channel.drain(check);
+
+    for (int p = 0; p < kParams; p++) {
+        if (seen[p] != finalValue[p]) {
+            fprintf(stderr, "channel: param %d ended at %f, expected %f\n", p, seen[p], finalValue[p]);
+            failures++;
+        }
+    }
+    printf("channel: %ld drains, %d failures\n", drains, failures);
+    return failures;
+}
+
+static int testWrapper() {
+    const int32 blockSize = 128;
+    Plugin plugin;
+    if (!plugin.open(48000.0, blockSize)) {
+        fprintf(stderr, "wrapper: failed to create plugin\n");
+        return 1;
+    }
+    void* obj = nullptr;
+    if (plugin.component->queryInterface(IEditController::iid, &obj) != kResultOk) {
+        fprintf(stderr, "wrapper: no IEditController\n");
+        return 1;
+    }
+    IEditController* controller = (IEditController*)obj;
+
+    StereoBlock block(blockSize);
+    fillNoise(block.in[0], 1);
+    fillNoise(block.in[1], 2);
+
+    std::atomic<bool> running(true);
+    std::atomic<long> blocks(0);
+    double lastWritten[kParams] = {};
+
+    std::thread render([&] {
+        while (running.load(std::memory_order_relaxed)) {
+            plugin.processor->process(block.data);
+            blocks.fetch_add(1, std::memory_order_relaxed);
+        }
+    });
+
+    std::vector<std::thread> writers;
+    for (int w = 0; w < kWriters; w++) {
+        writers.emplace_back([&, w] {
+            std::mt19937 rng(1234 + w);
+            std::uniform_real_distribution<double> dist(0.0, 1.0);
+            double last[kParams] = {};
+            while (running.load(std::memory_order_relaxed)) {
+                for (int p = w; p < kParams; p += kWriters) {
+                    last[p] = (float)dist(rng);
+                    controller->setParamNormalized(p, last[p]);
+                }
+            }
+            for (int p = w; p < kParams; p += kWriters) lastWritten[p] = last[p];
+        });
+    }
+
+    std::this_thread::sleep_for(kDuration);
+    running = false;
+    for (auto& t : writers) t.join();
+    render.join();
+    plugin.processor->process(block.data);
+
+    int failures = 0;
+    for (int p = 0; p < kParams; p++) {
+        if ((float)controller->getParamNormalized(p) != (float)lastWritten[p]) {
+            fprintf(stderr, "wrapper: param %d reads %f, last write was %f\n", p,
+                    controller->getParamNormalized(p), lastWritten[p]);
+            failures++;
+        }
+    }
+    printf("wrapper: %ld blocks rendered, %d failures\n", blocks.load(), failures);
+
+    controller->release();
+    plugin.close();
+    return failures;
+}
+
+static int testSingleQueue() {
+    const int32 blockSize = 128;
+    Plugin plugin;
+    if (!plugin.open(48000.0, blockSize)) {
+        fprintf(stderr, "single queue: failed to create plugin\n");
+        return 1;
+    }
+    void* obj = nullptr;
+    if (plugin.component->queryInterface(IEditController::iid, &obj) != kResultOk) {
+        fprintf(stderr, "single queue: no IEditController\n");
+        return 1;
+    }
+    IEditController* controller = (IEditController*)obj;
+
+    // Meters come after the parameters and are read-only
+    ParamID id = 0;
+    for (int32 i = 0; i < controller->getParameterCount(); i++) {
+        ParameterInfo info;
+        if (controller->getParameterInfo(i, info) == kResultOk && !(info.flags & ParameterInfo::kIsReadOnly)) id = info.id;
+    }
+    const double value = controller->getParamNormalized(id) < 0.5 ? 0.75 : 0.25;
+
+    StereoBlock block(blockSize);
+    fillNoise(block.in[0], 1);
+    fillNoise(block.in[1], 2);
+    HostParamChanges changes;
+    int32 index;
+    changes.addParameterData(id, index)->addPoint(10, value, index);
+    block.data.inputParameterChanges = &changes;
+    plugin.processor->process(block.data);
+    block.data.inputParameterChanges = nullptr;
+
+    int failures = 0;
+    if ((float)controller->getParamNormalized(id) != (float)value) {
+        fprintf(stderr, "single queue: param %u reads %f, automated to %f\n", (unsigned)id,
+                controller->getParamNormalized(id), value);
+        failures++;
+    }
+    printf("single queue: param %u automated alone, %d failures\n", (unsigned)id, failures);
+
+    controller->release();
+    plugin.close();
+    return failures;
+}
+
+static int testManyPoints() {
+    const int32 blockSize = 128;
+    const int32 pointsPerQueue = 100;
+    Plugin plugin;
+    if (!plugin.open(48000.0, blockSize)) {
+        fprintf(stderr, "many points: failed to create plugin\n");
+        return 1;
+    }
+    void* obj = nullptr;
+    if (plugin.component->queryInterface(IEditController::iid, &obj) != kResultOk) {
+        fprintf(stderr, "many points: no IEditController\n");
+        return 1;
+    }
+    IEditController* controller = (IEditController*)obj;
+
+    // Stepped settings round their values, so only continuous ones
+    std::vector<ParamID> ids;
+    for (int32 i = 0; i < controller->getParameterCount(); i++) {
+        ParameterInfo info;
+        if (controller->getParameterInfo(i, info) != kResultOk) continue;
+        if (!(info.flags & ParameterInfo::kIsReadOnly) && info.stepCount == 0) ids.push_back(info.id);
+    }
+    HostParamChanges changes;
+    std::vector<double> finalValue;
+    for (size_t q = 0; q < ids.size(); q++) {
+        int32 index;
+        IParamValueQueue* queue = changes.addParameterData(ids[q], index);
+        double value = 0.0;
+        for (int32 p = 0; p < pointsPerQueue; p++) {
+            value = 0.1 + 0.8 * (double)((p + 7 * (int32)q) % pointsPerQueue) / pointsPerQueue;
+            queue->addPoint(p * blockSize / pointsPerQueue, value, index);
+        }
+        finalValue.push_back(value);
+    }
+
+    if (ids.size() * pointsPerQueue <= 512) {
+        fprintf(stderr, "many points: only %zu continuous params\n", ids.size());
+        controller->release();
+        plugin.close();
+        return 1;
+    }
+
+    StereoBlock block(blockSize);
+    fillNoise(block.in[0], 1);
+    fillNoise(block.in[1], 2);
+    block.data.inputParameterChanges = &changes;
+    plugin.processor->process(block.data);
+    block.data.inputParameterChanges = nullptr;
+
+    int failures = 0;
+    for (size_t q = 0; q < ids.size(); q++) {
+        if ((float)controller->getParamNormalized(ids[q]) != (float)finalValue[q]) {
+            fprintf(stderr, "many points: param %u reads %f, last point was %f\n", (unsigned)ids[q],
+                    controller->getParamNormalized(ids[q]), finalValue[q]);
+            failures++;
+        }
+    }
+    printf("many points: %zu points over %zu params, %d failures\n", ids.size() * pointsPerQueue, ids.size(),
+           failures);
+
+    controller->release();
+    plugin.close();
+    return failures;
+}
+
+int main() {
+    int failures = testChannel() + testWrapper() + testSingleQueue() + testManyPoints();
+    if (failures) {
+        fprintf(stderr, "param_stress_test: FAILED\n");
+        return 1;
+    }
+    printf("param_stress_test: ok\n");
+    return 0;
+}
@@ -0,0 +1,183 @@
+// Pitch tracking and real-time tape stabilization test.
+//
+// The FFT-based YIN tracker must agree with the brute-force detector it
+// replaced on every frame of 60 Hz hum with wow, a harmonic and noise, and
+// give the same estimates when the signal is streamed in blocks of any
+// size. Then sonictapestabilizer, through the suite's VST3 wrapper, must
+// report its latency, pass noise (no tone to lock to) through delayed by
+// exactly that, and take most of the wow out of a hum-plus-tone recording.
+
+#include "bench_host.h"
+#include "pitch_tracker.h"
+#include <cmath>
+#include <cstring>
+
+using namespace bench;
+
+static const double kSampleRate = 48000.0;
+// process_tapestabilizer's analysis
+static const size_t kFrame = 2048;
+static const size_t kHop = 1024;
+static const float kTolerance = 0.01f;
+static const int32 kBlockSizes[] = { 333, 1, 64, 1000, 4096, 17 };
+static const int32 kMaxBlock = 4096;
+
+// Tape speed: 1% wow at 0.7 Hz and 0.3% flutter at 4 Hz
+static double speedAt(size_t i) {
+    const double t = i / kSampleRate;
+    return 1.0 + 0.01 * std::sin(2.0 * M_PI * 0.7 * t) + 0.003 * std::sin(2.0 * M_PI * 4.0 * t);
+}
+
+// 60 Hz hum and a 440 Hz tone recorded at that speed, plus noise
+static void fillWow(std::vector<float>& l, std::vector<float>& r) {
+    std::vector<float> noise(l.size());
+    fillNoise(noise, 7);
+    double hum = 0.0, tone = 0.0;
+    for (size_t i = 0; i < l.size(); i++) {
+        hum += 2.0 * M_PI * 60.0 * speedAt(i) / kSampleRate;
+        tone += 2.0 * M_PI * 440.0 * speedAt(i) / kSampleRate;
+        l[i] = (float)(0.3 * std::sin(hum) + 0.1 * std::sin(3.0 * hum) + 0.3 * std::sin(tone)) + 0.01f * noise[i];
+        r[i] = (float)(0.3 * std::sin(hum) + 0.1 * std::sin(3.0 * hum) + 0.2 * std::sin(tone + 1.0)) + 0.01f * noise[i];
+    }
+}
+
+static int checkTracker() {
+    std::vector<float> l(kSampleRate * 10), r(l.size());
+    fillWow(l, r);
+    void* tracker = pitch_tracker_create(kFrame, kHop, kSampleRate, 55.0f, 65.0f);
+    void* streamed = pitch_tracker_create(kFrame, kHop, kSampleRate, 55.0f, 65.0f);
+    if (!tracker || !streamed) {
+        fprintf(stderr, "pitch_test: failed to create trackers\n");
+        return 1;
+    }
+
+    std::vector<float> freqs;
+    std::vector<float> block(l.size() / kHop + 1);
+    size_t pos = 0;
+    for (int b = 0; pos < l.size(); b++) {
+        size_t n = std::min((size_t)kBlockSizes[b % (sizeof(kBlockSizes) / sizeof(kBlockSizes[0]))], l.size() - pos);
+        size_t count = pitch_tracker_push(streamed, l.data() + pos, n, block.data());
+        freqs.insert(freqs.end(), block.begin(), block.begin() + count);
+        pos += n;
+    }
+
+    int failures = 0;
+    float worst = 0.0f;
+    size_t frames = 0;
+    for (size_t p = 0; p + kFrame <= l.size(); p += kHop, frames++) {
+        const float reference = pitch_reference_detect(l.data() + p, kFrame, kSampleRate, 55.0f, 65.0f);
+        float aperiodicity = 1.0f;
+        const float fast = pitch_tracker_analyse(tracker, l.data() + p, &aperiodicity);
+        worst = std::max(worst, std::fabs(fast - reference));
+        if (std::fabs(fast - reference) > kTolerance || aperiodicity >= 0.15f) failures++;
+        if (frames >= freqs.size() || freqs[frames] != fast) failures++;
+    }
+    if (freqs.size() != frames) failures++;
+    printf("tracker: %zu frames, %zu streamed, worst difference from reference %.5f Hz\n", frames, freqs.size(), worst);
+    pitch_tracker_destroy(tracker);
+    pitch_tracker_destroy(streamed);
+    return failures ? 1 : 0;
+}
+
+static int32 findClass(const char* name) {
+    IPluginFactory* factory = GetPluginFactory();
+    for (int32 c = 0; c < factory->countClasses(); c++) {
+        PClassInfo info;
+        if (factory->getClassInfo(c, &info) == kResultOk && strcmp(info.name, name) == 0) return c;
+    }
+    return -1;
+}
+
+// The wrapper starts every parameter mid-range: 70 Hz nominal, half
+// correction. Set 60 Hz and full correction.
+static void setParams(Plugin& p) {
+    void* obj = nullptr;
+    p.component->queryInterface(IEditController::iid, &obj);
+    IEditController* controller = (IEditController*)obj;
+    controller->setParamNormalized(0, (60.0 - 40.0) / 60.0);
+    controller->setParamNormalized(1, 1.0);
+    controller->release();
+}
+
+static void render(Plugin& plugin, const std::vector<float> (&in)[2], std::vector<float> (&out)[2]) {
+    StereoBlock block(kMaxBlock);
+    size_t pos = 0;
+    for (int b = 0; pos < in[0].size(); b++) {
+        int32 n = kBlockSizes[b % (sizeof(kBlockSizes) / sizeof(kBlockSizes[0]))];
+        n = (int32)std::min((size_t)n, in[0].size() - pos);
+        block.data.numSamples = n;
+        for (int ch = 0; ch < 2; ch++) memcpy(block.in[ch].data(), in[ch].data() + pos, sizeof(float) * n);
+        plugin.processor->process(block.data);
+        for (int ch = 0; ch < 2; ch++) memcpy(out[ch].data() + pos, block.out[ch].data(), sizeof(float) * n);
+        pos += n;
+    }
+}
+
+// Standard deviation of the hum's measured frequency from `from` on
+static double humSpread(const std::vector<float>& x, size_t from) {
+    void* tracker = pitch_tracker_create(4096, kHop, kSampleRate, 50.0f, 70.0f);
+    double sum = 0.0, sq = 0.0;
+    int n = 0;
+    for (size_t p = from; p + 4096 <= x.size(); p += kHop, n++) {
+        const double f = pitch_tracker_analyse(tracker, x.data() + p, nullptr);
+        sum += f;
+        sq += f * f;
+    }
+    pitch_tracker_destroy(tracker);
+    const double mean = sum / n;
+    return std::sqrt(std::max(sq / n - mean * mean, 0.0));
+}
+
+static int checkStabilizer() {
+    const int32 classIndex = findClass("sonictapestabilizer");
+    if (classIndex < 0) {
+        fprintf(stderr, "pitch_test: no sonictapestabilizer in this build\n");
+        return 1;
+    }
+    Plugin noisePlugin;
+    Plugin wowPlugin;
+    if (!noisePlugin.open(kSampleRate, kMaxBlock, classIndex) || !wowPlugin.open(kSampleRate, kMaxBlock, classIndex)) {
+        fprintf(stderr, "pitch_test: failed to open sonictapestabilizer\n");
+        return 1;
+    }
+    setParams(noisePlugin);
+    setParams(wowPlugin);
+    int32 latency = 0;
+    noisePlugin.processor->getLatencySamples(latency);
+    printf("stabilizer: latency %d samples\n", latency);
+    int failures = latency > 0 ? 0 : 1;
+
+    // No tone: a pure delay
+    std::vector<float> noise[2] = { std::vector<float>(kSampleRate * 2), std::vector<float>(kSampleRate * 2) };
+    std::vector<float> delayed[2] = { std::vector<float>(noise[0].size()), std::vector<float>(noise[0].size()) };
+    fillNoise(noise[0], 1);
+    fillNoise(noise[1], 2);
+    render(noisePlugin, noise, delayed);
+    size_t mismatched = 0;
+    for (int ch = 0; ch < 2; ch++) {
+        for (size_t i = latency; i < noise[ch].size(); i++) mismatched += delayed[ch][i] != noise[ch][i - latency];
+    }
+    printf("stabilizer: noise, %zu samples off the reported delay\n", mismatched);
+    if (mismatched) failures++;
+
+    std::vector<float> wow[2] = { std::vector<float>(kSampleRate * 20), std::vector<float>(kSampleRate * 20) };
+    std::vector<float> fixed[2] = { std::vector<float>(wow[0].size()), std::vector<float>(wow[0].size()) };
+    fillWow(wow[0], wow[1]);
+    render(wowPlugin, wow, fixed);
+    // After the speed average has settled
+    const size_t settle = (size_t)kSampleRate * 5;
+    const double before = humSpread(wow[0], settle);
+    const double after = humSpread(fixed[0], settle + latency);
+    printf("stabilizer: hum frequency spread %.4f Hz in, %.4f Hz out\n", before, after);
+    if (!(after < 0.25 * before)) failures++;
+
+    noisePlugin.close();
+    wowPlugin.close();
+    return failures ? 1 : 0;
+}
+
+int main() {
+    const int failures = checkTracker() + checkStabilizer();
+    printf("pitch_test: %s\n", failures ? "FAILED" : "ok");
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,208 @@
+// RT-safety check for both native render paths.
+//
+// Built with -DSONIC_RT_GUARD and rt_guard.cpp linked in, so every
+// allocation made inside PluginWrapper::process or SonicAU::Render is
+// counted. Violations are logged instead of aborting so one run reports
+// them all.
+//
+// 1. Negative control: an allocation inside a guarded scope must be seen.
+// 2. VST3: static blocks, sample-accurate automation and controller edits.
+// 3. VST3 in-place: the host passes the same buffers for in and out; output
+//    must match an out-of-place run of a fresh instance.
+// 4. AU: factory -> Open -> Initialize -> Render with a render callback.
+
+#include "bench_host.h"
+#include "au_minimal.h"
+#include "rt_guard.h"
+#include <cmath>
+
+using namespace bench;
+
+extern "C" void* SonicPluginFactory(const AudioComponentDescription* inDesc);
+
+// No upstream AudioUnits here; the test feeds input through a render callback
+extern "C" OSStatus AudioUnitRender(void*, AudioUnitRenderActionFlags*, const AudioTimeStamp*, UInt32, UInt32, AudioBufferList*) {
+    return kAudioUnitErr_NoConnection;
+}
+
+static const double kSampleRate = 48000.0;
+static const int32 kBlockSize = 256;
+static const int kBlocks = 400;
+
+static uint64_t violations() { return sonic_rt_guard_violations(); }
+
+static int testControl() {
+    uint64_t before = violations();
+    {
+        RtGuardScope rtGuard;
+        void* volatile p = malloc(64);
+        free(p);
+    }
+    if (violations() - before != 2) {
+        fprintf(stderr, "control: guard missed malloc/free inside a scope\n");
+        return 1;
+    }
+    printf("control: ok\n");
+    return 0;
+}
+
+static int testVst3() {
+    Plugin plugin;
+    if (!plugin.open(kSampleRate, kBlockSize)) {
+        fprintf(stderr, "vst3: failed to create plugin\n");
+        return 1;
+    }
+    void* obj = nullptr;
+    plugin.component->queryInterface(IEditController::iid, &obj);
+    IEditController* controller = (IEditController*)obj;
+
+    StereoBlock block(kBlockSize);
+    fillNoise(block.in[0], 1);
+    fillNoise(block.in[1], 2);
+
+    HostParamChanges changes;
+    for (int32 p = 0; p < 4; p++) {
+        int32 idx;
+        changes.addParameterData(p, idx);
+    }
+
+    uint64_t before = violations();
+    for (int b = 0; b < kBlocks; b++) {
+        // Queue points are filled before process() so the host's own vectors stay out of the count
+        block.data.inputParameterChanges = nullptr;
+        if (b % 2) {
+            changes.clearPoints();
+            for (int32 p = 0; p < 4; p++) {
+                int32 idx;
+                for (int32 off = 0; off < kBlockSize; off += 32)
+                    changes.getParameterData(p)->addPoint(off, (double)((b + off + p) % 100) / 100.0, idx);
+            }
+            block.data.inputParameterChanges = &changes;
+        }
+        if (b % 5 == 0) controller->setParamNormalized(b % 16, (double)(b % 10) / 10.0);
+        plugin.processor->process(block.data);
+    }
+    uint64_t found = violations() - before;
+    printf("vst3: %d blocks, %llu violations\n", kBlocks, (unsigned long long)found);
+
+    controller->release();
+    plugin.close();
+    return found ? 1 : 0;
+}
+
+static int testVst3InPlace() {
+    Plugin reference, inPlace;
+    if (!reference.open(kSampleRate, kBlockSize) || !inPlace.open(kSampleRate, kBlockSize)) {
+        fprintf(stderr, "vst3 in-place: failed to create plugin\n");
+        return 1;
+    }
+
+    StereoBlock ref(kBlockSize);
+    StereoBlock shared(kBlockSize);
+    // Host-style in-place processing: output bus points at the input buffers
+    shared.outBus.channelBuffers32 = shared.inPtrs;
+
+    int failures = 0;
+    uint64_t before = violations();
+    for (int b = 0; b < 16 && !failures; b++) {
+        fillNoise(ref.in[0], 10 + b);
+        fillNoise(ref.in[1], 100 + b);
+        shared.in[0] = ref.in[0];
+        shared.in[1] = ref.in[1];
+        reference.processor->process(ref.data);
+        inPlace.processor->process(shared.data);
+        for (int ch = 0; ch < 2; ch++) {
+            if (memcmp(ref.out[ch].data(), shared.in[ch].data(), sizeof(float) * kBlockSize) != 0) {
+                fprintf(stderr, "vst3 in-place: block %d channel %d differs from out-of-place\n", b, ch);
+                failures++;
+            }
+        }
+    }
+    uint64_t found = violations() - before;
+    printf("vst3 in-place: %d failures, %llu violations\n", failures, (unsigned long long)found);
+
+    reference.close();
+    inPlace.close();
+    return failures + (found ? 1 : 0);
+}
+
+static OSStatus noiseInput(void*, AudioUnitRenderActionFlags*, const AudioTimeStamp*, UInt32, UInt32 frames, AudioBufferList* io) {
+    static uint32_t seed = 7;
+    for (UInt32 ch = 0; ch < io->mNumberBuffers; ch++) {
+        float* dst = (float*)io->mBuffers[ch].mData;
+        for (UInt32 i = 0; i < frames; i++) {
+            seed = seed * 1664525u + 1013904223u;
+            dst[i] = ((float)(seed >> 8) / 16777216.0f) * 2.0f - 1.0f;
+        }
+    }
+    return noErr;
+}
+
+typedef OSStatus (*InitializeProc)(void*);
+typedef OSStatus (*SetPropertyProc)(void*, AudioUnitPropertyID, AudioUnitScope, AudioUnitElement, const void*, UInt32);
+typedef OSStatus (*SetParameterProc)(void*, AudioUnitParameterID, AudioUnitScope, AudioUnitElement, AudioUnitParameterValue, UInt32);
+typedef OSStatus (*RenderProc)(void*, AudioUnitRenderActionFlags*, const AudioTimeStamp*, UInt32, UInt32, AudioBufferList*);
+
+static int testAu() {
+    AudioComponentDescription desc = {};
+    AudioComponentPlugInInterface* au = (AudioComponentPlugInInterface*)SonicPluginFactory(&desc);
+    if (!au || au->Open(au, nullptr) != noErr) {
+        fprintf(stderr, "au: failed to open\n");
+        return 1;
+    }
+    InitializeProc initialize = (InitializeProc)au->Lookup(kAudioUnitInitializeSelect);
+    SetPropertyProc setProperty = (SetPropertyProc)au->Lookup(kAudioUnitSetPropertySelect);
+    SetParameterProc setParameter = (SetParameterProc)au->Lookup(kAudioUnitSetParameterSelect);
+    RenderProc render = (RenderProc)au->Lookup(kAudioUnitRenderSelect);
+
+    UInt32 maxFrames = kBlockSize;
+    setProperty(au, kAudioUnitProperty_MaximumFramesPerSlice, kAudioUnitScope_Global, 0, &maxFrames, sizeof(maxFrames));
+    AURenderCallbackStruct input = { noiseInput, nullptr };
+    setProperty(au, kAudioUnitProperty_SetRenderCallback, kAudioUnitScope_Input, 0, &input, sizeof(input));
+    if (initialize(au) != noErr) {
+        fprintf(stderr, "au: Initialize failed\n");
+        return 1;
+    }
+
+    std::vector<float> out[2] = { std::vector<float>(kBlockSize), std::vector<float>(kBlockSize) };
+    std::vector<unsigned char> listStorage(sizeof(AudioBufferList) + sizeof(AudioBuffer));
+    AudioBufferList* list = (AudioBufferList*)listStorage.data();
+    AudioTimeStamp ts = {};
+
+    int failures = 0;
+    uint64_t before = violations();
+    for (int b = 0; b < kBlocks; b++) {
+        list->mNumberBuffers = 2;
+        for (int ch = 0; ch < 2; ch++) {
+            list->mBuffers[ch].mNumberChannels = 1;
+            list->mBuffers[ch].mDataByteSize = kBlockSize * sizeof(float);
+            // Every other block asks the AU to render into its own buffers
+            list->mBuffers[ch].mData = (b % 2) ? nullptr : out[ch].data();
+        }
+        if (b % 5 == 0) setParameter(au, b % 16, kAudioUnitScope_Global, 0, (float)(b % 10) / 10.0f, 0);
+        AudioUnitRenderActionFlags flags = 0;
+        ts.mSampleTime = (Float64)b * kBlockSize;
+        if (render(au, &flags, &ts, 0, kBlockSize, list) != noErr) failures++;
+    }
+    AudioUnitRenderActionFlags flags = 0;
+    if (render(au, &flags, &ts, 0, kBlockSize + 1, list) != kAudioUnitErr_TooManyFramesToProcess) {
+        fprintf(stderr, "au: oversized slice was not rejected\n");
+        failures++;
+    }
+    uint64_t found = violations() - before;
+    printf("au: %d blocks, %d failures, %llu violations\n", kBlocks, failures, (unsigned long long)found);
+
+    au->Close(au);
+    return failures + (found ? 1 : 0);
+}
+
+int main() {
+    sonic_rt_guard_set_abort(0);
+    int failures = testControl() + testVst3() + testVst3InPlace() + testAu();
+    if (failures) {
+        fprintf(stderr, "rt_safety_test: FAILED\n");
+        return 1;
+    }
+    printf("rt_safety_test: ok\n");
+    return 0;
+}
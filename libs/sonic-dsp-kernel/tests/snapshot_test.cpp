@@ -0,0 +1,213 @@
+// Snapshot/restore test, over every class in the library and a module
+// chain with three modules loaded.
+//
+// Each instance gets distinct parameter values (its stepped settings,
+// oversampling included, one step up), runs noise for a while and is
+// snapshotted. It then runs on for kCompareBlocks, has a parameter moved
+// and is restored: fed the same input again, it must give the same output
+// bit for bit and read the old parameter back. A snapshot from another
+// instance of the class, a truncated one, one from before a prepare and a
+// buffer below plugin_snapshot_size must all be refused, the first three
+// without touching the instance.
+//
+// Every class is checked twice: as a wrapper opens it for realtime use,
+// and as an offline render does, with worker threads and long blocks so
+// spectral classes prepare batch buffers. The second pass also creates
+// the instance at another rate than it is prepared at, so prepare has to
+// move it to a bigger block first.
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+extern "C" {
+    uint32_t plugin_class_count();
+    const char* plugin_class_id(uint32_t index);
+    uint32_t plugin_class_param_count(uint32_t index);
+    uint32_t plugin_class_param_steps(uint32_t index, int32_t param);
+    void* plugin_create_class(uint32_t index, float sample_rate);
+    int32_t plugin_prepare(void* instance, float sample_rate, size_t max_block);
+    void plugin_set_worker_threads(void* instance, uint32_t threads);
+    void plugin_process(void* instance, const float* const* inputs, float** outputs, size_t frames);
+    void plugin_set_parameter(void* instance, int32_t index, float value);
+    float plugin_get_parameter(void* instance, int32_t index);
+    void plugin_destroy(void* instance);
+    size_t plugin_snapshot_size(void* instance);
+    size_t plugin_snapshot(void* instance, uint8_t* out, size_t capacity);
+    int32_t plugin_restore(void* instance, const uint8_t* data, size_t len);
+}
+
+static const float kSampleRate = 48000.0f;
+static const int kRunBlocks = 200;
+static const int kCompareBlocks = 100;
+// The wrapper's parameter limit
+static const uint32_t kMaxParams = 256;
+// Modules the chain gets in its first three slots
+static const char* const kChainModules[] = { "soniccompressor", "sonicdenoise", "sonicfeedbackdelay" };
+
+struct Pass {
+    const char* name;
+    float createRate;
+    uint32_t threads;
+    size_t block;
+};
+static const Pass kPasses[] = {
+    { "realtime", kSampleRate, 1, 512 },
+    { "offline", 44100.0f, 4, 4096 },
+};
+
+struct Stereo {
+    explicit Stereo(size_t block) : block(block) {}
+    size_t block;
+    std::vector<float> in[2] = { std::vector<float>(block), std::vector<float>(block) };
+    std::vector<float> out[2] = { std::vector<float>(block), std::vector<float>(block) };
+    const float* inPtrs[2] = { in[0].data(), in[1].data() };
+    float* outPtrs[2] = { out[0].data(), out[1].data() };
+};
+
+static void fillNoise(std::vector<float>& buf, uint32_t seed) {
+    for (float& s : buf) {
+        seed = seed * 1664525u + 1013904223u;
+        s = ((float)(seed >> 8) / 16777216.0f) * 0.5f - 0.25f;
+    }
+}
+
+static int32_t findClass(const char* id) {
+    for (uint32_t c = 0; c < plugin_class_count(); c++) {
+        if (strcmp(plugin_class_id(c), id) == 0) return (int32_t)c;
+    }
+    return -1;
+}
+
+// Continuous parameters spread over 0.2..0.8, stepped ones at their first
+// step above 0; a chain's selectors pick kChainModules instead
+static void setParams(void* instance, uint32_t index) {
+    const bool chain = strcmp(plugin_class_id(index), "sonicchain") == 0;
+    const uint32_t params = std::min(plugin_class_param_count(index), kMaxParams);
+    for (uint32_t p = 0; p < params; p++) {
+        const uint32_t steps = plugin_class_param_steps(index, (int32_t)p);
+        float value = 0.2f + 0.6f * (float)((p * 7) % 11) / 10.0f;
+        if (steps) value = 1.0f / (float)steps;
+        if (chain && steps) {
+            const int32_t module = p < 3 ? findClass(kChainModules[p]) : -1;
+            value = module < 0 ? 0.0f : (float)(module + 1) / (float)steps;
+        }
+        plugin_set_parameter(instance, (int32_t)p, value);
+    }
+}
+
+static void* openClass(uint32_t index, const Pass& pass) {
+    void* instance = plugin_create_class(index, pass.createRate);
+    if (!instance) return nullptr;
+    setParams(instance, index);
+    if (pass.threads > 1) plugin_set_worker_threads(instance, pass.threads);
+    if (plugin_prepare(instance, kSampleRate, pass.block) != 0) {
+        plugin_destroy(instance);
+        return nullptr;
+    }
+    return instance;
+}
+
+// Runs `blocks` blocks of noise from block `first` on, appending the output
+static void run(void* instance, Stereo& io, int first, int blocks, std::vector<float>* out) {
+    for (int b = first; b < first + blocks; b++) {
+        fillNoise(io.in[0], (uint32_t)(2 * b + 1));
+        fillNoise(io.in[1], (uint32_t)(2 * b + 2));
+        plugin_process(instance, io.inPtrs, io.outPtrs, io.block);
+        if (out) {
+            for (int ch = 0; ch < 2; ch++) out->insert(out->end(), io.out[ch].begin(), io.out[ch].end());
+        }
+    }
+}
+
+static std::vector<uint8_t> snapshot(void* instance) {
+    std::vector<uint8_t> bytes(plugin_snapshot_size(instance));
+    if (bytes.empty() || plugin_snapshot(instance, bytes.data(), bytes.size()) != bytes.size()) bytes.clear();
+    return bytes;
+}
+
+static int checkClass(uint32_t index, const Pass& pass) {
+    const char* id = plugin_class_id(index);
+    void* instance = openClass(index, pass);
+    void* other = openClass(index, pass);
+    if (!instance || !other) {
+        fprintf(stderr, "%s (%s): failed to open\n", id, pass.name);
+        if (instance) plugin_destroy(instance);
+        if (other) plugin_destroy(other);
+        return 1;
+    }
+    int failures = 0;
+    Stereo io(pass.block);
+    run(instance, io, 0, kRunBlocks, nullptr);
+    run(other, io, 0, kRunBlocks, nullptr);
+
+    const std::vector<uint8_t> saved = snapshot(instance);
+    if (saved.empty()) {
+        fprintf(stderr, "%s (%s): no snapshot\n", id, pass.name);
+        plugin_destroy(instance);
+        plugin_destroy(other);
+        return 1;
+    }
+    std::vector<uint8_t> small(saved.size() - 1);
+    if (plugin_snapshot(instance, small.data(), small.size()) != 0) {
+        fprintf(stderr, "%s (%s): snapshot written into a short buffer\n", id, pass.name);
+        failures++;
+    }
+
+    std::vector<float> first, second;
+    run(instance, io, kRunBlocks, kCompareBlocks, &first);
+    const float before = plugin_get_parameter(instance, 0);
+    plugin_set_parameter(instance, 0, before < 0.5f ? 0.9f : 0.1f);
+    if (plugin_restore(instance, saved.data(), saved.size()) != 0) {
+        fprintf(stderr, "%s (%s): own snapshot refused\n", id, pass.name);
+        failures++;
+    }
+    if (plugin_get_parameter(instance, 0) != before) {
+        fprintf(stderr, "%s (%s): parameter 0 not restored\n", id, pass.name);
+        failures++;
+    }
+    run(instance, io, kRunBlocks, kCompareBlocks, &second);
+    if (first.size() != second.size() || memcmp(first.data(), second.data(), sizeof(float) * first.size()) != 0) {
+        size_t at = 0;
+        while (at < first.size() && first[at] == second[at]) at++;
+        fprintf(stderr, "%s (%s): restored output differs from sample %zu\n", id, pass.name, at / 2);
+        failures++;
+    }
+
+    // Refusals leave the instance as it was
+    const std::vector<uint8_t> now = snapshot(instance);
+    const std::vector<uint8_t> foreign = snapshot(other);
+    if (plugin_restore(instance, foreign.data(), foreign.size()) == 0) {
+        fprintf(stderr, "%s (%s): another instance's snapshot accepted\n", id, pass.name);
+        failures++;
+    }
+    if (plugin_restore(instance, now.data(), now.size() - 1) == 0) {
+        fprintf(stderr, "%s (%s): truncated snapshot accepted\n", id, pass.name);
+        failures++;
+    }
+    if (snapshot(instance) != now) {
+        fprintf(stderr, "%s (%s): refused snapshot changed the instance\n", id, pass.name);
+        failures++;
+    }
+    plugin_prepare(instance, kSampleRate, pass.block);
+    if (plugin_restore(instance, now.data(), now.size()) == 0) {
+        fprintf(stderr, "%s (%s): snapshot from before prepare accepted\n", id, pass.name);
+        failures++;
+    }
+
+    printf("%-24s %-9s %9zu bytes  %s\n", id, pass.name, saved.size(), failures ? "FAILED" : "ok");
+    plugin_destroy(instance);
+    plugin_destroy(other);
+    return failures;
+}
+
+int main() {
+    int failures = 0;
+    for (const Pass& pass : kPasses) {
+        for (uint32_t c = 0; c < plugin_class_count(); c++) failures += checkClass(c, pass);
+    }
+    printf("snapshot_test: %s\n", failures ? "FAILED" : "ok");
+    return failures ? 1 : 0;
+}
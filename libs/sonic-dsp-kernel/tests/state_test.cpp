@@ -0,0 +1,232 @@
+// State save/restore test, over every class in the suite.
+//
+// An instance gets distinct parameter values and runs noise with "learn"
+// (parameter 1) on and then off, so the denoiser's noise profile and the
+// spectral match's reference are filled in. Its getState blob must then
+// come back byte for byte from
+//   a fresh instance restored before setupProcessing (the usual session
+//   load), and
+//   a fresh, active instance restored between blocks, which hands the
+//   state to the audio thread, and
+//   an active instance given its own defaults and then the saved blob
+//   before its next block, where the later state must win.
+// Truncated, corrupted and other-class blobs must be refused without
+// touching the instance, and a restored denoiser must denoise from its
+// first frame exactly like the one that learned the profile. The module
+// chain takes the same pass, with its first parameters picking modules.
+
+#include "bench_host.h"
+#include <cmath>
+#include <cstring>
+
+using namespace bench;
+
+extern "C" {
+    const char* plugin_class_id(uint32_t index);
+    int32_t plugin_class_oversampling_param(uint32_t index);
+    uint32_t plugin_class_param_count(uint32_t index);
+}
+
+static const double kSampleRate = 48000.0;
+static const int32 kBlockSize = 1024;
+static const int kLearnBlocks = 40;
+static const int kCompareBlocks = 40;
+// Blocks after which a restored STFT has only seen the new input
+static const int kSettleBlocks = 8;
+// Saved blob layout (c_export.zig): 16-byte header with the parameter
+// count at byte 6, the parameters, then learned state. Read in host byte
+// order, so little-endian hosts only.
+static const size_t kStateHeader = 16;
+
+static int32 savedParams(const MemoryStream& s) {
+    uint16 count = 0;
+    if (s.bytes.size() >= kStateHeader) memcpy(&count, s.bytes.data() + 6, 2);
+    return count;
+}
+
+static IEditController* controllerOf(Plugin& plugin) {
+    void* obj = nullptr;
+    if (plugin.component->queryInterface(IEditController::iid, &obj) != kResultOk) return nullptr;
+    return (IEditController*)obj;
+}
+
+// Created through the factory but not set up, as a host does before
+// restoring a session
+static IComponent* createBare(int32 classIndex) {
+    IPluginFactory* factory = GetPluginFactory();
+    PClassInfo info;
+    void* obj = nullptr;
+    if (factory->getClassInfo(classIndex, &info) != kResultOk) return nullptr;
+    if (factory->createInstance(info.cid, IComponent::iid, &obj) != kResultOk) return nullptr;
+    return (IComponent*)obj;
+}
+
+static void runNoise(Plugin& plugin, StereoBlock& block, int blocks, uint32_t seed) {
+    for (int b = 0; b < blocks; b++) {
+        fillNoise(block.in[0], seed + 2 * b);
+        fillNoise(block.in[1], seed + 2 * b + 1);
+        for (int ch = 0; ch < 2; ch++) {
+            for (float& s : block.in[ch]) s *= 0.1f;
+        }
+        plugin.processor->process(block.data);
+    }
+}
+
+static bool sameBytes(const MemoryStream& a, const MemoryStream& b) {
+    return a.bytes.size() == b.bytes.size() && memcmp(a.bytes.data(), b.bytes.data(), a.bytes.size()) == 0;
+}
+
+// Same header and learned state byte for byte; parameters may move by a
+// rounding step going through the plugin's plain value and back
+static bool sameState(const MemoryStream& a, const MemoryStream& b) {
+    const int32 params = savedParams(a);
+    if (a.bytes.size() != b.bytes.size() || a.bytes.size() < kStateHeader + 4 * params) return false;
+    if (memcmp(a.bytes.data(), b.bytes.data(), kStateHeader) != 0) return false;
+    for (int32 p = 0; p < params; p++) {
+        float x, y;
+        memcpy(&x, a.bytes.data() + kStateHeader + 4 * p, 4);
+        memcpy(&y, b.bytes.data() + kStateHeader + 4 * p, 4);
+        if (!(fabsf(x - y) <= 1e-6f)) return false;
+    }
+    const size_t learned = kStateHeader + 4 * params;
+    return memcmp(a.bytes.data() + learned, b.bytes.data() + learned, a.bytes.size() - learned) == 0;
+}
+
+// Loading `blob` into a bare instance of classIndex must fail and leave
+// its state as it was
+static int expectRefused(int32 classIndex, const std::vector<uint8>& blob, const char* name, const char* what) {
+    IComponent* component = createBare(classIndex);
+    MemoryStream before, after, in;
+    component->getState(&before);
+    in.bytes = blob;
+    int failures = 0;
+    if (component->setState(&in) == kResultOk) {
+        fprintf(stderr, "state_test: %s: %s blob accepted\n", name, what);
+        failures++;
+    }
+    component->getState(&after);
+    if (!sameBytes(before, after)) {
+        fprintf(stderr, "state_test: %s: refused %s blob changed the instance\n", name, what);
+        failures++;
+    }
+    component->release();
+    return failures;
+}
+
+static int checkClass(int32 classIndex, int32 classCount) {
+    const char* name = plugin_class_id((uint32_t)classIndex);
+    int failures = 0;
+
+    Plugin source;
+    if (!source.open(kSampleRate, kBlockSize, classIndex)) {
+        fprintf(stderr, "state_test: %s: failed to open\n", name);
+        return 1;
+    }
+    IEditController* controller = controllerOf(source);
+    const int32 osParam = plugin_class_oversampling_param((uint32_t)classIndex);
+    const int32 params = (int32)plugin_class_param_count((uint32_t)classIndex);
+    for (int32 p = 0; p < params; p++) {
+        if (p == osParam) continue;
+        controller->setParamNormalized(p, p == 1 ? 1.0 : 0.05 + 0.05 * (p % 16));
+    }
+    StereoBlock block(kBlockSize);
+    runNoise(source, block, kLearnBlocks, 1);
+    controller->setParamNormalized(1, 0.0);
+    runNoise(source, block, 1, 1000);
+
+    MemoryStream saved;
+    if (source.component->getState(&saved) != kResultOk || savedParams(saved) != params) {
+        fprintf(stderr, "state_test: %s: getState failed\n", name);
+        controller->release();
+        source.close();
+        return 1;
+    }
+
+    // Session load: restored before setupProcessing
+    IComponent* bare = createBare(classIndex);
+    saved.rewind();
+    MemoryStream bareOut;
+    if (bare->setState(&saved) != kResultOk || bare->getState(&bareOut) != kResultOk || !sameState(saved, bareOut)) {
+        fprintf(stderr, "state_test: %s: restore before setup did not round-trip\n", name);
+        failures++;
+    }
+    bare->release();
+
+    // Restored into an active instance, applied by the next block
+    Plugin restored;
+    restored.open(kSampleRate, kBlockSize, classIndex);
+    saved.rewind();
+    MemoryStream activeOut;
+    restored.component->setState(&saved);
+    StereoBlock silent(kBlockSize);
+    restored.processor->process(silent.data);
+    restored.component->getState(&activeOut);
+    if (!sameState(saved, activeOut)) {
+        fprintf(stderr, "state_test: %s: restore while active did not round-trip\n", name);
+        failures++;
+    }
+
+    // Two states before the next block: the second replaces the first
+    Plugin twice;
+    twice.open(kSampleRate, kBlockSize, classIndex);
+    MemoryStream defaults, twiceOut;
+    twice.component->getState(&defaults);
+    defaults.rewind();
+    saved.rewind();
+    if (twice.component->setState(&defaults) != kResultOk || twice.component->setState(&saved) != kResultOk) {
+        fprintf(stderr, "state_test: %s: second state while active refused\n", name);
+        failures++;
+    }
+    twice.processor->process(silent.data);
+    twice.component->getState(&twiceOut);
+    if (!sameState(saved, twiceOut)) {
+        fprintf(stderr, "state_test: %s: later state while active did not win\n", name);
+        failures++;
+    }
+    twice.close();
+
+    // The restored denoiser must not re-learn: once both STFTs have only
+    // seen the new input, outputs match
+    if (strcmp(name, "sonicdenoise") == 0) {
+        StereoBlock a(kBlockSize), b(kBlockSize);
+        double maxDiff = 0.0;
+        for (int n = 0; n < kCompareBlocks; n++) {
+            fillNoise(a.in[0], 5000 + n);
+            fillNoise(a.in[1], 9000 + n);
+            for (int ch = 0; ch < 2; ch++) {
+                for (float& s : a.in[ch]) s *= 0.1f;
+                b.in[ch] = a.in[ch];
+            }
+            source.processor->process(a.data);
+            restored.processor->process(b.data);
+            if (n < kSettleBlocks) continue;
+            for (int32 i = 0; i < kBlockSize; i++) maxDiff = std::max(maxDiff, (double)fabsf(a.out[0][i] - b.out[0][i]));
+        }
+        printf("%s: restored vs learned output, max difference %.2e\n", name, maxDiff);
+        if (maxDiff > 1e-5) {
+            fprintf(stderr, "state_test: %s: restored profile does not denoise like the learned one\n", name);
+            failures++;
+        }
+    }
+    restored.close();
+    controller->release();
+    source.close();
+
+    std::vector<uint8> truncated(saved.bytes.begin(), saved.bytes.end() - 1);
+    failures += expectRefused(classIndex, truncated, name, "truncated");
+    std::vector<uint8> corrupted = saved.bytes;
+    corrupted[0] ^= 0xFF;
+    failures += expectRefused(classIndex, corrupted, name, "corrupted");
+    if (classCount > 1) failures += expectRefused((classIndex + 1) % classCount, saved.bytes, name, "other-class");
+
+    printf("%s: %zu bytes%s\n", name, saved.bytes.size(), failures ? " FAILED" : "");
+    return failures;
+}
+
+int main() {
+    const int32 classCount = GetPluginFactory()->countClasses();
+    int failures = 0;
+    for (int32 c = 0; c < classCount; c++) failures += checkClass(c, classCount);
+    printf("state_test: %s\n", failures ? "FAILED" : "ok");
+    return failures ? 1 : 0;
+}
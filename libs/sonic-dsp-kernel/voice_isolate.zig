@@ -6,8 +6,8 @@ var gpa = std.heap.GeneralPurposeAllocator(.{}){};
 const allocator = gpa.allocator();
 
 // --- Constants ---
-const WINDOW_SIZE: usize = 1024; // ~21ms at 48kHz
-const HOP_SIZE: usize = 512;
+pub const WINDOW_SIZE: usize = 1024; // ~21ms at 48kHz
+pub const HOP_SIZE: usize = 512;
 const NUM_BANDS: usize = 22;
 
 // --- GRU / RNN Structures ---
@@ -45,12 +45,12 @@ const GruLayer = struct {
     }
 };
 
-const VoiceIsolateModel = struct {
+pub const VoiceIsolateModel = struct {
     gru: GruLayer,
     // input_features: [NUM_BANDS]f32,
     // rnn_state: [HIDDEN_SIZE]f32,
 
-    fn init() VoiceIsolateModel {
+    pub fn init() VoiceIsolateModel {
         return .{
             .gru = .{ .input_size = NUM_BANDS, .hidden_size = 24 },
         };
@@ -95,29 +95,48 @@ fn compute_band_energy(fft_mag: []f32, bands: []f32) void {
     }
 }
 
-fn apply_band_gains(fft_buf: []math.Complex, bands_gains: []f32) void {
-    const bins_per_band = (fft_buf.len / 2) / NUM_BANDS; // Nyquist is len/2
+fn apply_band_gains(bins: []math.Complex, bands_gains: []f32) void {
+    const bins_per_band = (WINDOW_SIZE / 2) / NUM_BANDS;
 
     // Interpolate gains to bins
-    for (0..fft_buf.len / 2) |k| {
+    for (bins, 0..) |*bin, k| {
         const band_idx = k / bins_per_band;
         const gain = if (band_idx < NUM_BANDS) bands_gains[band_idx] else bands_gains[NUM_BANDS - 1];
 
-        // Apply gain
-        fft_buf[k].re *= gain;
-        fft_buf[k].im *= gain;
-
-        // Symmetry
-        if (k > 0) {
-            fft_buf[fft_buf.len - k].re = fft_buf[k].re;
-            fft_buf[fft_buf.len - k].im = fft_buf[k].im; // Conjugate symmetry: re, -im. Wait, main.zig says -im.
-            // But if we scale both re and im by gain (real scalar), the conjugate property is preserved.
-            // (a + bi) * g = ag + bgi.
-            // Conjugate was (a - bi).
-            // Scaled conjugate is (ag - bgi).
-            // So we just copy.
-        }
+        // Apply gain (a real gain keeps conjugate symmetry)
+        bin.re *= gain;
+        bin.im *= gain;
+    }
+}
+
+/// Masks one frame in place. bins: the frame's spectrum from DC up to at
+/// least bin WINDOW_SIZE/2 - 1 (a real-FFT frame may include Nyquist).
+pub fn mask_frame(model: *VoiceIsolateModel, bins: []math.Complex, amount: f32) void {
+    var magnitudes: [WINDOW_SIZE / 2]f32 = undefined;
+    var band_energies: [NUM_BANDS]f32 = undefined;
+    var band_gains: [NUM_BANDS]f32 = undefined;
+
+    // C. Feature Extraction (Magnitude -> Bands)
+    // We need magnitude for bands, but we work on complex for reconstruction
+    for (&magnitudes, bins[0 .. WINDOW_SIZE / 2]) |*m, bin| {
+        m.* = bin.magnitude();
+    }
+
+    compute_band_energy(&magnitudes, &band_energies);
+
+    // D. Inference (RNN)
+    model.infer(&band_energies, &band_gains);
+
+    // Mix with amount (0.0 = bypass, 1.0 = full effect)
+    // If amount is 0, gain should be 1.0 everywhere.
+    // If amount is 1, gain is band_gains[i].
+    for (band_gains, 0..) |g, i| {
+        const final_gain = 1.0 - amount * (1.0 - g);
+        band_gains[i] = final_gain;
     }
+
+    // E. Apply Mask
+    apply_band_gains(bins, &band_gains);
 }
 
 // --- Main Processing Function ---
@@ -128,6 +147,8 @@ pub fn process_voiceisolate(ptr: [*]f32, len: usize, amount: f32) void {
     // 1. Setup Buffers
     const fft_buf = allocator.alloc(math.Complex, WINDOW_SIZE) catch return;
     defer allocator.free(fft_buf);
+    var plan = math.fftPlan(allocator, WINDOW_SIZE);
+    defer math.deinitFftPlan(&plan, allocator);
 
     const output_buf = allocator.alloc(f32, len) catch return;
     defer allocator.free(output_buf);
@@ -136,17 +157,12 @@ pub fn process_voiceisolate(ptr: [*]f32, len: usize, amount: f32) void {
     const window = allocator.alloc(f32, WINDOW_SIZE) catch return;
     defer allocator.free(window);
 
-    const magnitudes = allocator.alloc(f32, WINDOW_SIZE / 2) catch return;
-    defer allocator.free(magnitudes);
-
     // Hanning Window
     for (window, 0..) |_, idx| {
         window[idx] = 0.5 * (1.0 - std.math.cos(math.TWO_PI * @as(f32, @floatFromInt(idx)) / @as(f32, @floatFromInt(WINDOW_SIZE - 1))));
     }
 
     var model = VoiceIsolateModel.init();
-    var band_energies: [NUM_BANDS]f32 = undefined;
-    var band_gains: [NUM_BANDS]f32 = undefined;
 
     // 2. STFT Loop
     var pos: usize = 0;
@@ -158,32 +174,15 @@ pub fn process_voiceisolate(ptr: [*]f32, len: usize, amount: f32) void {
         }
 
         // B. FFT
-        math.fft_iterative(fft_buf, false);
+        math.fft_iterative(&plan, fft_buf, false);
 
-        // C. Feature Extraction (Magnitude -> Bands)
-        // We need magnitude for bands, but we work on complex for reconstruction
-        for (0..WINDOW_SIZE/2) |k| {
-            magnitudes[k] = fft_buf[k].magnitude();
+        mask_frame(&model, fft_buf[0 .. WINDOW_SIZE / 2], amount);
+        for (1..WINDOW_SIZE / 2) |k| {
+            fft_buf[WINDOW_SIZE - k] = fft_buf[k].conjugate();
         }
 
-        compute_band_energy(magnitudes, &band_energies);
-
-        // D. Inference (RNN)
-        model.infer(&band_energies, &band_gains);
-
-        // Mix with amount (0.0 = bypass, 1.0 = full effect)
-        // If amount is 0, gain should be 1.0 everywhere.
-        // If amount is 1, gain is band_gains[i].
-        for (band_gains, 0..) |g, i| {
-            const final_gain = 1.0 - amount * (1.0 - g);
-            band_gains[i] = final_gain;
-        }
-
-        // E. Apply Mask
-        apply_band_gains(fft_buf, &band_gains);
-
         // F. IFFT
-        math.fft_iterative(fft_buf, true);
+        math.fft_iterative(&plan, fft_buf, true);
 
         // G. Overlap-Add
         for (0..WINDOW_SIZE) |k| {